@@ -42,6 +42,7 @@ SOURCES += $${VAULT_BASE}/source/vtypes/_mac/vtypes_platform.cpp
 OBJECTIVE_SOURCES += $${VAULT_BASE}/source/vtypes/_mac/vtypes_platform_objc.mm
 SOURCES += $${VAULT_BASE}/source/containers/_unix/vinstant_platform.cpp
 SOURCES += $${VAULT_BASE}/source/files/_unix/vfsnode_platform.cpp
+SOURCES += $${VAULT_BASE}/source/files/_unix/vmemorymappedfile_platform.cpp
 HEADERS += $${VAULT_BASE}/source/threads/_unix/vthread_platform.h
 SOURCES += $${VAULT_BASE}/source/threads/_unix/vthread_platform.cpp
 HEADERS += $${VAULT_BASE}/source/sockets/_unix/vsocket_platform.h
@@ -64,6 +65,7 @@ HEADERS += $${VAULT_BASE}/source/vtypes/_unix/vtypes_platform.h
 SOURCES += $${VAULT_BASE}/source/vtypes/_unix/vtypes_platform.cpp
 SOURCES += $${VAULT_BASE}/source/containers/_unix/vinstant_platform.cpp
 SOURCES += $${VAULT_BASE}/source/files/_unix/vfsnode_platform.cpp
+SOURCES += $${VAULT_BASE}/source/files/_unix/vmemorymappedfile_platform.cpp
 HEADERS += $${VAULT_BASE}/source/threads/_unix/vthread_platform.h
 SOURCES += $${VAULT_BASE}/source/threads/_unix/vthread_platform.cpp
 HEADERS += $${VAULT_BASE}/source/sockets/_unix/vsocket_platform.h
@@ -86,6 +88,7 @@ HEADERS += $${VAULT_BASE}/source/vtypes/_win/vtypes_platform.h
 SOURCES += $${VAULT_BASE}/source/vtypes/_win/vtypes_platform.cpp
 SOURCES += $${VAULT_BASE}/source/containers/_win/vinstant_platform.cpp
 SOURCES += $${VAULT_BASE}/source/files/_win/vfsnode_platform.cpp
+SOURCES += $${VAULT_BASE}/source/files/_win/vmemorymappedfile_platform.cpp
 HEADERS += $${VAULT_BASE}/source/threads/_win/vthread_platform.h
 SOURCES += $${VAULT_BASE}/source/threads/_win/vthread_platform.cpp
 HEADERS += $${VAULT_BASE}/source/sockets/_win/vsocket_platform.h
@@ -149,8 +152,12 @@ HEADERS += $${VAULT_BASE}/source/files/vfilewriter.h
 SOURCES += $${VAULT_BASE}/source/files/vfilewriter.cpp
 HEADERS += $${VAULT_BASE}/source/files/vfsnode.h
 SOURCES += $${VAULT_BASE}/source/files/vfsnode.cpp
+HEADERS += $${VAULT_BASE}/source/files/vmemorymappedfile.h
+SOURCES += $${VAULT_BASE}/source/files/vmemorymappedfile.cpp
 HEADERS += $${VAULT_BASE}/source/server/vclientsession.h
 SOURCES += $${VAULT_BASE}/source/server/vclientsession.cpp
+HEADERS += $${VAULT_BASE}/source/server/vdatagramlistenerthread.h
+SOURCES += $${VAULT_BASE}/source/server/vdatagramlistenerthread.cpp
 HEADERS += $${VAULT_BASE}/source/server/vlistenersocket.h
 SOURCES += $${VAULT_BASE}/source/server/vlistenersocket.cpp
 HEADERS += $${VAULT_BASE}/source/server/vlistenerthread.h
@@ -168,6 +175,8 @@ HEADERS += $${VAULT_BASE}/source/server/vmessagequeue.h
 SOURCES += $${VAULT_BASE}/source/server/vmessagequeue.cpp
 HEADERS += $${VAULT_BASE}/source/server/vserver.h
 SOURCES += $${VAULT_BASE}/source/server/vserver.cpp
+HEADERS += $${VAULT_BASE}/source/sockets/vdatagramsocket.h
+SOURCES += $${VAULT_BASE}/source/sockets/vdatagramsocket.cpp
 HEADERS += $${VAULT_BASE}/source/sockets/vsocket.h
 SOURCES += $${VAULT_BASE}/source/sockets/vsocket.cpp
 HEADERS += $${VAULT_BASE}/source/sockets/vsocketfactory.h
@@ -195,16 +204,24 @@ HEADERS += $${VAULT_BASE}/source/threads/vmutex.h
 SOURCES += $${VAULT_BASE}/source/threads/vmutex.cpp
 HEADERS += $${VAULT_BASE}/source/threads/vmutexlocker.h
 SOURCES += $${VAULT_BASE}/source/threads/vmutexlocker.cpp
+HEADERS += $${VAULT_BASE}/source/threads/vrwmutex.h
+SOURCES += $${VAULT_BASE}/source/threads/vrwmutex.cpp
+HEADERS += $${VAULT_BASE}/source/threads/vthreadpool.h
+SOURCES += $${VAULT_BASE}/source/threads/vthreadpool.cpp
 HEADERS += $${VAULT_BASE}/source/threads/vsemaphore.h
 SOURCES += $${VAULT_BASE}/source/threads/vsemaphore.cpp
 HEADERS += $${VAULT_BASE}/source/threads/vthread.h
 SOURCES += $${VAULT_BASE}/source/threads/vthread.cpp
 HEADERS += $${VAULT_BASE}/source/toolbox/vassert.h
 SOURCES += $${VAULT_BASE}/source/toolbox/vassert.cpp
+HEADERS += $${VAULT_BASE}/source/toolbox/vbinarylogappender.h
+SOURCES += $${VAULT_BASE}/source/toolbox/vbinarylogappender.cpp
 HEADERS += $${VAULT_BASE}/source/toolbox/vclassregistry.h
 SOURCES += $${VAULT_BASE}/source/toolbox/vclassregistry.cpp
 HEADERS += $${VAULT_BASE}/source/toolbox/vhex.h
 SOURCES += $${VAULT_BASE}/source/toolbox/vhex.cpp
+HEADERS += $${VAULT_BASE}/source/toolbox/vlogflightrecorder.h
+SOURCES += $${VAULT_BASE}/source/toolbox/vlogflightrecorder.cpp
 HEADERS += $${VAULT_BASE}/source/toolbox/vlogger.h
 SOURCES += $${VAULT_BASE}/source/toolbox/vlogger.cpp
 SOURCES += $${VAULT_BASE}/source/toolbox/vmemorytracker.cpp
@@ -0,0 +1,106 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+/*
+vlogdecode prints the records in files written by VBinaryLogAppender as text.
+
+Usage: vlogdecode [-format <format-spec>] [-timeformat <time-format>] file...
+
+The format spec and time format are the same as an appender's "format-spec" and "time-format"
+settings; by default, the output looks like the default appender's. Files are decoded in the
+order given, so to print a directory of segments in order, list them sorted by name.
+*/
+
+#include "vault.h"
+
+#include "vbinarylogappender.h"
+
+class App {
+    public:
+
+        App(int argc, char** argv);
+        ~App();
+        void run();
+
+        int getResult() { return mResult; }
+
+    private:
+
+        App(const App&); // not copyable
+        App& operator=(const App&); // not assignable
+
+        VStringVector mArgs;
+        int           mResult;
+};
+
+App::App(int argc, char** argv) :
+    mArgs(),
+    mResult(0) {
+    for (int i = 1; i < argc; ++i) // Omit argc[0] which is just the application name, not really an arg to be processed.
+        mArgs.push_back(argv[i]);
+}
+
+App::~App() {
+}
+
+void App::run() {
+    VString formatSpec;
+    VString timeFormat;
+    VStringVector filePaths;
+
+    for (size_t i = 0; i < mArgs.size(); ++i) {
+        if ((mArgs[i] == "-format") && (i + 1 < mArgs.size())) {
+            formatSpec = mArgs[++i];
+        } else if ((mArgs[i] == "-timeformat") && (i + 1 < mArgs.size())) {
+            timeFormat = mArgs[++i];
+        } else {
+            filePaths.push_back(mArgs[i]);
+        }
+    }
+
+    if (filePaths.empty()) {
+        std::cout << "Usage: vlogdecode [-format <format-spec>] [-timeformat <time-format>] file..." << std::endl;
+        mResult = -1;
+        return;
+    }
+
+    VCoutLogAppender output("vlogdecode", VLogAppender::DO_FORMAT_OUTPUT, formatSpec, timeFormat);
+    VBinaryLogDecoder decoder(output);
+
+    for (VStringVector::const_iterator i = filePaths.begin(); i != filePaths.end(); ++i) {
+        try {
+            (void) decoder.decodeFile(VFSNode(*i));
+        } catch (const VException& ex) {
+            std::cout << "ERROR: Failed to decode '" << (*i) << "': " << ex.what() << std::endl;
+            mResult = -1;
+        }
+    }
+}
+
+// static
+int VThread::userMain(int argc, char** argv) {
+    int    result = -1;
+    App    app(argc, argv);
+
+    try {
+        app.run();
+        result = app.getResult();
+    } catch (const VException& ex) {
+        std::cout << "ERROR: Caught VException (" << ex.getError() << "): '" << ex.what() << "'\n";
+    } catch (const std::exception& ex) {
+        std::cout << "ERROR: Caught STL exception: '" << ex.what() << "'\n";
+    }
+
+    VShutdownRegistry::shutdown();
+
+    return result;
+}
+
+int main(int argc, char** argv) {
+    VMainThread mainThread;
+    return mainThread.execute(argc, argv);
+}
@@ -10,6 +10,11 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vexception.h"
 
 #include <sys/time.h>
+#include <time.h>
+
+#ifdef VPLATFORM_MAC
+#include <mach/mach_time.h>
+#endif
 
 /*
 These are the platform-specific implementations of these required
@@ -117,3 +122,20 @@ Vs64 VInstant::_platform_snapshot() {
     return (((Vs64)(tv.tv_sec)) * CONST_S64(1000)) + (Vs64)(tv.tv_usec / 1000);
 }
 
+// static
+Vs64 VDeadline::_platform_monotonicMicroseconds() {
+#ifdef VPLATFORM_MAC
+    static mach_timebase_info_data_t timebase = { 0, 0 };
+    if (timebase.denom == 0) {
+        (void) ::mach_timebase_info(&timebase);
+    }
+
+    // Ticks to nanoseconds is ticks * numer / denom; divide by 1000 last to keep the precision.
+    return static_cast<Vs64>((::mach_absolute_time() * timebase.numer) / (timebase.denom * CONST_U64(1000)));
+#else
+    struct timespec ts;
+    (void) ::clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (static_cast<Vs64>(ts.tv_sec) * CONST_S64(1000000)) + static_cast<Vs64>(ts.tv_nsec / 1000);
+#endif
+}
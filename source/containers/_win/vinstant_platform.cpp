@@ -113,3 +113,18 @@ Vs64 VInstant::_platform_snapshot() {
 
 #endif
 
+// static
+Vs64 VDeadline::_platform_monotonicMicroseconds() {
+    static LARGE_INTEGER frequency = { 0 };
+    if (frequency.QuadPart == 0) {
+        (void) ::QueryPerformanceFrequency(&frequency);
+    }
+
+    LARGE_INTEGER counter;
+    (void) ::QueryPerformanceCounter(&counter);
+
+    // Split into whole seconds and remainder so that the multiplication cannot overflow.
+    Vs64 seconds = counter.QuadPart / frequency.QuadPart;
+    Vs64 remainder = counter.QuadPart % frequency.QuadPart;
+    return (seconds * CONST_S64(1000000)) + ((remainder * CONST_S64(1000000)) / frequency.QuadPart);
+}
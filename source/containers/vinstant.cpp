@@ -355,6 +355,36 @@ VDuration VDuration::_complexAbs(const VDuration& d) {
     return d; // presumably UNSPECIFIED
 }
 
+// VDeadline -----------------------------------------------------------------
+
+VDeadline::VDeadline(const VDuration& timeoutInterval)
+    : mNeverExpires(timeoutInterval == VDuration::POSITIVE_INFINITY())
+    , mExpiryMicroseconds(mNeverExpires ? 0 : VDeadline::monotonicMicroseconds() + (CONST_S64(1000) * timeoutInterval.getDurationMilliseconds()))
+    {
+}
+
+bool VDeadline::hasExpired() const {
+    return (! mNeverExpires) && (VDeadline::monotonicMicroseconds() >= mExpiryMicroseconds);
+}
+
+VDuration VDeadline::getRemaining() const {
+    if (mNeverExpires) {
+        return VDuration::POSITIVE_INFINITY();
+    }
+
+    Vs64 remainingMicroseconds = mExpiryMicroseconds - VDeadline::monotonicMicroseconds();
+    if (remainingMicroseconds <= 0) {
+        return VDuration::ZERO();
+    }
+
+    return VDuration::MILLISECOND() * ((remainingMicroseconds + CONST_S64(999)) / CONST_S64(1000));
+}
+
+// static
+Vs64 VDeadline::monotonicMicroseconds() {
+    return VDeadline::_platform_monotonicMicroseconds();
+}
+
 // VInstantStruct ------------------------------------------------------------
 
 #ifdef VPLATFORM_WIN
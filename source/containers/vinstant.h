@@ -253,6 +253,63 @@ elements are objects, not pointers to objects.
 */
 typedef std::vector<VDuration> VDurationVector;
 
+/**
+VDeadline is a point in time a given duration from when it was constructed, measured
+on the platform's monotonic clock. Unlike VInstant, it is unaffected by changes to the
+wall clock (NTP steps, a user setting the time) and by VInstant's simulated clock
+offset and frozen time, so it is the right thing to use for timeouts: a wait bounded
+by a VDeadline neither returns early nor hangs when the wall clock moves.
+
+Typical use is a wait loop that must tolerate spurious wake-ups:
+
+    VDeadline deadline(5 * VDuration::SECOND());
+    while (! conditionIsMet && ! deadline.hasExpired()) {
+        semaphore.wait(&mutex, deadline.getRemaining());
+    }
+*/
+class VDeadline {
+    public:
+
+        /**
+        Constructs a deadline the specified duration from now.
+        @param  timeoutInterval the duration from now; POSITIVE_INFINITY means the
+                                deadline never expires
+        */
+        explicit VDeadline(const VDuration& timeoutInterval);
+        /** Non-virtual destructor. This class is not intended to be subclassed. */
+        ~VDeadline() {}
+
+        /**
+        Returns true if the deadline has passed.
+        @return obvious
+        */
+        bool hasExpired() const;
+        /**
+        Returns the time left until the deadline, rounded up to the next millisecond
+        so that a non-zero remainder never looks like zero (which VSemaphore::wait()
+        takes to mean "no timeout").
+        @return the remaining time; ZERO if the deadline has passed; POSITIVE_INFINITY
+                if it never expires
+        */
+        VDuration getRemaining() const;
+
+        /**
+        Returns the current value of the monotonic clock, in microseconds from an
+        arbitrary origin (typically system boot). Only differences between values are
+        meaningful, which makes it suitable for measuring short intervals.
+        @return the monotonic clock value
+        */
+        static Vs64 monotonicMicroseconds();
+
+    private:
+
+        /** Returns the platform's monotonic clock value in microseconds. */
+        static Vs64 _platform_monotonicMicroseconds();
+
+        bool    mNeverExpires;          ///< True if constructed with an infinite duration.
+        Vs64    mExpiryMicroseconds;    ///< The monotonic clock value at which the deadline expires.
+};
+
 /**
 This structure is passed to or returned by the core functions to
 describe a calendar structured instant in some implied time zone.
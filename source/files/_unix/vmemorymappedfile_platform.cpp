@@ -0,0 +1,77 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+/** @file */
+
+#include "vmemorymappedfile.h"
+#include "vtypes_internal.h"
+
+#include "vexception.h"
+#include <sys/mman.h>
+
+void VMemoryMappedFile::_platform_open(Vs64 length) {
+    const VString& path = mNode.getPath();
+
+    mFile = VFileSystem::open(path, READWRITE_MODE | O_TRUNC);
+    if (mFile == -1) {
+        throw VException(VSystemError(), VSTRING_FORMAT("VMemoryMappedFile::openReadWrite failed to open '%s'.", path.chars()));
+    }
+
+    /*
+    Allocate the blocks now rather than leaving a sparse file. Otherwise, if the disk fills up,
+    the failure would come as a SIGBUS when we touch an unbacked page rather than as an error here.
+    posix_fallocate returns the error number rather than setting errno.
+    */
+    int result = 0;
+#ifdef __linux__
+    result = ::posix_fallocate(mFile, 0, static_cast<off_t>(length));
+#else
+    result = (::ftruncate(mFile, static_cast<off_t>(length)) == 0) ? 0 : errno;
+#endif
+    if (result != 0) {
+        (void) VFileSystem::close(mFile);
+        mFile = -1;
+        throw VException(VSystemError(result), VSTRING_FORMAT("VMemoryMappedFile::openReadWrite failed to allocate " VSTRING_FORMATTER_S64 " bytes for '%s'.", length, path.chars()));
+    }
+
+    void* buffer = ::mmap(NULL, static_cast<size_t>(length), PROT_READ | PROT_WRITE, MAP_SHARED, mFile, 0);
+    if (buffer == MAP_FAILED) {
+        VSystemError error;
+        (void) VFileSystem::close(mFile);
+        mFile = -1;
+        throw VException(error, VSTRING_FORMAT("VMemoryMappedFile::openReadWrite failed to map '%s'.", path.chars()));
+    }
+
+    mBuffer = static_cast<Vu8*>(buffer);
+    mLength = length;
+}
+
+void VMemoryMappedFile::_platform_close(Vs64 finalLength) {
+    (void) ::munmap(mBuffer, static_cast<size_t>(mLength));
+    mBuffer = NULL;
+    mLength = 0;
+
+    int result = 0;
+    if (finalLength >= 0) {
+        result = ::ftruncate(mFile, static_cast<off_t>(finalLength));
+    }
+
+    VSystemError error;
+    (void) VFileSystem::close(mFile);
+    mFile = -1;
+
+    if (result != 0) {
+        throw VException(error, VSTRING_FORMAT("VMemoryMappedFile::close failed to trim '%s' to " VSTRING_FORMATTER_S64 " bytes.", mNode.getPath().chars(), finalLength));
+    }
+}
+
+void VMemoryMappedFile::_platform_flush(bool waitForCompletion) {
+    if (::msync(mBuffer, static_cast<size_t>(mLength), waitForCompletion ? MS_SYNC : MS_ASYNC) != 0) {
+        throw VException(VSystemError(), VSTRING_FORMAT("VMemoryMappedFile::flush failed for '%s'.", mNode.getPath().chars()));
+    }
+}
+
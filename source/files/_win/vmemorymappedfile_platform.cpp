@@ -0,0 +1,78 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+/** @file */
+
+#include "vmemorymappedfile.h"
+#include "vtypes_internal.h"
+
+#include "vexception.h"
+
+void VMemoryMappedFile::_platform_open(Vs64 length) {
+    const VString& path = mNode.getPath();
+
+    mFile = VFileSystem::open(path, READWRITE_MODE | O_TRUNC);
+    if (mFile == -1) {
+        throw VException(VSystemError(), VSTRING_FORMAT("VMemoryMappedFile::openReadWrite failed to open '%s'.", path.chars()));
+    }
+
+    // Creating a mapping larger than the file extends the file to the mapping size, zero filled.
+    HANDLE fileHandle = reinterpret_cast<HANDLE>(::_get_osfhandle(mFile));
+    HANDLE mapping = ::CreateFileMappingW(fileHandle, NULL, PAGE_READWRITE, static_cast<DWORD>(length >> 32), static_cast<DWORD>(length & CONST_S64(0xFFFFFFFF)), NULL);
+    if (mapping == NULL) {
+        VSystemError error;
+        (void) VFileSystem::close(mFile);
+        mFile = -1;
+        throw VException(error, VSTRING_FORMAT("VMemoryMappedFile::openReadWrite failed to allocate " VSTRING_FORMATTER_S64 " bytes for '%s'.", length, path.chars()));
+    }
+
+    void* buffer = ::MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, static_cast<SIZE_T>(length));
+    if (buffer == NULL) {
+        VSystemError error;
+        (void) ::CloseHandle(mapping);
+        (void) VFileSystem::close(mFile);
+        mFile = -1;
+        throw VException(error, VSTRING_FORMAT("VMemoryMappedFile::openReadWrite failed to map '%s'.", path.chars()));
+    }
+
+    mMapping = mapping;
+    mBuffer = static_cast<Vu8*>(buffer);
+    mLength = length;
+}
+
+void VMemoryMappedFile::_platform_close(Vs64 finalLength) {
+    (void) ::UnmapViewOfFile(mBuffer);
+    (void) ::CloseHandle(static_cast<HANDLE>(mMapping));
+    mMapping = NULL;
+    mBuffer = NULL;
+    mLength = 0;
+
+    // The file can only be trimmed once the mapping is gone.
+    errno_t result = 0;
+    if (finalLength >= 0) {
+        result = ::_chsize_s(mFile, finalLength);
+    }
+
+    (void) VFileSystem::close(mFile);
+    mFile = -1;
+
+    if (result != 0) {
+        throw VException(VSTRING_FORMAT("VMemoryMappedFile::close failed to trim '%s' to " VSTRING_FORMATTER_S64 " bytes: error %d.", mNode.getPath().chars(), finalLength, (int) result));
+    }
+}
+
+void VMemoryMappedFile::_platform_flush(bool waitForCompletion) {
+    BOOL success = ::FlushViewOfFile(mBuffer, 0);
+    if (success && waitForCompletion) {
+        success = ::FlushFileBuffers(reinterpret_cast<HANDLE>(::_get_osfhandle(mFile)));
+    }
+
+    if (! success) {
+        throw VException(VSystemError(), VSTRING_FORMAT("VMemoryMappedFile::flush failed for '%s'.", mNode.getPath().chars()));
+    }
+}
+
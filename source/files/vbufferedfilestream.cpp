@@ -214,3 +214,12 @@ Vs64 VBufferedFileStream::available() const {
     return eofOffset - currentOffset;
 }
 
+int VBufferedFileStream::_getReadFileDescriptor() {
+    if (! this->isOpen()) {
+        return -1;
+    }
+
+    (void) VFileSystem::fflush(mFile);
+    return ::fileno(mFile);
+}
+
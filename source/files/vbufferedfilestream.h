@@ -148,6 +148,17 @@ class VBufferedFileStream : public VAbstractFileStream {
         */
         virtual Vs64 available() const;
 
+    protected:
+
+        /**
+        Returns the file descriptor underlying the FILE, so that streamCopy()
+        can have the kernel transfer file data directly to a socket. Any
+        buffered write data is flushed first so that the descriptor sees the
+        same file contents as the stream.
+        @return    the file descriptor, or -1 if the stream is not open
+        */
+        virtual int _getReadFileDescriptor();
+
     private:
 
         // Prevent copy construction and assignment, since there is no provision for sharing the mFile pointer.
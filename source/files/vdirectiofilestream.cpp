@@ -213,3 +213,7 @@ Vs64 VDirectIOFileStream::available() const {
     return eofOffset - currentOffset;
 }
 
+int VDirectIOFileStream::_getReadFileDescriptor() {
+    return mFile;
+}
+
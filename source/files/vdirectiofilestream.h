@@ -148,6 +148,15 @@ class VDirectIOFileStream : public VAbstractFileStream {
         */
         virtual Vs64 available() const;
 
+    protected:
+
+        /**
+        Returns the file descriptor, so that streamCopy() can have the kernel
+        transfer file data directly to a socket.
+        @return    the file descriptor, or -1 if the stream is not open
+        */
+        virtual int _getReadFileDescriptor();
+
     private:
 
         // Prevent copy construction and assignment, since there is no provision for sharing the mFile pointer.
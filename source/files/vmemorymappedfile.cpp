@@ -0,0 +1,50 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+/** @file */
+
+#include "vmemorymappedfile.h"
+
+#include "vexception.h"
+
+VMemoryMappedFile::VMemoryMappedFile()
+    : mNode()
+    , mFile(-1)
+    , mMapping(NULL)
+    , mBuffer(NULL)
+    , mLength(0)
+    {
+}
+
+VMemoryMappedFile::~VMemoryMappedFile() {
+    try {
+        this->close();
+    } catch (...) {} // Prevent all exceptions from escaping destructor.
+}
+
+void VMemoryMappedFile::openReadWrite(const VFSNode& node, Vs64 length) {
+    if (length <= 0) {
+        throw VRangeException(VSTRING_FORMAT("VMemoryMappedFile::openReadWrite: invalid length " VSTRING_FORMATTER_S64 " for '%s'.", length, node.getPath().chars()));
+    }
+
+    this->close();
+    mNode = node;
+    this->_platform_open(length);
+}
+
+void VMemoryMappedFile::close(Vs64 finalLength) {
+    if (this->isOpen()) {
+        this->_platform_close(finalLength);
+    }
+}
+
+void VMemoryMappedFile::flush(bool waitForCompletion) {
+    if (this->isOpen()) {
+        this->_platform_flush(waitForCompletion);
+    }
+}
+
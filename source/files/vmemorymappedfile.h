@@ -0,0 +1,83 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+#ifndef vmemorymappedfile_h
+#define vmemorymappedfile_h
+
+/** @file */
+
+#include "vfsnode.h"
+
+/**
+    @ingroup vfilesystem
+*/
+
+/**
+VMemoryMappedFile maps a file of a fixed length into memory for writing. The file is
+created (or truncated) and extended to the requested length when it is opened, so the
+space is allocated up front, and the unwritten part of it reads as zeroes. Writing to
+the file is then just writing to the buffer; the operating system writes the changed
+pages to the file in the background, and they survive the process crashing.
+
+When you are done, close() can trim the file to the length you actually used.
+
+The implementation is platform-specific: mmap on Unix and Mac, and a file mapping on Windows.
+*/
+class VMemoryMappedFile {
+    public:
+
+        /**
+        Constructs an object with no file open.
+        */
+        VMemoryMappedFile();
+        /**
+        Destructor, closes the file if it is open, leaving it at its full length.
+        */
+        ~VMemoryMappedFile();
+
+        /**
+        Creates the file, or truncates it if it exists, allocates the specified length, and maps
+        it into memory for reading and writing. Throws a VException if any of that fails.
+        @param  node    the file
+        @param  length  the file length, which is the size of the buffer
+        */
+        void openReadWrite(const VFSNode& node, Vs64 length);
+        /**
+        Unmaps and closes the file, if it is open.
+        @param  finalLength if not negative, the length to trim the file to after unmapping it
+        */
+        void close(Vs64 finalLength = -1);
+        /**
+        Asks the operating system to write changed pages to the file.
+        @param  waitForCompletion   true to return only once the data has been written
+        */
+        void flush(bool waitForCompletion);
+
+        bool isOpen() const { return mBuffer != NULL; }     ///< Returns true if the file is open. @return obvious
+        Vu8* getBuffer() const { return mBuffer; }          ///< Returns the mapped memory, or NULL if not open. @return obvious
+        Vs64 getLength() const { return mLength; }          ///< Returns the length of the mapped memory, or 0 if not open. @return obvious
+        const VFSNode& getNode() const { return mNode; }    ///< Returns the file most recently opened. @return obvious
+
+    private:
+
+        VMemoryMappedFile(const VMemoryMappedFile&); // not copyable
+        VMemoryMappedFile& operator=(const VMemoryMappedFile&); // not assignable
+
+        // These are implemented in the platform-specific code. Each throws a VException on failure.
+        void _platform_open(Vs64 length);           ///< Opens mNode, allocates the length, and maps it; sets mFile, mMapping, mBuffer, mLength.
+        void _platform_close(Vs64 finalLength);     ///< Unmaps and closes, trims if finalLength is not negative; clears mFile, mMapping, mBuffer, mLength.
+        void _platform_flush(bool waitForCompletion);
+
+        VFSNode mNode;      ///< The file.
+        int     mFile;      ///< The open file descriptor, or -1.
+        void*   mMapping;   ///< On Windows, the file mapping object handle; unused on other platforms.
+        Vu8*    mBuffer;    ///< The mapped memory, or NULL.
+        Vs64    mLength;    ///< The length of the mapped memory.
+};
+
+#endif /* vmemorymappedfile_h */
+
@@ -22,7 +22,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 VClientSession::VClientSession(const VString& sessionBaseName, VServer* server, const VString& clientType, VSocket* socket, VMessageInputThread* inputThread, VMessageOutputThread* outputThread, const VDuration& standbyTimeLimit, Vs64 maxQueueDataSize)
     : VEnableSharedFromThis<VClientSession>()
     , mName(sessionBaseName)
-    , mLoggerName(VSTRING_ARGS("vault.messages.VClientSession.%s.%s", sessionBaseName.chars(), VLogger::getCleansedLoggerName(socket->getHostIPAddress()).chars()))
+    , mLoggerName(VSTRING_FORMAT("vault.messages.VClientSession.%s.%s", sessionBaseName.chars(), VLogger::getCleansedLoggerName(socket->getHostIPAddress()).chars()))
     , mMutex(VString::EMPTY()/*name will be set in body*/)
     , mServer(server)
     , mClientType(clientType)
@@ -75,7 +75,7 @@ void VClientSession::initIOThreads() {
 }
 
 void VClientSession::shutdown(VThread* callingThread) {
-    VMutexLocker locker(&mMutex, VSTRING_FORMAT("[%s]VClientSession::shutdown() %s", this->getName().chars(), (callingThread == NULL ? "" : callingThread->getName().chars())));
+    VMutexLocker locker(&mMutex, "VClientSession::shutdown()");
 
     mIsShuttingDown = true;
 
@@ -108,7 +108,7 @@ void VClientSession::shutdown(VThread* callingThread) {
 }
 
 void VClientSession::postOutputMessage(VMessagePtr message, bool isForBroadcast) {
-    VMutexLocker locker(&mMutex, VSTRING_FORMAT("[%s]VClientSession::postOutputMessage()", this->getName().chars())); // protect the mStartupStandbyQueue during queue operations
+    VMutexLocker locker(&mMutex, "VClientSession::postOutputMessage()"); // protect the mStartupStandbyQueue during queue operations
 
     // Don't post if client is doing a disconnect:
     if (mIsShuttingDown || this->isClientGoingOffline()) {
@@ -215,7 +215,7 @@ void VClientSession::_postStandbyMessageToAsyncOutputQueue(VMessagePtr message)
 }
 
 void VClientSession::_releaseQueuedClientMessages() {
-    VMutexLocker locker(&mMutex, VSTRING_FORMAT("[%s]VClientSession::_releaseQueuedClientMessages()", this->getName().chars())); // protect the mStartupStandbyQueue during queue operations
+    VMutexLocker locker(&mMutex, "VClientSession::_releaseQueuedClientMessages()"); // protect the mStartupStandbyQueue during queue operations
 
     // Order probably does not matter, but it makes sense to pop them in the order they would have been sent.
 
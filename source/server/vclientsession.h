@@ -16,6 +16,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vmessagequeue.h"
 #include "vsocketstream.h"
 #include "vbinaryiostream.h"
+#include "vlogger.h"
 
 /**
     @ingroup vsocket
@@ -166,7 +167,7 @@ class VClientSession : public VEnableSharedFromThis<VClientSession> {
         virtual void _postStandbyMessageToAsyncOutputQueue(VMessagePtr message);
 
         VString                 mName;          ///< A name for the session to use in logging; built from supplied base name + IP address + port.
-        VString                 mLoggerName;    ///< The logger name which we will use when emitting log output.
+        VNamedLoggerHandle      mLoggerName;    ///< The logger name which we will use when emitting log output.
         VMutex                  mMutex;         ///< A mutex we use to enforce sequential processing of outbound messages, and to protect our task list.
         VServer*                mServer;        ///< The server that keeps track of this session.
         VString                 mClientType;    ///< A string distinguishing this type of session.
@@ -0,0 +1,148 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+/** @file */
+
+#include "vdatagramlistenerthread.h"
+#include "vtypes_internal.h"
+
+#include "vmanagementinterface.h"
+#include "vexception.h"
+#include "vmutexlocker.h"
+#include "vlogger.h"
+
+VDatagramListenerThread::VDatagramListenerThread(const VString& threadBaseName, bool deleteSelfAtEnd, bool createDetached, VManagementInterface* manager, int portNumber, const VString& bindAddress, int maxDatagramSize, int batchSize, bool initiallyListening)
+    : VThread(threadBaseName, VSTRING_FORMAT("vault.messages.VDatagramListenerThread.%s.%d", threadBaseName.chars(), portNumber), deleteSelfAtEnd, createDetached, manager)
+    , mPortNumber(portNumber)
+    , mBindAddress(bindAddress)
+    , mMaxDatagramSize(maxDatagramSize)
+    , mBatchSize(batchSize)
+    , mShouldListen(initiallyListening)
+    , mSocket(NULL)
+    , mSocketMutex(VSTRING_FORMAT("VDatagramListenerThread(%s)::mSocketMutex", threadBaseName.chars()))
+    , mLastStatisticsSampleTime()
+    {
+}
+
+VDatagramListenerThread::~VDatagramListenerThread() {
+    VLOGGER_NAMED_DEBUG(mLoggerName, VSTRING_FORMAT("VDatagramListenerThread '%s' ended.", mName.chars()));
+}
+
+void VDatagramListenerThread::stop() {
+    this->stopListening();
+
+    VThread::stop();
+}
+
+void VDatagramListenerThread::run() {
+    while (this->isRunning()) {
+        if (mShouldListen) {
+            this->_runListening();
+        } else {
+            VThread::sleep(VDuration::SECOND()); // this value limits how quickly we can be shut down
+        }
+    }
+}
+
+int VDatagramListenerThread::getPortNumber() const {
+    return mPortNumber;
+}
+
+VSocketInfoVector VDatagramListenerThread::enumerateActiveSockets() {
+    VSocketInfoVector   info;
+    VMutexLocker        locker(&mSocketMutex, "VDatagramListenerThread::enumerateActiveSockets()");
+
+    if (mSocket != NULL) {
+        info.push_back(VSocketInfo(*mSocket));
+    }
+
+    return info;
+}
+
+void VDatagramListenerThread::_runListening() {
+    VDatagramSocket* socket = NULL;
+
+    if (mManager != NULL) {
+        mManager->datagramListenerStarting(this);
+    }
+
+    VString exceptionMessage; // filled in if catch block entered
+    try {
+        socket = new VDatagramSocket(mMaxDatagramSize, mBatchSize);
+
+        // As with VListenerSocket, receives must time out so that we get a chance to check isRunning().
+        struct timeval timeout;
+        timeout.tv_sec = 1;
+        timeout.tv_usec = 0;
+        socket->setReadTimeOut(timeout);
+
+        socket->bind(mBindAddress, mPortNumber);
+        mPortNumber = socket->getLocalPortNumber();
+
+        /* scope */ {
+            VMutexLocker locker(&mSocketMutex, "VDatagramListenerThread::_runListening()");
+            mSocket = socket;
+        }
+
+        if (mManager != NULL) {
+            mManager->datagramListenerListening(this);
+        }
+
+        while (mShouldListen && this->isRunning()) {
+            int numDatagrams = socket->receiveBatch();
+
+            if (numDatagrams != 0) {
+                try {
+                    this->handleDatagrams(*socket, numDatagrams);
+                } catch (const VException& ex) {
+                    // A bad datagram or failed reply should not take down the listener. Log, but keep listening.
+                    VLOGGER_NAMED_ERROR(mLoggerName, VSTRING_FORMAT("[%s]VDatagramListenerThread::_runListening: Error handling %d datagrams: Error %d. %s", this->getName().chars(), numDatagrams, ex.getError(), ex.what()));
+                } catch (const std::exception& ex) {
+                    VLOGGER_NAMED_ERROR(mLoggerName, VSTRING_FORMAT("[%s]VDatagramListenerThread::_runListening: Error handling %d datagrams: %s", this->getName().chars(), numDatagrams, ex.what()));
+                } catch (...) {
+                    VLOGGER_NAMED_ERROR(mLoggerName, VSTRING_FORMAT("[%s]VDatagramListenerThread::_runListening: Unknown error handling %d datagrams.", this->getName().chars(), numDatagrams));
+                }
+            } else {
+                /*
+                We timed out, which is normal since we have a timeout value.
+                As long as we haven't been stopped, we'll try again.
+                */
+            }
+
+            VInstant now;
+            if ((now - mLastStatisticsSampleTime).getDurationMilliseconds() >= VSocket::kStatisticsSampleIntervalMilliseconds) {
+                socket->sampleStatistics();
+                mLastStatisticsSampleTime = now;
+            }
+        }
+    } catch (const VException& ex) {
+        exceptionMessage.format("[%s]VDatagramListenerThread::_runListening() caught exception #%d '%s'.", mName.chars(), ex.getError(), ex.what());
+    } catch (const std::exception& ex) {
+        exceptionMessage.format("[%s]VDatagramListenerThread::_runListening() caught exception '%s'.", mName.chars(), ex.what());
+    } catch (...) {
+        exceptionMessage.format("[%s]VDatagramListenerThread::_runListening() caught unknown exception.", mName.chars());
+    }
+
+    if (exceptionMessage.isNotEmpty()) {
+        mShouldListen = false;
+        VLOGGER_NAMED_ERROR(mLoggerName, exceptionMessage);
+        if (mManager != NULL) {
+            mManager->datagramListenerFailed(this, exceptionMessage);
+        }
+    }
+
+    /* scope */ {
+        VMutexLocker locker(&mSocketMutex, "VDatagramListenerThread::_runListening()");
+        mSocket = NULL;
+    }
+
+    delete socket;
+
+    if (mManager != NULL) {
+        mManager->datagramListenerEnded(this);
+    }
+}
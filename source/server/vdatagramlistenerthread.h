@@ -0,0 +1,133 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+#ifndef vdatagramlistenerthread_h
+#define vdatagramlistenerthread_h
+
+/** @file */
+
+#include "vthread.h"
+#include "vdatagramsocket.h"
+
+/**
+    @ingroup vsocket vthread
+*/
+
+/**
+A VDatagramListenerThread is the UDP counterpart of VListenerThread. There are
+no connections to accept, so rather than creating a thread per connection, it
+binds one VDatagramSocket and loops receiving batches of datagrams on it,
+handing each batch to handleDatagrams() on this same thread.
+
+To implement a datagram listener, subclass VDatagramListenerThread and override
+handleDatagrams(). Your override can reply to senders by calling sendBatch() on
+the socket it is given. When you want to shut down the listener, call its stop()
+method; it notices within the socket's read timeout.
+
+The VManagementInterface, if supplied, is notified of the listener's lifecycle
+via its datagramListenerXXX() notifications, in addition to the usual thread
+notifications.
+*/
+class VDatagramListenerThread : public VThread {
+    public:
+
+        /**
+        Constructs the listener thread to listen on a specified port.
+        @param  threadBaseName      a distinguishing base name for the thread, useful for debugging purposes
+        @param  deleteSelfAtEnd     @see VThread
+        @param  createDetached      @see VThread
+        @param  manager             the object that receives notifications for this thread, or NULL
+        @param  portNumber          the port number to listen on; 0 lets the OS choose, in which case
+                                        getPortNumber() returns the chosen port once listening
+        @param  bindAddress         if empty, the socket will bind to INADDR_ANY (usually a good
+                                    default); if a value is supplied the socket will bind to the
+                                    supplied IP address (can be useful on a multi-homed server)
+        @param  maxDatagramSize     @see VDatagramSocket
+        @param  batchSize           @see VDatagramSocket
+        @param  initiallyListening  true if the thread should be listening when it first starts;
+                                        false means it won't listen until you call startListening()
+        */
+        VDatagramListenerThread(const VString& threadBaseName, bool deleteSelfAtEnd, bool createDetached, VManagementInterface* manager, int portNumber, const VString& bindAddress, int maxDatagramSize = VDatagramSocket::kDefaultMaxDatagramSize, int batchSize = VDatagramSocket::kDefaultBatchSize, bool initiallyListening = true);
+        /**
+        Destructor.
+        */
+        virtual ~VDatagramListenerThread();
+
+        /**
+        Stops the thread; for VDatagramListenerThread this also stops listening.
+        */
+        virtual void stop();
+        /**
+        Run method, binds the socket and then goes into a loop that receives
+        datagrams until the thread has been externally stopped.
+        */
+        virtual void run();
+
+        /**
+        Returns the port number we're listening on.
+        @return    the port number
+        */
+        int getPortNumber() const;
+
+        /**
+        Returns a snapshot of information about this listener's socket, if
+        it is currently listening; otherwise returns an empty vector. As with
+        VListenerThread, the socket's statistics are sampled on a fixed
+        interval by our run loop, not by this call.
+        */
+        VSocketInfoVector enumerateActiveSockets();
+
+        /**
+        Sets the thread to listen if it isn't already; @see VListenerThread.
+        */
+        void startListening() { mShouldListen = true; }
+        /**
+        Sets the thread to stop listening if it's currently listening; @see VListenerThread.
+        */
+        void stopListening() { mShouldListen = false; }
+        /**
+        Returns true if the thread is in listening mode; @see VListenerThread.
+        */
+        bool isListening() const { return mShouldListen; }
+
+    protected:
+
+        /**
+        Override this to process each batch of received datagrams. The
+        datagrams are socket.getReceivedDatagram(0) through
+        socket.getReceivedDatagram(numDatagrams - 1); they are only valid
+        until this method returns. An exception thrown from here is logged
+        and does not stop the listener.
+        @param  socket          the listener's socket, which you may use to reply
+        @param  numDatagrams    the number of datagrams received, at least 1
+        */
+        virtual void handleDatagrams(VDatagramSocket& socket, int numDatagrams) = 0;
+
+    private:
+
+        // Prevent copy construction and assignment since there is no provision for sharing the underlying thread
+        // or the socket.
+        VDatagramListenerThread(const VDatagramListenerThread& other);
+        VDatagramListenerThread& operator=(const VDatagramListenerThread& other);
+
+        /**
+        Performs the run() loop operations needed when we should be listening.
+        */
+        void _runListening();
+
+        int                 mPortNumber;        ///< The port number we are listening on.
+        VString             mBindAddress;       ///< The address to bind to (INADDR_ANY is used if the address is empty)
+        int                 mMaxDatagramSize;   ///< The socket's receive buffer size.
+        int                 mBatchSize;         ///< The socket's batch size.
+        volatile bool       mShouldListen;      ///< True if we should be listening; false if we should not. Controls run loops.
+        VDatagramSocket*    mSocket;            ///< The socket while we are listening, else NULL.
+        VMutex              mSocketMutex;       ///< Mutex to protect mSocket for enumerateActiveSockets().
+        VInstant            mLastStatisticsSampleTime; ///< When the run loop last sampled mSocket's statistics.
+
+};
+
+#endif /* vdatagramlistenerthread_h */
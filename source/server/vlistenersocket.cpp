@@ -35,7 +35,29 @@ VListenerSocket::VListenerSocket(int portNumber, const VString& bindAddress, VSo
     VListenerSocket::setReadTimeOut(timeout);
 }
 
+VListenerSocket::VListenerSocket(const VString& localPath, VSocketFactory* factory, int backlog)
+    : VSocket()
+    , mBindAddress()
+    , mBacklog(backlog)
+    , mFactory(factory)
+    {
+    this->setLocalPath(localPath);
+
+    // See above for the reason for the timeout.
+    struct timeval timeout;
+
+    timeout.tv_sec = 5;
+    timeout.tv_usec = 0;
+
+    VListenerSocket::setReadTimeOut(timeout);
+}
+
 VListenerSocket::~VListenerSocket() {
+    // Unlike a port, the socket file outlives the socket, so clean it up if we created it.
+    if (this->isLocal() && (mSocketID != kNoSocketID)) {
+        this->close();
+        (void) VFileSystem::unlink(mLocalPath);
+    }
 }
 
 VSocket* VListenerSocket::accept() {
@@ -43,11 +65,11 @@ VSocket* VListenerSocket::accept() {
         throw VStackTraceException("VListenerSocket::accept called before socket is listening.");
     }
 
-    struct sockaddr_in  clientaddr;
-    VSocklenT           clientaddrLength = sizeof(clientaddr);
-    VSocketID           handlerSockID = kNoSocketID;
-    VSocket*            handlerSocket = NULL;
-    bool                shouldAccept = true;
+    struct sockaddr_storage clientaddr; // large enough for any address family
+    VSocklenT               clientaddrLength = sizeof(clientaddr);
+    VSocketID               handlerSockID = kNoSocketID;
+    VSocket*                handlerSocket = NULL;
+    bool                    shouldAccept = true;
 
     if (mReadTimeOutActive) {
         /* then we need to do a select call */
@@ -83,6 +105,10 @@ VSocket* VListenerSocket::accept() {
 }
 
 void VListenerSocket::listen() {
-    this->_listen(mBindAddress, mBacklog);
+    if (this->isLocal()) {
+        this->_listenLocal(mBacklog);
+    } else {
+        this->_listen(mBindAddress, mBacklog);
+    }
 }
 
@@ -51,6 +51,16 @@ class VListenerSocket : public VSocket {
         */
         VListenerSocket(int portNumber, const VString& bindAddress, VSocketFactory* factory, int backlog = 50);
         /**
+        Creates a VListenerSocket to listen on a Unix domain socket at a
+        particular path, for connections from other processes on this machine.
+        The socket file is created by listen() and removed upon destruction.
+        @param    localPath     the file system path to listen on
+        @param    factory        a factory that will create a VSocket-derived
+                            object for each incoming connection
+        @param    backlog        the listen backlog for the socket
+        */
+        VListenerSocket(const VString& localPath, VSocketFactory* factory, int backlog = 50);
+        /**
         Destructor.
         */
         virtual ~VListenerSocket();
@@ -25,12 +25,35 @@ VListenerThread::VListenerThread(const VString& threadBaseName, bool deleteSelfA
     : VThread(threadBaseName, VSTRING_FORMAT("vault.messages.VListenerThread.%s.%d", threadBaseName.chars(), portNumber), deleteSelfAtEnd, createDetached, manager)
     , mPortNumber(portNumber)
     , mBindAddress(bindAddress)
+    , mLocalPath()
     , mShouldListen(initiallyListening)
     , mSocketFactory(socketFactory)
     , mThreadFactory(threadFactory)
     , mSessionFactory(sessionFactory)
     , mSocketThreads()
     , mSocketThreadsMutex(VSTRING_FORMAT("VListenerThread(%s)::mSocketThreadsMutex", threadBaseName.chars()))
+    , mSocketThreadEnded()
+    , mDraining(false)
+    , mSocketThreadOptions()
+    , mLastStatisticsSampleTime()
+    {
+}
+
+VListenerThread::VListenerThread(const VString& threadBaseName, bool deleteSelfAtEnd, bool createDetached, VManagementInterface* manager, const VString& localPath, VSocketFactory* socketFactory, VSocketThreadFactory* threadFactory, VClientSessionFactory* sessionFactory, bool initiallyListening)
+    : VThread(threadBaseName, VSTRING_FORMAT("vault.messages.VListenerThread.%s.%s", threadBaseName.chars(), VLogger::getCleansedLoggerName(localPath).chars()), deleteSelfAtEnd, createDetached, manager)
+    , mPortNumber(0)
+    , mBindAddress()
+    , mLocalPath(localPath)
+    , mShouldListen(initiallyListening)
+    , mSocketFactory(socketFactory)
+    , mThreadFactory(threadFactory)
+    , mSessionFactory(sessionFactory)
+    , mSocketThreads()
+    , mSocketThreadsMutex(VSTRING_FORMAT("VListenerThread(%s)::mSocketThreadsMutex", threadBaseName.chars()))
+    , mSocketThreadEnded()
+    , mDraining(false)
+    , mSocketThreadOptions()
+    , mLastStatisticsSampleTime()
     {
 }
 
@@ -38,7 +61,7 @@ VListenerThread::~VListenerThread() {
     VLOGGER_NAMED_DEBUG(mLoggerName, VSTRING_FORMAT("VListenerThread '%s' ended.", mName.chars()));
 
     // Make sure any of socket threads still alive no longer reference us.
-    VMutexLocker locker(&mSocketThreadsMutex, VSTRING_FORMAT("[%s]VListenerThread::socketThreadEnded()", this->getName().chars()));
+    VMutexLocker locker(&mSocketThreadsMutex, "VListenerThread::socketThreadEnded()");
     for (VSocketThreadPtrVector::const_iterator i = mSocketThreads.begin(); i != mSocketThreads.end(); ++i) {
         (*i)->mOwnerThread = NULL;
     }
@@ -62,13 +85,14 @@ void VListenerThread::run() {
 }
 
 void VListenerThread::socketThreadEnded(VSocketThread* socketThread) {
-    VMutexLocker                        locker(&mSocketThreadsMutex, VSTRING_FORMAT("[%s]VListenerThread::socketThreadEnded()", this->getName().chars()));
+    VMutexLocker                        locker(&mSocketThreadsMutex, "VListenerThread::socketThreadEnded()");
     VSocketThreadPtrVector::iterator    position;
 
     position = std::find(mSocketThreads.begin(), mSocketThreads.end(), socketThread);
 
     if (position != mSocketThreads.end()) {
         mSocketThreads.erase(position);
+        mSocketThreadEnded.signal();
     }
 }
 
@@ -78,7 +102,7 @@ int VListenerThread::getPortNumber() const {
 
 VSocketInfoVector VListenerThread::enumerateActiveSockets() {
     VSocketInfoVector   info;
-    VMutexLocker        locker(&mSocketThreadsMutex, VSTRING_FORMAT("[%s]VListenerThread::enumerateActiveSockets()", this->getName().chars()));
+    VMutexLocker        locker(&mSocketThreadsMutex, "VListenerThread::enumerateActiveSockets()");
 
     for (VSizeType i = 0; i < mSocketThreads.size(); ++i) {
         VSocketInfo oneSocketInfo(*(mSocketThreads[i]->getSocket()));
@@ -91,7 +115,7 @@ VSocketInfoVector VListenerThread::enumerateActiveSockets() {
 
 void VListenerThread::stopSocketThread(VSocketID socketID, int localPortNumber) {
     bool            found = false;
-    VMutexLocker    locker(&mSocketThreadsMutex, VSTRING_FORMAT("[%s]VListenerThread::stopSocketThread()", this->getName().chars()));
+    VMutexLocker    locker(&mSocketThreadsMutex, "VListenerThread::stopSocketThread()");
 
     for (VSizeType i = 0; i < mSocketThreads.size(); ++i) {
         VSocketThread*  thread = mSocketThreads[i];
@@ -110,7 +134,7 @@ void VListenerThread::stopSocketThread(VSocketID socketID, int localPortNumber)
 }
 
 void VListenerThread::stopAllSocketThreads() {
-    VMutexLocker locker(&mSocketThreadsMutex, VSTRING_FORMAT("[%s]VListenerThread::stopAllSocketThreads()", this->getName().chars()));
+    VMutexLocker locker(&mSocketThreadsMutex, "VListenerThread::stopAllSocketThreads()");
 
     for (VSizeType i = 0; i < mSocketThreads.size(); ++i) {
         VSocketThread* thread = mSocketThreads[i];
@@ -119,6 +143,102 @@ void VListenerThread::stopAllSocketThreads() {
     }
 }
 
+bool VListenerThread::drainAndStop(const VDuration& drainTimeout) {
+    VDeadline   deadline(drainTimeout);
+    int         numRemaining = 0;
+
+    /* locker scope */ {
+        VMutexLocker locker(&mSocketThreadsMutex, "VListenerThread::drainAndStop() start");
+        mDraining = true;
+    }
+
+    this->stopListening();
+
+    /* locker scope */ {
+        VMutexLocker locker(&mSocketThreadsMutex, "VListenerThread::drainAndStop() start");
+
+        numRemaining = static_cast<int>(mSocketThreads.size());
+        for (VSizeType i = 0; i < mSocketThreads.size(); ++i) {
+            mSocketThreads[i]->stopWhenIdle();
+        }
+    }
+
+    VLOGGER_NAMED_INFO(mLoggerName, VSTRING_FORMAT("[%s] VListenerThread::drainAndStop: Draining %d socket threads for up to %s.", mName.chars(), numRemaining, drainTimeout.getDurationString().chars()));
+    if (mManager != NULL) {
+        mManager->listenerDrainStarted(this, numRemaining);
+    }
+
+    while ((numRemaining > 0) && ! deadline.hasExpired()) {
+        /* locker scope */ {
+            VMutexLocker locker(&mSocketThreadsMutex, "VListenerThread::drainAndStop() wait");
+
+            // Wait for at least one thread to end. Each signal wakes only us, since we are the only waiter.
+            while ((static_cast<int>(mSocketThreads.size()) >= numRemaining) && ! deadline.hasExpired()) {
+                mSocketThreadEnded.wait(&mSocketThreadsMutex, deadline);
+            }
+
+            numRemaining = static_cast<int>(mSocketThreads.size());
+        }
+
+        if (mManager != NULL) {
+            mManager->listenerDrainProgress(this, numRemaining);
+        }
+    }
+
+    if (numRemaining > 0) {
+        VLOGGER_NAMED_WARN(mLoggerName, VSTRING_FORMAT("[%s] VListenerThread::drainAndStop: Closing %d socket threads that did not finish within %s.", mName.chars(), numRemaining, drainTimeout.getDurationString().chars()));
+        this->stopAllSocketThreads();
+
+        // Closing their sockets makes the threads fail out of any i/o, but they still have to run down. Give them a moment,
+        // so that the caller can rely on them being gone, but don't let one that is stuck elsewhere hang the shutdown.
+        const VDuration kForceCloseTimeout = 5 * VDuration::SECOND();
+        VDeadline       closeDeadline(kForceCloseTimeout);
+        int             numStillRunning = 0;
+
+        /* locker scope */ {
+            VMutexLocker locker(&mSocketThreadsMutex, "VListenerThread::drainAndStop() force close");
+
+            while (! mSocketThreads.empty() && ! closeDeadline.hasExpired()) {
+                mSocketThreadEnded.wait(&mSocketThreadsMutex, closeDeadline);
+            }
+
+            numStillRunning = static_cast<int>(mSocketThreads.size());
+        }
+
+        if (numStillRunning > 0) {
+            VLOGGER_NAMED_ERROR(mLoggerName, VSTRING_FORMAT("[%s] VListenerThread::drainAndStop: %d closed socket threads did not end within %s.", mName.chars(), numStillRunning, kForceCloseTimeout.getDurationString().chars()));
+        }
+    }
+
+    if (mManager != NULL) {
+        mManager->listenerDrainEnded(this, numRemaining);
+    }
+
+    VThread::stop();
+
+    return (numRemaining == 0);
+}
+
+void VListenerThread::_sampleSocketStatistics() {
+    VInstant now;
+    if ((now - mLastStatisticsSampleTime).getDurationMilliseconds() < VSocket::kStatisticsSampleIntervalMilliseconds) {
+        return;
+    }
+
+    mLastStatisticsSampleTime = now;
+
+    VMutexLocker            locker(&mSocketThreadsMutex, "VListenerThread::_sampleSocketStatistics()");
+    std::vector<VSocket*>   sampledSockets; // a session's input and output threads share one socket; sample it once
+
+    for (VSizeType i = 0; i < mSocketThreads.size(); ++i) {
+        VSocket* socket = mSocketThreads[i]->getSocket();
+        if (std::find(sampledSockets.begin(), sampledSockets.end(), socket) == sampledSockets.end()) {
+            socket->sampleStatistics();
+            sampledSockets.push_back(socket);
+        }
+    }
+}
+
 void VListenerThread::_runListening() {
     VListenerSocket* listenerSocket = NULL;
 
@@ -128,7 +248,12 @@ void VListenerThread::_runListening() {
 
     VString exceptionMessage; // filled in if catch block entered
     try {
-        listenerSocket = new VListenerSocket(mPortNumber, mBindAddress, mSocketFactory);
+        if (mLocalPath.isEmpty()) {
+            listenerSocket = new VListenerSocket(mPortNumber, mBindAddress, mSocketFactory);
+        } else {
+            listenerSocket = new VListenerSocket(mLocalPath, mSocketFactory);
+        }
+
         listenerSocket->listen();
 
         if (mManager != NULL) {
@@ -140,9 +265,12 @@ void VListenerThread::_runListening() {
 
             if (theSocket != NULL) {
                 try {
-                    VMutexLocker locker(&mSocketThreadsMutex, VSTRING_FORMAT("[%s]VListenerThread::_runListening()", this->getName().chars()));
+                    VMutexLocker locker(&mSocketThreadsMutex, "VListenerThread::_runListening()");
 
-                    if (mSessionFactory == NULL) {
+                    if (mDraining) {
+                        // Accepted in the moment between drainAndStop() starting and this loop noticing.
+                        delete theSocket;
+                    } else if (mSessionFactory == NULL) {
                         VSocketThread* thread = mThreadFactory->createThread(theSocket, this);
                         thread->start(); // throws if can't create OS thread
                         mSocketThreads.push_back(thread);
@@ -172,6 +300,8 @@ void VListenerThread::_runListening() {
                 As long as we haven't been stopped, we'll try again.
                 */
             }
+
+            this->_sampleSocketStatistics();
         }
     } catch (const VException& ex) {
         exceptionMessage.format("[%s]VListenerThread::_runListening() caught exception #%d '%s'.", mName.chars(), ex.getError(), ex.what());
@@ -13,6 +13,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vsocketthread.h"
 #include "vsocket.h"
 #include "vmutex.h"
+#include "vsemaphore.h"
 
 class VSocketFactory;
 class VSocketThreadFactory;
@@ -80,6 +81,23 @@ class VListenerThread : public VThread {
         */
         VListenerThread(const VString& threadBaseName, bool deleteSelfAtEnd, bool createDetached, VManagementInterface* manager, int portNumber, const VString& bindAddress, VSocketFactory* socketFactory, VSocketThreadFactory* threadFactory, VClientSessionFactory* sessionFactory = NULL, bool initiallyListening = true);
         /**
+        Constructs the listener thread to listen on a Unix domain socket at a
+        specified path, for connections from other processes on this machine.
+        Each incoming connection is handled exactly as for a TCP listener;
+        only the way the listener is addressed differs.
+
+        @param  threadBaseName      a distinguishing base name for the thread, useful for debugging purposes
+        @param  deleteSelfAtEnd     @see VThread
+        @param  createDetached      @see VThread
+        @param  manager             the object that receives notifications for this thread, or NULL
+        @param  localPath           the file system path to listen on
+        @param  socketFactory       a factory for creating a VSocket for each incoming connection
+        @param  threadFactory       @see above
+        @param  sessionFactory      @see above
+        @param  initiallyListening  @see above
+        */
+        VListenerThread(const VString& threadBaseName, bool deleteSelfAtEnd, bool createDetached, VManagementInterface* manager, const VString& localPath, VSocketFactory* socketFactory, VSocketThreadFactory* threadFactory, VClientSessionFactory* sessionFactory = NULL, bool initiallyListening = true);
+        /**
         Destructor.
         */
         virtual ~VListenerThread();
@@ -110,6 +128,11 @@ class VListenerThread : public VThread {
         @return    the port number
         */
         int getPortNumber() const;
+        /**
+        Returns the Unix domain socket path we're listening on.
+        @return    the path; empty if we are listening on a TCP port
+        */
+        const VString& getLocalPath() const { return mLocalPath; }
 
         /**
         Returns a list of information about all of this listener's
@@ -117,7 +140,11 @@ class VListenerThread : public VThread {
         so dynamic, the caller receives a snapshot of the information,
         which may be stale at any moment. For example, by the time
         you look at the information, it may refer to sockets that have
-        since been closed.
+        since been closed. The listener samples each socket's statistics
+        (see VSocket::sampleStatistics()) every
+        VSocket::kStatisticsSampleIntervalMilliseconds, so the reported
+        throughput rates cover the most recent interval no matter how often
+        you call this.
         */
         VSocketInfoVector enumerateActiveSockets();
 
@@ -138,6 +165,20 @@ class VListenerThread : public VThread {
         */
         void stopAllSocketThreads();
         /**
+        Shuts the listener down without cutting off requests in progress, as
+        for a rolling restart. The listener stops accepting connections, asks
+        each socket thread to finish what it is doing and end (see
+        VSocketThread::stopWhenIdle()), and waits for them to do so. Threads
+        still running when the timeout elapses are closed and stopped as
+        stopAllSocketThreads() would, and given a few more seconds to end.
+        Finally the listener thread itself is stopped. The VManagementInterface, if any, is notified as the drain
+        progresses. This method blocks the calling thread, so it must not be
+        called from the listener thread or one of its socket threads.
+        @param  drainTimeout    how long to wait for the socket threads to end on their own
+        @return true if all socket threads ended by themselves; false if some had to be closed
+        */
+        bool drainAndStop(const VDuration& drainTimeout);
+        /**
         Sets the thread to listen if it isn't already. If the thread is
         currently listening, nothing changes. If it's sleeping in non-listening
         mode, next time through the loop it will start listening again.
@@ -158,6 +199,20 @@ class VListenerThread : public VThread {
         */
         bool isListening() const { return mShouldListen; }
 
+        /**
+        Sets the OS thread attributes for the socket threads this listener creates
+        from now on, whether by its thread factory or its session factory; for
+        example, a smaller stack size for servers with many connections. These
+        are typically read from settings; @see VThreadOptions.
+        @param  options the options
+        */
+        void setSocketThreadOptions(const VThreadOptions& options) { mSocketThreadOptions = options; }
+        /**
+        Returns the OS thread attributes for the socket threads this listener creates.
+        @return the options
+        */
+        const VThreadOptions& getSocketThreadOptions() const { return mSocketThreadOptions; }
+
     private:
 
         // Prevent copy construction and assignment since there is no provision for sharing the underlying thread
@@ -170,15 +225,26 @@ class VListenerThread : public VThread {
         The run() method calls this when we are listening. So
         */
         void _runListening();
+        /**
+        Samples the statistics of each socket we own, if the sample interval
+        has elapsed since the last time. Called from our run loop, so that
+        sampling does not depend on anyone calling enumerateActiveSockets().
+        */
+        void _sampleSocketStatistics();
 
         int                     mPortNumber;            ///< The port number we are listening on.
         VString                 mBindAddress;           ///< The address to bind to (INADDR_ANY is used if the address is empty)
+        VString                 mLocalPath;             ///< The Unix domain socket path to listen on instead of a port, or empty.
         bool                    mShouldListen;          ///< True if we should be listening; false if we should not. Controls run loops.
         VSocketFactory*         mSocketFactory;         ///< A factory for each incoming connection's VSocket.
         VSocketThreadFactory*   mThreadFactory;         ///< A factory for each incoming connection's VSocketThread.
         VClientSessionFactory*  mSessionFactory;        ///< A factory for each incoming connection's VClientSession.
         VSocketThreadPtrVector  mSocketThreads;         ///< The VSocketThread objects we have created.
         VMutex                  mSocketThreadsMutex;    ///< Mutex to protect our VSocketThread vector.
+        VSemaphore              mSocketThreadEnded;     ///< Signaled when a socket thread removes itself from mSocketThreads.
+        volatile bool           mDraining;              ///< True once drainAndStop() has begun; connections accepted after that are closed at once.
+        VThreadOptions          mSocketThreadOptions;   ///< The OS thread attributes for our VSocketThreads.
+        VInstant                mLastStatisticsSampleTime; ///< When _sampleSocketStatistics() last sampled our sockets.
 
 };
 
@@ -12,6 +12,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 
 class VThread;
 class VListenerThread;
+class VDatagramListenerThread;
 
 /**
 VManagementInterface defines the interface for a class you can provide
@@ -106,6 +107,62 @@ class VManagementInterface {
         */
         virtual void listenerEnded(VListenerThread* listener) = 0;
 
+        /*
+        The following notifications report the progress of a
+        VListenerThread::drainAndStop() call. They are made on the thread
+        that called drainAndStop(), and have empty default implementations
+        so that a management interface that does not drain its listeners
+        need not implement them.
+        */
+
+        /**
+        Notifies the interface that the listener has stopped accepting
+        connections and asked its socket threads to finish their work.
+        @param  listener            the listener thread being drained
+        @param  numSocketThreads    the number of socket threads still running
+        */
+        virtual void listenerDrainStarted(VListenerThread* /*listener*/, int /*numSocketThreads*/) {}
+        /**
+        Notifies the interface that some of the listener's socket threads have
+        ended while it is being drained.
+        @param  listener            the listener thread being drained
+        @param  numSocketThreads    the number of socket threads still running
+        */
+        virtual void listenerDrainProgress(VListenerThread* /*listener*/, int /*numSocketThreads*/) {}
+        /**
+        Notifies the interface that the drain is over, just before the
+        listener thread itself is stopped.
+        @param  listener            the listener thread that was drained
+        @param  numForceClosed      the number of socket threads that had not
+                                        finished by the deadline and were closed
+        */
+        virtual void listenerDrainEnded(VListenerThread* /*listener*/, int /*numForceClosed*/) {}
+
+        /**
+        The following notifications are the VDatagramListenerThread equivalents
+        of the listener notifications above, and have the same semantics. They
+        have empty default implementations so that a management interface that
+        has no datagram listeners need not implement them.
+        @param  listener    the datagram listener thread
+        */
+        virtual void datagramListenerStarting(VDatagramListenerThread* /*listener*/) {}
+        /**
+        @see listenerListening()
+        @param  listener    the datagram listener thread that is listening
+        */
+        virtual void datagramListenerListening(VDatagramListenerThread* /*listener*/) {}
+        /**
+        @see listenerFailed()
+        @param  listener    the datagram listener thread that failed
+        @param  message     error message describing the failure
+        */
+        virtual void datagramListenerFailed(VDatagramListenerThread* /*listener*/, const VString& /*message*/) {}
+        /**
+        @see listenerEnded()
+        @param  listener    the datagram listener thread that has ended
+        */
+        virtual void datagramListenerEnded(VDatagramListenerThread* /*listener*/) {}
+
 };
 
 #endif /* vmanagementinterface_h */
@@ -11,7 +11,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 
 // VMessage -------------------------------------------------------------------
 
-const VString VMessage::kMessageLoggerName("vault.messages");
+const VNamedLoggerHandle VMessage::kMessageLoggerName("vault.messages");
 const int VMessage::kMessageContentRecordingLevel  = VLoggerLevel::INFO;
 const int VMessage::kMessageHeaderLevel            = VLoggerLevel::DEBUG;
 const int VMessage::kMessageContentFieldsLevel     = VLoggerLevel::DEBUG + 1;
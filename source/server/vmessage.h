@@ -12,6 +12,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vstring.h"
 #include "vbinaryiostream.h"
 #include "vmemorystream.h"
+#include "vlogger.h"
 
 /** @file */
 
@@ -156,7 +157,7 @@ class VMessage : public VBinaryIOStream {
 
         Use the macros defined at the top of this file to emit message log output.
         */
-        static const VString kMessageLoggerName;
+        static const VNamedLoggerHandle kMessageLoggerName;
         static const int kMessageContentRecordingLevel; ///< VLoggerLevel::INFO      -- human-readable single-line form of message content (e.g., bento text format)
         static const int kMessageHeaderLevel;           ///< VLoggerLevel::DEBUG     -- message meta data such as ID, length, key, etc.
         static const int kMessageContentFieldsLevel;    ///< VLoggerLevel::DEBUG + 1 -- human-readable multi-line form of message content (e.g., non-bento message fields)
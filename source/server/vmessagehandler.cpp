@@ -10,14 +10,65 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vexception.h"
 #include "vsocketthread.h"
 #include "vclientsession.h"
+#include "vrwmutex.h"
 
 // VMessageHandler ------------------------------------------------------------
 
 VMessageHandlerFactoryMap* VMessageHandler::gFactoryMap = NULL;
 
+// Registration happens during static initialization, so the factory map's mutex must be
+// created on first use rather than as a static object. Once registration is done the map
+// is only read, by every message dispatch, so readers must not serialize.
+static VRWMutex* _factoryMapMutexInstance() {
+    static VRWMutex* gFactoryMapMutex = new VRWMutex("VMessageHandler::gFactoryMapMutex");
+    return gFactoryMapMutex;
+}
+
+typedef std::map<VMessageID, const VNamedLoggerHandle*> VMessageHandlerLoggerMap;
+
+// All handlers for a message ID log to the same name, so they share one handle rather than each
+// resolving the name again. Handles are created on first use and, like the factory map, never deleted.
+static VRWMutex* _loggerMapMutexInstance() {
+    static VRWMutex* gLoggerMapMutex = new VRWMutex("VMessageHandler::gLoggerMapMutex");
+    return gLoggerMapMutex;
+}
+
+static VMessageHandlerLoggerMap& _getLoggerMap() {
+    static VMessageHandlerLoggerMap* gLoggerMap = new VMessageHandlerLoggerMap();
+    return *gLoggerMap;
+}
+
+static const VNamedLoggerHandle& _getLoggerHandle(VMessageID messageID) {
+    /* locker scope */ {
+        VReadLocker locker(_loggerMapMutexInstance(), "VMessageHandler _getLoggerHandle");
+        const VMessageHandlerLoggerMap& loggerMap = _getLoggerMap();
+        VMessageHandlerLoggerMap::const_iterator position = loggerMap.find(messageID);
+        if (position != loggerMap.end()) {
+            return *(position->second);
+        }
+    }
+
+    VWriteLocker locker(_loggerMapMutexInstance(), "VMessageHandler _getLoggerHandle");
+    const VNamedLoggerHandle*& handle = _getLoggerMap()[messageID];
+    if (handle == NULL) { // another thread may have added it while we waited
+        handle = new VNamedLoggerHandle(VSTRING_FORMAT("vault.messages.VMessageHandler.%d", messageID));
+    }
+
+    return *handle;
+}
+
 // static
 VMessageHandler* VMessageHandler::get(VMessagePtr m, VServer* server, VClientSessionPtr session, VSocketThread* thread) {
-    VMessageHandlerFactory* factory = (*(VMessageHandler::mapInstance()))[m->getMessageID()];
+    VMessageHandlerFactory* factory = NULL;
+
+    /* locker scope */ {
+        VReadLocker locker(_factoryMapMutexInstance(), "VMessageHandler::get");
+        const VMessageHandlerFactoryMap* factoryMap = VMessageHandler::mapInstance();
+        VMessageHandlerFactoryMap::const_iterator position = factoryMap->find(m->getMessageID());
+        if (position != factoryMap->end()) {
+            factory = position->second;
+        }
+    }
 
     if (factory == NULL)
         return NULL;
@@ -27,6 +78,7 @@ VMessageHandler* VMessageHandler::get(VMessagePtr m, VServer* server, VClientSes
 
 // static
 void VMessageHandler::registerHandlerFactory(VMessageID messageID, VMessageHandlerFactory* factory) {
+    VWriteLocker locker(_factoryMapMutexInstance(), "VMessageHandler::registerHandlerFactory");
     (*(VMessageHandler::mapInstance()))[messageID] = factory;
 }
 
@@ -43,14 +95,14 @@ VMessageHandlerFactoryMap* VMessageHandler::mapInstance() {
 
 VMessageHandler::VMessageHandler(const VString& name, VMessagePtr m, VServer* server, VClientSessionPtr session, VSocketThread* thread, const VMessageFactory* messageFactory, VMutex* mutex)
     : mName(name)
-    , mLoggerName(VSTRING_ARGS("vault.messages.VMessageHandler.%d", m->getMessageID()))
+    , mLoggerName(_getLoggerHandle(m->getMessageID()))
     , mMessage(m)
     , mServer(server)
     , mSession(session)
     , mThread(thread)
     , mMessageFactory(messageFactory)
     , mStartTime(/*now*/)
-    , mLocker(mutex, VSTRING_FORMAT("VMessageHandler(%s)", name.chars()))
+    , mLocker(mutex, "VMessageHandler::VMessageHandler()")
     , mUnblockTime(/*now*/) // Note that if we block locking the mutex, mUnblockTime - mStartTime will indicate how long we were blocked here.
     , mSessionName() // initialized below if session or thread was supplied
     {
@@ -6,10 +6,14 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 */
 
 #include "vmessageinputthread.h"
+#include "vtypes_internal.h"
 
 #include "vexception.h"
+#include "vmutexlocker.h"
+#include "vsocket.h"
 #include "vmessagehandler.h"
 #include "vlogger.h"
+#include "vlogflightrecorder.h"
 #include "vmessage.h"
 #include "vclientsession.h"
 #include "vbento.h"
@@ -25,6 +29,9 @@ VMessageInputThread::VMessageInputThread(const VString& threadBaseName, VSocket*
     , mServer(server)
     , mMessageFactory(messageFactory)
     , mHasOutputThread(false)
+    , mRequestMutex(VSTRING_FORMAT("VMessageInputThread(%s)::mRequestMutex", threadBaseName.chars()))
+    , mRequestInProgress(false)
+    , mInputShutDown(false)
     {
 }
 
@@ -64,15 +71,21 @@ void VMessageInputThread::run() {
         VLOGGER_NAMED_DEBUG(mLoggerName, VSTRING_FORMAT("[%s] VMessageInputThread: Socket has closed, thread will end.", mName.chars()));
     } catch (const VException& ex) {
         if (this->isRunning()) {
-            VLOGGER_NAMED_ERROR(mLoggerName, VSTRING_FORMAT("[%s] VMessageInputThread: Exiting due to top level exception #%d '%s'.", mName.chars(), ex.getError(), ex.what()));
+            VString message(VSTRING_ARGS("[%s] VMessageInputThread: Exiting due to top level exception #%d '%s'.", mName.chars(), ex.getError(), ex.what()));
+            VLOGGER_NAMED_ERROR(mLoggerName, message);
+            VLogFlightRecorder::dumpCurrentThreadOnException(mLoggerName, message);
         }
     } catch (const std::exception& ex) {
         if (this->isRunning()) {
-            VLOGGER_NAMED_ERROR(mLoggerName, VSTRING_FORMAT("[%s] VMessageInputThread: Exiting due to top level exception '%s'.", mName.chars(), ex.what()));
+            VString message(VSTRING_ARGS("[%s] VMessageInputThread: Exiting due to top level exception '%s'.", mName.chars(), ex.what()));
+            VLOGGER_NAMED_ERROR(mLoggerName, message);
+            VLogFlightRecorder::dumpCurrentThreadOnException(mLoggerName, message);
         }
     } catch (...) {
         if (this->isRunning()) {
-            VLOGGER_NAMED_ERROR(mLoggerName, VSTRING_FORMAT("[%s] VMessageInputThread: Exiting due to top level unknown exception.", mName.chars()));
+            VString message(VSTRING_ARGS("[%s] VMessageInputThread: Exiting due to top level unknown exception.", mName.chars()));
+            VLOGGER_NAMED_ERROR(mLoggerName, message);
+            VLogFlightRecorder::dumpCurrentThreadOnException(mLoggerName, message);
         }
     }
 
@@ -107,6 +120,29 @@ void VMessageInputThread::attachSession(VClientSessionPtr session) {
     mSession = session;
 }
 
+void VMessageInputThread::stopWhenIdle() {
+    VMutexLocker locker(&mRequestMutex, "VMessageInputThread::stopWhenIdle()");
+
+    this->stop();
+
+    // A request that has started arriving is finished first; the run loop then notices we were stopped.
+    // Otherwise we are blocked waiting for the next request, so shut down our input to wake up and end now.
+    if (mRequestInProgress || (mSocket == NULL)) {
+        return;
+    }
+
+    try {
+        if (mSocket->available() != 0) {
+            return; // a request has arrived but we have yet to notice; let it be handled
+        }
+    } catch (const VException& /*ex*/) {
+        // The socket has already failed or closed, so there is nothing left to read.
+    }
+
+    (void) ::shutdown(mSocket->getSockID(), SHUT_RD);
+    mInputShutDown = true;
+}
+
 //lint -e429 "Custodial pointer 'message' has not been freed or returned" [OK: try or catch branches guarantee message is released.]
 void VMessageInputThread::_processNextRequest() {
     VMessagePtr message = mMessageFactory->instantiateNewMessage();
@@ -128,8 +164,25 @@ void VMessageInputThread::_processNextRequest() {
         catch here in order to release the message we instantiated above
         before re-throwing. So there is no longer a try/catch here at all.
     */
+    // Count the request as in progress only once it starts to arrive, so that stopWhenIdle() can tell an idle connection.
+    mSocket->waitForData();
+
+    /* locker scope */ {
+        VMutexLocker locker(&mRequestMutex, "VMessageInputThread::_processNextRequest()");
+        if (mInputShutDown) {
+            return; // stopWhenIdle() woke us; the run loop will see that we have been stopped
+        }
+
+        mRequestInProgress = true;
+    }
+
     message->receive(mName, mInputStream);
     this->_dispatchMessage(message);
+
+    /* locker scope */ {
+        VMutexLocker locker(&mRequestMutex, "VMessageInputThread::_processNextRequest()");
+        mRequestInProgress = false;
+    }
 }
 
 void VMessageInputThread::_dispatchMessage(VMessagePtr message) {
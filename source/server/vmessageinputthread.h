@@ -71,6 +71,14 @@ class VMessageInputThread : public VSocketThread {
         */
         void setHasOutputThread(bool hasOutputThread) { mHasOutputThread = hasOutputThread; }
 
+        // VSocketThread implementation:
+        /**
+        Stops the thread once the request in progress, if any, has been
+        handled. If the thread is between requests, waiting for a client that
+        may never send another, its input is shut down so that it ends at once.
+        */
+        virtual void stopWhenIdle();
+
     protected:
 
         /**
@@ -119,6 +127,9 @@ class VMessageInputThread : public VSocketThread {
         VServer*                mServer;            ///< The server object that owns us.
         const VMessageFactory*  mMessageFactory;    ///< Factory for instantiating new messages to read from input stream.
         volatile bool           mHasOutputThread;   ///< True if we are dependent on an output thread completion before returning from run(). (see run() code)
+        VMutex                  mRequestMutex;      ///< Protects mRequestInProgress and mInputShutDown against a concurrent stopWhenIdle().
+        bool                    mRequestInProgress; ///< True from when a request starts arriving until it has been handled.
+        bool                    mInputShutDown;     ///< True once stopWhenIdle() has shut down our input; no further request is read.
 
     private:
 
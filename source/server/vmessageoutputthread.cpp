@@ -29,6 +29,7 @@ VMessageOutputThread::VMessageOutputThread(const VString& threadBaseName, VSocke
     , mWhenMaxQueueSizeWarned(VInstant() - VDuration::MINUTE()) // one minute ago (past warning throttle threshold)
     , mWasOverLimit(false)
     , mWhenWentOverLimit(VInstant::NEVER_OCCURRED())
+    , mStopWhenIdle(false)
     {
 
     if (mDependentInputThread != NULL) {
@@ -54,6 +55,11 @@ VMessageOutputThread::~VMessageOutputThread() {
 void VMessageOutputThread::run() {
     try {
         while (this->isRunning()) {
+            if (mStopWhenIdle && (mOutputQueue.getQueueSize() == 0)) {
+                VSocketThread::stop();
+                break;
+            }
+
             this->_processNextOutboundMessage();
         }
     } catch (const VSocketClosedException& /*ex*/) {
@@ -91,10 +97,18 @@ void VMessageOutputThread::run() {
 }
 
 void VMessageOutputThread::stop() {
-    VSocketThread::stop();
+    if (! mStopWhenIdle) {
+        VSocketThread::stop();
+    } // else the run loop stops once the queue has been sent, or when a send fails because the socket was closed
+
     mOutputQueue.wakeUp(); // if it's blocked, this is needed to kick it back to its run loop
 }
 
+void VMessageOutputThread::stopWhenIdle() {
+    mStopWhenIdle = true;
+    mOutputQueue.wakeUp();
+}
+
 void VMessageOutputThread::attachSession(VClientSessionPtr session) {
     mSession = session;
 }
@@ -66,9 +66,15 @@ class VMessageOutputThread : public VSocketThread {
 
         /**
         Stops the thread; for VMessageOutputThread this calls inherited and
-        then wakes up the message queue in case it is blocked.
+        then wakes up the message queue in case it is blocked. After
+        stopWhenIdle(), the thread instead keeps running until the messages
+        already queued have been sent, unless its socket is closed first.
         */
         virtual void stop();
+        /**
+        Sends the messages already queued, then ends the thread; @see VSocketThread.
+        */
+        virtual void stopWhenIdle();
 
         /**
         Attaches the thread to its session, so that message handlers on this
@@ -137,6 +143,8 @@ class VMessageOutputThread : public VSocketThread {
         // These are the transient flags we use to enforce and monitor the queue limits.
         bool        mWasOverLimit;      ///< True if the last postOutputMessage() call left us over the limit.
         VInstant    mWhenWentOverLimit; ///< When did we last transition from under-limit to over-limit.
+
+        volatile bool mStopWhenIdle;    ///< True once stopWhenIdle() has been called; the run loop ends when the queue is empty.
 };
 
 #endif /* vmessageoutputthread_h */
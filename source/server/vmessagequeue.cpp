@@ -10,18 +10,25 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vmutexlocker.h"
 #include "vmessage.h"
 #include "vlogger.h"
+#include "vthread.h"
 
 // VMessageQueue --------------------------------------------------------------
 
 VDuration VMessageQueue::gVMessageQueueLagLoggingThreshold(-1 * VDuration::MILLISECOND()); // -1 means we don't examine the lag time at all
 int VMessageQueue::gVMessageQueueLagLoggingLevel(VLoggerLevel::DEBUG);
+int VMessageQueue::gVMessageQueueBlockingSpinCount(50);
+
+static const VNamedLoggerHandle gVMessageQueueLoggerName("vault.messages.VMessageQueue");
 
 VMessageQueue::VMessageQueue()
     : mQueuedMessages()
     , mQueuedMessagesDataSize(0)
-    , mMessageQueueMutex("VMessageQueue::mMessageQueueMutex")
+    , mNumQueuedMessages(0)
+    , mMessageQueueMutex("VMessageQueue::mMessageQueueMutex", false, VMutex::kSpinThenBlock) // push and pop hold it only briefly
     , mMessageQueueSemaphore()
     , mLastMessagePostTime()
+    , mNumWaiters(0)
+    , mWakeUpRequested(false)
     {
 }
 
@@ -33,38 +40,74 @@ void VMessageQueue::postMessage(VMessagePtr message) {
     VMutexLocker locker(&mMessageQueueMutex, "VMessageQueue::postMessage()");
 
     mQueuedMessages.push_back(message);
+    mNumQueuedMessages = mQueuedMessages.size();
     mLastMessagePostTime.setNow();
 
     if (message != nullptr) {
         mQueuedMessagesDataSize += message->getMessageDataLength();
     }
 
-    locker.unlock();    // otherwise signal() will deadlock
-    mMessageQueueSemaphore.signal();
+    // Only pay for the signal if a reader is parked. A reader that is about to park checks the
+    // queue under this same mutex first, so it cannot miss this message.
+    bool needSignal = (mNumWaiters > 0);
+    locker.unlock();
+
+    if (needSignal) {
+        mMessageQueueSemaphore.signal();
+    }
 }
 
 VMessagePtr VMessageQueue::blockUntilNextMessage() {
-    // If there is a message on the queue, we can simply return it.
-    VMessagePtr message = this->getNextMessage();
-    if (message != nullptr) {
-        return message;
+    // Spin briefly before parking. The lock-free count check is only a hint; the locked pop decides.
+    for (int i = 0; i < gVMessageQueueBlockingSpinCount; ++i) {
+        if (mNumQueuedMessages > 0) {
+            VMessagePtr message = this->getNextMessage();
+            if (message != nullptr) {
+                return message;
+            }
+        }
+
+        VThread::yield();
     }
 
-    // There is nothing on the queue, so wait until someone posts a message.
-    VMutex dummy("VMessageQueue::blockUntilNextMessage() dummy");
-    mMessageQueueSemaphore.wait(&dummy, 5 * VDuration::SECOND());
+    VMutexLocker locker(&mMessageQueueMutex, "VMessageQueue::blockUntilNextMessage()");
 
-    return this->getNextMessage();
+    // Check and wait under the same mutex that postMessage() holds while pushing. The semaphore wait
+    // releases the mutex atomically while parked, so a post cannot slip in between the check and the wait.
+    // Wake-ups without a message (signals meant for another reader, or spurious ones) just loop.
+    // If nothing is posted for a while we return NULL anyway, so that the caller can check whether to keep running.
+    VDeadline parkDeadline(5 * VDuration::SECOND());
+    ++mNumWaiters;
+    while ((mQueuedMessages.size() == 0) && (! mWakeUpRequested) && (! parkDeadline.hasExpired())) {
+        mMessageQueueSemaphore.wait(&mMessageQueueMutex, parkDeadline);
+    }
+    --mNumWaiters;
+
+    mWakeUpRequested = false;
+
+    return this->_lockedGetNextMessage();
 }
 
 VMessagePtr VMessageQueue::getNextMessage() {
-    VMessagePtr message;
-
     VMutexLocker locker(&mMessageQueueMutex, "VMessageQueue::getNextMessage()");
+    return this->_lockedGetNextMessage();
+}
+
+void VMessageQueue::wakeUp() {
+    VMutexLocker locker(&mMessageQueueMutex, "VMessageQueue::wakeUp()");
+    mWakeUpRequested = true;
+    locker.unlock();
+
+    mMessageQueueSemaphore.signal();
+}
+
+VMessagePtr VMessageQueue::_lockedGetNextMessage() {
+    VMessagePtr message;
 
     if (mQueuedMessages.size() > 0) {
         message = mQueuedMessages.front();
         mQueuedMessages.pop_front();
+        mNumQueuedMessages = mQueuedMessages.size();
 
         if (message != nullptr) {
             mQueuedMessagesDataSize -= message->getMessageDataLength();
@@ -76,20 +119,16 @@ VMessagePtr VMessageQueue::getNextMessage() {
         VInstant now;
         VDuration delayInterval = now - mLastMessagePostTime;
         if (delayInterval >= gVMessageQueueLagLoggingThreshold) {
-            VLOGGER_NAMED_LEVEL("vault.messages.VMessageQueue", gVMessageQueueLagLoggingLevel, VSTRING_FORMAT("VMessageQueue saw a delay of %s when getting a message with ID %d.", delayInterval.getDurationString().chars(), message->getMessageID()));
+            VLOGGER_NAMED_LEVEL(gVMessageQueueLoggerName, gVMessageQueueLagLoggingLevel, VSTRING_FORMAT("VMessageQueue saw a delay of %s when getting a message with ID %d.", delayInterval.getDurationString().chars(), message->getMessageID()));
         }
     }
 
     return message;
 }
 
-void VMessageQueue::wakeUp() {
-    mMessageQueueSemaphore.signal();
-}
-
 VSizeType VMessageQueue::getQueueSize() const {
-    // No need to lock here, nothing bad can happen underneath us.
-    return mQueuedMessages.size();
+    // No need to lock here; the count is kept up to date under the mutex.
+    return mNumQueuedMessages;
 }
 
 Vs64 VMessageQueue::getQueueDataSize() const {
@@ -108,5 +147,7 @@ void VMessageQueue::releaseAllMessages() {
             mQueuedMessagesDataSize -= message->getMessageDataLength();
         }
     }
+
+    mNumQueuedMessages = 0;
 }
 
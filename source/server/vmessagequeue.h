@@ -14,6 +14,8 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vcompactingdeque.h"
 #include "vmessage.h"
 
+#include <atomic>
+
 /** @file */
 
 /**
@@ -32,6 +34,12 @@ getNextMessage() simply returns the next message, or NULL, so the caller must
 decide how to manage de-queueing messages without chewing up the CPU
 needlessly (for UI apps this may mean a notification scheme so that the app's
 UI thread only looks at the queue when something gets posted to it).
+
+blockUntilNextMessage() first spins briefly, yielding, in case a message is
+about to be posted; this avoids the cost of parking and waking the thread when
+messages arrive in quick succession. It then parks on the queue's semaphore,
+checking for messages under the same mutex that postMessage() holds, so a
+message posted at any moment wakes it immediately.
 */
 class VMessageQueue {
     public:
@@ -54,9 +62,12 @@ class VMessageQueue {
         virtual void postMessage(VMessagePtr message);
         /**
         Returns the message at the front of the queue, blocking if the queue
-        is empty. May be safely called from any thread.
-        @return the message at the front of the queue; the caller becomes
-                        owner of the object
+        is empty. May be safely called from any thread. Returns NULL if
+        wakeUp() is called while the queue is empty, or if nothing is posted
+        within a few seconds, so that the caller can periodically check
+        whether it should keep running.
+        @return the message at the front of the queue, or NULL; the caller
+                        becomes owner of the object
         */
         VMessagePtr blockUntilNextMessage();
         /**
@@ -70,7 +81,8 @@ class VMessageQueue {
         Wakes up the thread in case it is necessary to let the thread cycle
         even though there are no messages and it is blocked. This is used
         during the shutdown process to allow the blocking thread to notice
-        that it has been asked to terminate.
+        that it has been asked to terminate. If no thread is blocked, the
+        next call to blockUntilNextMessage() returns immediately.
         */
         void wakeUp();
         /**
@@ -100,16 +112,36 @@ class VMessageQueue {
         static void setQueueingLagLoggingLevel(int logLevel) { gVMessageQueueLagLoggingLevel = logLevel; }
         static int getQueueingLagLoggingLevel() { return gVMessageQueueLagLoggingLevel; }
 
+        /**
+        Sets and gets the number of times blockUntilNextMessage() checks the
+        queue, yielding between checks, before it parks the thread. Spinning
+        lowers the latency of picking up a message that is posted shortly after
+        the queue empties, at the cost of some CPU time. 0 disables spinning.
+        */
+        static void setBlockingSpinCount(int spinCount) { gVMessageQueueBlockingSpinCount = spinCount; }
+        static int getBlockingSpinCount() { return gVMessageQueueBlockingSpinCount; }
+
     private:
 
+        /**
+        Removes and returns the message at the front of the queue, or NULL if
+        the queue is empty. The caller must hold mMessageQueueMutex.
+        @return the message at the front of the queue, or NULL
+        */
+        VMessagePtr _lockedGetNextMessage();
+
         VCompactingDeque<VMessagePtr> mQueuedMessages;///< The actual queue of messages.
         Vs64            mQueuedMessagesDataSize;    ///< The number of bytes in the queued messages.
+        std::atomic<VSizeType> mNumQueuedMessages;  ///< mQueuedMessages.size(), updated under mMessageQueueMutex so that it can be read without it.
         VMutex          mMessageQueueMutex;         ///< The mutex used to synchronize.
         VSemaphore      mMessageQueueSemaphore;     ///< The semaphore used to block/awaken.
         VInstant        mLastMessagePostTime;       ///< Time most recent message was posted.
+        int             mNumWaiters;                ///< Number of threads parked in blockUntilNextMessage(); protected by mMessageQueueMutex.
+        bool            mWakeUpRequested;           ///< True if wakeUp() was called and no blocked thread has returned since; protected by mMessageQueueMutex.
 
         static VDuration gVMessageQueueLagLoggingThreshold; ///< If >=0, queuing lags are logged.
         static int gVMessageQueueLagLoggingLevel;           ///< Log level at which queuing lags are logged.
+        static int gVMessageQueueBlockingSpinCount;         ///< Number of yielding checks before blockUntilNextMessage() parks.
 };
 
 #endif /* vmessagequeue_h */
@@ -11,7 +11,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 
 VServer::VServer()
     : mSessions()
-    , mSessionsMutex("VServer::mSessionsMutex")
+    , mSessionsMutex("VServer::mSessionsMutex", false, VMutex::kSpinThenBlock) // session add, remove and lookup hold it only briefly
     {
 }
 
@@ -19,6 +19,20 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 
 #include <sys/ioctl.h>
 #include <ifaddrs.h>
+#include <fcntl.h>
+
+// Received descriptors must not leak into child processes. Where possible, the kernel marks them close-on-exec as they arrive.
+#ifdef MSG_CMSG_CLOEXEC
+    #define VSOCKET_RECVMSG_CLOEXEC_FLAG MSG_CMSG_CLOEXEC
+#else
+    #define VSOCKET_RECVMSG_CLOEXEC_FLAG 0
+#endif
+
+#ifdef VPLATFORM_MAC
+#include <sys/uio.h>
+#elif defined(VSOCKET_SENDFILE_SUPPORTED)
+#include <sys/sendfile.h>
+#endif
 
 // static
 bool VSocket::_platform_staticInit() {
@@ -110,3 +124,166 @@ int VSocket::_platform_available() {
     return numBytesAvailable;
 }
 
+Vs64 VSocket::_platform_sendFile(int fd, Vs64 offset, Vs64 numBytesToSend) {
+#ifdef VPLATFORM_MAC
+    // The BSD form reports the number of bytes sent in len, even if interrupted part way.
+    off_t len = static_cast<off_t>(numBytesToSend);
+    int result = ::sendfile(fd, mSocketID, static_cast<off_t>(offset), &len, NULL, 0);
+    if ((result == -1) && (len == 0)) {
+        return -1;
+    }
+
+    return static_cast<Vs64>(len);
+#elif defined(VSOCKET_SENDFILE_SUPPORTED)
+    // The Linux form advances fileOffset rather than the file descriptor's own offset.
+    off_t fileOffset = static_cast<off_t>(offset);
+    return static_cast<Vs64>(::sendfile(mSocketID, fd, &fileOffset, static_cast<size_t>(numBytesToSend)));
+#else
+    (void) fd;
+    (void) offset;
+    (void) numBytesToSend;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+void VSocket::_platform_sendFileDescriptor(int fd) {
+    // The descriptor travels as ancillary data, which must accompany at least one byte of ordinary data.
+    Vu8             dataByte = 0;
+    struct iovec    dataVector;
+    dataVector.iov_base = &dataByte;
+    dataVector.iov_len = 1;
+
+    union {
+        struct cmsghdr  header; // forces correct alignment of the buffer
+        char            buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    ::memset(&control, 0, sizeof(control));
+
+    struct msghdr message;
+    ::memset(&message, 0, sizeof(message));
+    message.msg_iov = &dataVector;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    struct cmsghdr* controlHeader = CMSG_FIRSTHDR(&message);
+    controlHeader->cmsg_level = SOL_SOCKET;
+    controlHeader->cmsg_type = SCM_RIGHTS;
+    controlHeader->cmsg_len = CMSG_LEN(sizeof(int));
+    ::memcpy(CMSG_DATA(controlHeader), &fd, sizeof(int));
+
+    for (;;) {
+        ssize_t result = ::sendmsg(mSocketID, &message, VSOCKET_DEFAULT_SEND_FLAGS);
+        if (result == 1) {
+            return;
+        }
+
+        VSystemError e = VSystemError::getSocketError();
+        if ((result < 0) && e.isLikePosixError(EINTR)) {
+            continue;
+        }
+
+        if (e.isLikePosixError(EPIPE)) {
+            throw VSocketClosedException(e, VSTRING_FORMAT("VSocket[%s] sendFileDescriptor: Socket has closed (EPIPE).", mSocketName.chars()));
+        } else {
+            throw VException(e, VSTRING_FORMAT("VSocket[%s] sendFileDescriptor: sendmsg() failed. Result=%d.", mSocketName.chars(), (int) result));
+        }
+    }
+}
+
+int VSocket::_platform_receiveFileDescriptor() {
+    if (mReadTimeOutActive) {
+        fd_set readset;
+        FD_ZERO(&readset);
+        FD_SET(mSocketID, &readset);
+        struct timeval timeout = mReadTimeOut;
+        int result = ::select(SelectSockIDTypeCast (mSocketID + 1), &readset, NULL, NULL, &timeout);
+        if (result == 0) {
+            throw VException(VSTRING_FORMAT("VSocket[%s] receiveFileDescriptor: Select timed out.", mSocketName.chars()));
+        }
+        // On error, fall through and let recvmsg() report it.
+    }
+
+    Vu8             dataByte = 0;
+    struct iovec    dataVector;
+    dataVector.iov_base = &dataByte;
+    dataVector.iov_len = 1;
+
+    union {
+        struct cmsghdr  header;
+        char            buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    ::memset(&control, 0, sizeof(control));
+
+    struct msghdr message;
+    ::memset(&message, 0, sizeof(message));
+    message.msg_iov = &dataVector;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    ssize_t result;
+    do {
+        result = ::recvmsg(mSocketID, &message, VSOCKET_DEFAULT_RECV_FLAGS | VSOCKET_RECVMSG_CLOEXEC_FLAG);
+    } while ((result < 0) && VSystemError::getSocketError().isLikePosixError(EINTR));
+
+    if (result < 0) {
+        throw VException(VSystemError::getSocketError(), VSTRING_FORMAT("VSocket[%s] receiveFileDescriptor: recvmsg() failed.", mSocketName.chars()));
+    } else if (result == 0) {
+        throw VEOFException(VSTRING_FORMAT("VSocket[%s] receiveFileDescriptor: recvmsg() returned 0 bytes.", mSocketName.chars()));
+    }
+
+    struct cmsghdr* controlHeader = CMSG_FIRSTHDR(&message);
+
+    // If the sender passed more descriptors than we have room for, the kernel has closed the extras, but the
+    // first one may still have arrived; don't leak it.
+    if ((message.msg_flags & MSG_CTRUNC) != 0) {
+        if ((controlHeader != NULL) && (controlHeader->cmsg_level == SOL_SOCKET) && (controlHeader->cmsg_type == SCM_RIGHTS) && (controlHeader->cmsg_len >= CMSG_LEN(sizeof(int)))) {
+            int truncatedFD;
+            ::memcpy(&truncatedFD, CMSG_DATA(controlHeader), sizeof(int));
+            (void) ::close(truncatedFD);
+        }
+
+        throw VException(VSTRING_FORMAT("VSocket[%s] receiveFileDescriptor: More than one descriptor arrived; the control data was truncated.", mSocketName.chars()));
+    }
+
+    if ((controlHeader == NULL) || (controlHeader->cmsg_level != SOL_SOCKET) || (controlHeader->cmsg_type != SCM_RIGHTS) || (controlHeader->cmsg_len != CMSG_LEN(sizeof(int)))) {
+        throw VException(VSTRING_FORMAT("VSocket[%s] receiveFileDescriptor: Data arrived without a descriptor.", mSocketName.chars()));
+    }
+
+    int fd;
+    ::memcpy(&fd, CMSG_DATA(controlHeader), sizeof(int));
+
+#ifndef MSG_CMSG_CLOEXEC
+    // Without MSG_CMSG_CLOEXEC there is a window in which a fork() and exec() on another thread inherits the
+    // descriptor; this is the best we can do.
+    (void) ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+
+    return fd;
+}
+
+bool VSocket::_platform_getTCPInfo(VSocketTCPInfo& info) const {
+#ifdef __linux__
+    struct tcp_info tcpInfo;
+    VSocklenT tcpInfoLength = sizeof(tcpInfo);
+    ::memset(&tcpInfo, 0, sizeof(tcpInfo));
+
+    // Fails harmlessly (ENOPROTOOPT, EOPNOTSUPP) for Unix domain and UDP sockets.
+    if (::getsockopt(mSocketID, IPPROTO_TCP, TCP_INFO, &tcpInfo, &tcpInfoLength) != 0) {
+        return false;
+    }
+
+    info.mIsValid = true;
+    info.mRoundTripTimeMicroseconds = static_cast<Vs64>(tcpInfo.tcpi_rtt);
+    info.mRoundTripTimeVarianceMicroseconds = static_cast<Vs64>(tcpInfo.tcpi_rttvar);
+    info.mNumRetransmits = static_cast<Vs64>(tcpInfo.tcpi_total_retrans);
+    info.mCongestionWindowSegments = static_cast<int>(tcpInfo.tcpi_snd_cwnd);
+    info.mNumUnackedSegments = static_cast<int>(tcpInfo.tcpi_unacked);
+    return true;
+#else
+    (void) info;
+    return false; // Mac OS X's TCP_CONNECTION_INFO differs enough that it's not yet supported here.
+#endif
+}
@@ -34,6 +34,24 @@ License: MIT. See LICENSE.md in the Vault top level directory.
     #define VSOCKET_DEFAULT_RECV_FLAGS 0
 #endif
 
+// Mac OS X and Linux can send file data directly to a socket in the kernel via sendfile(),
+// though their signatures differ. See VSocket::_platform_sendFile().
+#if defined(VPLATFORM_MAC) || defined(__linux__)
+    #define VSOCKET_SENDFILE_SUPPORTED
+#endif
+
+// Unix domain (AF_UNIX) stream sockets, and passing descriptors over them, are available on all Unix platforms.
+#define VSOCKET_LOCAL_DOMAIN_SUPPORTED
+#include <sys/un.h>
+#include <sys/stat.h> // lstat() on a socket path before bind(); see VSocket::_listenLocal()
+
+// Linux can send and receive multiple datagrams in one system call via sendmmsg()/recvmmsg().
+// Elsewhere VDatagramSocket loops over sendto()/recvfrom() instead.
+#ifdef __linux__
+    #define VSOCKET_MMSG_SUPPORTED
+    #include <sys/uio.h>
+#endif
+
 /*
 There are a couple of Unix APIs we call that take a socklen_t parameter.
 Well, on HP-UX the parameter is defined as an int. The cleanest way of dealing
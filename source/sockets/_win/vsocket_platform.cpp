@@ -119,3 +119,20 @@ int VSocket::_platform_available() {
     return (int) numBytesAvailable;
 }
 
+Vs64 VSocket::_platform_sendFile(int /*fd*/, Vs64 /*offset*/, Vs64 /*numBytesToSend*/) {
+    // Not called: VSOCKET_SENDFILE_SUPPORTED is not defined for Winsock. (TransmitFile would be the equivalent.)
+    return -1;
+}
+
+void VSocket::_platform_sendFileDescriptor(int /*fd*/) {
+    // Winsock cannot pass descriptors between processes this way; WSADuplicateSocket() is the nearest equivalent.
+    throw VUnimplementedException(VSTRING_FORMAT("VSocket[%s] sendFileDescriptor: Not supported on this platform.", mSocketName.chars()));
+}
+
+int VSocket::_platform_receiveFileDescriptor() {
+    throw VUnimplementedException(VSTRING_FORMAT("VSocket[%s] receiveFileDescriptor: Not supported on this platform.", mSocketName.chars()));
+}
+
+bool VSocket::_platform_getTCPInfo(VSocketTCPInfo& /*info*/) const {
+    return false; // Windows has no TCP_INFO equivalent for an arbitrary connected socket.
+}
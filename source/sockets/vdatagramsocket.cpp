@@ -0,0 +1,454 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+/** @file */
+
+#include "vdatagramsocket.h"
+#include "vtypes_internal.h"
+
+#include "vexception.h"
+
+// VDatagram ------------------------------------------------------------------
+
+VDatagram::VDatagram(int capacity)
+    : mBuffer(new Vu8[capacity])
+    , mCapacity(capacity)
+    , mLength(0)
+    , mTruncated(false)
+    , mHostIPAddress()
+    , mPortNumber(0)
+    {
+}
+
+VDatagram::VDatagram(const Vu8* data, int length, const VString& hostIPAddress, int portNumber)
+    : mBuffer(new Vu8[length])
+    , mCapacity(length)
+    , mLength(length)
+    , mTruncated(false)
+    , mHostIPAddress(hostIPAddress)
+    , mPortNumber(portNumber)
+    {
+    ::memcpy(mBuffer, data, static_cast<size_t>(length));
+}
+
+VDatagram::~VDatagram() {
+    delete [] mBuffer;
+}
+
+void VDatagram::setLength(int length) {
+    if ((length < 0) || (length > mCapacity)) {
+        throw VRangeException(VSTRING_FORMAT("VDatagram::setLength: Length %d exceeds capacity %d.", length, mCapacity));
+    }
+
+    mLength = length;
+}
+
+void VDatagram::setHostIPAddressAndPort(const VString& hostIPAddress, int portNumber) {
+    mHostIPAddress = hostIPAddress;
+    mPortNumber = portNumber;
+}
+
+// Converts a numeric IPv4 or IPv6 address string and port into a socket address; returns the address length.
+static VSocklenT _ipAddressToSockAddr(const VString& ipAddress, int portNumber, struct sockaddr_storage& addr) {
+    ::memset(&addr, 0, sizeof(addr));
+
+    if (ipAddress.isEmpty() || VSocket::isIPv4NumericString(ipAddress)) {
+        struct sockaddr_in* info = reinterpret_cast<struct sockaddr_in*>(&addr);
+        info->sin_family = AF_INET;
+        info->sin_port = (in_port_t) V_BYTESWAP_HTON_S16_GET(static_cast<Vs16>(portNumber));
+        info->sin_addr.s_addr = (ipAddress.isEmpty() ? INADDR_ANY : ::inet_addr(ipAddress));
+        return sizeof(struct sockaddr_in);
+    }
+
+    struct sockaddr_in6* info = reinterpret_cast<struct sockaddr_in6*>(&addr);
+    info->sin6_family = AF_INET6;
+    info->sin6_port = (in_port_t) V_BYTESWAP_HTON_S16_GET(static_cast<Vs16>(portNumber));
+    if (::inet_pton(AF_INET6, ipAddress, &info->sin6_addr) != 1) {
+        throw VException(VSystemError::getSocketError(), VSTRING_FORMAT("VDatagramSocket: inet_pton(%s) failed.", ipAddress.chars()));
+    }
+
+    return sizeof(struct sockaddr_in6);
+}
+
+static const int MAX_ADDRSTRLEN = V_MAX(INET_ADDRSTRLEN, INET6_ADDRSTRLEN);
+// Converts a received socket address into a numeric address string and port.
+static void _sockAddrToIPAddress(const struct sockaddr_storage& addr, VString& ipAddress, int& portNumber) {
+    char buffer[MAX_ADDRSTRLEN];
+    const char* result = NULL;
+
+    if (addr.ss_family == AF_INET6) {
+        const struct sockaddr_in6* info = reinterpret_cast<const struct sockaddr_in6*>(&addr);
+        result = ::inet_ntop(AF_INET6, (void*) &info->sin6_addr, buffer, MAX_ADDRSTRLEN);
+        portNumber = (int) (Vu16) V_BYTESWAP_NTOH_S16_GET(static_cast<Vs16>(info->sin6_port));
+    } else {
+        const struct sockaddr_in* info = reinterpret_cast<const struct sockaddr_in*>(&addr);
+        result = ::inet_ntop(AF_INET, (void*) &info->sin_addr, buffer, MAX_ADDRSTRLEN);
+        portNumber = (int) (Vu16) V_BYTESWAP_NTOH_S16_GET(static_cast<Vs16>(info->sin_port));
+    }
+
+    if (result == NULL) {
+        ipAddress = VString::EMPTY();
+    } else {
+        ipAddress.copyFromCString(result);
+    }
+}
+
+// VDatagramSocket ------------------------------------------------------------
+
+VDatagramSocket::VDatagramSocket(int maxDatagramSize, int batchSize)
+    : VSocket()
+    , mMaxDatagramSize(maxDatagramSize)
+    , mBatchSize(V_MAX(1, batchSize))
+    , mLocalPortNumber(0)
+    , mAddressFamily(AF_UNSPEC)
+    , mReceivePool()
+    , mNumReceivedDatagrams(0)
+    , mPeerAddresses(static_cast<size_t>(mBatchSize))
+    , mPeerAddressLengths(static_cast<size_t>(mBatchSize))
+#ifdef VSOCKET_MMSG_SUPPORTED
+    , mMessageHeaders(static_cast<size_t>(mBatchSize))
+    , mIOVectors(static_cast<size_t>(mBatchSize))
+#endif
+    , mNumDatagramsRead(0)
+    , mNumDatagramsWritten(0)
+    {
+    for (int i = 0; i < mBatchSize; ++i) {
+        mReceivePool.push_back(new VDatagram(mMaxDatagramSize));
+    }
+}
+
+VDatagramSocket::~VDatagramSocket() {
+    vault::vectorDeleteAll(mReceivePool);
+}
+
+void VDatagramSocket::bind(const VString& bindAddress, int portNumber) {
+    struct sockaddr_storage info;
+    VSocklenT               infoLength = _ipAddressToSockAddr(bindAddress, portNumber, info);
+
+    this->_open(info.ss_family);
+
+    int result = ::bind(mSocketID, (const sockaddr*) &info, infoLength);
+    if (result != 0) {
+        throw VStackTraceException(VSystemError::getSocketError(), VSTRING_FORMAT("VDatagramSocket[%s] bind: bind() failed for %s:%d. Result=%d.", mSocketName.chars(), bindAddress.chars(), portNumber, result));
+    }
+
+    // Find out what port we got, in case the OS chose it.
+    infoLength = sizeof(info);
+    result = ::getsockname(mSocketID, (struct sockaddr*) &info, &infoLength);
+    if (result != 0) {
+        throw VStackTraceException(VSystemError::getSocketError(), VSTRING_FORMAT("VDatagramSocket[%s] bind: getsockname() failed. Result=%d.", mSocketName.chars(), result));
+    }
+
+    VString boundAddress;
+    _sockAddrToIPAddress(info, boundAddress, mLocalPortNumber);
+
+    if (mSocketName.isEmpty()) {
+        mSocketName.format("udp(%s:%d)", boundAddress.chars(), mLocalPortNumber);
+    }
+}
+
+int VDatagramSocket::send(const Vu8* buffer, int numBytesToSend) {
+    VDatagram           datagram(buffer, numBytesToSend);
+    VDatagramPtrVector  datagrams(1, &datagram);
+
+    (void) this->sendBatch(datagrams);
+
+    return numBytesToSend;
+}
+
+int VDatagramSocket::sendBatch(const VDatagramPtrVector& datagrams) {
+    int numDatagramsToSend = static_cast<int>(datagrams.size());
+    int numDatagramsSent = 0;
+
+    this->_checkAddressFamilies(datagrams);
+
+    while (numDatagramsSent < numDatagramsToSend) {
+        this->_waitForWritable();
+        numDatagramsSent += this->_sendSome(datagrams, numDatagramsSent, V_MIN(mBatchSize, numDatagramsToSend - numDatagramsSent));
+    }
+
+    mLastEventTime.setNow();
+
+    return numDatagramsSent;
+}
+
+int VDatagramSocket::receiveBatch() {
+    if (! VSocket::_platform_isSocketIDValid(mSocketID)) {
+        throw VStackTraceException(VSTRING_FORMAT("VDatagramSocket[%s] receiveBatch: Invalid socket ID %d. Call bind() first.", mSocketName.chars(), mSocketID));
+    }
+
+    mNumReceivedDatagrams = 0;
+
+    fd_set readset;
+    for (;;) {
+        FD_ZERO(&readset);
+        FD_SET(mSocketID, &readset);
+        struct timeval timeout = mReadTimeOut; // select() may modify it
+        int result = ::select(SelectSockIDTypeCast (mSocketID + 1), &readset, NULL, NULL, (mReadTimeOutActive ? &timeout : NULL));
+
+        if (result < 0) {
+            VSystemError e = VSystemError::getSocketError();
+            if (e.isLikePosixError(EINTR)) {
+                continue;
+            }
+
+            if (e.isLikePosixError(EBADF)) {
+                throw VSocketClosedException(e, VSTRING_FORMAT("VDatagramSocket[%s] receiveBatch: Socket has closed (EBADF).", mSocketName.chars()));
+            } else {
+                throw VException(e, VSTRING_FORMAT("VDatagramSocket[%s] receiveBatch: Select failed. Result=%d.", mSocketName.chars(), result));
+            }
+        } else if (result == 0) {
+            return 0; // Timed out, which is normal if we have a timeout value.
+        }
+
+        break;
+    }
+
+    mNumReceivedDatagrams = this->_receiveSome();
+
+    if (mNumReceivedDatagrams > 0) {
+        mLastEventTime.setNow();
+    }
+
+    return mNumReceivedDatagrams;
+}
+
+const VDatagram& VDatagramSocket::getReceivedDatagram(int index) const {
+    if ((index < 0) || (index >= mNumReceivedDatagrams)) {
+        throw VRangeException(VSTRING_FORMAT("VDatagramSocket[%s] getReceivedDatagram: Index %d is out of range; %d datagrams were received.", mSocketName.chars(), index, mNumReceivedDatagrams));
+    }
+
+    return *(mReceivePool[index]);
+}
+
+void VDatagramSocket::_open(int family) {
+    if (mSocketID != kNoSocketID) {
+        return;
+    }
+
+    VSocketID socketID = ::socket(family, SOCK_DGRAM, 0);
+    if (! VSocket::_platform_isSocketIDValid(socketID)) {
+        throw VStackTraceException(VSystemError::getSocketError(), VSTRING_FORMAT("VDatagramSocket[%s] open: socket() failed. Result=%d.", mSocketName.chars(), socketID));
+    }
+
+    mSocketID = socketID;
+    mAddressFamily = family;
+
+#ifdef VPLATFORM_MAC
+    // See VSocket::setDefaultSockOpt().
+    this->setIntSockOpt(SOL_SOCKET, SO_NOSIGPIPE, 1);
+#endif
+}
+
+void VDatagramSocket::_waitForWritable() {
+    if (mSocketID == kNoSocketID) {
+        return; // _sendSome() will open the socket for the first destination's address family
+    }
+
+    fd_set writeset;
+    for (;;) {
+        FD_ZERO(&writeset);
+        FD_SET(mSocketID, &writeset);
+        struct timeval timeout = mWriteTimeOut; // select() may modify it
+        int result = ::select(SelectSockIDTypeCast (mSocketID + 1), NULL, &writeset, NULL, (mWriteTimeOutActive ? &timeout : NULL));
+
+        if (result < 0) {
+            VSystemError e = VSystemError::getSocketError();
+            if (e.isLikePosixError(EINTR)) {
+                continue;
+            }
+
+            if (e.isLikePosixError(EBADF)) {
+                throw VSocketClosedException(e, VSTRING_FORMAT("VDatagramSocket[%s] sendBatch: Socket has closed (EBADF).", mSocketName.chars()));
+            } else {
+                throw VException(e, VSTRING_FORMAT("VDatagramSocket[%s] sendBatch: select() failed. Result=%d.", mSocketName.chars(), result));
+            }
+        } else if (result == 0) {
+            throw VException(VSTRING_FORMAT("VDatagramSocket[%s] sendBatch: Select timed out.", mSocketName.chars()));
+        }
+
+        return;
+    }
+}
+
+void VDatagramSocket::_checkAddressFamilies(const VDatagramPtrVector& datagrams) const {
+    int family = (mSocketID == kNoSocketID) ? AF_UNSPEC : mAddressFamily;
+    const VString* previousAddress = NULL;
+    for (VDatagramPtrVector::const_iterator i = datagrams.begin(); i != datagrams.end(); ++i) {
+        const VString& hostIPAddress = ((*i)->mHostIPAddress.isEmpty() ? mHostIPAddress : (*i)->mHostIPAddress);
+        if ((previousAddress != NULL) && (hostIPAddress == *previousAddress)) {
+            continue;
+        }
+
+        previousAddress = &hostIPAddress;
+        if (hostIPAddress.isEmpty()) {
+            continue; // _sendSome() reports it
+        }
+
+        int datagramFamily = VSocket::isIPv4NumericString(hostIPAddress) ? AF_INET : AF_INET6;
+        if (family == AF_UNSPEC) {
+            family = datagramFamily;
+        } else if (datagramFamily != family) {
+            throw VException(VSTRING_FORMAT("VDatagramSocket[%s] sendBatch: Cannot send to %s on an %s socket. Use a separate socket for each address family.",
+                mSocketName.chars(), hostIPAddress.chars(), (family == AF_INET) ? "IPv4" : "IPv6"));
+        }
+    }
+}
+
+int VDatagramSocket::_sendSome(const VDatagramPtrVector& datagrams, int start, int count) {
+    // Resolve each destination. Consecutive datagrams to the same address (the usual case) reuse the previous result.
+    const VString* previousAddress = NULL;
+    int previousPortNumber = 0;
+    for (int i = 0; i < count; ++i) {
+        const VDatagram* datagram = datagrams[start + i];
+        const VString& hostIPAddress = (datagram->mHostIPAddress.isEmpty() ? mHostIPAddress : datagram->mHostIPAddress);
+        int portNumber = (datagram->mHostIPAddress.isEmpty() ? mPortNumber : datagram->mPortNumber);
+
+        if (hostIPAddress.isEmpty()) {
+            throw VStackTraceException(VSTRING_FORMAT("VDatagramSocket[%s] sendBatch: Datagram has no destination address and none was set for the socket.", mSocketName.chars()));
+        }
+
+        if ((previousAddress != NULL) && (portNumber == previousPortNumber) && (hostIPAddress == *previousAddress)) {
+            mPeerAddresses[i] = mPeerAddresses[i - 1];
+            mPeerAddressLengths[i] = mPeerAddressLengths[i - 1];
+        } else {
+            mPeerAddressLengths[i] = _ipAddressToSockAddr(hostIPAddress, portNumber, mPeerAddresses[i]);
+        }
+
+        previousAddress = &hostIPAddress;
+        previousPortNumber = portNumber;
+    }
+
+    this->_open(mPeerAddresses[0].ss_family);
+
+    int numDatagramsSent = 0;
+    Vs64 numBytesSent = 0;
+
+#ifdef VSOCKET_MMSG_SUPPORTED
+    for (int i = 0; i < count; ++i) {
+        const VDatagram* datagram = datagrams[start + i];
+        mIOVectors[i].iov_base = static_cast<void*>(datagram->mBuffer);
+        mIOVectors[i].iov_len = static_cast<size_t>(datagram->mLength);
+        ::memset(&mMessageHeaders[i], 0, sizeof(struct mmsghdr));
+        mMessageHeaders[i].msg_hdr.msg_name = static_cast<void*>(&mPeerAddresses[i]);
+        mMessageHeaders[i].msg_hdr.msg_namelen = mPeerAddressLengths[i];
+        mMessageHeaders[i].msg_hdr.msg_iov = &mIOVectors[i];
+        mMessageHeaders[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int result = ::sendmmsg(mSocketID, &mMessageHeaders[0], static_cast<unsigned int>(count), VSOCKET_DEFAULT_SEND_FLAGS);
+    if (result < 0) {
+        VSystemError e = VSystemError::getSocketError();
+        if (e.isLikePosixError(EINTR)) {
+            return 0;
+        }
+
+        throw VException(e, VSTRING_FORMAT("VDatagramSocket[%s] sendBatch: sendmmsg() failed.", mSocketName.chars()));
+    }
+
+    numDatagramsSent = result;
+    for (int i = 0; i < numDatagramsSent; ++i) {
+        numBytesSent += mMessageHeaders[i].msg_len;
+    }
+#else
+    for (int i = 0; i < count; ++i) {
+        const VDatagram* datagram = datagrams[start + i];
+        int result = SendRecvResultTypeCast ::sendto(mSocketID, SendBufferPtrTypeCast datagram->mBuffer, SendRecvByteCountTypeCast datagram->mLength, VSOCKET_DEFAULT_SEND_FLAGS, (const sockaddr*) &mPeerAddresses[i], mPeerAddressLengths[i]);
+        if (result < 0) {
+            VSystemError e = VSystemError::getSocketError();
+            if ((numDatagramsSent != 0) || e.isLikePosixError(EINTR)) {
+                break; // report what we sent; the caller will come back for the rest
+            }
+
+            throw VException(e, VSTRING_FORMAT("VDatagramSocket[%s] sendBatch: sendto() failed.", mSocketName.chars()));
+        }
+
+        ++numDatagramsSent;
+        numBytesSent += result;
+    }
+#endif
+
+    mNumBytesWritten += numBytesSent;
+    mNumDatagramsWritten += numDatagramsSent;
+
+    return numDatagramsSent;
+}
+
+int VDatagramSocket::_receiveSome() {
+    int numDatagramsReceived = 0;
+
+#ifdef VSOCKET_MMSG_SUPPORTED
+    for (int i = 0; i < mBatchSize; ++i) {
+        mIOVectors[i].iov_base = static_cast<void*>(mReceivePool[i]->mBuffer);
+        mIOVectors[i].iov_len = static_cast<size_t>(mReceivePool[i]->mCapacity);
+        ::memset(&mMessageHeaders[i], 0, sizeof(struct mmsghdr));
+        mMessageHeaders[i].msg_hdr.msg_name = static_cast<void*>(&mPeerAddresses[i]);
+        mMessageHeaders[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        mMessageHeaders[i].msg_hdr.msg_iov = &mIOVectors[i];
+        mMessageHeaders[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // We already know at least one datagram is waiting; take it and whatever else is queued, without blocking.
+    int result = ::recvmmsg(mSocketID, &mMessageHeaders[0], static_cast<unsigned int>(mBatchSize), MSG_DONTWAIT, NULL);
+    if (result < 0) {
+        VSystemError e = VSystemError::getSocketError();
+        if (e.isLikePosixError(EINTR) || e.isLikePosixError(EAGAIN) || e.isLikePosixError(EWOULDBLOCK)) {
+            return 0;
+        }
+
+        throw VException(e, VSTRING_FORMAT("VDatagramSocket[%s] receiveBatch: recvmmsg() failed.", mSocketName.chars()));
+    }
+
+    for (numDatagramsReceived = 0; numDatagramsReceived < result; ++numDatagramsReceived) {
+        VDatagram* datagram = mReceivePool[numDatagramsReceived];
+        datagram->mLength = static_cast<int>(mMessageHeaders[numDatagramsReceived].msg_len);
+        datagram->mTruncated = ((mMessageHeaders[numDatagramsReceived].msg_hdr.msg_flags & MSG_TRUNC) != 0);
+        _sockAddrToIPAddress(mPeerAddresses[numDatagramsReceived], datagram->mHostIPAddress, datagram->mPortNumber);
+        mNumBytesRead += datagram->mLength;
+    }
+#else
+    while (numDatagramsReceived < mBatchSize) {
+        // After the first datagram, which select() told us is waiting, only take what is already queued.
+        if (numDatagramsReceived != 0) {
+            fd_set readset;
+            FD_ZERO(&readset);
+            FD_SET(mSocketID, &readset);
+            struct timeval noWait = { 0, 0 };
+            if (::select(SelectSockIDTypeCast (mSocketID + 1), &readset, NULL, NULL, &noWait) <= 0) {
+                break;
+            }
+        }
+
+        VDatagram* datagram = mReceivePool[numDatagramsReceived];
+        VSocklenT addressLength = sizeof(struct sockaddr_storage);
+        int result = SendRecvResultTypeCast ::recvfrom(mSocketID, RecvBufferPtrTypeCast datagram->mBuffer, SendRecvByteCountTypeCast datagram->mCapacity, VSOCKET_DEFAULT_RECV_FLAGS, (struct sockaddr*) &mPeerAddresses[numDatagramsReceived], &addressLength);
+        datagram->mTruncated = false;
+
+        if (result < 0) {
+            VSystemError e = VSystemError::getSocketError();
+            if (e.isLikePosixError(EMSGSIZE)) {
+                // Winsock reports an oversized datagram this way; its buffer has been filled.
+                datagram->mTruncated = true;
+                result = datagram->mCapacity;
+            } else if ((numDatagramsReceived != 0) || e.isLikePosixError(EINTR)) {
+                break;
+            } else {
+                throw VException(e, VSTRING_FORMAT("VDatagramSocket[%s] receiveBatch: recvfrom() failed.", mSocketName.chars()));
+            }
+        }
+
+        datagram->mLength = result;
+        _sockAddrToIPAddress(mPeerAddresses[numDatagramsReceived], datagram->mHostIPAddress, datagram->mPortNumber);
+        mNumBytesRead += result;
+        ++numDatagramsReceived;
+    }
+#endif
+
+    mNumDatagramsRead += numDatagramsReceived;
+
+    return numDatagramsReceived;
+}
@@ -0,0 +1,296 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+#ifndef vdatagramsocket_h
+#define vdatagramsocket_h
+
+/** @file */
+
+#include "vsocket.h"
+
+/**
+    @ingroup vsocket
+*/
+
+/**
+VDatagram holds one UDP datagram: a buffer of fixed capacity, the number of
+bytes of it that are in use, and the address of the peer it came from or is
+to be sent to.
+
+VDatagramSocket owns a pool of these that it reuses for every received batch.
+To send, you construct your own and pass them to VDatagramSocket::sendBatch().
+*/
+class VDatagram {
+    public:
+
+        /**
+        Constructs an empty datagram with a buffer of the specified capacity.
+        @param  capacity    the maximum number of bytes the datagram can hold
+        */
+        VDatagram(int capacity);
+        /**
+        Constructs a datagram holding a copy of the specified data, to be sent
+        to the specified address. If the address is empty, the datagram is sent
+        to the sending socket's host IP address and port.
+        @param  data            the data to copy
+        @param  length          the number of bytes to copy
+        @param  hostIPAddress   the IPv4 or IPv6 numeric address to send to, or empty
+        @param  portNumber      the port number to send to
+        */
+        VDatagram(const Vu8* data, int length, const VString& hostIPAddress = VString::EMPTY(), int portNumber = 0);
+        /**
+        Destructor.
+        */
+        ~VDatagram();
+
+        /**
+        Returns a pointer to the datagram's data.
+        @return the data buffer
+        */
+        const Vu8* getData() const { return mBuffer; }
+        /**
+        Returns a pointer to the datagram's buffer so it can be filled in;
+        call setLength() afterwards.
+        @return the data buffer
+        */
+        Vu8* getBuffer() { return mBuffer; }
+        /**
+        Returns the number of bytes of data in the datagram.
+        @return the data length
+        */
+        int getLength() const { return mLength; }
+        /**
+        Sets the number of bytes of data in the datagram. Throws a VRangeException
+        if the length exceeds the buffer capacity.
+        @param  length  the data length
+        */
+        void setLength(int length);
+        /**
+        Returns the size of the datagram's buffer.
+        @return the capacity in bytes
+        */
+        int getCapacity() const { return mCapacity; }
+        /**
+        Returns true if the datagram was received with more bytes than its
+        buffer could hold, in which case the excess was discarded. Not every
+        platform reports this; where it doesn't, the excess is discarded silently.
+        @return obvious
+        */
+        bool isTruncated() const { return mTruncated; }
+        /**
+        Returns the address of the peer this datagram came from (for a received
+        datagram) or is to be sent to (for a datagram being sent).
+        @return the peer's IPv4 or IPv6 numeric address, possibly empty
+        */
+        const VString& getHostIPAddress() const { return mHostIPAddress; }
+        /**
+        Returns the port number of the peer; @see getHostIPAddress().
+        @return the peer's port number
+        */
+        int getPortNumber() const { return mPortNumber; }
+        /**
+        Sets the peer address; @see getHostIPAddress().
+        @param  hostIPAddress   the IPv4 or IPv6 numeric address
+        @param  portNumber      the port number
+        */
+        void setHostIPAddressAndPort(const VString& hostIPAddress, int portNumber);
+
+    private:
+
+        // Prevent copy construction and assignment since there is no provision for sharing the buffer.
+        VDatagram(const VDatagram& other);
+        VDatagram& operator=(const VDatagram& other);
+
+        friend class VDatagramSocket;
+
+        Vu8*    mBuffer;        ///< The data buffer, owned by this object.
+        int     mCapacity;      ///< The size of mBuffer.
+        int     mLength;        ///< The number of bytes of mBuffer in use.
+        bool    mTruncated;     ///< True if a received datagram did not fit in mBuffer.
+        VString mHostIPAddress; ///< The peer address.
+        int     mPortNumber;    ///< The peer port number.
+};
+
+/**
+VDatagramPtrVector is simply a vector of VDatagram object pointers.
+*/
+typedef std::vector<VDatagram*> VDatagramPtrVector;
+
+/**
+VDatagramSocket is a UDP socket that sends and receives datagrams in batches.
+On Linux each batch is a single sendmmsg() or recvmmsg() system call; on
+other platforms it is a loop of sendto() or recvfrom() calls. Received
+datagrams land in a pool of buffers that the socket allocates once, at
+construction, and reuses for every batch, so steady-state receiving does
+no allocation.
+
+It is a VSocket so that it has the same naming, byte counters, idle time,
+and VSocketInfo support as a TCP socket. However, the stream-oriented
+VSocket read() and write() APIs are not meaningful for it; use
+receiveBatch() and sendBatch() instead.
+
+To receive, call bind() and then loop on receiveBatch(), examining each
+received datagram with getReceivedDatagram(). Usually you will let a
+VDatagramListenerThread do this for you. To send, optionally call bind()
+to choose the local address, call setHostIPAddressAndPort() to set the
+default destination, and call send() or sendBatch().
+
+@see    VDatagramListenerThread
+*/
+class VDatagramSocket : public VSocket {
+    public:
+
+        /**
+        Constructs the socket and its receive buffer pool. The underlying
+        socket is not created until bind() or the first send.
+        @param  maxDatagramSize the size of each pooled receive buffer; larger
+                                incoming datagrams are truncated
+        @param  batchSize       the maximum number of datagrams moved per
+                                system call (and the number of pooled buffers)
+        */
+        VDatagramSocket(int maxDatagramSize = kDefaultMaxDatagramSize, int batchSize = kDefaultBatchSize);
+        /**
+        Destructor.
+        */
+        virtual ~VDatagramSocket();
+
+        /**
+        Creates the socket if necessary and binds it to a local address and port.
+        @param  bindAddress if empty, the socket will bind to INADDR_ANY; if a value
+                            is supplied the socket will bind to the supplied IPv4 or
+                            IPv6 address
+        @param  portNumber  the local port to bind to; 0 lets the OS choose, in which
+                            case getLocalPortNumber() tells you what it chose
+        */
+        void bind(const VString& bindAddress, int portNumber);
+        /**
+        Returns the local port number the socket is bound to, or 0 if not bound.
+        @return the local port number
+        */
+        int getLocalPortNumber() const { return mLocalPortNumber; }
+
+        /**
+        Sends one datagram to the socket's host IP address and port, as set by
+        setHostIPAddressAndPort().
+        @param  buffer          the data to send
+        @param  numBytesToSend  the number of bytes to send as one datagram
+        @return the number of bytes sent
+        */
+        int send(const Vu8* buffer, int numBytesToSend);
+        /**
+        Sends a batch of datagrams. Each datagram goes to its own address, or
+        to the socket's host IP address and port if its address is empty.
+        If there are more datagrams than the batch size, they are sent in
+        as many system calls as needed.
+
+        If you don't have a write timeout set up for this socket, then this
+        will block until all datagrams have been handed to the OS.
+
+        A socket has one address family, that of its bind() address or else of
+        the first datagram it sends. If any datagram's destination is of the
+        other family, a VException is thrown and none of the batch is sent;
+        use a separate socket for each family.
+
+        @param  datagrams   the datagrams to send
+        @return the number of datagrams sent
+        */
+        int sendBatch(const VDatagramPtrVector& datagrams);
+        /**
+        Waits for incoming datagrams and receives up to the batch size of them
+        into the pooled buffers, replacing the previous batch. The wait is
+        limited by the read timeout, if one is set; only the first datagram
+        is waited for, and the rest are whatever is already queued.
+        @return the number of datagrams received; 0 if the read timeout elapsed
+        */
+        int receiveBatch();
+        /**
+        Returns the number of datagrams received by the last receiveBatch().
+        @return the number of valid received datagrams
+        */
+        int getNumReceivedDatagrams() const { return mNumReceivedDatagrams; }
+        /**
+        Returns one of the datagrams received by the last receiveBatch(). It
+        remains valid until the next call to receiveBatch().
+        @param  index   the datagram index, from 0 to getNumReceivedDatagrams() - 1
+        @return the received datagram
+        */
+        const VDatagram& getReceivedDatagram(int index) const;
+
+        /**
+        Returns the number of datagrams that have been received on this socket.
+        @return the number of datagrams received
+        */
+        Vs64 numDatagramsRead() const { return mNumDatagramsRead; }
+        /**
+        Returns the number of datagrams that have been sent on this socket.
+        @return the number of datagrams sent
+        */
+        Vs64 numDatagramsWritten() const { return mNumDatagramsWritten; }
+        /**
+        Returns the size of each pooled receive buffer.
+        @return the maximum received datagram size
+        */
+        int getMaxDatagramSize() const { return mMaxDatagramSize; }
+        /**
+        Returns the maximum number of datagrams moved per system call.
+        @return the batch size
+        */
+        int getBatchSize() const { return mBatchSize; }
+
+        static const int kDefaultMaxDatagramSize = 2048;    ///< The default receive buffer size; comfortably more than an ethernet MTU.
+        static const int kDefaultBatchSize = 32;            ///< The default number of datagrams per system call.
+
+    private:
+
+        // Prevent copy construction and assignment since there is no provision for sharing the buffer pool.
+        VDatagramSocket(const VDatagramSocket& other);
+        VDatagramSocket& operator=(const VDatagramSocket& other);
+
+        /**
+        Creates the underlying socket for the specified address family, if it
+        does not exist yet.
+        @param  family  AF_INET or AF_INET6
+        */
+        void _open(int family);
+        /**
+        Waits until the socket is writable, honoring the write timeout.
+        */
+        void _waitForWritable();
+        /**
+        Throws a VException if the datagrams' destinations are not all of one
+        address family, matching the socket's if it has been created.
+        */
+        void _checkAddressFamilies(const VDatagramPtrVector& datagrams) const;
+        /**
+        Sends datagrams [start, start + count) in one system call if possible;
+        count must not exceed the batch size.
+        @return the number of datagrams sent; 0 if interrupted
+        */
+        int _sendSome(const VDatagramPtrVector& datagrams, int start, int count);
+        /**
+        Receives up to the batch size of datagrams that are already queued.
+        @return the number of datagrams received, possibly 0
+        */
+        int _receiveSome();
+
+        int                                     mMaxDatagramSize;       ///< The size of each pooled receive buffer.
+        int                                     mBatchSize;             ///< The maximum number of datagrams per system call.
+        int                                     mLocalPortNumber;       ///< The port we are bound to, or 0.
+        int                                     mAddressFamily;         ///< AF_INET or AF_INET6, once the underlying socket has been created.
+        VDatagramPtrVector                      mReceivePool;           ///< The pooled buffers for received datagrams.
+        int                                     mNumReceivedDatagrams;  ///< The number of mReceivePool elements filled by the last receive.
+        std::vector<struct sockaddr_storage>    mPeerAddresses;         ///< Pooled peer addresses, one per batch slot.
+        std::vector<VSocklenT>                  mPeerAddressLengths;    ///< Pooled peer address lengths for sending, one per batch slot.
+#ifdef VSOCKET_MMSG_SUPPORTED
+        std::vector<struct mmsghdr>             mMessageHeaders;        ///< Pooled sendmmsg()/recvmmsg() headers, one per batch slot.
+        std::vector<struct iovec>               mIOVectors;             ///< Pooled buffer descriptors, one per batch slot.
+#endif
+        Vs64                                    mNumDatagramsRead;      ///< Number of datagrams received on this socket.
+        Vs64                                    mNumDatagramsWritten;   ///< Number of datagrams sent on this socket.
+};
+
+#endif /* vdatagramsocket_h */
@@ -12,14 +12,136 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 
 #include "vexception.h"
 #include "vmutexlocker.h"
+#include "vsettings.h"
+#include "vthreadpool.h"
 
 V_STATIC_INIT_TRACE
 
 // This is to force our _platform_staticInit to be called at startup.
 bool VSocket::gStaticInited = VSocket::_platform_staticInit();
 
+// VSocketTuningProfile -------------------------------------------------------
+
+VSocketTuningProfile::VSocketTuningProfile()
+    : mName("default")
+    , mReceiveBufferSize(VSocket::kDefaultBufferSize)
+    , mSendBufferSize(VSocket::kDefaultBufferSize)
+    , mServiceType(VSocket::kDefaultServiceType)
+    , mNoDelay(VSocket::kDefaultNoDelay != 0)
+    , mQuickAck(false)
+    , mCork(false)
+    , mBusyPollMicroseconds(0)
+    , mKeepAlive(false)
+    , mKeepAliveIdleSeconds(0)
+    , mKeepAliveIntervalSeconds(0)
+    , mKeepAliveCount(0)
+    {
+}
+
+VSocketTuningProfile::VSocketTuningProfile(const VSettingsNode& settings)
+    : mName()
+    , mReceiveBufferSize(0)
+    , mSendBufferSize(0)
+    , mServiceType(-1)
+    , mNoDelay(false)
+    , mQuickAck(false)
+    , mCork(false)
+    , mBusyPollMicroseconds(0)
+    , mKeepAlive(false)
+    , mKeepAliveIdleSeconds(0)
+    , mKeepAliveIntervalSeconds(0)
+    , mKeepAliveCount(0)
+    {
+    *this = VSocketTuningProfile::forName(settings.getString("profile", "default"));
+
+    mName = settings.getString("name", mName);
+    mReceiveBufferSize = settings.getInt("receive-buffer-size", mReceiveBufferSize);
+    mSendBufferSize = settings.getInt("send-buffer-size", mSendBufferSize);
+    mServiceType = settings.getInt("service-type", mServiceType);
+    mNoDelay = settings.getBoolean("no-delay", mNoDelay);
+    mQuickAck = settings.getBoolean("quick-ack", mQuickAck);
+    mCork = settings.getBoolean("cork", mCork);
+    mBusyPollMicroseconds = settings.getInt("busy-poll-usec", mBusyPollMicroseconds);
+    mKeepAlive = settings.getBoolean("keep-alive", mKeepAlive);
+    mKeepAliveIdleSeconds = settings.getInt("keep-alive-idle-sec", mKeepAliveIdleSeconds);
+    mKeepAliveIntervalSeconds = settings.getInt("keep-alive-interval-sec", mKeepAliveIntervalSeconds);
+    mKeepAliveCount = settings.getInt("keep-alive-count", mKeepAliveCount);
+}
+
+// static
+VSocketTuningProfile VSocketTuningProfile::forName(const VString& name) {
+    if (name == DEFAULT().mName) {
+        return DEFAULT();
+    } else if (name == LOW_LATENCY().mName) {
+        return LOW_LATENCY();
+    } else if (name == BULK_THROUGHPUT().mName) {
+        return BULK_THROUGHPUT();
+    } else if (name == MANY_IDLE().mName) {
+        return MANY_IDLE();
+    }
+
+    throw VRangeException(VSTRING_FORMAT("VSocketTuningProfile::forName: Unknown profile '%s'.", name.chars()));
+}
+
+// static
+const VSocketTuningProfile& VSocketTuningProfile::DEFAULT() {
+    static const VSocketTuningProfile kDefault;
+    return kDefault;
+}
+
+static VSocketTuningProfile _newLowLatencyProfile() {
+    VSocketTuningProfile profile;
+    profile.mName = "low-latency";
+    profile.mServiceType = 0x10; // IPTOS_LOWDELAY
+    profile.mNoDelay = true;
+    profile.mQuickAck = true;
+    profile.mBusyPollMicroseconds = 50;
+    return profile;
+}
+
+// static
+const VSocketTuningProfile& VSocketTuningProfile::LOW_LATENCY() {
+    static const VSocketTuningProfile kLowLatency = _newLowLatencyProfile();
+    return kLowLatency;
+}
+
+static VSocketTuningProfile _newBulkThroughputProfile() {
+    VSocketTuningProfile profile;
+    profile.mName = "bulk-throughput";
+    profile.mReceiveBufferSize = 0;
+    profile.mSendBufferSize = 0;
+    profile.mNoDelay = false;
+    return profile;
+}
+
+// static
+const VSocketTuningProfile& VSocketTuningProfile::BULK_THROUGHPUT() {
+    static const VSocketTuningProfile kBulkThroughput = _newBulkThroughputProfile();
+    return kBulkThroughput;
+}
+
+static VSocketTuningProfile _newManyIdleProfile() {
+    VSocketTuningProfile profile;
+    profile.mName = "many-idle";
+    profile.mReceiveBufferSize = 16384;
+    profile.mSendBufferSize = 16384;
+    profile.mKeepAlive = true;
+    profile.mKeepAliveIdleSeconds = 60;
+    profile.mKeepAliveIntervalSeconds = 10;
+    profile.mKeepAliveCount = 6;
+    return profile;
+}
+
+// static
+const VSocketTuningProfile& VSocketTuningProfile::MANY_IDLE() {
+    static const VSocketTuningProfile kManyIdle = _newManyIdleProfile();
+    return kManyIdle;
+}
+
 // VSocket ----------------------------------------------------------------
 
+const int VSocket::kStatisticsSampleIntervalMilliseconds = 5000;
+
 VString VSocket::gPreferredNetworkInterfaceName("en0");
 VString VSocket::gPreferredLocalIPAddressPrefix;
 VString VSocket::gCachedLocalHostIPAddress;
@@ -230,6 +352,15 @@ VSocket::VSocket()
     , mNumBytesWritten(0)
     , mLastEventTime()
     , mSocketName()
+    , mLocalPath()
+    , mTuningProfile()
+    , mStatisticsMutex("VSocket::mStatisticsMutex", true/*suppressLogging*/)
+    , mTCPInfo()
+    , mLastSampleTime()
+    , mLastSampleNumBytesRead(0)
+    , mLastSampleNumBytesWritten(0)
+    , mReadBytesPerSecond(0)
+    , mWriteBytesPerSecond(0)
     {
 }
 
@@ -246,6 +377,15 @@ VSocket::VSocket(VSocketID id)
     , mNumBytesWritten(0)
     , mLastEventTime()
     , mSocketName()
+    , mLocalPath()
+    , mTuningProfile()
+    , mStatisticsMutex("VSocket::mStatisticsMutex", true/*suppressLogging*/)
+    , mTCPInfo()
+    , mLastSampleTime()
+    , mLastSampleNumBytesRead(0)
+    , mLastSampleNumBytesWritten(0)
+    , mReadBytesPerSecond(0)
+    , mWriteBytesPerSecond(0)
     {
 }
 
@@ -259,6 +399,88 @@ void VSocket::setHostIPAddressAndPort(const VString& hostIPAddress, int portNumb
     mSocketName.format("%s:%d", hostIPAddress.chars(), portNumber);
 }
 
+void VSocket::setLocalPath(const VString& path) {
+    mHostIPAddress = path;
+    mPortNumber = 0;
+    mLocalPath = path;
+    mSocketName = path;
+}
+
+#ifdef VSOCKET_LOCAL_DOMAIN_SUPPORTED
+// Fills in a Unix domain socket address for a path; returns the address length.
+static VSocklenT _localPathToSockAddr(const VString& path, struct sockaddr_un& info) {
+    ::memset(&info, 0, sizeof(info));
+    info.sun_family = AF_UNIX;
+
+    if ((path.length() == 0) || (path.length() >= (int) sizeof(info.sun_path))) {
+        throw VRangeException(VSTRING_FORMAT("VSocket: Local socket path '%s' is empty or longer than the limit of %d bytes.", path.chars(), (int) sizeof(info.sun_path) - 1));
+    }
+
+    ::memcpy(info.sun_path, path.chars(), static_cast<size_t>(path.length()));
+    return sizeof(info);
+}
+
+// static
+void VSocket::_removeStaleLocalSocketFile(const VString& socketName, const VString& path) {
+    struct sockaddr_un  info;
+    VSocklenT           infoLength = _localPathToSockAddr(path, info);
+
+    struct stat pathInfo;
+    if (::lstat(path.chars(), &pathInfo) != 0) {
+        return; // Nothing there. If something else prevents binding, bind() will say so.
+    }
+
+    if (! S_ISSOCK(pathInfo.st_mode)) {
+        throw VStackTraceException(VSTRING_FORMAT("VSocket[%s] listen: Address in use: '%s' exists and is not a socket.", socketName.chars(), path.chars()));
+    }
+
+    VSocketID probeSockID = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (! VSocket::_platform_isSocketIDValid(probeSockID)) {
+        throw VStackTraceException(VSystemError::getSocketError(), VSTRING_FORMAT("VSocket[%s] listen: socket() failed. Result=%d.", socketName.chars(), probeSockID));
+    }
+
+    int result = ::connect(probeSockID, (const sockaddr*) &info, infoLength);
+    VSystemError e = VSystemError::getSocketError(); // Call before calling vault::closeSocket(), which will succeed and clear the error code!
+    vault::closeSocket(probeSockID);
+
+    if (result == 0) {
+        throw VStackTraceException(VSTRING_FORMAT("VSocket[%s] listen: Address in use: another listener is accepting connections at '%s'.", socketName.chars(), path.chars()));
+    }
+
+    if (e.isLikePosixError(ECONNREFUSED)) {
+        (void) VFileSystem::unlink(path);
+    }
+}
+#endif
+
+void VSocket::connectToLocalPath(const VString& path) {
+#ifndef VSOCKET_LOCAL_DOMAIN_SUPPORTED
+    throw VUnimplementedException(VSTRING_FORMAT("VSocket::connectToLocalPath(%s): Unix domain sockets are not supported on this platform.", path.chars()));
+#else
+    this->setLocalPath(path);
+
+    struct sockaddr_un  info;
+    VSocklenT           infoLength = _localPathToSockAddr(path, info);
+    VSocketID           socketID = ::socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (! VSocket::_platform_isSocketIDValid(socketID)) {
+        throw VException(VSystemError::getSocketError(), VSTRING_FORMAT("VSocket[%s] connectToLocalPath: socket() failed. Result=%d.", mSocketName.chars(), socketID));
+    }
+
+    int result = ::connect(socketID, (const sockaddr*) &info, infoLength);
+
+    if (result != 0) {
+        // Connect failed.
+        VSystemError e = VSystemError::getSocketError(); // Call before calling vault::closeSocket(), which will succeed and clear the error code!
+        vault::closeSocket(socketID);
+        throw VException(e, VSTRING_FORMAT("VSocket[%s] connectToLocalPath: Connect failed.", mSocketName.chars()));
+    }
+
+    mSocketID = socketID;
+    this->setDefaultSockOpt();
+#endif
+}
+
 void VSocket::connectToIPAddress(const VString& ipAddress, int portNumber) {
     this->_connectToIPAddress(ipAddress, portNumber);
     this->setDefaultSockOpt();
@@ -330,13 +552,25 @@ void VSocket::setWriteTimeOut(const struct timeval& timeout) {
 }
 
 void VSocket::setDefaultSockOpt() {
+    const VSocketTuningProfile& profile = mTuningProfile;
+
     // set buffer sizes
-    this->setIntSockOpt(SOL_SOCKET, SO_RCVBUF, kDefaultBufferSize);
-    this->setIntSockOpt(SOL_SOCKET, SO_SNDBUF, kDefaultBufferSize);
+    if (profile.mReceiveBufferSize > 0) {
+        this->setIntSockOpt(SOL_SOCKET, SO_RCVBUF, profile.mReceiveBufferSize);
+    }
+
+    if (profile.mSendBufferSize > 0) {
+        this->setIntSockOpt(SOL_SOCKET, SO_SNDBUF, profile.mSendBufferSize);
+    }
+
+    // The IP and TCP options below don't apply to Unix domain sockets.
+    bool isIPSocket = ! this->isLocal();
 
 #ifndef VPLATFORM_WIN
     // set type of service
-    this->setIntSockOpt(IPPROTO_IP, IP_TOS, kDefaultServiceType);
+    if (isIPSocket && (profile.mServiceType >= 0)) {
+        this->setIntSockOpt(IPPROTO_IP, IP_TOS, profile.mServiceType);
+    }
 #endif
 
 #ifdef VPLATFORM_MAC
@@ -348,8 +582,60 @@ void VSocket::setDefaultSockOpt() {
     this->setIntSockOpt(SOL_SOCKET, SO_NOSIGPIPE, 1);
 #endif
 
+    if (! isIPSocket) {
+        return;
+    }
+
     // set no delay
-    this->setIntSockOpt(IPPROTO_TCP, TCP_NODELAY, kDefaultNoDelay);
+    this->setIntSockOpt(IPPROTO_TCP, TCP_NODELAY, profile.mNoDelay ? 1 : 0);
+
+#ifdef TCP_QUICKACK
+    if (profile.mQuickAck) {
+        this->setIntSockOpt(IPPROTO_TCP, TCP_QUICKACK, 1);
+    }
+#endif
+
+#if defined(TCP_CORK)
+    if (profile.mCork) {
+        this->setIntSockOpt(IPPROTO_TCP, TCP_CORK, 1);
+    }
+#elif defined(TCP_NOPUSH)
+    if (profile.mCork) {
+        this->setIntSockOpt(IPPROTO_TCP, TCP_NOPUSH, 1);
+    }
+#endif
+
+#ifdef SO_BUSY_POLL
+    if (profile.mBusyPollMicroseconds > 0) {
+        this->setIntSockOpt(SOL_SOCKET, SO_BUSY_POLL, profile.mBusyPollMicroseconds);
+    }
+#endif
+
+    if (profile.mKeepAlive) {
+        this->setIntSockOpt(SOL_SOCKET, SO_KEEPALIVE, 1);
+
+#if defined(TCP_KEEPIDLE)
+        if (profile.mKeepAliveIdleSeconds > 0) {
+            this->setIntSockOpt(IPPROTO_TCP, TCP_KEEPIDLE, profile.mKeepAliveIdleSeconds);
+        }
+#elif defined(VPLATFORM_MAC) && defined(TCP_KEEPALIVE)
+        if (profile.mKeepAliveIdleSeconds > 0) {
+            this->setIntSockOpt(IPPROTO_TCP, TCP_KEEPALIVE, profile.mKeepAliveIdleSeconds);
+        }
+#endif
+
+#ifdef TCP_KEEPINTVL
+        if (profile.mKeepAliveIntervalSeconds > 0) {
+            this->setIntSockOpt(IPPROTO_TCP, TCP_KEEPINTVL, profile.mKeepAliveIntervalSeconds);
+        }
+#endif
+
+#ifdef TCP_KEEPCNT
+        if (profile.mKeepAliveCount > 0) {
+            this->setIntSockOpt(IPPROTO_TCP, TCP_KEEPCNT, profile.mKeepAliveCount);
+        }
+#endif
+    }
 }
 
 Vs64 VSocket::numBytesRead() const {
@@ -365,6 +651,45 @@ VDuration VSocket::getIdleTime() const {
     return now - mLastEventTime;
 }
 
+void VSocket::sampleStatistics() {
+    VSocketTCPInfo info;
+    if (mSocketID != kNoSocketID) {
+        (void) this->_platform_getTCPInfo(info);
+    }
+
+    Vs64 numBytesRead = mNumBytesRead;
+    Vs64 numBytesWritten = mNumBytesWritten;
+    VInstant now;
+
+    VMutexLocker locker(&mStatisticsMutex, "VSocket::sampleStatistics()");
+    mTCPInfo = info;
+
+    Vs64 elapsedMilliseconds = (now - mLastSampleTime).getDurationMilliseconds();
+    // Rates computed over less than a millisecond would be meaningless, so keep the previous ones until time advances.
+    if (elapsedMilliseconds > 0) {
+        mReadBytesPerSecond = ((numBytesRead - mLastSampleNumBytesRead) * CONST_S64(1000)) / elapsedMilliseconds;
+        mWriteBytesPerSecond = ((numBytesWritten - mLastSampleNumBytesWritten) * CONST_S64(1000)) / elapsedMilliseconds;
+        mLastSampleTime = now;
+        mLastSampleNumBytesRead = numBytesRead;
+        mLastSampleNumBytesWritten = numBytesWritten;
+    }
+}
+
+VSocketTCPInfo VSocket::getTCPInfo() const {
+    VMutexLocker locker(&mStatisticsMutex, "VSocket::getTCPInfo()");
+    return mTCPInfo;
+}
+
+Vs64 VSocket::getReadBytesPerSecond() const {
+    VMutexLocker locker(&mStatisticsMutex, "VSocket::getReadBytesPerSecond()");
+    return mReadBytesPerSecond;
+}
+
+Vs64 VSocket::getWriteBytesPerSecond() const {
+    VMutexLocker locker(&mStatisticsMutex, "VSocket::getWriteBytesPerSecond()");
+    return mWriteBytesPerSecond;
+}
+
 int VSocket::read(Vu8* buffer, int numBytesToRead) {
     if (! VSocket::_platform_isSocketIDValid(mSocketID)) {
         throw VStackTraceException(VSTRING_FORMAT("VSocket[%s] read: Invalid socket ID %d.", mSocketName.chars(), mSocketID));
@@ -428,6 +753,37 @@ int VSocket::read(Vu8* buffer, int numBytesToRead) {
     return (numBytesToRead - bytesRemainingToRead);
 }
 
+void VSocket::waitForData() {
+    if (! VSocket::_platform_isSocketIDValid(mSocketID)) {
+        throw VStackTraceException(VSTRING_FORMAT("VSocket[%s] waitForData: Invalid socket ID %d.", mSocketName.chars(), mSocketID));
+    }
+
+    fd_set readset;
+
+    for (;;) {
+        FD_ZERO(&readset);
+        FD_SET(mSocketID, &readset);
+        int result = ::select(SelectSockIDTypeCast (mSocketID + 1), &readset, NULL, NULL, (mReadTimeOutActive ? &mReadTimeOut : NULL));
+
+        if (result < 0) {
+            VSystemError e = VSystemError::getSocketError();
+            if (e.isLikePosixError(EINTR)) {
+                continue;
+            }
+
+            if (e.isLikePosixError(EBADF)) {
+                throw VSocketClosedException(e, VSTRING_FORMAT("VSocket[%s] waitForData: Socket has closed (EBADF).", mSocketName.chars()));
+            } else {
+                throw VException(e, VSTRING_FORMAT("VSocket[%s] waitForData: Select failed. Result=%d.", mSocketName.chars(), result));
+            }
+        } else if (result == 0) {
+            throw VException(VSTRING_FORMAT("VSocket[%s] waitForData: Select timed out.", mSocketName.chars()));
+        }
+
+        return;
+    }
+}
+
 int VSocket::write(const Vu8* buffer, int numBytesToWrite) {
     if (! VSocket::_platform_isSocketIDValid(mSocketID)) {
         throw VStackTraceException(VSTRING_FORMAT("VSocket[%s] write: Invalid socket ID %d.", mSocketName.chars(), mSocketID));
@@ -483,18 +839,107 @@ int VSocket::write(const Vu8* buffer, int numBytesToWrite) {
     return (numBytesToWrite - bytesRemainingToWrite);
 }
 
+Vs64 VSocket::writeFromFile(int fd, Vs64 offset, Vs64 numBytesToWrite) {
+#ifndef VSOCKET_SENDFILE_SUPPORTED
+    (void) fd;
+    (void) offset;
+    (void) numBytesToWrite;
+    return -1;
+#else
+    if (! VSocket::_platform_isSocketIDValid(mSocketID)) {
+        throw VStackTraceException(VSTRING_FORMAT("VSocket[%s] writeFromFile: Invalid socket ID %d.", mSocketName.chars(), mSocketID));
+    }
+
+    Vs64    nextFileOffset = offset;
+    Vs64    bytesRemainingToWrite = numBytesToWrite;
+    fd_set  writeset;
+
+    while (bytesRemainingToWrite > 0) {
+
+        FD_ZERO(&writeset);
+        FD_SET(mSocketID, &writeset);
+        int result = ::select(SelectSockIDTypeCast (mSocketID + 1), NULL, &writeset, NULL, (mWriteTimeOutActive ? &mWriteTimeOut : NULL));
+
+        if (result < 0) {
+            VSystemError e = VSystemError::getSocketError();
+            if (e.isLikePosixError(EINTR)) {
+                continue;
+            }
+
+            if (e.isLikePosixError(EBADF)) {
+                throw VSocketClosedException(e, VSTRING_FORMAT("VSocket[%s] writeFromFile: Socket has closed (EBADF).", mSocketName.chars()));
+            } else {
+                throw VException(e, VSTRING_FORMAT("VSocket[%s] writeFromFile: select() failed. Result=%d.", mSocketName.chars(), result));
+            }
+        } else if (result == 0) {
+            throw VException(VSTRING_FORMAT("VSocket[%s] writeFromFile: Select timed out.", mSocketName.chars()));
+        }
+
+        // Each call is limited to what a 32-bit size can express; we just loop for more.
+        Vs64 theNumBytesWritten = this->_platform_sendFile(fd, nextFileOffset, V_MIN(bytesRemainingToWrite, static_cast<Vs64>(V_MAX_S32)));
+
+        if (theNumBytesWritten < 0) {
+            VSystemError e = VSystemError::getSocketError();
+            if (e.isLikePosixError(EINTR)) {
+                continue;
+            }
+
+            // Some kinds of file (pipes, special files) can't be sent this way. If nothing has been sent yet, the caller can fall back.
+            if ((bytesRemainingToWrite == numBytesToWrite) && (e.isLikePosixError(EINVAL) || e.isLikePosixError(ENOSYS) || e.isLikePosixError(ENOTSUP))) {
+                return -1;
+            }
+
+            if (e.isLikePosixError(EPIPE)) {
+                throw VSocketClosedException(e, VSTRING_FORMAT("VSocket[%s] writeFromFile: Socket has closed (EPIPE).", mSocketName.chars()));
+            } else {
+                throw VException(e, VSTRING_FORMAT("VSocket[%s] writeFromFile: sendfile() failed.", mSocketName.chars()));
+            }
+        } else if (theNumBytesWritten == 0) {
+            break; // reached end of file
+        }
+
+        bytesRemainingToWrite -= theNumBytesWritten;
+        nextFileOffset += theNumBytesWritten;
+
+        mNumBytesWritten += theNumBytesWritten;
+    }
+
+    return (numBytesToWrite - bytesRemainingToWrite);
+#endif /* VSOCKET_SENDFILE_SUPPORTED */
+}
+
 void VSocket::discoverHostAndPort() {
-    struct sockaddr_in  info;
-    VSocklenT           infoLength = sizeof(info);
+    struct sockaddr_storage peerInfo;
+    VSocklenT               peerInfoLength = sizeof(peerInfo);
 
-    int result = ::getpeername(mSocketID, (struct sockaddr*) &info, &infoLength);
+    ::memset(&peerInfo, 0, sizeof(peerInfo));
+    int result = ::getpeername(mSocketID, (struct sockaddr*) &peerInfo, &peerInfoLength);
     if (result != 0) {
         throw VStackTraceException(VSystemError::getSocketError(), VSTRING_FORMAT("VSocket[%s] discoverHostAndPort: getpeername() failed.", mSocketName.chars()));
     }
 
-    int portNumber = (int) V_BYTESWAP_NTOH_S16_GET(static_cast<Vs16>(info.sin_port));
+#ifdef VSOCKET_LOCAL_DOMAIN_SUPPORTED
+    if (peerInfo.ss_family == AF_UNIX) {
+        // A connecting peer is normally unnamed, so identify the connection by our end's (the listener's) path.
+        struct sockaddr_un  localInfo;
+        VSocklenT           localInfoLength = sizeof(localInfo);
+
+        ::memset(&localInfo, 0, sizeof(localInfo));
+        result = ::getsockname(mSocketID, (struct sockaddr*) &localInfo, &localInfoLength);
+        if (result != 0) {
+            throw VStackTraceException(VSystemError::getSocketError(), VSTRING_FORMAT("VSocket[%s] discoverHostAndPort: getsockname() failed.", mSocketName.chars()));
+        }
+
+        localInfo.sun_path[sizeof(localInfo.sun_path) - 1] = 0;
+        this->setLocalPath(VSTRING_COPY(localInfo.sun_path));
+        return;
+    }
+#endif
 
-    const char* ipAddress = ::inet_ntoa(info.sin_addr);
+    const struct sockaddr_in* info = reinterpret_cast<const struct sockaddr_in*>(&peerInfo);
+    int portNumber = (int) V_BYTESWAP_NTOH_S16_GET(static_cast<Vs16>(info->sin_port));
+
+    const char* ipAddress = ::inet_ntoa(info->sin_addr);
     this->setHostIPAddressAndPort(VSTRING_COPY(ipAddress), portNumber);
 }
 
@@ -635,6 +1080,63 @@ void VSocket::_listen(const VString& bindAddress, int backlog) {
     mSocketID = listenSockID;
 }
 
+void VSocket::_listenLocal(int backlog) {
+#ifndef VSOCKET_LOCAL_DOMAIN_SUPPORTED
+    (void) backlog;
+    throw VUnimplementedException(VSTRING_FORMAT("VSocket[%s] listen: Unix domain sockets are not supported on this platform.", mSocketName.chars()));
+#else
+    struct sockaddr_un  info;
+    VSocklenT           infoLength = _localPathToSockAddr(mLocalPath, info);
+
+    VSocketID listenSockID = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (! VSocket::_platform_isSocketIDValid(listenSockID)) {
+        throw VStackTraceException(VSystemError::getSocketError(), VSTRING_FORMAT("VSocket[%s] listen: socket() failed. Result=%d.", mSocketName.chars(), listenSockID));
+    }
+
+    try {
+        VSocket::_removeStaleLocalSocketFile(mSocketName, mLocalPath);
+
+        int result = ::bind(listenSockID, (const sockaddr*) &info, infoLength);
+        if (result != 0) {
+            throw VStackTraceException(VSystemError::getSocketError(), VSTRING_FORMAT("VSocket[%s] listen: bind() failed. Result=%d.", mSocketName.chars(), result));
+        }
+
+        result = ::listen(listenSockID, backlog);
+        if (result != 0) {
+            throw VStackTraceException(VSystemError::getSocketError(), VSTRING_FORMAT("VSocket[%s] listen: listen() failed. Result=%d.", mSocketName.chars(), result));
+        }
+
+    } catch (...) {
+        vault::closeSocket(listenSockID);
+        throw;
+    }
+
+    mSocketID = listenSockID;
+#endif
+}
+
+void VSocket::sendFileDescriptor(int fd) {
+    if (! this->isLocal()) {
+        throw VStackTraceException(VSTRING_FORMAT("VSocket[%s] sendFileDescriptor: Descriptors can only be passed over a Unix domain socket.", mSocketName.chars()));
+    }
+
+    this->_platform_sendFileDescriptor(fd);
+    mNumBytesWritten += 1;
+    mLastEventTime.setNow();
+}
+
+int VSocket::receiveFileDescriptor() {
+    if (! this->isLocal()) {
+        throw VStackTraceException(VSTRING_FORMAT("VSocket[%s] receiveFileDescriptor: Descriptors can only be passed over a Unix domain socket.", mSocketName.chars()));
+    }
+
+    int fd = this->_platform_receiveFileDescriptor();
+    mNumBytesRead += 1;
+    mLastEventTime.setNow();
+
+    return fd;
+}
+
 VSocketID VSocket::getSockID() const {
     return mSocketID;
 }
@@ -652,6 +1154,9 @@ VSocketInfo::VSocketInfo(const VSocket& socket)
     , mNumBytesRead(socket.numBytesRead())
     , mNumBytesWritten(socket.numBytesWritten())
     , mIdleTime(socket.getIdleTime())
+    , mTCPInfo(socket.getTCPInfo())
+    , mReadBytesPerSecond(socket.getReadBytesPerSecond())
+    , mWriteBytesPerSecond(socket.getWriteBytesPerSecond())
     {
 }
 
@@ -694,13 +1199,13 @@ void VSocketConnectionStrategyLinear::connect(const VString& hostName, int portN
 
 class VSocketConnectionStrategyThreadedRunner;
 
-class VSocketConnectionStrategyThreadedWorker : public VThread {
+class VSocketConnectionStrategyThreadedWorker : public VThreadPoolTask {
     public:
 
-        VSocketConnectionStrategyThreadedWorker(VSocketConnectionStrategyThreadedRunner* ownerRunner, const VString& ipAddressToConnect, int portNumberToConnect);
+        VSocketConnectionStrategyThreadedWorker(VSocketConnectionStrategyThreadedRunner* ownerRunner, const VString& ipAddressToConnect, int portNumberToConnect, const VSocketTuningProfile& tuningProfile);
         virtual ~VSocketConnectionStrategyThreadedWorker();
 
-        // VThread implementation:
+        // VThreadPoolTask implementation:
         virtual void run();
 
     private:
@@ -714,22 +1219,24 @@ class VSocketConnectionStrategyThreadedWorker : public VThread {
         VSocketConnectionStrategyThreadedRunner*    mOwnerRunner;
         VString                                     mIPAddressToConnect;
         int                                         mPortNumberToConnect;
+        VSocketTuningProfile                        mTuningProfile; // Applied by the temporary socket, which the winning socket ID keeps.
 };
 
 // VSocketConnectionStrategyThreadedRunner ------------------------------------
 
 /**
-Because the strategy involves creating multiple threads but wanting to proceed as
+Because the strategy involves running multiple workers but wanting to proceed as
 soon as 1 of them succeeds, we need an intermediary thread object that can live
 longer and wait around for all of the workers to complete and properly bookkeep
-them. This "runner" class manages all communication with the workers, pokes the
+them. The workers are tasks run on the strategy's shared thread pool, or on a
+private pool the runner creates if the strategy has none. This "runner" class manages all communication with the workers, pokes the
 strategy object back immediately upon success (at which point the strategy can
 let go of the runner and proceed), and hangs around until all worker threads have
 communicated their completion.
 */
 class VSocketConnectionStrategyThreadedRunner : public VThread {
     public:
-        VSocketConnectionStrategyThreadedRunner(const VDuration& timeoutInterval, int maxNumThreads, const VString& hostName, int portNumber, const VStringVector& debugIPAddresses);
+        VSocketConnectionStrategyThreadedRunner(const VDuration& timeoutInterval, int maxNumThreads, const VString& hostName, int portNumber, const VStringVector& debugIPAddresses, const VSocketTuningProfile& tuningProfile, VThreadPool* threadPool);
         virtual ~VSocketConnectionStrategyThreadedRunner();
 
         // VThread implementation:
@@ -747,9 +1254,11 @@ class VSocketConnectionStrategyThreadedRunner : public VThread {
 
     private:
 
-        bool _isDone() const;
+        bool _isDone(); // also reaps workers that the pool finished without running
         bool _isDetachedFromStrategy() const;
-        void _lockedStartWorker(const VString& ipAddressToConnect);
+        bool _lockedStartWorker(const VString& ipAddressToConnect); // returns false if the pool would not take the worker
+        void _lockedStartNextWorker(); // replaces a failed worker with one for the next address, if any and if still worthwhile
+        void _lockedReapAbandonedWorkers(); // forgets workers whose tasks are done but never reported, and replaces them
         void _lockedForgetOneWorker(VSocketConnectionStrategyThreadedWorker* worker); // forgets one worker but assumes that worker will no longer reference us
         void _lockedForgetAllWorkers(); // forgets all workers and tells them to stop referring to us
 
@@ -758,6 +1267,9 @@ class VSocketConnectionStrategyThreadedRunner : public VThread {
         const VString       mHostNameToConnect;
         const int           mPortNumberToConnect;
         const VStringVector mDebugIPAddresses;
+        const VSocketTuningProfile mTuningProfile;
+        VUniquePtr<VThreadPool> mPrivateThreadPool; // Created if the strategy supplied no pool; shut down when we are done.
+        VThreadPool*    mThreadPool; // Where the workers run: the strategy's shared pool, or mPrivateThreadPool.
 
         bool            mDetachedFromStrategy;
         mutable VMutex  mMutex;
@@ -768,8 +1280,8 @@ class VSocketConnectionStrategyThreadedRunner : public VThread {
         VSocketID       mConnectedSocketID;
         VString         mConnectedSocketIPAddress;
 
-        typedef std::deque<VSocketConnectionStrategyThreadedWorker*> WorkerList;
-        WorkerList      mWorkers;
+        typedef std::deque<VThreadPoolTaskPtr> WorkerList;
+        WorkerList      mWorkers; // We share ownership with the pool, so a worker outlives a failed submit() or a cancellation.
 
         // Private functions called only by our worker friend class.
         friend class VSocketConnectionStrategyThreadedWorker;
@@ -780,12 +1292,13 @@ class VSocketConnectionStrategyThreadedRunner : public VThread {
 
 // VSocketConnectionStrategyThreadedWorker ------------------------------------
 
-VSocketConnectionStrategyThreadedWorker::VSocketConnectionStrategyThreadedWorker(VSocketConnectionStrategyThreadedRunner* ownerRunner, const VString& ipAddressToConnect, int portNumberToConnect)
-    : VThread(VSTRING_FORMAT("VSocketConnectionStrategyThreadedWorker.%s:%d", ipAddressToConnect.chars(), portNumberToConnect), "vault.sockets.VSocketConnectionStrategyThreadedWorker", kDeleteSelfAtEnd, kCreateThreadDetached, NULL)
-    , mMutex(mName)
+VSocketConnectionStrategyThreadedWorker::VSocketConnectionStrategyThreadedWorker(VSocketConnectionStrategyThreadedRunner* ownerRunner, const VString& ipAddressToConnect, int portNumberToConnect, const VSocketTuningProfile& tuningProfile)
+    : VThreadPoolTask(VSTRING_FORMAT("VSocketConnectionStrategyThreadedWorker.%s:%d", ipAddressToConnect.chars(), portNumberToConnect))
+    , mMutex(this->getName())
     , mOwnerRunner(ownerRunner)
     , mIPAddressToConnect(ipAddressToConnect)
     , mPortNumberToConnect(portNumberToConnect)
+    , mTuningProfile(tuningProfile)
     {
     VLOGGER_TRACE(VSTRING_FORMAT("VSocketConnectionStrategyThreadedWorker %s:%d constructor.", mIPAddressToConnect.chars(), mPortNumberToConnect));
 }
@@ -798,6 +1311,7 @@ void VSocketConnectionStrategyThreadedWorker::run() {
     VInstant connectStart;
     try {
         VSocket tempSocket;
+        tempSocket.setTuningProfile(mTuningProfile);
         tempSocket.connectToIPAddress(mIPAddressToConnect, mPortNumberToConnect);
         VDuration duration(connectStart);
         VLOGGER_TRACE(VSTRING_FORMAT("VSocketConnectionStrategyThreadedWorker %s:%d run() succeeded with sockid %d in %s.", mIPAddressToConnect.chars(), mPortNumberToConnect, (int) tempSocket.getSockID(), duration.getDurationString().chars()));
@@ -827,13 +1341,16 @@ void VSocketConnectionStrategyThreadedWorker::_handleFailure(const VException& e
 
 // VSocketConnectionStrategyThreadedRunner ------------------------------------
 
-VSocketConnectionStrategyThreadedRunner::VSocketConnectionStrategyThreadedRunner(const VDuration& timeoutInterval, int maxNumThreads, const VString& hostName, int portNumber, const VStringVector& debugIPAddresses)
+VSocketConnectionStrategyThreadedRunner::VSocketConnectionStrategyThreadedRunner(const VDuration& timeoutInterval, int maxNumThreads, const VString& hostName, int portNumber, const VStringVector& debugIPAddresses, const VSocketTuningProfile& tuningProfile, VThreadPool* threadPool)
     : VThread(VSTRING_FORMAT("VSocketConnectionStrategyThreadedRunner.%s:%d", hostName.chars(), portNumber), "vault.sockets.VSocketConnectionStrategyThreadedRunner", kDeleteSelfAtEnd, kCreateThreadDetached, NULL)
     , mExpiry(VInstant() + timeoutInterval)
     , mMaxNumThreads(maxNumThreads)
     , mHostNameToConnect(hostName)
     , mPortNumberToConnect(portNumber)
     , mDebugIPAddresses(debugIPAddresses)
+    , mTuningProfile(tuningProfile)
+    , mPrivateThreadPool(threadPool == NULL ? new VThreadPool(VSTRING_FORMAT("VSocketConnectionStrategyThreaded.%s:%d", hostName.chars(), portNumber), maxNumThreads) : NULL)
+    , mThreadPool(threadPool == NULL ? mPrivateThreadPool.get() : threadPool)
     , mDetachedFromStrategy(false)
     , mMutex(mName)
     , mIPAddressesYetToTry()
@@ -852,6 +1369,10 @@ VSocketConnectionStrategyThreadedRunner::~VSocketConnectionStrategyThreadedRunne
 
 void VSocketConnectionStrategyThreadedRunner::run() {
 
+    if (mPrivateThreadPool.get() != NULL) {
+        mPrivateThreadPool->start();
+    }
+
     /* locking scope */ {
         VMutexLocker locker(&mMutex, "VSocketConnectionStrategyThreadedRunner::run() starting initial workers");
         VStringVector ipAddresses = (mDebugIPAddresses.empty() ? VSocket::resolveHostName(mHostNameToConnect) : mDebugIPAddresses);
@@ -860,11 +1381,14 @@ void VSocketConnectionStrategyThreadedRunner::run() {
             //for (size_t i1 = ipAddresses.size(); i1 > 0; --i1) { int i = i1-1; // try backwards to get that google.com IPv6 address
             if (numWorkersRemaining == 0) {
                 mIPAddressesYetToTry.push_back(ipAddresses[i]);
-            } else {
-                this->_lockedStartWorker(ipAddresses[i]);
+            } else if (this->_lockedStartWorker(ipAddresses[i])) {
                 --numWorkersRemaining;
             }
         }
+
+        if (mWorkers.empty()) {
+            mAllWorkersFailed = true;
+        }
     }
 
     // More workers will be created when and if others complete unsuccessfully.
@@ -877,6 +1401,10 @@ void VSocketConnectionStrategyThreadedRunner::run() {
         VThread::sleep(VDuration::MILLISECOND());
     }
 
+    if (mPrivateThreadPool.get() != NULL) {
+        mPrivateThreadPool->shutdown();
+    }
+
 }
 
 bool VSocketConnectionStrategyThreadedRunner::hasAnswer() const {
@@ -899,8 +1427,9 @@ void VSocketConnectionStrategyThreadedRunner::detachFromStrategy() {
     mDetachedFromStrategy = true;
 }
 
-bool VSocketConnectionStrategyThreadedRunner::_isDone() const {
+bool VSocketConnectionStrategyThreadedRunner::_isDone() {
     VMutexLocker locker(&mMutex, "_done");
+    this->_lockedReapAbandonedWorkers();
     return mWorkers.empty();
 }
 
@@ -909,15 +1438,23 @@ bool VSocketConnectionStrategyThreadedRunner::_isDetachedFromStrategy() const {
     return mDetachedFromStrategy;
 }
 
-void VSocketConnectionStrategyThreadedRunner::_lockedStartWorker(const VString& ipAddressToConnect) {
+bool VSocketConnectionStrategyThreadedRunner::_lockedStartWorker(const VString& ipAddressToConnect) {
     VLOGGER_TRACE(VSTRING_FORMAT("VSocketConnectionStrategyThreadedRunner starting worker %s:%d.", ipAddressToConnect.chars(), mPortNumberToConnect));
-    VSocketConnectionStrategyThreadedWorker* worker = new VSocketConnectionStrategyThreadedWorker(this, ipAddressToConnect, mPortNumberToConnect);
+    VThreadPoolTaskPtr worker(new VSocketConnectionStrategyThreadedWorker(this, ipAddressToConnect, mPortNumberToConnect, mTuningProfile));
+
+    // Don't wait for queue space: we hold our mutex, which running workers need in order to finish.
+    // For the same reason, a worker can't report back before we've added it to mWorkers below.
+    if (! mThreadPool->submit(worker, VDuration::ZERO())) {
+        VLOGGER_ERROR(VSTRING_FORMAT("VSocketConnectionStrategyThreadedRunner %s:%d: thread pool '%s' rejected the worker.", ipAddressToConnect.chars(), mPortNumberToConnect, mThreadPool->getName().chars()));
+        return false;
+    }
+
     mWorkers.push_back(worker);
-    worker->start();
+    return true;
 }
 
 void VSocketConnectionStrategyThreadedRunner::_workerSucceeded(VSocketConnectionStrategyThreadedWorker* worker, VSocket& openedSocket) {
-    VMutexLocker locker(&mMutex, VSTRING_FORMAT("_workerSucceeded(%s)", worker->getName().chars()));
+    VMutexLocker locker(&mMutex, "VSocketConnectionStrategyThreadedRunner::_workerSucceeded()");
     if (mConnectionCompleted) {
         VLOGGER_TRACE(VSTRING_FORMAT("VSocketConnectionStrategyThreadedRunner %s:%d _workerSucceeded(sockid %d) ignored because another worker has already won.", openedSocket.getHostIPAddress().chars(), mPortNumberToConnect, (int) openedSocket.getSockID()));
     } else {
@@ -934,26 +1471,30 @@ void VSocketConnectionStrategyThreadedRunner::_workerSucceeded(VSocketConnection
 }
 
 void VSocketConnectionStrategyThreadedRunner::_workerFailed(VSocketConnectionStrategyThreadedWorker* worker, const VException& ex) {
-    VMutexLocker locker(&mMutex, VSTRING_FORMAT("_workerFailed(%s)", worker->getName().chars()));
+    VMutexLocker locker(&mMutex, "VSocketConnectionStrategyThreadedRunner::_workerFailed()");
     this->_lockedForgetOneWorker(worker);
 
     VLOGGER_ERROR(VSTRING_FORMAT("VSocketConnectionStrategyThreadedRunner::_workerFailed: %s", ex.what()));
 
-    // If we have yet to succeed, start another worker thread if we have more addresses to try.
-    if (!mConnectionCompleted) {
-        if (mIPAddressesYetToTry.empty()) {
-            // Nothing left to try.
-        } else if (VInstant() > mExpiry) {
+    this->_lockedStartNextWorker();
+}
+
+void VSocketConnectionStrategyThreadedRunner::_lockedStartNextWorker() {
+    // If we have yet to succeed, start another worker if we have more addresses to try.
+    while (!mConnectionCompleted && !mIPAddressesYetToTry.empty()) {
+        if (VInstant() > mExpiry) {
             // Too much time has elapsed. Give up. Don't start a new worker. Clear the "to do" list.
             // Mark failure so that the caller can immediately proceed, not waiting for any other
             // outstanding workers to complete. The presence of an overdue expiry means we failed.
             mIPAddressesYetToTry.clear();
             mAllWorkersFailed = true;
         } else {
-            // Pop the next address off and start a worker for it.
+            // Pop the next address off and start a worker for it. If the pool rejects it, move on to the next one.
             VString nextIPAddressToTry = mIPAddressesYetToTry[0];
             mIPAddressesYetToTry.erase(mIPAddressesYetToTry.begin());
-            this->_lockedStartWorker(nextIPAddressToTry);
+            if (this->_lockedStartWorker(nextIPAddressToTry)) {
+                break;
+            }
         }
     }
 
@@ -964,10 +1505,29 @@ void VSocketConnectionStrategyThreadedRunner::_workerFailed(VSocketConnectionStr
     }
 }
 
+void VSocketConnectionStrategyThreadedRunner::_lockedReapAbandonedWorkers() {
+    // A worker that runs reports back, and so leaves mWorkers, from within run(); its task isn't done until after that.
+    // So a task that is done but still listed will never report: the pool cancelled it before it ran (a shared pool
+    // may be shut down or cancel its queue under us), or it threw something other than a VException. Count it as failed.
+    WorkerList::iterator i = mWorkers.begin();
+    while (i != mWorkers.end()) {
+        if ((*i)->isDone()) {
+            VLOGGER_ERROR(VSTRING_FORMAT("VSocketConnectionStrategyThreadedRunner %s:%d: worker '%s' ended without reporting a result.", mHostNameToConnect.chars(), mPortNumberToConnect, (*i)->getName().chars()));
+            i = mWorkers.erase(i);
+            this->_lockedStartNextWorker(); // appends to mWorkers, which a deque may do by invalidating iterators
+            i = mWorkers.begin();
+        } else {
+            ++i;
+        }
+    }
+}
+
 void VSocketConnectionStrategyThreadedRunner::_lockedForgetOneWorker(VSocketConnectionStrategyThreadedWorker* worker) {
-    WorkerList::iterator position = std::find(mWorkers.begin(), mWorkers.end(), worker);
-    if (position != mWorkers.end()) {
-        mWorkers.erase(position);
+    for (WorkerList::iterator i = mWorkers.begin(); i != mWorkers.end(); ++i) {
+        if ((*i).get() == worker) {
+            mWorkers.erase(i);
+            return;
+        }
     }
 }
 
@@ -977,16 +1537,17 @@ void VSocketConnectionStrategyThreadedRunner::_lockedForgetAllWorkers() {
 
 // VSocketConnectionStrategyThreaded ------------------------------------------
 
-VSocketConnectionStrategyThreaded::VSocketConnectionStrategyThreaded(const VDuration& timeoutInterval, int maxNumThreads)
+VSocketConnectionStrategyThreaded::VSocketConnectionStrategyThreaded(const VDuration& timeoutInterval, int maxNumThreads, VThreadPool* threadPool)
     : VSocketConnectionStrategy()
     , mTimeoutInterval(timeoutInterval)
     , mMaxNumThreads(maxNumThreads)
+    , mThreadPool(threadPool)
     {
 }
 
 void VSocketConnectionStrategyThreaded::connect(const VString& hostName, int portNumber, VSocket& socketToConnect) const {
 
-    VSocketConnectionStrategyThreadedRunner* runner = new VSocketConnectionStrategyThreadedRunner(mTimeoutInterval, mMaxNumThreads, hostName, portNumber, mDebugIPAddresses);
+    VSocketConnectionStrategyThreadedRunner* runner = new VSocketConnectionStrategyThreadedRunner(mTimeoutInterval, mMaxNumThreads, hostName, portNumber, mDebugIPAddresses, socketToConnect.getTuningProfile(), mThreadPool);
     runner->start();
 
     while (! runner->hasAnswer()) {
@@ -12,6 +12,9 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 
 #include "vinstant.h"
 #include "vstring.h"
+#include "vmutex.h"
+
+#include <atomic>
 
 // This pulls in any platform-specific declarations and includes:
 #include "vsocket_platform.h"
@@ -71,6 +74,101 @@ class VNetworkInterfaceInfo {
 typedef std::vector<VNetworkInterfaceInfo> VNetworkInterfaceList;
 
 class VSocketConnectionStrategy;
+class VSettingsNode;
+class VThreadPool;
+
+/**
+VSocketTuningProfile is a named set of socket options that VSocket::setDefaultSockOpt()
+applies when a socket is connected or accepted. Give a profile to a VSocketFactory and
+every socket it creates, including every socket accepted by a listener that uses that
+factory, gets the profile's options. The built-in profiles are:
+
+- "default": the options Vault has always used (64KB buffers, throughput type of
+  service, TCP_NODELAY).
+- "low-latency": for request/response traffic; TCP_NODELAY, TCP_QUICKACK, low-delay
+  type of service, and SO_BUSY_POLL so that the receiver spins briefly on the device
+  queue instead of sleeping.
+- "bulk-throughput": for large transfers; leaves buffer sizes to the OS (on Linux,
+  setting SO_RCVBUF or SO_SNDBUF disables automatic buffer tuning and caps the buffer
+  at net.core.rmem_max/wmem_max, so leaving them alone is what lets the window grow)
+  and leaves Nagle's algorithm on to coalesce small writes.
+- "many-idle": for large numbers of mostly-idle connections; small buffers to bound
+  per-connection kernel memory, and TCP keepalive so that dead peers are noticed.
+
+A profile can be read from settings, starting from a named built-in profile and
+overriding any of its values, for example:
+
+    <socket-tuning profile="low-latency" name="market-data" receive-buffer-size="262144" busy-poll-usec="0" />
+
+Options a platform does not support are skipped, as are options the kernel refuses
+(for example, SO_BUSY_POLL without CAP_NET_ADMIN, or TCP_QUICKACK, which Linux may
+turn back off later in the connection's life). Options that don't apply to Unix
+domain sockets are skipped for them.
+*/
+class VSocketTuningProfile {
+    public:
+
+        /**
+        Constructs the "default" profile.
+        */
+        VSocketTuningProfile();
+        /**
+        Constructs a profile from settings: the built-in profile named by the
+        "profile" attribute (default "default"), with any of its values overridden
+        by the "name", "receive-buffer-size", "send-buffer-size", "service-type",
+        "no-delay", "quick-ack", "cork", "busy-poll-usec", "keep-alive",
+        "keep-alive-idle-sec", "keep-alive-interval-sec" and "keep-alive-count"
+        attributes. Throws a VRangeException if the profile name is unknown.
+        @param  settings    the settings node to read
+        */
+        explicit VSocketTuningProfile(const VSettingsNode& settings);
+        ~VSocketTuningProfile() {}
+
+        /**
+        Returns the built-in profile with the specified name. Throws a
+        VRangeException if there is no such profile.
+        @param  name    "default", "low-latency", "bulk-throughput", or "many-idle"
+        @return the profile
+        */
+        static VSocketTuningProfile forName(const VString& name);
+        static const VSocketTuningProfile& DEFAULT();          ///< The "default" built-in profile.
+        static const VSocketTuningProfile& LOW_LATENCY();      ///< The "low-latency" built-in profile.
+        static const VSocketTuningProfile& BULK_THROUGHPUT();  ///< The "bulk-throughput" built-in profile.
+        static const VSocketTuningProfile& MANY_IDLE();        ///< The "many-idle" built-in profile.
+
+        VString mName;                      ///< The profile name, for logging and diagnostics.
+        int     mReceiveBufferSize;         ///< SO_RCVBUF; 0 leaves the OS default.
+        int     mSendBufferSize;            ///< SO_SNDBUF; 0 leaves the OS default.
+        int     mServiceType;               ///< IP_TOS; -1 leaves the OS default. Not set on Windows.
+        bool    mNoDelay;                   ///< TCP_NODELAY; true disables Nagle's algorithm.
+        bool    mQuickAck;                  ///< TCP_QUICKACK (Linux); true sends ACKs immediately rather than delaying them.
+        bool    mCork;                      ///< TCP_CORK (Linux) or TCP_NOPUSH (BSD, Mac); true holds back partial segments.
+        int     mBusyPollMicroseconds;      ///< SO_BUSY_POLL (Linux); 0 leaves it off.
+        bool    mKeepAlive;                 ///< SO_KEEPALIVE.
+        int     mKeepAliveIdleSeconds;      ///< Idle time before the first keepalive probe; 0 leaves the OS default.
+        int     mKeepAliveIntervalSeconds;  ///< Time between keepalive probes; 0 leaves the OS default.
+        int     mKeepAliveCount;            ///< Unanswered probes before the connection is dropped; 0 leaves the OS default.
+};
+
+/**
+VSocketTCPInfo holds a sample of the kernel's TCP state for a connected socket,
+as reported by getsockopt(TCP_INFO). It lets you tell whether a slow connection
+is network-bound (high round trip time, retransmits, a small congestion window,
+lots of unacknowledged data in flight) or is being held up at one end.
+Only platforms that support TCP_INFO (Linux) fill it in; elsewhere, and for
+non-TCP sockets, mIsValid is false and the other values are zero.
+*/
+class VSocketTCPInfo {
+    public:
+        VSocketTCPInfo() : mIsValid(false), mRoundTripTimeMicroseconds(0), mRoundTripTimeVarianceMicroseconds(0), mNumRetransmits(0), mCongestionWindowSegments(0), mNumUnackedSegments(0) {}
+        ~VSocketTCPInfo() {}
+        bool    mIsValid;                           ///< True if the platform provided the sample.
+        Vs64    mRoundTripTimeMicroseconds;         ///< Smoothed round trip time.
+        Vs64    mRoundTripTimeVarianceMicroseconds; ///< Round trip time variance.
+        Vs64    mNumRetransmits;                    ///< Total segments retransmitted over the connection's lifetime.
+        int     mCongestionWindowSegments;          ///< Current send congestion window, in segments.
+        int     mNumUnackedSegments;                ///< Segments sent but not yet acknowledged.
+};
 
 /**
 VSocket is the class that defines a BSD or Winsock socket connection.
@@ -293,6 +391,16 @@ class VSocket {
                                     (@see VSocketConnectionStrategySingle, VSocketConnectionStrategyLinear, VSocketConnectionStrategyThreaded)
         */
         virtual void connectToHostName(const VString& hostName, int portNumber, const VSocketConnectionStrategy& connectionStrategy);
+        /**
+        Connects to a server on this machine that is listening on a Unix domain
+        (AF_UNIX) stream socket at the specified path. Aside from how it is
+        addressed, the socket then behaves exactly like a TCP socket, but local
+        IPC avoids the cost of the TCP/IP stack. If the connection cannot be
+        opened, a VException is thrown; on platforms without Unix domain socket
+        support, a VUnimplementedException is thrown.
+        @param  path    the file system path of the listening socket
+        */
+        virtual void connectToLocalPath(const VString& path);
 
         /**
         Associates this socket object with the specified socket id. This is
@@ -313,6 +421,14 @@ class VSocket {
         @param    portNumber    the port number to connect to on the host
         */
         virtual void setHostIPAddressAndPort(const VString& hostIPAddress, int portNumber);
+        /**
+        Marks this socket as a Unix domain socket addressed by the specified
+        path. The path is also returned as the host IP address, with a port
+        number of 0, so that code that identifies sockets by address sees
+        something meaningful.
+        @param    path  the file system path of the socket
+        */
+        virtual void setLocalPath(const VString& path);
 
         // --------------- These are the various utility and accessor methods.
 
@@ -334,6 +450,16 @@ class VSocket {
         */
         int getPortNumber() const;
         /**
+        Returns true if this is a Unix domain socket; @see connectToLocalPath().
+        @return obvious
+        */
+        bool isLocal() const { return mLocalPath.isNotEmpty(); }
+        /**
+        Returns the file system path of a Unix domain socket.
+        @return the path; empty if this is not a Unix domain socket
+        */
+        const VString& getLocalPath() const { return mLocalPath; }
+        /**
         Returns a string concatenating the host name and port number, for purposes
         of socket connection identification when debugging and logging.
         @return a string with this socket's address and port
@@ -367,10 +493,25 @@ class VSocket {
         */
         void setWriteTimeOut(const struct timeval& timeout);
         /**
-        Sets the socket options to their default values.
+        Sets the socket options to the values of the socket's tuning profile,
+        which is the "default" profile unless setTuningProfile() says otherwise.
+        This is called when the socket is connected; VSocketFactory calls it for
+        accepted sockets.
         */
         void setDefaultSockOpt();
         /**
+        Sets the tuning profile that setDefaultSockOpt() applies. Call this
+        before connecting; to retune an already-connected socket, call
+        setDefaultSockOpt() afterwards.
+        @param    profile    the profile to use
+        */
+        void setTuningProfile(const VSocketTuningProfile& profile) { mTuningProfile = profile; }
+        /**
+        Returns the tuning profile that setDefaultSockOpt() applies.
+        @return the profile
+        */
+        const VSocketTuningProfile& getTuningProfile() const { return mTuningProfile; }
+        /**
         Returns the number of bytes that have been read from this socket.
         @return    the number of bytes read from this socket
         */
@@ -385,6 +526,36 @@ class VSocket {
         occurred on this socket.
         */
         VDuration getIdleTime() const;
+        /**
+        Takes a sample of the socket's statistics: the kernel TCP state (see
+        VSocketTCPInfo), and the read and write throughput since the previous
+        sample (or since the socket was created, for the first sample).
+        VListenerThread and VDatagramListenerThread call this for each of their
+        sockets every kStatisticsSampleIntervalMilliseconds, so the rates they
+        report do not depend on how often anyone looks at them; call it yourself
+        for sockets that no listener owns. It may be called from any thread; the
+        socket's own i/o is not affected.
+        */
+        void sampleStatistics();
+        /**
+        Returns the TCP state captured by the last sampleStatistics() call.
+        @return the TCP sample; mIsValid is false if none has been taken
+        */
+        VSocketTCPInfo getTCPInfo() const;
+        /**
+        Returns the read throughput over the interval ending at the last
+        sampleStatistics() call.
+        @return bytes read per second
+        */
+        Vs64 getReadBytesPerSecond() const;
+        /**
+        Returns the write throughput over the interval ending at the last
+        sampleStatistics() call.
+        @return bytes written per second
+        */
+        Vs64 getWriteBytesPerSecond() const;
+
+        static const int kStatisticsSampleIntervalMilliseconds; ///< How often listeners sample their sockets' statistics.
 
         // --------------- These are the pure virtual methods that only a platform
         // subclass can implement.
@@ -408,6 +579,14 @@ class VSocket {
         */
         virtual int read(Vu8* buffer, int numBytesToRead);
         /**
+        Waits until the socket has data to read, or the peer has closed or shut
+        down its end, without reading anything. Like read(), this honors the
+        read timeout and throws if it expires or the wait fails. This lets a
+        caller tell the time spent waiting for a request from the time spent
+        reading one.
+        */
+        void waitForData();
+        /**
         Writes data to the socket.
 
         If you don't have a write timeout set up for this socket, then
@@ -419,6 +598,25 @@ class VSocket {
         */
         virtual int write(const Vu8* buffer, int numBytesToWrite);
         /**
+        Writes data to the socket directly from a file, letting the kernel
+        transfer the data (sendfile) so that it does not pass through a
+        user-space buffer. VStream::streamCopy() uses this when copying from a
+        file stream to a socket stream.
+
+        Like write(), this honors the write timeout and blocks until all
+        requested bytes have been written. The file descriptor's own offset is
+        neither used nor changed.
+
+        @param    fd                the file descriptor to read from
+        @param    offset            the file offset at which to start reading
+        @param    numBytesToWrite   the number of bytes to write to the socket
+        @return    the number of bytes written (fewer than requested only if
+                the end of file is reached), or -1 if the platform or file
+                does not support kernel file-to-socket transfer, in which case
+                nothing was written and the caller must fall back to write()
+        */
+        virtual Vs64 writeFromFile(int fd, Vs64 offset, Vs64 numBytesToWrite);
+        /**
         Flushes any unwritten bytes to the socket.
         */
         virtual void flush();
@@ -450,6 +648,26 @@ class VSocket {
         @param  value   the option value
         */
         void setIntSockOpt(int level, int name, int value);
+        /**
+        Passes an open file descriptor to the peer process over a Unix domain
+        socket (SCM_RIGHTS), along with one byte of ordinary data. The peer
+        receives its own descriptor for the same open file or socket; this
+        process's descriptor remains open and is still the caller's to close.
+        This is how a connection can be handed off to another process: send
+        the accepted VSocket's getSockID(), then close it here.
+        Throws a VException if this is not a Unix domain socket, or a
+        VUnimplementedException on platforms that cannot pass descriptors.
+        @param  fd  the file or socket descriptor to pass
+        */
+        void sendFileDescriptor(int fd);
+        /**
+        Receives a file descriptor sent by the peer's sendFileDescriptor().
+        Blocks (subject to the read timeout) until it arrives. The caller owns
+        the returned descriptor; for a socket, you can hand it to
+        VSocketFactory::createSocket() to get a VSocket that owns it.
+        @return the received descriptor
+        */
+        int receiveFileDescriptor();
 
         static const VSocketID kNoSocketID = V_NO_SOCKET_ID_CONSTANT; ///< The sock id for a socket that is not connected.
         static const int kDefaultBufferSize = 65535;    ///< The default buffer size.
@@ -471,6 +689,24 @@ class VSocket {
         @param  backlog     the backlog value to supply to the ::listen() function
         */
         virtual void _listen(const VString& bindAddress, int backlog);
+        /**
+        Starts listening for incoming connections on a Unix domain socket
+        at the path previously set via setLocalPath(). A socket file left
+        at that path by a previous listener that is gone is removed first. Only useful
+        to call from a VListenerSocket subclass that exposes a public listen() API.
+        @param  backlog     the backlog value to supply to the ::listen() function
+        */
+        virtual void _listenLocal(int backlog);
+        /**
+        The socket file outlives its socket, so one left by a listener that did not
+        shut down cleanly would make bind() fail. This removes the file at the path,
+        but only if it is a socket that nothing accepts connections on; it throws an
+        "address in use" exception if a live listener, or something other than a
+        socket, is there. Only available where VSOCKET_LOCAL_DOMAIN_SUPPORTED.
+        @param  socketName  the name to use in an exception message
+        @param  path        the socket file path
+        */
+        static void _removeStaleLocalSocketFile(const VString& socketName, const VString& path);
 
         VSocketID       mSocketID;              ///< The socket id.
         VString         mHostIPAddress;         ///< The IP address of the host to which the socket is connected.
@@ -480,10 +716,19 @@ class VSocket {
         bool            mWriteTimeOutActive;    ///< True if writes should time out.
         struct timeval  mWriteTimeOut;          ///< The write timeout value, if used.
         bool            mRequireReadAll;        ///< True if we throw when read returns less than # bytes asked for.
-        Vs64            mNumBytesRead;          ///< Number of bytes read from this socket.
-        Vs64            mNumBytesWritten;       ///< Number of bytes written to this socket.
+        std::atomic<Vs64> mNumBytesRead;        ///< Number of bytes read from this socket; atomic because sampleStatistics() may run on another thread.
+        std::atomic<Vs64> mNumBytesWritten;     ///< Number of bytes written to this socket; atomic because sampleStatistics() may run on another thread.
         VInstant        mLastEventTime;         ///< Timestamp of last read or write.
         VString         mSocketName;            ///< Returned by getName(), useful purely for logging and debugging.
+        VString         mLocalPath;             ///< The path of a Unix domain socket; empty for a TCP socket.
+        VSocketTuningProfile mTuningProfile;    ///< The options applied by setDefaultSockOpt().
+        mutable VMutex  mStatisticsMutex;       ///< Guards the sampled statistics below, which another thread may sample.
+        VSocketTCPInfo  mTCPInfo;               ///< The TCP state captured by the last sampleStatistics().
+        VInstant        mLastSampleTime;        ///< When sampleStatistics() was last called, or when the socket was created.
+        Vs64            mLastSampleNumBytesRead;    ///< mNumBytesRead as of mLastSampleTime.
+        Vs64            mLastSampleNumBytesWritten; ///< mNumBytesWritten as of mLastSampleTime.
+        Vs64            mReadBytesPerSecond;    ///< Read throughput over the last sample interval.
+        Vs64            mWriteBytesPerSecond;   ///< Write throughput over the last sample interval.
 
         static VString gPreferredNetworkInterfaceName;
         static VString gPreferredLocalIPAddressPrefix;
@@ -524,6 +769,33 @@ class VSocket {
         @return the number of bytes currently available for reading
         */
         int _platform_available();
+        /**
+        Sends up to the specified number of bytes from a file directly to the
+        socket using the platform's kernel file-to-socket API. Only called if
+        the platform defines VSOCKET_SENDFILE_SUPPORTED.
+        @param    fd                the file descriptor to read from
+        @param    offset            the file offset at which to start reading
+        @param    numBytesToSend    the maximum number of bytes to send
+        @return the number of bytes sent, 0 at end of file, or -1 on error (in
+                which case the socket error code is set)
+        */
+        Vs64 _platform_sendFile(int fd, Vs64 offset, Vs64 numBytesToSend);
+        /**
+        Sends a file descriptor as SCM_RIGHTS ancillary data; @see sendFileDescriptor().
+        @param    fd    the descriptor to send
+        */
+        void _platform_sendFileDescriptor(int fd);
+        /**
+        Receives a file descriptor sent as SCM_RIGHTS ancillary data; @see receiveFileDescriptor().
+        @return the received descriptor
+        */
+        int _platform_receiveFileDescriptor();
+        /**
+        Fills in a sample of the kernel's TCP state for this socket; @see sampleStatistics().
+        @param    info  the object to fill in
+        @return true if the platform provided the information
+        */
+        bool _platform_getTCPInfo(VSocketTCPInfo& info) const;
 };
 
 /**
@@ -550,6 +822,9 @@ class VSocketInfo {
         Vs64        mNumBytesRead;      ///< Number of bytes read from this socket.
         Vs64        mNumBytesWritten;   ///< Number of bytes written to this socket.
         VDuration   mIdleTime;          ///< Amount of time elapsed since last activity.
+        VSocketTCPInfo mTCPInfo;        ///< The TCP state as of the socket's last sampleStatistics().
+        Vs64        mReadBytesPerSecond;    ///< Read throughput as of the socket's last sampleStatistics().
+        Vs64        mWriteBytesPerSecond;   ///< Write throughput as of the socket's last sampleStatistics().
 };
 
 /**
@@ -631,11 +906,16 @@ Connects to the all DNS resolved IP addresses for a host name, in parallel batch
 until one succeeds or a specified timeout is reached. This strategy makes most sense with IPv6
 where DNS is supposed to return a preferred-order list of resolved names (rather than round-
 robining) but where we have an opportunity to use the one that responds fastest.
+
+The connection attempts run as tasks on a VThreadPool. If you supply one, they share its
+threads with whatever else it is used for (it must already be started, and its queue
+should have room for maxNumThreads tasks); otherwise each connect() creates a private pool
+of maxNumThreads threads for its attempts.
 */
 class VSocketConnectionStrategyThreaded : public VSocketConnectionStrategy {
 
     public:
-        VSocketConnectionStrategyThreaded(const VDuration& timeoutInterval, int maxNumThreads = 4);
+        VSocketConnectionStrategyThreaded(const VDuration& timeoutInterval, int maxNumThreads = 4, VThreadPool* threadPool = NULL);
         virtual ~VSocketConnectionStrategyThreaded() {}
 
         // VSocketConnectionStrategy implementation:
@@ -643,8 +923,9 @@ class VSocketConnectionStrategyThreaded : public VSocketConnectionStrategy {
 
     private:
 
-        VDuration   mTimeoutInterval;
-        int         mMaxNumThreads;
+        VDuration       mTimeoutInterval;
+        int             mMaxNumThreads;
+        VThreadPool*    mThreadPool;    ///< The shared pool to run connection attempts on, or NULL to use a private pool per connect().
 };
 
 #endif /* vsocket_h */
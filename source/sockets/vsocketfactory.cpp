@@ -9,11 +9,19 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 
 #include "vsocketfactory.h"
 
-VSocketFactory::VSocketFactory() {
+VSocketFactory::VSocketFactory()
+    : mTuningProfile()
+    {
+}
+
+VSocketFactory::VSocketFactory(const VSocketTuningProfile& tuningProfile)
+    : mTuningProfile(tuningProfile)
+    {
 }
 
 VSocket* VSocketFactory::createSocket(VSocketID socketID) {
     VSocket* theSocket = new VSocket(socketID);
+    theSocket->setTuningProfile(mTuningProfile);
     theSocket->discoverHostAndPort();
     theSocket->setDefaultSockOpt();
 
@@ -22,8 +30,23 @@ VSocket* VSocketFactory::createSocket(VSocketID socketID) {
 
 VSocket* VSocketFactory::createSocket(const VString& hostName, int portNumber, const VSocketConnectionStrategy& connectionStrategy) {
     VSocket* theSocket = new VSocket();
+    theSocket->setTuningProfile(mTuningProfile);
     theSocket->connectToHostName(hostName, portNumber, connectionStrategy);
 
     return theSocket;
 }
 
+VSocket* VSocketFactory::createLocalSocket(const VString& localPath) {
+    VSocket* theSocket = new VSocket();
+    theSocket->setTuningProfile(mTuningProfile);
+
+    try {
+        theSocket->connectToLocalPath(localPath);
+    } catch (...) {
+        delete theSocket;
+        throw;
+    }
+
+    return theSocket;
+}
+
@@ -20,6 +20,10 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 VSocketFactory can be used as-is, or can be subclassed to create
 special kinds of sockets; normally every socket is just a VSocket,
 but it is conceivable to have things like VSecureSocket or such.
+
+Every socket the factory creates gets the factory's tuning profile
+(see VSocketTuningProfile), so giving a listener a factory with a
+particular profile tunes all the sockets that listener accepts.
 */
 class VSocketFactory {
     public:
@@ -29,6 +33,11 @@ class VSocketFactory {
         */
         VSocketFactory();
         /**
+        Constructs a factory whose sockets use the specified tuning profile.
+        @param    tuningProfile    the profile to give each created socket
+        */
+        VSocketFactory(const VSocketTuningProfile& tuningProfile);
+        /**
         Destructor, declared for completeness.
         */
         virtual ~VSocketFactory() {}
@@ -49,6 +58,28 @@ class VSocketFactory {
         @return the new VSocket object
         */
         virtual VSocket* createSocket(const VString& hostName, int portNumber, const VSocketConnectionStrategy& connectionStrategy);
+        /**
+        Creates a VSocket object and connects it to a Unix domain socket at the
+        specified path, by calling connectToLocalPath().
+        @param    localPath     the file system path to pass to connectToLocalPath()
+        @return the new VSocket object
+        */
+        virtual VSocket* createLocalSocket(const VString& localPath);
+
+        /**
+        Sets the tuning profile given to sockets created from now on.
+        @param    tuningProfile    the profile to give each created socket
+        */
+        void setTuningProfile(const VSocketTuningProfile& tuningProfile) { mTuningProfile = tuningProfile; }
+        /**
+        Returns the tuning profile given to created sockets.
+        @return the profile
+        */
+        const VSocketTuningProfile& getTuningProfile() const { return mTuningProfile; }
+
+    protected:
+
+        VSocketTuningProfile mTuningProfile;   ///< The profile given to each created socket.
 
 };
 
@@ -88,3 +88,7 @@ Vs64 VSocketStream::available() const {
     return mSocket->available();
 }
 
+Vs64 VSocketStream::_writeFromFileDescriptor(int fd, Vs64 offset, Vs64 numBytesToWrite) {
+    return mSocket->writeFromFile(fd, offset, numBytesToWrite);
+}
+
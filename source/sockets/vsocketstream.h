@@ -122,6 +122,19 @@ class VSocketStream : public VStream {
         */
         virtual Vs64 available() const;
 
+    protected:
+
+        /**
+        Writes data to the socket directly from a file descriptor, so that
+        streamCopy() can transfer file data to the socket without a user-space
+        buffer. See VSocket::writeFromFile().
+        @param    fd                the file descriptor to read from
+        @param    offset            the file offset at which to start reading
+        @param    numBytesToWrite   the number of bytes to write
+        @return    the number of bytes written, or -1 if not supported
+        */
+        virtual Vs64 _writeFromFileDescriptor(int fd, Vs64 offset, Vs64 numBytesToWrite);
+
     private:
 
         VSocket* mSocket;   ///< The socket on which this stream does its i/o.
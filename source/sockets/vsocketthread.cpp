@@ -8,6 +8,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 /** @file */
 
 #include "vsocketthread.h"
+#include "vtypes_internal.h"
 
 #include "vlistenerthread.h"
 
@@ -19,6 +20,10 @@ VSocketThread::VSocketThread(const VString& threadBaseName, VSocket* socket, VLi
     , mSocket(socket)
     , mOwnerThread(ownerThread)
     {
+
+    if (ownerThread != NULL) {
+        this->setThreadOptions(ownerThread->getSocketThreadOptions());
+    }
 }
 
 VSocketThread::~VSocketThread() {
@@ -42,9 +47,15 @@ VListenerThread* VSocketThread::getOwnerThread() const {
 
 void VSocketThread::closeAndStop() {
     if (mSocket != NULL) {
+        // On some platforms close() alone does not wake the thread if it is blocked reading the socket; shutdown() does.
+        (void) ::shutdown(mSocket->getSockID(), SHUT_RDWR);
         mSocket->close();
     }
 
     this->stop();
 }
 
+void VSocketThread::stopWhenIdle() {
+    this->stop();
+}
+
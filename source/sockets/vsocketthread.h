@@ -49,7 +49,8 @@ class VSocketThread : public VThread {
         @param  threadBaseName  a distinguishing base name for the thread, useful for debugging purposes;
                                 the thread name will be composed of this and the socket's IP address and port
         @param    socket        the socket this thread is managing
-        @param    ownerThread   the thread that created this one
+        @param    ownerThread   the thread that created this one; its socket thread
+                                options (@see VListenerThread::setSocketThreadOptions) are applied
         */
         VSocketThread(const VString& threadBaseName, VSocket* socket, VListenerThread* ownerThread);
         /**
@@ -70,8 +71,22 @@ class VSocketThread : public VThread {
 
         /**
         Closes the socket and stops the thread (causing it to end) in one shot.
+        The socket is shut down before it is closed, so that a read or write
+        in progress on the thread fails right away rather than blocking on.
         */
         void closeAndStop();
+        /**
+        Asks the thread to finish the work it has in hand and then end, leaving
+        the socket open until it does; this is how VListenerThread::drainAndStop()
+        winds down connections without cutting off in-flight requests. The
+        default implementation simply calls stop(), which a run loop notices
+        between requests. A subclass that buffers work, such as queued output,
+        can override this to finish that work before ending. A thread blocked
+        waiting for a request that never comes will not notice, which is why
+        the drain is bounded by a deadline; VMessageInputThread overrides this
+        to wake such a thread and end it at once.
+        */
+        virtual void stopWhenIdle();
 
     protected:
 
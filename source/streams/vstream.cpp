@@ -87,6 +87,25 @@ Vs64 VStream::streamCopy(VStream& fromStream, VStream& toStream, Vs64 numBytesTo
         fromStream._finishRead(numBytesCopied);
         toStream._finishWrite(numBytesCopied);
     } else {
+        /*
+        Neither stream has a buffer. If the source is a file and the target can
+        take data straight from a file descriptor (a socket, via sendfile), let
+        the kernel do the transfer without any user-space copy. We read from the
+        source's logical offset rather than its descriptor's, since a buffered
+        file stream may have read ahead, and then seek the source past the data.
+        */
+        int fromFileDescriptor = fromStream._getReadFileDescriptor();
+        if (fromFileDescriptor != -1) {
+            Vs64 fromOffset = fromStream.getIOOffset();
+            numBytesCopied = toStream._writeFromFileDescriptor(fromFileDescriptor, fromOffset, numBytesToCopy);
+            if (numBytesCopied != -1) {
+                (void) fromStream.seek(fromOffset + numBytesCopied, SEEK_SET);
+                return numBytesCopied;
+            }
+
+            numBytesCopied = 0;
+        }
+
         /*
         Worst case scenario: direct copy between streams without their own
         buffers, so we have to create a buffer to do the transfer.
@@ -240,3 +259,13 @@ void VStream::_finishWrite(Vs64 /*numBytesWritten*/) {
     // To be overridden by memory-based streams.
 }
 
+int VStream::_getReadFileDescriptor() {
+    // To be overridden by file descriptor-based streams.
+    return -1;
+}
+
+Vs64 VStream::_writeFromFileDescriptor(int /*fd*/, Vs64 /*offset*/, Vs64 /*numBytesToWrite*/) {
+    // To be overridden by streams whose platform can write directly from a file descriptor.
+    return -1;
+}
+
@@ -342,9 +342,11 @@ class VStream {
         toStream is a VSocketStream).
 
         If either of the streams is a VMemoryStream, the copy is made
-        directly with no extra copying. If neither stream is a VMemoryStream,
-        a temporary buffer is used to transfer the data with just a single
-        copy.
+        directly with no extra copying. If the source is a file stream and the
+        target is a socket stream, and the platform supports it (sendfile), the
+        kernel transfers the data directly from the file to the socket without
+        it passing through user space at all. Otherwise, a temporary buffer is
+        used to transfer the data with just a single copy.
 
         Of course, this method does not actually know the stream classes,
         but simply asks the to and from streams about their capabilities.
@@ -465,6 +467,38 @@ class VStream {
         */
         virtual void    _finishWrite(Vs64 numBytesWritten);
 
+        /*
+        These methods are ONLY overridden by file descriptor-based subclasses,
+        for example VBufferedFileStream and VSocketStream. They are called by
+        streamCopy() so that when neither stream has a buffer, it can still let
+        the kernel copy data directly between them (e.g., sendfile) rather than
+        bouncing the data through a temporary buffer.
+        */
+
+        /**
+        Returns the platform file descriptor from which the kernel can read the
+        stream's data directly, or -1 if the stream is not backed by a file
+        descriptor that supports this (for example, a memory or socket stream).
+        The caller will read relative to getIOOffset() and then seek() past the
+        data it consumed, so the stream must be prepared for its descriptor's
+        own offset to be bypassed.
+        @return    the file descriptor, or -1
+        */
+        virtual int _getReadFileDescriptor();
+        /**
+        Writes data to the stream by having the kernel read it directly from
+        the specified file descriptor, starting at the specified offset. The
+        file descriptor's own offset is neither used nor changed. Returns -1
+        by default, meaning the stream (or platform) does not support this, in
+        which case the caller must fall back to a buffered copy.
+        @param    fd                the file descriptor to read from
+        @param    offset            the file offset at which to start reading
+        @param    numBytesToWrite   the number of bytes to write
+        @return    the number of bytes written (fewer than requested only if the
+                end of file is reached), or -1 if not supported
+        */
+        virtual Vs64 _writeFromFileDescriptor(int fd, Vs64 offset, Vs64 numBytesToWrite);
+
         VString mName; ///< A name for use when debugging stream.
 };
 
@@ -103,7 +103,7 @@ class VTextTailRunner {
         VTailHandler&                   mHandler;           ///< The handler to be called with each line or code point tailed.
         bool                            mProcessByLine;     ///< True if we are tailing line-by-line, vs. by code point.
         VDuration                       mSleepDuration;     ///< The interval to sleep when there is no data available to read.
-        VString                         mLoggerName;        ///< The logger name to be used when emitting log output.
+        VNamedLoggerHandle              mLoggerName;        ///< The logger name to be used when emitting log output.
     
         mutable VMutex                  mMutex;             ///< Synchronizes access to mTailThread.
         VThread*                        mTailThread;        ///< The thread that does the actual tailing.
@@ -11,6 +11,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vtypes_internal_platform.h"
 
 #include "vmutex.h"
+#include "vrwmutex.h"
 #include "vsemaphore.h"
 #include "vlogger.h"
 #include "vinstant.h"
@@ -18,11 +19,74 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <time.h>
+#include <sched.h>
+#include <limits.h>
 
 // VThread platform-specific functions ---------------------------------------
 
+// Applies the stack size, affinity, and scheduling options to the thread attributes.
+// Returns true if an explicit scheduling policy was set, so the caller can fall back if it is refused.
+static bool _applyThreadOptions(pthread_attr_t* threadAttributes, const VThreadOptions& options) {
+    if (options.mStackSize != 0) {
+        // The size must be at least PTHREAD_STACK_MIN, and some implementations want a page multiple.
+        size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t stackSize = V_MAX(options.mStackSize, static_cast<size_t>(PTHREAD_STACK_MIN));
+        stackSize = ((stackSize + pageSize - 1) / pageSize) * pageSize;
+        int result = ::pthread_attr_setstacksize(threadAttributes, stackSize);
+        if (result != 0) {
+            throw VStackTraceException(VSystemError(result), VSTRING_FORMAT("VThread::threadCreate: pthread_attr_setstacksize(%d) failed.", (int) stackSize));
+        }
+    }
+
+#if defined(__GLIBC__) && defined(__USE_GNU)
+    if (options.mCPUAffinityMask != 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu = 0; cpu < 64; ++cpu) {
+            if ((options.mCPUAffinityMask & (CONST_U64(1) << cpu)) != 0) {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+
+        int result = ::pthread_attr_setaffinity_np(threadAttributes, sizeof(cpus), &cpus);
+        if (result != 0) {
+            throw VStackTraceException(VSystemError(result), "VThread::threadCreate: pthread_attr_setaffinity_np() failed.");
+        }
+    }
+#endif
+
+    if (options.mSchedulingPolicy == VThreadOptions::kDefaultPolicy) {
+        return false;
+    }
+
+    int policy = SCHED_OTHER;
+    if (options.mSchedulingPolicy == VThreadOptions::kFIFOPolicy) {
+        policy = SCHED_FIFO;
+    } else if (options.mSchedulingPolicy == VThreadOptions::kRoundRobinPolicy) {
+        policy = SCHED_RR;
+    }
+
+    struct sched_param param;
+    ::memset(&param, 0, sizeof(param));
+    param.sched_priority = V_MAX(::sched_get_priority_min(policy), V_MIN(options.mSchedulingPriority, ::sched_get_priority_max(policy)));
+
+    int result = ::pthread_attr_setinheritsched(threadAttributes, PTHREAD_EXPLICIT_SCHED);
+    if (result == 0) {
+        result = ::pthread_attr_setschedpolicy(threadAttributes, policy);
+    }
+    if (result == 0) {
+        result = ::pthread_attr_setschedparam(threadAttributes, &param);
+    }
+    if (result != 0) {
+        throw VStackTraceException(VSystemError(result), "VThread::threadCreate: Unable to set the scheduling policy attributes.");
+    }
+
+    return true;
+}
+
 // static
-void VThread::threadCreate(VThreadID_Type* threadID, bool createDetached, threadMainFunction threadMainProcPtr, void* threadArgument) {
+void VThread::threadCreate(VThreadID_Type* threadID, bool createDetached, threadMainFunction threadMainProcPtr, void* threadArgument, const VThreadOptions& options) {
     int             result;
     pthread_attr_t  threadAttributes;
 
@@ -32,28 +96,51 @@ void VThread::threadCreate(VThreadID_Type* threadID, bool createDetached, thread
         throw VStackTraceException(VSystemError(result), "VThread::threadCreate: pthread_attr_init() failed.");
     }
 
-    result = ::pthread_attr_setdetachstate(&threadAttributes, createDetached ? PTHREAD_CREATE_DETACHED : PTHREAD_CREATE_JOINABLE);
+    bool explicitScheduling = false;
+    try {
+        result = ::pthread_attr_setdetachstate(&threadAttributes, createDetached ? PTHREAD_CREATE_DETACHED : PTHREAD_CREATE_JOINABLE);
 
-    if (result != 0) {
-        throw VStackTraceException(VSystemError(result), "VThread::threadCreate: pthread_attr_setdetachstate() failed.");
+        if (result != 0) {
+            throw VStackTraceException(VSystemError(result), "VThread::threadCreate: pthread_attr_setdetachstate() failed.");
+        }
+
+        explicitScheduling = _applyThreadOptions(&threadAttributes, options);
+    } catch (...) {
+        (void) ::pthread_attr_destroy(&threadAttributes);
+        throw;
     }
 
     result = ::pthread_create(threadID, &threadAttributes, threadMainProcPtr, threadArgument);
 
+    if ((result == EPERM) && explicitScheduling) {
+        // Real-time policies need privileges we may not have. Run the thread anyway, with the inherited policy.
+        VLOGGER_WARN("VThread::threadCreate: Not permitted to set the requested scheduling policy; using the default policy.");
+        (void) ::pthread_attr_setinheritsched(&threadAttributes, PTHREAD_INHERIT_SCHED);
+        result = ::pthread_create(threadID, &threadAttributes, threadMainProcPtr, threadArgument);
+    }
+
+    (void) ::pthread_attr_destroy(&threadAttributes);
+
     if (result != 0) {
         // Usually this means we have hit the limit of threads allowed per process.
         // Log our statistics. Maybe we have a thread handle leak.
         throw VStackTraceException(VSystemError(result), "VThread::threadCreate: pthread_create failed. Likely due to lack of resources.");
     }
-
-    (void) ::pthread_attr_destroy(&threadAttributes);
 }
 
 // static
 #ifdef VTHREAD_PTHREAD_SETNAME_SUPPORTED
 void VThread::_threadStarting(const VThread* thread) {
     // This API lets us associate our thread name with the native thread resource, so that debugger/crashdump/instruments etc. can see our thread name.
-    (void)/*int result =*/ ::pthread_setname_np(thread->getName()); // "np" indicates API is non-POSIX
+    // "np" indicates API is non-POSIX, and indeed the signature differs: Mac OS X only names the calling thread,
+    // while Linux takes the thread to name, and limits the name to 15 characters plus the terminating null.
+#ifdef VPLATFORM_MAC
+    (void)/*int result =*/ ::pthread_setname_np(thread->getName());
+#else
+    char name[16];
+    thread->getName().copyToBuffer(name, sizeof(name));
+    (void)/*int result =*/ ::pthread_setname_np(::pthread_self(), name);
+#endif
 }
 #else
 void VThread::_threadStarting(const VThread* /*thread*/) {
@@ -91,6 +178,12 @@ bool VThread::setPriority(int nice) {
     return (::setpriority(PRIO_PROCESS, 0, nice) == 0);
 }
 
+// static
+int VThread::getNumberOfProcessors() {
+    long numProcessors = ::sysconf(_SC_NPROCESSORS_ONLN);
+    return (numProcessors < 1) ? 1 : static_cast<int>(numProcessors);
+}
+
 // static
 void VThread::sleep(const VDuration& interval) {
     int milliseconds = static_cast<int>(interval.getDurationMilliseconds());
@@ -134,11 +227,76 @@ bool VMutex::mutexUnlock(VMutex_Type* mutex) {
     return (::pthread_mutex_unlock(mutex) == 0);
 }
 
+// static
+bool VMutex::mutexTryLock(VMutex_Type* mutex) {
+    return (::pthread_mutex_trylock(mutex) == 0);
+}
+
+// VRWMutex platform-specific functions -------------------------------------
+
+// static
+bool VRWMutex::rwMutexInit(VRWMutex_Type* rwMutex) {
+    pthread_rwlockattr_t attributes;
+    if (::pthread_rwlockattr_init(&attributes) != 0) {
+        return false;
+    }
+
+#if defined(__GLIBC__) && defined(__USE_GNU)
+    // glibc defaults to preferring readers, which lets a steady stream of readers starve a writer.
+    (void) ::pthread_rwlockattr_setkind_np(&attributes, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+
+    bool success = (::pthread_rwlock_init(rwMutex, &attributes) == 0);
+    (void) ::pthread_rwlockattr_destroy(&attributes);
+    return success;
+}
+
+// static
+void VRWMutex::rwMutexDestroy(VRWMutex_Type* rwMutex) {
+    (void) ::pthread_rwlock_destroy(rwMutex);
+}
+
+// static
+bool VRWMutex::rwMutexReadLock(VRWMutex_Type* rwMutex) {
+    return (::pthread_rwlock_rdlock(rwMutex) == 0);
+}
+
+// static
+bool VRWMutex::rwMutexReadUnlock(VRWMutex_Type* rwMutex) {
+    return (::pthread_rwlock_unlock(rwMutex) == 0);
+}
+
+// static
+bool VRWMutex::rwMutexWriteLock(VRWMutex_Type* rwMutex) {
+    return (::pthread_rwlock_wrlock(rwMutex) == 0);
+}
+
+// static
+bool VRWMutex::rwMutexWriteUnlock(VRWMutex_Type* rwMutex) {
+    return (::pthread_rwlock_unlock(rwMutex) == 0);
+}
+
 // VSemaphore platform-specific functions ------------------------------------
 
 // static
 bool VSemaphore::semaphoreInit(VSemaphore_Type* semaphore) {
+#ifdef VPLATFORM_MAC
+    // Mac OS X has no pthread_condattr_setclock(); semaphoreWait() uses a relative timed wait instead.
     return (pthread_cond_init(semaphore, NULL) == 0);
+#else
+    // Measure timed waits on the monotonic clock, so that wall clock changes don't make them
+    // return early or hang. semaphoreWait() computes its deadlines on the same clock.
+    pthread_condattr_t attributes;
+    if (pthread_condattr_init(&attributes) != 0) {
+        return false;
+    }
+
+    bool success = (pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC) == 0) &&
+                   (pthread_cond_init(semaphore, &attributes) == 0);
+
+    (void) pthread_condattr_destroy(&attributes);
+    return success;
+#endif
 }
 
 // static
@@ -148,23 +306,29 @@ bool VSemaphore::semaphoreDestroy(VSemaphore_Type* semaphore) {
 
 // static
 bool VSemaphore::semaphoreWait(VSemaphore_Type* semaphore, VMutex_Type* mutex, const VDuration& timeoutInterval) {
-    if (timeoutInterval == VDuration::ZERO()) {
+    if ((timeoutInterval == VDuration::ZERO()) || (timeoutInterval == VDuration::POSITIVE_INFINITY())) {
         return (pthread_cond_wait(semaphore, mutex) == 0);
     }
 
-    // The timespec is an absolute time (base is 1970 UTC), not an
-    // offset from the current time.
-    VInstant now;
-    VInstant timeoutWhen = now + timeoutInterval;
-    Vs64     timeoutValue = timeoutWhen.getValue();
-
+    Vs64 timeoutMilliseconds = timeoutInterval.getDurationMilliseconds();
     struct timespec timeoutSpec;
 
-    // Convert milliseconds to seconds.nanoseconds. e.g., 1234ms = 1sec + 234,000,000ns
-    timeoutSpec.tv_sec = static_cast<time_t>(timeoutValue / CONST_S64(1000));
-    timeoutSpec.tv_nsec = static_cast<time_t>(CONST_S64(1000000) * (timeoutValue % CONST_S64(1000)));
+#ifdef VPLATFORM_MAC
+    // A relative wait, which the wall clock cannot affect.
+    timeoutSpec.tv_sec = static_cast<time_t>(timeoutMilliseconds / CONST_S64(1000));
+    timeoutSpec.tv_nsec = static_cast<long>(CONST_S64(1000000) * (timeoutMilliseconds % CONST_S64(1000)));
+
+    int result = pthread_cond_timedwait_relative_np(semaphore, mutex, &timeoutSpec);
+#else
+    // The timespec is an absolute time on the condition's clock, which semaphoreInit() set to CLOCK_MONOTONIC.
+    (void) clock_gettime(CLOCK_MONOTONIC, &timeoutSpec);
+
+    Vs64 nanoseconds = static_cast<Vs64>(timeoutSpec.tv_nsec) + (CONST_S64(1000000) * (timeoutMilliseconds % CONST_S64(1000)));
+    timeoutSpec.tv_sec += static_cast<time_t>((timeoutMilliseconds / CONST_S64(1000)) + (nanoseconds / CONST_S64(1000000000)));
+    timeoutSpec.tv_nsec = static_cast<long>(nanoseconds % CONST_S64(1000000000));
 
     int result = pthread_cond_timedwait(semaphore, mutex, &timeoutSpec);
+#endif
 
     return (result == 0) || (result == ETIMEDOUT);
 }
@@ -21,6 +21,7 @@ extern "C" {
 typedef pthread_t       VThreadID_Type;
 typedef pthread_cond_t  VSemaphore_Type;
 typedef pthread_mutex_t VMutex_Type;
+typedef pthread_rwlock_t VRWMutex_Type;
 typedef struct timespec VTimeout_Type;
 
 #endif /* vthread_platform_h */
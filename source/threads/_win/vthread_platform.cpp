@@ -9,6 +9,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 
 #include "vthread.h"
 #include "vmutex.h"
+#include "vrwmutex.h"
 #include "vsemaphore.h"
 #include "vexception.h"
 #include "vmutexlocker.h"
@@ -46,14 +47,26 @@ static HANDLE _lookupThreadHandle(VThreadID_Type threadID) {
 // VThread platform-specific functions ---------------------------------------
 
 // static
-void VThread::threadCreate(VThreadID_Type* threadID, bool /*createDetached*/, threadMainFunction threadMainProcPtr, void* threadArgument) {
-    HANDLE threadHandle = ::CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE) threadMainProcPtr, threadArgument, 0, /*(LPDWORD)*/ threadID);
+void VThread::threadCreate(VThreadID_Type* threadID, bool /*createDetached*/, threadMainFunction threadMainProcPtr, void* threadArgument, const VThreadOptions& options) {
+    // The stack size is a reservation, like the Unix one, rather than an amount to commit up front.
+    // If we are setting the affinity, create the thread suspended so that it never runs anywhere else.
+    // The scheduling policy options are Unix-only and are ignored here.
+    DWORD creationFlags = (options.mStackSize == 0 ? 0 : STACK_SIZE_PARAM_IS_A_RESERVATION) | (options.mCPUAffinityMask == 0 ? 0 : CREATE_SUSPENDED);
+    HANDLE threadHandle = ::CreateThread(NULL, options.mStackSize, (LPTHREAD_START_ROUTINE) threadMainProcPtr, threadArgument, creationFlags, /*(LPDWORD)*/ threadID);
 
     if (threadHandle == NULL) {
         throw VStackTraceException(VSystemError(), "VThread::threadCreate: CreateThread returned null.");
     }
 
     _addThreadToMap(*threadID, threadHandle);
+
+    if (options.mCPUAffinityMask != 0) {
+        if (::SetThreadAffinityMask(threadHandle, (DWORD_PTR) options.mCPUAffinityMask) == 0) {
+            VLOGGER_WARN(VSTRING_FORMAT("VThread::threadCreate: SetThreadAffinityMask failed with error %d.", (int) ::GetLastError()));
+        }
+
+        (void) ::ResumeThread(threadHandle);
+    }
 }
 
 // static
@@ -101,6 +114,13 @@ bool VThread::setPriority(int /*nice*/) {
     return true;
 }
 
+// static
+int VThread::getNumberOfProcessors() {
+    SYSTEM_INFO systemInfo;
+    ::GetSystemInfo(&systemInfo);
+    return (systemInfo.dwNumberOfProcessors < 1) ? 1 : static_cast<int>(systemInfo.dwNumberOfProcessors);
+}
+
 // static
 void VThread::sleep(const VDuration& interval) {
     Sleep(static_cast<DWORD>(interval.getDurationMilliseconds()));
@@ -138,6 +158,48 @@ bool VMutex::mutexUnlock(VMutex_Type* mutex) {
     return true;
 }
 
+// static
+bool VMutex::mutexTryLock(VMutex_Type* mutex) {
+    return (TryEnterCriticalSection(mutex) != 0);
+}
+
+// VRWMutex platform-specific functions -------------------------------------
+
+// static
+bool VRWMutex::rwMutexInit(VRWMutex_Type* rwMutex) {
+    InitializeSRWLock(rwMutex);
+    return true;
+}
+
+// static
+void VRWMutex::rwMutexDestroy(VRWMutex_Type* /*rwMutex*/) {
+    // An SRW lock has no resources to release.
+}
+
+// static
+bool VRWMutex::rwMutexReadLock(VRWMutex_Type* rwMutex) {
+    AcquireSRWLockShared(rwMutex);
+    return true;
+}
+
+// static
+bool VRWMutex::rwMutexReadUnlock(VRWMutex_Type* rwMutex) {
+    ReleaseSRWLockShared(rwMutex);
+    return true;
+}
+
+// static
+bool VRWMutex::rwMutexWriteLock(VRWMutex_Type* rwMutex) {
+    AcquireSRWLockExclusive(rwMutex);
+    return true;
+}
+
+// static
+bool VRWMutex::rwMutexWriteUnlock(VRWMutex_Type* rwMutex) {
+    ReleaseSRWLockExclusive(rwMutex);
+    return true;
+}
+
 // VSemaphore platform-specific functions ------------------------------------
 
 #define kSemaphoreMaxCount 1
@@ -155,16 +217,21 @@ bool VSemaphore::semaphoreDestroy(VSemaphore_Type* semaphore) {
 }
 
 // static
-bool VSemaphore::semaphoreWait(VSemaphore_Type* semaphore, VMutex_Type* /*mutex*/, const VDuration& timeoutInterval) {
+bool VSemaphore::semaphoreWait(VSemaphore_Type* semaphore, VMutex_Type* mutex, const VDuration& timeoutInterval) {
     DWORD timeoutMillisecondsDWORD;
 
-    if (timeoutInterval == VDuration::ZERO()) {
+    if ((timeoutInterval == VDuration::ZERO()) || (timeoutInterval == VDuration::POSITIVE_INFINITY())) {
         timeoutMillisecondsDWORD = INFINITE;
     } else {
         timeoutMillisecondsDWORD = static_cast<DWORD>(timeoutInterval.getDurationMilliseconds());
     }
 
+    // Release the caller's mutex while waiting, as pthread_cond_wait does. Unlike a condition variable,
+    // the semaphore keeps its count, so a signal that arrives after we unlock but before we wait is not lost.
+    LeaveCriticalSection(mutex);
     DWORD result = WaitForSingleObject(*semaphore, timeoutMillisecondsDWORD);    // waits until the semaphore's count is > 0, then decrements it
+    EnterCriticalSection(mutex);
+
     return (result != WAIT_FAILED);
 }
 
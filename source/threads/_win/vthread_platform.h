@@ -24,6 +24,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 typedef DWORD               VThreadID_Type;
 typedef HANDLE              VSemaphore_Type;
 typedef CRITICAL_SECTION    VMutex_Type;
+typedef SRWLOCK             VRWMutex_Type;
 typedef long                VTimeout_Type;
 
 #endif /* vthread_platform_h */
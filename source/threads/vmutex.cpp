@@ -12,18 +12,126 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vexception.h"
 #include "vthread.h"
 #include "vlogger.h"
+#include "vbento.h"
+
+#include <set>
 
 VDuration VMutex::gVMutexLockDelayLoggingThreshold(100 * VDuration::MILLISECOND());
 int VMutex::gVMutexLockDelayLoggingLevel(VLoggerLevel::DEBUG);
+volatile bool VMutex::gVMutexContentionProfilingEnabled = false;
+volatile int VMutex::gVMutexContentionGeneration = 0;
+
+// VMutexContentionStats ------------------------------------------------------
+
+void VMutexContentionStats::add(const VMutexContentionStats& other) {
+    mNumAcquisitions += other.mNumAcquisitions;
+    mNumContendedAcquisitions += other.mNumContendedAcquisitions;
+    mTotalWaitMicroseconds += other.mTotalWaitMicroseconds;
+    mMaxWaitMicroseconds = V_MAX(mMaxWaitMicroseconds, other.mMaxWaitMicroseconds);
+    mTotalHoldMicroseconds += other.mTotalHoldMicroseconds;
+    mMaxHoldMicroseconds = V_MAX(mMaxHoldMicroseconds, other.mMaxHoldMicroseconds);
+}
+
+// VMutexContentionRegistry ---------------------------------------------------
+
+/**
+VMutexContentionRegistry knows every mutex that has been locked while contention
+profiling was on, plus the counts of such mutexes that have since been destroyed,
+so that the profile can be aggregated by name. It uses a raw platform mutex,
+because a VMutex would profile itself.
+*/
+class VMutexContentionRegistry {
+    public:
+
+        // Never destroyed, so that static VMutexes destructed at exit can still unregister.
+        static VMutexContentionRegistry& instance() {
+            static VMutexContentionRegistry* gInstance = new VMutexContentionRegistry();
+            return *gInstance;
+        }
+
+        void registerMutex(VMutex* mutex) {
+            RawLocker locker(&mMutex);
+            mMutexes.insert(mutex);
+            mutex->mContentionRegistered = true;
+        }
+
+        void unregisterMutex(VMutex* mutex) {
+            RawLocker locker(&mMutex);
+            mMutexes.erase(mutex);
+            if (mutex->mContentionGeneration == VMutex::gVMutexContentionGeneration) {
+                mRetired[_getProfileName(mutex)].add(mutex->mContentionStats);
+            }
+        }
+
+        void reset() {
+            RawLocker locker(&mMutex);
+            mRetired.clear();
+            ++VMutex::gVMutexContentionGeneration; // each mutex discards its own counts at its next lock
+        }
+
+        VMutexContentionMap getProfile() {
+            RawLocker locker(&mMutex);
+            VMutexContentionMap profile = mRetired;
+            for (MutexSet::const_iterator i = mMutexes.begin(); i != mMutexes.end(); ++i) {
+                if ((*i)->mContentionGeneration == VMutex::gVMutexContentionGeneration) {
+                    profile[_getProfileName(*i)].add((*i)->mContentionStats);
+                }
+            }
+
+            return profile;
+        }
+
+    private:
+
+        VMutexContentionRegistry() : mMutex(), mMutexes(), mRetired() { (void) VMutex::mutexInit(&mMutex); }
+        ~VMutexContentionRegistry() { VMutex::mutexDestroy(&mMutex); }
+
+        class RawLocker {
+            public:
+                RawLocker(VMutex_Type* mutex) : mMutex(mutex) { (void) VMutex::mutexLock(mMutex); }
+                ~RawLocker() { (void) VMutex::mutexUnlock(mMutex); }
+            private:
+                RawLocker(const RawLocker&); // not copyable
+                RawLocker& operator=(const RawLocker&); // not assignable
+                VMutex_Type* mMutex;
+        };
 
-VMutex::VMutex(const VString& name, bool suppressLogging)
+        static VString _getProfileName(const VMutex* mutex) {
+            return mutex->mName.isEmpty() ? VString("(unnamed)") : mutex->mName;
+        }
+
+        typedef std::set<VMutex*> MutexSet;
+
+        VMutex_Type         mMutex;     ///< Protects the set and the retired counts.
+        MutexSet            mMutexes;   ///< Live mutexes that have been profiled.
+        VMutexContentionMap mRetired;   ///< Counts of profiled mutexes that have been destroyed, by name.
+};
+
+// VMutex ---------------------------------------------------------------------
+
+const int VMutex::kMaxAdaptiveSpins; // V_MIN takes it by reference, so it needs a definition
+
+// Spinning only helps if the holder can run meanwhile. A function-local static, because
+// mutexes are constructed during static initialization.
+static bool _isMultiprocessor() {
+    static const bool kMultiprocessor = (VThread::getNumberOfProcessors() > 1);
+    return kMultiprocessor;
+}
+
+VMutex::VMutex(const VString& name, bool suppressLogging, bool spinBeforeBlocking)
     : mMutex()
     , mName(name)
     , mSuppressLogging(suppressLogging)
+    , mSpinBeforeBlocking(spinBeforeBlocking && _isMultiprocessor())
+    , mSpinEstimate(0)
     , mLastLockThread((VThreadID_Type) - 1)
     , mLastLockerName()
-    , mLastLockTime(VInstant::NEVER_OCCURRED())
+    , mLastLockTime(0)
     , mIsLocked(false)
+    , mProfileLockTime(0)
+    , mContentionStats()
+    , mContentionGeneration(0)
+    , mContentionRegistered(false)
     {
 
     if (! VMutex::mutexInit(&mMutex))
@@ -31,6 +139,10 @@ VMutex::VMutex(const VString& name, bool suppressLogging)
 }
 
 VMutex::~VMutex() {
+    if (mContentionRegistered) {
+        VMutexContentionRegistry::instance().unregisterMutex(this);
+    }
+
     VMutex::mutexDestroy(&mMutex);
 }
 
@@ -46,22 +158,49 @@ bool VMutex::isLockedByCurrentThread() const {
     return mIsLocked && (mLastLockThread == VThread::threadSelf());
 }
 
-void VMutex::_lock(const VString& lockerName) {
+void VMutex::_lock(const char* lockerName) {
 #ifdef VAULT_MUTEX_LOCK_DELAY_CHECK
-    VInstant start;
+    // Only pay for the clock reads and name copy if delay logging is actually turned on.
+    const bool checkDelay = (gVMutexLockDelayLoggingThreshold >= VDuration::ZERO()) && ! mSuppressLogging;
+    Vs64 start = checkDelay ? VDeadline::monotonicMicroseconds() : 0;
 #endif
-    if (VMutex::mutexLock(&mMutex)) {
-        mLastLockTime.setNow();
 
+    // With contention profiling on, a failed try-lock tells us we are about to wait.
+    const bool profile = gVMutexContentionProfilingEnabled;
+    bool contended = false;
+    Vs64 waitMicroseconds = 0;
+    bool locked;
+    if (! profile && ! mSpinBeforeBlocking) {
+        locked = VMutex::mutexLock(&mMutex);
+    } else if (VMutex::mutexTryLock(&mMutex)) {
+        locked = true;
+    } else if (! profile) {
+        locked = this->_lockContended();
+    } else {
+        contended = true;
+        Vs64 waitStart = VDeadline::monotonicMicroseconds();
+        locked = this->_lockContended();
+        waitMicroseconds = VDeadline::monotonicMicroseconds() - waitStart;
+    }
+
+    if (locked) {
 #ifdef VAULT_MUTEX_LOCK_DELAY_CHECK
-        if ((gVMutexLockDelayLoggingThreshold >= VDuration::ZERO()) && ! mSuppressLogging) {
-            VInstant end;
-            VDuration waitTime = end - start;
+        if (checkDelay) {
+            if (lockerName == NULL) {
+                lockerName = "";
+            }
+
+            mLastLockTime = VDeadline::monotonicMicroseconds();
+            VDuration waitTime = VDuration::MILLISECOND() * ((mLastLockTime - start) / CONST_S64(1000));
 
             if (waitTime >= gVMutexLockDelayLoggingThreshold) {
                 VLOGGER_LEVEL(gVMutexLockDelayLoggingLevel, VSTRING_FORMAT("Delay: '%s' was blocked " VSTRING_FORMATTER_S64 "ms on mutex '%s' released by '%s'.",
-                                                                           lockerName.chars(), waitTime.getDurationMilliseconds(), mName.chars(), mLastLockerName.chars()));
+                                                                           lockerName, waitTime.getDurationMilliseconds(), mName.chars(), mLastLockerName.chars()));
             }
+
+            mLastLockerName = lockerName;
+        } else {
+            mLastLockTime = 0;
         }
 #endif
 
@@ -69,8 +208,11 @@ void VMutex::_lock(const VString& lockerName) {
         // The only guarantee is that they end up set to their new values after the lock is acquired above, and before we return.
         // They may only be used for mutex diagnostics (e.g. isLockedByCurrentThread() and lock delay reporting), not for concurrency control.
         mLastLockThread = VThread::threadSelf();
-        mLastLockerName = lockerName;
         mIsLocked = true;
+
+        if (profile) {
+            this->_recordAcquisition(contended, waitMicroseconds);
+        }
     } else {
         if (mName.isEmpty()) {
             throw VStackTraceException("VMutex::lock unable to lock mutex.");
@@ -82,9 +224,8 @@ void VMutex::_lock(const VString& lockerName) {
 
 void VMutex::_unlock() {
 #ifdef VAULT_MUTEX_LOCK_DELAY_CHECK
-    if ((gVMutexLockDelayLoggingThreshold >= VDuration::ZERO()) && ! mSuppressLogging) {
-        VInstant now;
-        VDuration delay = now - mLastLockTime;
+    if ((mLastLockTime != 0) && (gVMutexLockDelayLoggingThreshold >= VDuration::ZERO()) && ! mSuppressLogging) {
+        VDuration delay = VDuration::MILLISECOND() * ((VDeadline::monotonicMicroseconds() - mLastLockTime) / CONST_S64(1000));
         if (delay >= gVMutexLockDelayLoggingThreshold) {
             VLOGGER_LEVEL(gVMutexLockDelayLoggingLevel, VSTRING_FORMAT("Delay: '%s' is unlocking mutex '%s' after holding it for " VSTRING_FORMATTER_S64 "ms.",
                                                                        mLastLockerName.chars(), mName.chars(), delay.getDurationMilliseconds()));
@@ -92,6 +233,10 @@ void VMutex::_unlock() {
     }
 #endif
 
+    if (mProfileLockTime != 0) {
+        this->_recordHoldEnded();
+    }
+
     mIsLocked = false; // Note: Must set false *before* unlocking, otherwise we may set it false after another thread jumps in, locks, sets it true, confusing isLockedByCurrentThread(). Part of non-atomicity warning above.
     if (! VMutex::mutexUnlock(&mMutex)) {
         mIsLocked = true; // Restore value since we failed to unlock.
@@ -103,3 +248,133 @@ void VMutex::_unlock() {
     }
 }
 
+
+bool VMutex::_lockContended() {
+    if (! mSpinBeforeBlocking) {
+        return VMutex::mutexLock(&mMutex);
+    }
+
+    // Like glibc's adaptive mutex: allow a little more than the recent average number of
+    // spins, and fold each outcome into the average, so that a mutex whose holders keep it
+    // too long for spinning to pay off soon goes back to blocking almost at once.
+    // The estimate is only written while holding the lock.
+    int maxSpins = V_MIN(kMaxAdaptiveSpins, (mSpinEstimate * 2) + 10);
+    for (int spins = 1; spins <= maxSpins; ++spins) {
+        V_CPU_PAUSE();
+        if (VMutex::mutexTryLock(&mMutex)) {
+            mSpinEstimate += (spins - mSpinEstimate) / 8;
+            return true;
+        }
+    }
+
+    if (! VMutex::mutexLock(&mMutex)) {
+        return false;
+    }
+
+    mSpinEstimate += (maxSpins - mSpinEstimate) / 8;
+    return true;
+}
+
+void VMutex::_recordAcquisition(bool contended, Vs64 waitMicroseconds) {
+    if (mContentionGeneration != gVMutexContentionGeneration) {
+        mContentionStats = VMutexContentionStats(); // the profile was reset since we last counted
+        mContentionGeneration = gVMutexContentionGeneration;
+    }
+
+    if (! mContentionRegistered) {
+        VMutexContentionRegistry::instance().registerMutex(this);
+    }
+
+    ++mContentionStats.mNumAcquisitions;
+    if (contended) {
+        ++mContentionStats.mNumContendedAcquisitions;
+        mContentionStats.mTotalWaitMicroseconds += waitMicroseconds;
+        mContentionStats.mMaxWaitMicroseconds = V_MAX(mContentionStats.mMaxWaitMicroseconds, waitMicroseconds);
+    }
+
+    mProfileLockTime = VDeadline::monotonicMicroseconds();
+}
+
+bool VMutex::_suspendHoldTiming() {
+    if (mProfileLockTime == 0) {
+        return false;
+    }
+
+    this->_recordHoldEnded();
+    return true;
+}
+
+void VMutex::_resumeHoldTiming() {
+    mProfileLockTime = VDeadline::monotonicMicroseconds();
+}
+
+void VMutex::_recordHoldEnded() {
+    Vs64 holdMicroseconds = VDeadline::monotonicMicroseconds() - mProfileLockTime;
+    mProfileLockTime = 0;
+
+    // Counts from before a reset are discarded at the next acquisition rather than here.
+    if (mContentionGeneration == gVMutexContentionGeneration) {
+        mContentionStats.mTotalHoldMicroseconds += holdMicroseconds;
+        mContentionStats.mMaxHoldMicroseconds = V_MAX(mContentionStats.mMaxHoldMicroseconds, holdMicroseconds);
+    }
+}
+
+// static
+void VMutex::resetContentionProfile() {
+    VMutexContentionRegistry::instance().reset();
+}
+
+// static
+VMutexContentionMap VMutex::getContentionProfile() {
+    return VMutexContentionRegistry::instance().getProfile();
+}
+
+static bool _isMoreWaitedOn(const VMutexContentionMap::value_type* a, const VMutexContentionMap::value_type* b) {
+    return a->second.mTotalWaitMicroseconds > b->second.mTotalWaitMicroseconds;
+}
+
+// static
+VBentoNode* VMutex::commandGetContentionInfo() {
+    VMutexContentionMap profile = VMutex::getContentionProfile();
+
+    std::vector<const VMutexContentionMap::value_type*> entries;
+    for (VMutexContentionMap::const_iterator i = profile.begin(); i != profile.end(); ++i) {
+        entries.push_back(&(*i));
+    }
+
+    std::stable_sort(entries.begin(), entries.end(), _isMoreWaitedOn);
+
+    VBentoNode* rootNode = new VBentoNode("mutex-contention");
+    rootNode->addBool("enabled", gVMutexContentionProfilingEnabled);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const VMutexContentionStats& stats = entries[i]->second;
+        VBentoNode* mutexNode = rootNode->addNewChildNode("mutex");
+        mutexNode->addString("name", entries[i]->first);
+        mutexNode->addS64("acquisitions", stats.mNumAcquisitions);
+        mutexNode->addS64("contended", stats.mNumContendedAcquisitions);
+        mutexNode->addS64("total-wait-us", stats.mTotalWaitMicroseconds);
+        mutexNode->addS64("max-wait-us", stats.mMaxWaitMicroseconds);
+        mutexNode->addS64("total-hold-us", stats.mTotalHoldMicroseconds);
+        mutexNode->addS64("max-hold-us", stats.mMaxHoldMicroseconds);
+    }
+
+    return rootNode;
+}
+
+// static
+VString VMutex::commandGetContentionInfoString() {
+    VUniquePtr<VBentoNode> bento(VMutex::commandGetContentionInfo());
+    VString s;
+    bento->writeToBentoTextString(s, true);
+    return s;
+}
+
+// static
+void VMutex::commandSetContentionProfiling(bool enabled) {
+    VMutex::setContentionProfilingEnabled(enabled);
+}
+
+// static
+void VMutex::commandResetContentionProfile() {
+    VMutex::resetContentionProfile();
+}
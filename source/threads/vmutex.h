@@ -16,10 +16,41 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vstring.h"
 #include "vinstant.h"
 
+class VBentoNode;
+
 /**
     @ingroup vthread
 */
 
+/**
+VMutexContentionStats holds the contention profiler's counts for the
+mutexes of one name; @see VMutex::setContentionProfilingEnabled().
+*/
+class VMutexContentionStats {
+    public:
+
+        VMutexContentionStats() : mNumAcquisitions(0), mNumContendedAcquisitions(0), mTotalWaitMicroseconds(0), mMaxWaitMicroseconds(0), mTotalHoldMicroseconds(0), mMaxHoldMicroseconds(0) {}
+        ~VMutexContentionStats() {}
+
+        /**
+        Adds another set of counts into this one.
+        @param  other   the counts to add
+        */
+        void add(const VMutexContentionStats& other);
+
+        Vs64    mNumAcquisitions;           ///< Times the mutex was locked.
+        Vs64    mNumContendedAcquisitions;  ///< Times the locker had to wait because another thread held it.
+        Vs64    mTotalWaitMicroseconds;     ///< Total time spent waiting to acquire it.
+        Vs64    mMaxWaitMicroseconds;       ///< Longest single wait to acquire it.
+        Vs64    mTotalHoldMicroseconds;     ///< Total time it was held (excluding VSemaphore waits, which release it).
+        Vs64    mMaxHoldMicroseconds;       ///< Longest single hold.
+};
+
+/**
+VMutexContentionMap maps mutex names to their aggregated contention counts.
+*/
+typedef std::map<VString, VMutexContentionStats> VMutexContentionMap;
+
 /**
 VMutex implements a platform-independent mutex that you can embed in an
 object or place on the stack to guarantee its cleanup when the VMutex object
@@ -44,13 +75,24 @@ class VMutex {
         @param suppressLogging  if this mutex is specifically locked during logging, this flag
                 must be set so that VMutex doesn't try to log information
                 about this mutex (avoids recursive locking deadlock)
+        @param spinBeforeBlocking   kSpinThenBlock for a mutex that protects very short critical
+                sections: a locker that finds it held spins briefly, in case the holder
+                is about to release it, before sleeping in the OS; the number of spins
+                adapts to how long recent lockers had to spin. kBlockImmediately (the
+                default) sleeps right away. Spinning is skipped on single-processor
+                machines, where the holder cannot run while we spin.
         */
-        VMutex(const VString& name = VString::EMPTY(), bool suppressLogging = false);
+        VMutex(const VString& name = VString::EMPTY(), bool suppressLogging = false, bool spinBeforeBlocking = kBlockImmediately);
         /**
         Destructs the mutex.
         */
         virtual ~VMutex();
 
+        // Constants to pass for the constructor spinBeforeBlocking parameter:
+        static const bool kSpinThenBlock = true;        ///< Spin briefly before sleeping when the mutex is held.
+        static const bool kBlockImmediately = false;    ///< Sleep as soon as the mutex is found held.
+        static const int kMaxAdaptiveSpins = 100;       ///< The most times a kSpinThenBlock locker retries before sleeping.
+
         /**
         In some cases it's more convenient to name a mutex after constructing,
         in which case you can call setName(). The name is only used for
@@ -113,6 +155,12 @@ class VMutex {
         @return true on success; false on failure
         */
         static bool mutexUnlock(VMutex_Type* mutex);
+        /**
+        Locks the platform mutex value if it is not already locked, without blocking.
+        Wrapper on Unix for pthread_mutex_trylock.
+        @return true if the lock was acquired; false if another thread holds it
+        */
+        static bool mutexTryLock(VMutex_Type* mutex);
 
         /**
         The following methods set and get the configuration for emitting
@@ -120,6 +168,7 @@ class VMutex {
         a lock. First, you must compile with VAULT_MUTEX_LOCK_DELAY_CHECK
         defined (presumably in vconfigure.h) to have the delay checking code in place.
         The default delay threshold is 50ms. If you specify 0, every lock will log a message.
+        A negative threshold turns the checking off, and locking then skips the clock reads.
         You can set the log leve at which the output will be emitted.
         */
         static void setLockDelayLoggingThreshold(const VDuration& threshold)    { gVMutexLockDelayLoggingThreshold = threshold; }
@@ -127,6 +176,28 @@ class VMutex {
         static void setLockDelayLoggingLevel(int logLevel)                      { gVMutexLockDelayLoggingLevel = logLevel; }
         static int getLockDelayLoggingLevel()                                   { return gVMutexLockDelayLoggingLevel; }
 
+        /**
+        The contention profiler, unlike the delay logging above, is always compiled in
+        and is turned on and off at runtime. While it is on, every lock records whether
+        it had to wait, how long it waited, and how long the mutex was then held; the
+        counts are aggregated by mutex name, so that you can see which mutexes actually
+        limit scaling without logging every slow lock. While it is off, locking costs one
+        extra flag test. Counts accumulate until resetContentionProfile() is called; a
+        mutex's counts survive its destruction. The counts of mutexes that are in use are
+        read without locking them, so a snapshot may be very slightly inconsistent.
+        */
+        static void setContentionProfilingEnabled(bool enabled) { gVMutexContentionProfilingEnabled = enabled; }
+        static bool isContentionProfilingEnabled()              { return gVMutexContentionProfilingEnabled; }
+        static void resetContentionProfile();                   ///< Discards all counts gathered so far.
+        static VMutexContentionMap getContentionProfile();      ///< Returns the counts for each mutex name. @return obvious
+
+        // These functions whose name is prefixed with "command" are intended for use at runtime from
+        // a command facility, in the same way as the VLogger command functions.
+        static VBentoNode* commandGetContentionInfo();      ///< Returns a Bento structure of the contention profile, most-waited-on mutex first. Caller owns it. @return obvious
+        static VString commandGetContentionInfoString();    ///< Returns a string taken from the Bento results of commandGetContentionInfo(). @return obvious
+        static void commandSetContentionProfiling(bool enabled); ///< Calls through to setContentionProfilingEnabled().
+        static void commandResetContentionProfile();        ///< Calls through to resetContentionProfile().
+
     private:
 
         VMutex(const VMutex&); // not copyable
@@ -135,34 +206,73 @@ class VMutex {
         // _lock() and _unlock() are only accessible to the locker and unlocker classes, and unit test.
         friend class VMutexLocker;
         friend class VMutexUnlocker;
+        friend class VSemaphore;
         friend class VThreadsUnit;
+        friend class VMutexContentionRegistry;
 
         /**
         Acquires the mutex lock; if the mutex is currently locked by another
         thread, this call blocks until the mutex lock can be acquired (if
         several threads are competing, the order in which they acquire the
         mutex is not known). You can supply a name to identify who is attempting
-        to lock, for diagnostic purposes (the name is stored).
-        @param lockerName the name of the caller, for diagnostic purposes
+        to lock, for diagnostic purposes. The name and lock time are only
+        recorded when compiled with VAULT_MUTEX_LOCK_DELAY_CHECK and the delay
+        logging threshold is not negative; otherwise this does no more than the
+        platform lock plus two plain stores.
+        @param lockerName the name of the caller, for diagnostic purposes; may be NULL
+        */
+        void _lock(const char* lockerName = NULL);
+        /**
+        Acquires the mutex lock after a try-lock has failed: for a kSpinThenBlock
+        mutex, spins retrying first, then blocks.
+        @return true on success; false if the platform lock failed
         */
-        void _lock(const VString& lockerName = VString::EMPTY());
+        bool _lockContended();
         /**
         Releases the mutex lock; if one or more other threads is waiting on
         the mutex, one of them will unblock and acquire the mutex lock once
         this thread releases it.
         */
         void _unlock();
+        /**
+        Updates the contention profile for an acquisition. Called with the mutex held.
+        @param  contended           true if the lock had to wait for another thread
+        @param  waitMicroseconds    how long it waited
+        */
+        void _recordAcquisition(bool contended, Vs64 waitMicroseconds);
+        /**
+        Ends the current hold for the contention profile because VSemaphore is about
+        to release the mutex while it waits.
+        @return true if the hold was being timed, in which case _resumeHoldTiming() must follow the wait
+        */
+        bool _suspendHoldTiming();
+        /**
+        Starts timing a new hold after a VSemaphore wait has re-acquired the mutex.
+        */
+        void _resumeHoldTiming();
+        /**
+        Records the end of a hold in the contention profile.
+        */
+        void _recordHoldEnded();
 
         VMutex_Type             mMutex;             ///< The OS mutex handle.
         VString                 mName;              ///< The name of this mutex for diagnostic purposes.
         bool                    mSuppressLogging;   ///< True if this VMutex must not call logger functions.
+        bool                    mSpinBeforeBlocking;///< True if contended lockers spin before blocking.
+        volatile int            mSpinEstimate;      ///< Running average of the spins recent contended lockers needed; only updated while locked.
         volatile VThreadID_Type mLastLockThread;    ///< If locked, the thread that acquired the lock.
-        VString                 mLastLockerName;    ///< The name of the last (or current) caller of lock().
-        VInstant                mLastLockTime;      ///< When the last acquisition of the lock occurred.
+        VString                 mLastLockerName;    ///< The name of the last (or current) caller of lock(). Only maintained with VAULT_MUTEX_LOCK_DELAY_CHECK.
+        Vs64                    mLastLockTime;      ///< VDeadline::monotonicMicroseconds() when the lock was last acquired, or 0 if delay checking was off. Only maintained with VAULT_MUTEX_LOCK_DELAY_CHECK.
         volatile bool           mIsLocked;          ///< For use only by isLockedByCurrentThread(); value may change concurrently.
+        Vs64                    mProfileLockTime;   ///< VDeadline::monotonicMicroseconds() when the lock was acquired with contention profiling on; otherwise 0.
+        VMutexContentionStats   mContentionStats;   ///< This mutex's contention counts, updated while it is held.
+        int                     mContentionGeneration; ///< The resetContentionProfile() generation that mContentionStats belongs to.
+        bool                    mContentionRegistered; ///< True once the contention registry knows about this mutex.
 
         static VDuration gVMutexLockDelayLoggingThreshold;  ///< If >=0, lock delays are logged.
         static int gVMutexLockDelayLoggingLevel;            ///< Log level at which lock delays are logged.
+        static volatile bool gVMutexContentionProfilingEnabled; ///< True if locks update the contention profile.
+        static volatile int gVMutexContentionGeneration;    ///< Incremented by resetContentionProfile() so that stale counts are discarded.
 };
 
 #endif /* vmutex_h */
@@ -17,6 +17,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 VMutexLocker::VMutexLocker(VMutex* mutex, const VString& name, bool lockInitially)
     : mMutex(mutex)
     , mIsLocked(false)
+    , mLabel(NULL)
     , mName(name)
     {
 
@@ -25,6 +26,18 @@ VMutexLocker::VMutexLocker(VMutex* mutex, const VString& name, bool lockInitiall
     }
 }
 
+VMutexLocker::VMutexLocker(VMutex* mutex, const char* name, bool lockInitially)
+    : mMutex(mutex)
+    , mIsLocked(false)
+    , mLabel(name)
+    , mName()
+    {
+
+    if (lockInitially) {
+        this->lock();
+    }
+}
+
 VMutexLocker::~VMutexLocker() {
     if (this->isLocked()) {
         // Prevent all exceptions from escaping destructor.
@@ -38,7 +51,7 @@ VMutexLocker::~VMutexLocker() {
 
 void VMutexLocker::lock() {
     if (mMutex != NULL) {
-        mMutex->_lock(mName); // specific friend access to private API
+        mMutex->_lock((mLabel == NULL) ? mName.chars() : mLabel); // specific friend access to private API
         mIsLocked = true;
     }
 }
@@ -61,6 +61,13 @@ mutex before the VMutexLocker is destructed. Another useful technique to cause
 the lock to be released earlier than the end of a function is to create a
 scope specifically to surround the VMutexLocker's existence.
 
+The locker name is only used for lock delay diagnostics, which are compiled
+in only when VAULT_MUTEX_LOCK_DELAY_CHECK is defined. Prefer passing a string
+literal: the const char* constructor just keeps the pointer, so a lock costs
+no more than the underlying platform mutex lock. Avoid building the name with
+VSTRING_FORMAT on hot paths; that formats and allocates on every lock even
+though the name is discarded in a normal build.
+
 @see    VMutex
 */
 class VMutexLocker {
@@ -81,6 +88,16 @@ class VMutexLocker {
         */
         VMutexLocker(VMutex* mutex, const VString& name, bool lockInitially = true);
         /**
+        Constructs the locker with a name that is a string literal or other
+        string whose lifetime exceeds the locker's. Only the pointer is kept,
+        so no string is constructed. Otherwise identical to the VString
+        constructor.
+        @param    mutex            the VMutex to lock, or NULL if no action is wanted
+        @param    name             the mutex locker name, typically a string literal; may be NULL
+        @param    lockInitially    true if the lock should be acquired on construction
+        */
+        VMutexLocker(VMutex* mutex, const char* name, bool lockInitially = true);
+        /**
         Destructor, unlocks the mutex if this object has acquired it.
         */
         virtual ~VMutexLocker();
@@ -118,9 +135,10 @@ class VMutexLocker {
 
     protected:
 
-        VMutex* mMutex;     ///< Pointer to the VMutex object, or NULL.
-        bool    mIsLocked;  ///< True if this object has acquired the lock.
-        VString mName;      ///< The name of this locker, for diagnostic purposes.
+        VMutex*     mMutex;     ///< Pointer to the VMutex object, or NULL.
+        bool        mIsLocked;  ///< True if this object has acquired the lock.
+        const char* mLabel;     ///< The name of this locker if supplied as a const char*, else NULL; for diagnostic purposes.
+        VString     mName;      ///< The name of this locker if supplied as a VString; for diagnostic purposes.
 
     private:
 
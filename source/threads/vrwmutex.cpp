@@ -0,0 +1,127 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+/** @file */
+
+#include "vrwmutex.h"
+
+#include "vexception.h"
+
+// VRWMutex --------------------------------------------------------------------
+
+VRWMutex::VRWMutex(const VString& name)
+    : mRWMutex()
+    , mName(name)
+    {
+
+    if (! VRWMutex::rwMutexInit(&mRWMutex))
+        throw VStackTraceException(VSTRING_FORMAT("VRWMutex::VRWMutex unable to initialize mutex '%s'.", name.chars()));
+}
+
+VRWMutex::~VRWMutex() {
+    VRWMutex::rwMutexDestroy(&mRWMutex);
+}
+
+void VRWMutex::_lockRead() {
+    if (! VRWMutex::rwMutexReadLock(&mRWMutex)) {
+        throw VStackTraceException(VSTRING_FORMAT("VRWMutex::_lockRead unable to lock mutex '%s'.", mName.chars()));
+    }
+}
+
+void VRWMutex::_unlockRead() {
+    if (! VRWMutex::rwMutexReadUnlock(&mRWMutex)) {
+        throw VStackTraceException(VSTRING_FORMAT("VRWMutex::_unlockRead unable to unlock mutex '%s'.", mName.chars()));
+    }
+}
+
+void VRWMutex::_lockWrite() {
+    if (! VRWMutex::rwMutexWriteLock(&mRWMutex)) {
+        throw VStackTraceException(VSTRING_FORMAT("VRWMutex::_lockWrite unable to lock mutex '%s'.", mName.chars()));
+    }
+}
+
+void VRWMutex::_unlockWrite() {
+    if (! VRWMutex::rwMutexWriteUnlock(&mRWMutex)) {
+        throw VStackTraceException(VSTRING_FORMAT("VRWMutex::_unlockWrite unable to unlock mutex '%s'.", mName.chars()));
+    }
+}
+
+// VReadLocker -----------------------------------------------------------------
+
+VReadLocker::VReadLocker(VRWMutex* rwMutex, const char* name, bool lockInitially)
+    : mRWMutex(rwMutex)
+    , mIsLocked(false)
+    , mName(name)
+    {
+
+    if (lockInitially) {
+        this->lock();
+    }
+}
+
+VReadLocker::~VReadLocker() {
+    if (this->isLocked()) {
+        // Prevent all exceptions from escaping destructor.
+        try {
+            this->unlock();
+        } catch (...) {}
+    }
+
+    mRWMutex = NULL;
+}
+
+void VReadLocker::lock() {
+    if ((mRWMutex != NULL) && ! this->isLocked()) {
+        mRWMutex->_lockRead(); // specific friend access to private API
+        mIsLocked = true;
+    }
+}
+
+void VReadLocker::unlock() {
+    if ((mRWMutex != NULL) && this->isLocked()) {
+        mRWMutex->_unlockRead(); // specific friend access to private API
+        mIsLocked = false;
+    }
+}
+
+// VWriteLocker ----------------------------------------------------------------
+
+VWriteLocker::VWriteLocker(VRWMutex* rwMutex, const char* name, bool lockInitially)
+    : mRWMutex(rwMutex)
+    , mIsLocked(false)
+    , mName(name)
+    {
+
+    if (lockInitially) {
+        this->lock();
+    }
+}
+
+VWriteLocker::~VWriteLocker() {
+    if (this->isLocked()) {
+        // Prevent all exceptions from escaping destructor.
+        try {
+            this->unlock();
+        } catch (...) {}
+    }
+
+    mRWMutex = NULL;
+}
+
+void VWriteLocker::lock() {
+    if ((mRWMutex != NULL) && ! this->isLocked()) {
+        mRWMutex->_lockWrite(); // specific friend access to private API
+        mIsLocked = true;
+    }
+}
+
+void VWriteLocker::unlock() {
+    if ((mRWMutex != NULL) && this->isLocked()) {
+        mRWMutex->_unlockWrite(); // specific friend access to private API
+        mIsLocked = false;
+    }
+}
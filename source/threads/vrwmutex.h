@@ -0,0 +1,256 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+#ifndef vrwmutex_h
+#define vrwmutex_h
+
+/** @file */
+
+#include "vtypes.h"
+
+#include "vthread_platform.h"
+#include "vstring.h"
+
+/**
+    @ingroup vthread
+*/
+
+// VRWMutex --------------------------------------------------------------------
+
+/**
+VRWMutex is a reader-writer lock: any number of threads may hold it for
+reading at the same time, but a thread holding it for writing excludes all
+others. Use it instead of a VMutex to protect read-mostly structures such as
+registries and lookup maps, where many threads look things up and changes
+are rare.
+
+You should use a VReadLocker or VWriteLocker to lock and unlock a VRWMutex,
+just as you would use a VMutexLocker with a VMutex.
+
+A VRWMutex is not recursive: a thread must not acquire it for writing while
+it already holds it, and should not acquire it for reading while it already
+holds it either, because a waiting writer may be given priority over the
+second read lock, deadlocking the thread. It also cannot be upgraded; to
+change from reading to writing, release the read lock, acquire the write
+lock, and re-check whatever you examined under the read lock.
+
+On Linux the lock is configured to prefer writers, so that a steady stream of
+readers cannot starve a writer indefinitely.
+
+@see    VReadLocker
+@see    VWriteLocker
+@see    VMutex
+*/
+class VRWMutex {
+    public:
+
+        /**
+        Constructs the reader-writer mutex.
+        @param  name    a name for the mutex, for diagnostic purposes
+        */
+        VRWMutex(const VString& name = VString::EMPTY());
+        /**
+        Destructor.
+        */
+        ~VRWMutex();
+
+        /**
+        Sets the mutex's name, for diagnostic purposes.
+        @param  name    the name
+        */
+        void setName(const VString& name) { mName = name; }
+        /**
+        Returns the mutex's name.
+        @return the name
+        */
+        const VString& getName() const { return mName; }
+
+        /**
+        Returns a pointer to the raw OS reader-writer lock handle.
+        @return a pointer to the raw OS lock handle
+        */
+        VRWMutex_Type* getRWMutex() { return &mRWMutex; }
+
+        // These are the static functions that provide the low-level platform-specific implementation.
+
+        /**
+        Initializes the platform reader-writer lock value.
+        Wrapper on Unix for pthread_rwlock_init.
+        @param  rwMutex pointer to the platform lock
+        @return true on success; false on failure
+        */
+        static bool rwMutexInit(VRWMutex_Type* rwMutex);
+        /**
+        Destroys the platform reader-writer lock value.
+        Wrapper on Unix for pthread_rwlock_destroy.
+        @param  rwMutex pointer to the platform lock
+        */
+        static void rwMutexDestroy(VRWMutex_Type* rwMutex);
+        /**
+        Acquires the platform reader-writer lock for reading.
+        Wrapper on Unix for pthread_rwlock_rdlock.
+        @return true on success; false on failure
+        */
+        static bool rwMutexReadLock(VRWMutex_Type* rwMutex);
+        /**
+        Releases the platform reader-writer lock after reading.
+        Wrapper on Unix for pthread_rwlock_unlock.
+        @return true on success; false on failure
+        */
+        static bool rwMutexReadUnlock(VRWMutex_Type* rwMutex);
+        /**
+        Acquires the platform reader-writer lock for writing.
+        Wrapper on Unix for pthread_rwlock_wrlock.
+        @return true on success; false on failure
+        */
+        static bool rwMutexWriteLock(VRWMutex_Type* rwMutex);
+        /**
+        Releases the platform reader-writer lock after writing.
+        Wrapper on Unix for pthread_rwlock_unlock.
+        @return true on success; false on failure
+        */
+        static bool rwMutexWriteUnlock(VRWMutex_Type* rwMutex);
+
+    private:
+
+        VRWMutex(const VRWMutex&); // not copyable
+        VRWMutex& operator=(const VRWMutex&); // not assignable
+
+        // The _lock and _unlock functions are only accessible to the locker classes, and unit test.
+        friend class VReadLocker;
+        friend class VWriteLocker;
+        friend class VThreadsUnit;
+
+        /**
+        Acquires the lock for reading, blocking while a writer holds it.
+        Throws a VStackTraceException if the lock cannot be acquired.
+        */
+        void _lockRead();
+        /**
+        Releases a read lock acquired by _lockRead().
+        */
+        void _unlockRead();
+        /**
+        Acquires the lock for writing, blocking while any reader or writer holds it.
+        Throws a VStackTraceException if the lock cannot be acquired.
+        */
+        void _lockWrite();
+        /**
+        Releases a write lock acquired by _lockWrite().
+        */
+        void _unlockWrite();
+
+        VRWMutex_Type   mRWMutex;   ///< The OS reader-writer lock handle.
+        VString         mName;      ///< The name of this mutex for diagnostic purposes.
+};
+
+// VReadLocker -----------------------------------------------------------------
+
+/**
+VReadLocker is the VMutexLocker counterpart for holding a VRWMutex for
+reading: it acquires the read lock on construction (unless told not to) and
+releases it on destruction, so the lock is released even if an exception is
+thrown while it is held.
+*/
+class VReadLocker {
+    public:
+
+        /**
+        Constructs the locker, and if specified, acquires the read lock.
+        @param    rwMutex          the VRWMutex to lock, or NULL if no action is wanted
+        @param    name             the locker name, typically a string literal; may be NULL
+        @param    lockInitially    true if the lock should be acquired on construction
+        */
+        VReadLocker(VRWMutex* rwMutex, const char* name, bool lockInitially = true);
+        /**
+        Destructor, releases the read lock if this object has acquired it.
+        */
+        ~VReadLocker();
+
+        /**
+        Acquires the read lock; blocks while a writer holds the mutex.
+        */
+        void lock();
+        /**
+        Releases the read lock.
+        */
+        void unlock();
+        /**
+        Returns true if this object has acquired the lock.
+        @return    true if this object has acquired the lock
+        */
+        bool isLocked() const { return mIsLocked; }
+        /**
+        Returns a pointer to the VRWMutex object.
+        @return a pointer to the VRWMutex object (may be NULL)
+        */
+        VRWMutex* getMutex() { return mRWMutex; }
+
+    private:
+
+        // Prevent copy construction and assignment since there is no provision for sharing a lock.
+        VReadLocker(const VReadLocker& other);
+        VReadLocker& operator=(const VReadLocker& other);
+
+        VRWMutex*   mRWMutex;   ///< Pointer to the VRWMutex object, or NULL.
+        bool        mIsLocked;  ///< True if this object has acquired the lock.
+        const char* mName;      ///< The name of this locker, for diagnostic purposes.
+};
+
+// VWriteLocker ----------------------------------------------------------------
+
+/**
+VWriteLocker is the VMutexLocker counterpart for holding a VRWMutex for
+writing: it acquires the write lock on construction (unless told not to) and
+releases it on destruction.
+*/
+class VWriteLocker {
+    public:
+
+        /**
+        Constructs the locker, and if specified, acquires the write lock.
+        @param    rwMutex          the VRWMutex to lock, or NULL if no action is wanted
+        @param    name             the locker name, typically a string literal; may be NULL
+        @param    lockInitially    true if the lock should be acquired on construction
+        */
+        VWriteLocker(VRWMutex* rwMutex, const char* name, bool lockInitially = true);
+        /**
+        Destructor, releases the write lock if this object has acquired it.
+        */
+        ~VWriteLocker();
+
+        /**
+        Acquires the write lock; blocks while any reader or writer holds the mutex.
+        */
+        void lock();
+        /**
+        Releases the write lock.
+        */
+        void unlock();
+        /**
+        Returns true if this object has acquired the lock.
+        @return    true if this object has acquired the lock
+        */
+        bool isLocked() const { return mIsLocked; }
+        /**
+        Returns a pointer to the VRWMutex object.
+        @return a pointer to the VRWMutex object (may be NULL)
+        */
+        VRWMutex* getMutex() { return mRWMutex; }
+
+    private:
+
+        // Prevent copy construction and assignment since there is no provision for sharing a lock.
+        VWriteLocker(const VWriteLocker& other);
+        VWriteLocker& operator=(const VWriteLocker& other);
+
+        VRWMutex*   mRWMutex;   ///< Pointer to the VRWMutex object, or NULL.
+        bool        mIsLocked;  ///< True if this object has acquired the lock.
+        const char* mName;      ///< The name of this locker, for diagnostic purposes.
+};
+
+#endif /* vrwmutex_h */
@@ -26,11 +26,25 @@ VSemaphore::~VSemaphore() {
 }
 
 void VSemaphore::wait(VMutex* ownedMutex, const VDuration& timeoutInterval) {
-    if (! VSemaphore::semaphoreWait(&mSemaphore, ownedMutex->getMutex(), timeoutInterval)) {
+    // The wait releases the mutex, so it must not count as holding it in the contention profile.
+    bool timingHold = ownedMutex->_suspendHoldTiming();
+    bool success = VSemaphore::semaphoreWait(&mSemaphore, ownedMutex->getMutex(), timeoutInterval);
+    if (timingHold) {
+        ownedMutex->_resumeHoldTiming();
+    }
+
+    if (! success) {
         throw VStackTraceException("VSemaphore::wait unable to wait on semaphore.");
     }
 }
 
+void VSemaphore::wait(VMutex* ownedMutex, const VDeadline& deadline) {
+    VDuration remaining = deadline.getRemaining();
+    if (remaining != VDuration::ZERO()) {
+        this->wait(ownedMutex, remaining);
+    }
+}
+
 void VSemaphore::signal() {
     if (! VSemaphore::semaphoreSignal(&mSemaphore)) {
         throw VStackTraceException("VSemaphore::signal unable to signal semaphore.");
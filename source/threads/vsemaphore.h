@@ -27,6 +27,11 @@ You can call the wait() and signal() methods to wait for a signal, and to
 unblock a waiter, respectively. To wait on a semaphore, you must supply a
 pointer to the VMutex that you have already acquired -- a semaphore is
 implicitly linked with a mutex.
+
+Timed waits are measured on the monotonic clock, so they are not affected by
+changes to the wall clock or by VInstant's simulated clock. A wait can return
+before it is signaled or times out (a "spurious" wake-up), so wait in a loop
+that re-checks your condition, bounding the loop with a VDeadline.
 */
 class VSemaphore {
     public:
@@ -44,11 +49,19 @@ class VSemaphore {
         Waits until the semaphore is signaled by another thread.
         @param    ownedMutex    the mutex that the caller has already
                             acquired the lock for
-        @param    timeoutInterval    zero for no timeout; otherwise, the amount
-                            of time after which to timeout
+        @param    timeoutInterval    zero or POSITIVE_INFINITY for no timeout; otherwise,
+                            the amount of time after which to timeout
         */
         void wait(VMutex* ownedMutex, const VDuration& timeoutInterval);
         /**
+        Waits until the semaphore is signaled by another thread, or until the
+        deadline passes. Returns at once if the deadline has already passed.
+        @param    ownedMutex    the mutex that the caller has already
+                            acquired the lock for
+        @param    deadline      the time after which to stop waiting
+        */
+        void wait(VMutex* ownedMutex, const VDeadline& deadline);
+        /**
         Signals the semaphore; if one or more other threads is waiting on
         the semaphore, exactly one of them will become unblocked by its
         wait() call returning.
@@ -63,7 +76,7 @@ class VSemaphore {
 
         /**
         Initializes the platform semaphore value.
-        Wrapper on Unix for pthread_cond_init.
+        Wrapper on Unix for pthread_cond_init, using the monotonic clock for timed waits.
         @param    semaphore    pointer to the platform semaphore
         @return true on success; false on failure
         */
@@ -84,8 +97,8 @@ class VSemaphore {
         @param    mutex        pointer to a locked platform mutex that the calling
                             thread had acquired; this function unlocks it while
                             waiting and locks it upon return
-        @param    timeoutInterval    zero for no timeout; otherwise, the interval after
-                            which to timeout
+        @param    timeoutInterval    zero or POSITIVE_INFINITY for no timeout; otherwise,
+                            the interval, measured on the monotonic clock, after which to timeout
         @return true on success; false on failure; timeout is considered success
         */
         static bool semaphoreWait(VSemaphore_Type* semaphore, VMutex_Type* mutex, const VDuration& timeoutInterval);
@@ -13,28 +13,84 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vexception.h"
 #include "vmanagementinterface.h"
 #include "vlogger.h"
+#include "vlogflightrecorder.h"
 #include "vmutexlocker.h"
+#include "vrwmutex.h"
 #include "vbento.h"
+#include "vsettings.h"
 
-// This private map allows us to keep track of all VThread objects, and therefore to
-// find the current thread's VThread object from the thread ID. We also have an API
-// to get info about all these threads.
+// This private map allows us to keep track of all VThread objects, so that we can
+// find a VThread object from its thread ID, and have an API to get info about all
+// these threads.
 typedef std::map<VThreadID_Type, VThread*> VThreadIDToVThreadMap;
 VThreadIDToVThreadMap gVThreadIDToVThreadMap;
-static VMutex gVThreadMapMutex("gVThreadMapMutex", true/*suppress logging because logging itself uses this*/);
+static VRWMutex gVThreadMapMutex("gVThreadMapMutex"); // enumeration and management only read the map
+
+// Each thread's own VThread, so that finding the current thread (which every log statement
+// does to show the thread name) needs neither the map nor its mutex. It is set and cleared
+// by _vthreadStarting() and _vthreadEnded(), which are always called on the thread itself.
+static V_THREAD_LOCAL VThread* gCurrentVThread = NULL;
 
 static void _vthreadStarting(VThread* thread) {
-    VMutexLocker locker(&gVThreadMapMutex, "_vthreadStarting");
+    gCurrentVThread = thread;
+
+    VWriteLocker locker(&gVThreadMapMutex, "_vthreadStarting");
     gVThreadIDToVThreadMap[thread->threadID()] = thread;
 }
 
 static void _vthreadEnded(VThread* thread) {
-    VMutexLocker locker(&gVThreadMapMutex, "_vthreadEnded");
+    if (gCurrentVThread == thread) {
+        gCurrentVThread = NULL;
+    }
+
+    VWriteLocker locker(&gVThreadMapMutex, "_vthreadEnded");
     VThreadIDToVThreadMap::iterator position = gVThreadIDToVThreadMap.find(thread->threadID());
     if (position != gVThreadIDToVThreadMap.end())
         gVThreadIDToVThreadMap.erase(position);
 }
 
+// VThreadOptions -------------------------------------------------------------
+
+VThreadOptions::VThreadOptions()
+    : mStackSize(0)
+    , mCPUAffinityMask(0)
+    , mSchedulingPolicy(kDefaultPolicy)
+    , mSchedulingPriority(0)
+    {
+}
+
+VThreadOptions::VThreadOptions(const VSettingsNode& settings)
+    : mStackSize(0)
+    , mCPUAffinityMask(0)
+    , mSchedulingPolicy(kDefaultPolicy)
+    , mSchedulingPriority(0)
+    {
+    mStackSize = static_cast<size_t>(V_MAX(CONST_S64(0), settings.getS64("stack-size", 0)));
+    mCPUAffinityMask = static_cast<Vu64>(settings.getS64("cpu-affinity-mask", 0));
+    mSchedulingPriority = settings.getInt("scheduling-priority", mSchedulingPriority);
+
+    VString policyName = settings.getString("scheduling-policy", "default");
+    if (policyName == "default") {
+        mSchedulingPolicy = kDefaultPolicy;
+    } else if (policyName == "time-sharing") {
+        mSchedulingPolicy = kTimeSharingPolicy;
+    } else if (policyName == "fifo") {
+        mSchedulingPolicy = kFIFOPolicy;
+    } else if (policyName == "round-robin") {
+        mSchedulingPolicy = kRoundRobinPolicy;
+    } else {
+        throw VRangeException(VSTRING_FORMAT("VThreadOptions: Unknown scheduling policy '%s'.", policyName.chars()));
+    }
+}
+
+// static
+const VThreadOptions& VThreadOptions::DEFAULT() {
+    static const VThreadOptions kDefault;
+    return kDefault;
+}
+
+// VThread --------------------------------------------------------------------
+
 /**
 VStandinThread is a special VThread object we simply declare as gStandinThread (but never execute) and reference
 if we need to return a reference to the current thread but it's not one of our threads.
@@ -49,15 +105,12 @@ class VStandinThread : public VThread {
 static VStandinThread gStandinThread;
 
 static VThread* _getCurrentVThread() {
-    VThreadID_Type currentThreadID = VThread::threadSelf();
-    VMutexLocker locker(&gVThreadMapMutex, "_getCurrentVThread");
-    VThreadIDToVThreadMap::const_iterator position = gVThreadIDToVThreadMap.find(currentThreadID);
-    if (position == gVThreadIDToVThreadMap.end())
+    VThread* currentThread = gCurrentVThread;
+    if (currentThread == NULL)
         return &gStandinThread; // If called from main thread, or non-VThread-derived thread, we won't find a VThread. This allows us to return something workable to any caller.
 
-    return (*position).second;
-    // Note: once we return, the thread could stop.
-    // But since this is called from the current thread, it really can't disappear while caller lives.
+    return currentThread;
+    // Note: since this is the current thread's own VThread, it can't disappear while the caller lives.
     // It just can't be passed around to other threads!
 }
 
@@ -69,6 +122,7 @@ VThread::VThread(const VString& name, const VString& loggerName, bool deleteAtEn
     , mCreateDetached(createDetached)
     , mManager(manager)
     , mThreadID((VThreadID_Type) - 1)
+    , mThreadOptions()
     , mIsRunning(false)
     {
 }
@@ -91,7 +145,7 @@ void VThread::start() {
     mIsRunning = true;
 
     try {
-        VThread::threadCreate(&mThreadID, mCreateDetached, VThread::userThreadMain, (void*) this);
+        VThread::threadCreate(&mThreadID, mCreateDetached, VThread::userThreadMain, (void*) this, mThreadOptions);
     } catch (...) {
         mIsRunning = false;
         throw;
@@ -156,11 +210,17 @@ void* VThread::threadMain(void* arg) {
 
         thread->run();
     } catch (const VException& ex) {
-        VLOGGER_NAMED_ERROR(threadLoggerName, VSTRING_FORMAT("Thread '%s' main caught exception #%d '%s'.", threadName.chars(), ex.getError(), ex.what()));
+        VString message(VSTRING_ARGS("Thread '%s' main caught exception #%d '%s'.", threadName.chars(), ex.getError(), ex.what()));
+        VLOGGER_NAMED_ERROR(threadLoggerName, message);
+        VLogFlightRecorder::dumpCurrentThreadOnException(threadLoggerName, message);
     } catch (const std::exception& ex) {
-        VLOGGER_NAMED_ERROR(threadLoggerName, VSTRING_FORMAT("Thread '%s' main caught exception '%s'.", threadName.chars(), ex.what()));
+        VString message(VSTRING_ARGS("Thread '%s' main caught exception '%s'.", threadName.chars(), ex.what()));
+        VLOGGER_NAMED_ERROR(threadLoggerName, message);
+        VLogFlightRecorder::dumpCurrentThreadOnException(threadLoggerName, message);
     } catch (...) {
-        VLOGGER_NAMED_ERROR(threadLoggerName, VSTRING_FORMAT("Thread '%s' main caught unknown exception.", threadName.chars()));
+        VString message(VSTRING_ARGS("Thread '%s' main caught unknown exception.", threadName.chars()));
+        VLOGGER_NAMED_ERROR(threadLoggerName, message);
+        VLogFlightRecorder::dumpCurrentThreadOnException(threadLoggerName, message);
     }
 
     // Let's be bulletproof even on this notification -- use try/catch.
@@ -182,6 +242,9 @@ void* VThread::threadMain(void* arg) {
 
     VLOGGER_NAMED_TRACE(threadLoggerName, VSTRING_FORMAT("VThread::threadMain: completed thread '%s'.", threadName.chars()));
 
+    VLogFlightRecorder::threadEnded();
+    VLogger::threadEnded();
+
     return NULL;
 }
 
@@ -207,7 +270,7 @@ VString VThread::getCurrentThreadName() {
 void VThread::getThreadsInfo(VBentoNode& bento) {
     bento.setName("threads");
 
-    VMutexLocker locker(&gVThreadMapMutex, "VThread::getThreadsInfo");
+    VReadLocker locker(&gVThreadMapMutex, "VThread::getThreadsInfo");
     for (VThreadIDToVThreadMap::const_iterator i = gVThreadIDToVThreadMap.begin(); i != gVThreadIDToVThreadMap.end(); ++i) {
         VThread* thread = (*i).second;
         VBentoNode* child = bento.addNewChildNode("thread");
@@ -223,8 +286,8 @@ void VThread::getThreadsInfo(VBentoNode& bento) {
 
 // static
 VString VThread::getThreadName(VThreadID_Type threadID) {
-    VMutexLocker locker(&gVThreadMapMutex, "VThread::getThreadName");
-    VThreadIDToVThreadMap::iterator position = gVThreadIDToVThreadMap.find(threadID);
+    VReadLocker locker(&gVThreadMapMutex, "VThread::getThreadName");
+    VThreadIDToVThreadMap::const_iterator position = gVThreadIDToVThreadMap.find(threadID);
     if (position == gVThreadIDToVThreadMap.end()) {
         return VString::EMPTY();
     }
@@ -236,7 +299,7 @@ VString VThread::getThreadName(VThreadID_Type threadID) {
 
 // static
 void VThread::stopThread(VThreadID_Type threadID) {
-    VMutexLocker locker(&gVThreadMapMutex, "VThread::stopThread");
+    VReadLocker locker(&gVThreadMapMutex, "VThread::stopThread");
     VThreadIDToVThreadMap::iterator position = gVThreadIDToVThreadMap.find(threadID);
     if (position != gVThreadIDToVThreadMap.end()) {
         VThread* thread = (*position).second;
@@ -19,6 +19,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 class VDuration;
 class VManagementInterface;
 class VBentoNode;
+class VSettingsNode;
 
 /**
 
@@ -89,6 +90,60 @@ class VBentoNode;
     @ingroup vthread
 */
 
+/**
+VThreadOptions holds the OS thread attributes that VThread::start() applies
+when it creates the thread: stack size, CPU affinity, and scheduling policy.
+The default-constructed options leave everything to the OS, which on Linux
+means an 8MB stack reservation per thread; servers that create a thread per
+connection can reduce their address space use considerably by asking for
+less. Options can be read from settings, for example:
+
+    <socket-threads stack-size="262144" cpu-affinity-mask="12" scheduling-policy="round-robin" scheduling-priority="10" />
+
+The stack size is rounded up to the platform minimum. CPU affinity is
+supported on Linux and Windows, and the scheduling policy on Unix only;
+elsewhere they are ignored. Real-time policies usually require privileges;
+if the OS refuses them, the thread is created with the default policy and
+a warning is logged, rather than not created at all.
+*/
+class VThreadOptions {
+    public:
+
+        /**
+        The scheduling policies that may be requested.
+        */
+        enum SchedulingPolicy {
+            kDefaultPolicy,     ///< Inherit the creating thread's policy and priority.
+            kTimeSharingPolicy, ///< SCHED_OTHER: the normal time-sharing policy.
+            kFIFOPolicy,        ///< SCHED_FIFO: real-time, runs until it blocks or yields.
+            kRoundRobinPolicy   ///< SCHED_RR: real-time, time-sliced among equal priorities.
+        };
+
+        /**
+        Constructs options that leave all attributes to the OS.
+        */
+        VThreadOptions();
+        /**
+        Constructs options from settings: the "stack-size", "cpu-affinity-mask",
+        "scheduling-policy" ("default", "time-sharing", "fifo" or "round-robin"),
+        and "scheduling-priority" attributes, each defaulting as for the default
+        constructor. Throws a VRangeException if the policy name is unknown.
+        @param  settings    the settings node to read
+        */
+        explicit VThreadOptions(const VSettingsNode& settings);
+        ~VThreadOptions() {}
+
+        /**
+        Returns the options that leave all attributes to the OS.
+        */
+        static const VThreadOptions& DEFAULT();
+
+        size_t              mStackSize;             ///< The stack size in bytes; 0 leaves the OS default.
+        Vu64                mCPUAffinityMask;       ///< Bit n allows the thread to run on CPU n; 0 allows any CPU.
+        SchedulingPolicy    mSchedulingPolicy;      ///< The scheduling policy.
+        int                 mSchedulingPriority;    ///< The priority within the policy; ignored for kDefaultPolicy.
+};
+
 /**
 VThread is class that provides an easy way to create a thread of execution.
 
@@ -205,6 +260,18 @@ class VThread {
         */
         virtual ~VThread();
 
+        /**
+        Sets the OS thread attributes to apply when the thread is started. Has
+        no effect on a thread that has already been started.
+        @param  options the options
+        */
+        void setThreadOptions(const VThreadOptions& options) { mThreadOptions = options; }
+        /**
+        Returns the OS thread attributes applied when the thread is started.
+        @return the options
+        */
+        const VThreadOptions& getThreadOptions() const { return mThreadOptions; }
+
         /**
         Starts the thread by creating whatever OS-specific resources are
         necessary, and invoking the thread main, resulting in the
@@ -281,7 +348,7 @@ class VThread {
         Returns the thread's logger name (useful for emitting to a named logger).
         @return the thread's logger name
         */
-        const VString& getLoggerName() const { return mLoggerName; }
+        const VString& getLoggerName() const { return mLoggerName.getName(); }
 
         /**
         The main function that invokes the thread's run() and cleans up when
@@ -331,9 +398,10 @@ class VThread {
         @param    createDetached        true to create the thread in detached state; false if not.
         @param    threadMainProcPtr    the thread main function that will be invoked
         @param    threadArgument        the argument to be passed to the thread main
+        @param    options               the stack size, affinity, and scheduling attributes to apply
         @throws VException if the thread cannot be created
         */
-        static void threadCreate(VThreadID_Type* threadID, bool createDetached, threadMainFunction threadMainProcPtr, void* threadArgument);
+        static void threadCreate(VThreadID_Type* threadID, bool createDetached, threadMainFunction threadMainProcPtr, void* threadArgument, const VThreadOptions& options = VThreadOptions::DEFAULT());
 
         /**
         Terminates the current thread. This could be called from anywhere, but
@@ -372,6 +440,7 @@ class VThread {
         Returns the current thread's VThread. If the current thread is main or a thread that
         was not created using VThread, a dummy "stand-in" object is returned, that is not actually
         running or having a valid thread ID. But this means we guarantee to not return NULL.
+        The lookup is a thread-local read; it takes no lock.
         */
         static VThread* getCurrentThread();
 
@@ -391,6 +460,12 @@ class VThread {
         */
         static bool setPriority(int nice);
 
+        /**
+        Returns the number of processors currently online.
+        @return the processor count; at least 1
+        */
+        static int getNumberOfProcessors();
+
         /**
         Blocks the current thread for a specified number of milliseconds.
         The thread will resume execution after approximately that amount
@@ -412,11 +487,12 @@ class VThread {
 
         bool                    mIsDeleted;         ///< For debugging purposes it's useful to detect when an attempt is made to delete a thread twice.
         VString                 mName;              ///< For debugging purposes it's very useful to give each thread a name.
-        VString                 mLoggerName;        ///< The logger name which we will use when emitting log output.
+        VNamedLoggerHandle      mLoggerName;        ///< The logger name which we will use when emitting log output.
         bool                    mDeleteAtEnd;       ///< True if threadMain should delete this obj when it returns from run().
         bool                    mCreateDetached;    ///< True if the thread is created in detached state.
         VManagementInterface*   mManager;           ///< The VManagementInterface that manages us, or NULL.
         VThreadID_Type          mThreadID;          ///< The OS-specific thread ID value.
+        VThreadOptions          mThreadOptions;     ///< The OS thread attributes that start() applies.
         volatile bool           mIsRunning;         ///< The running state of the thread (@see isRunning()).
 
     private:
@@ -460,6 +536,7 @@ VForeignThread is a special case that is intended to be declared on the stack in
 is called by a foreign (non-VThread) source such as the Windows Service Control Manager. It allows you to give a
 name to that thread via the constructor, and it will register the current thread id with that name. This provides
 for getting a useful thread name (useful in VLogger output) from within that thread.
+It must be destroyed on the same thread that constructed it, which declaring it on the stack ensures.
 */
 class VForeignThread : public VThread {
     public:
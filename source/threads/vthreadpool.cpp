@@ -0,0 +1,390 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+/** @file */
+
+#include "vthreadpool.h"
+
+#include "vthread.h"
+#include "vmutexlocker.h"
+#include "vexception.h"
+#include "vlogger.h"
+
+// VThreadPoolWorker ----------------------------------------------------------
+
+/**
+One of a VThreadPool's threads: takes tasks from the pool's queue and runs
+them until the pool tells it to end.
+*/
+class VThreadPoolWorker : public VThread {
+    public:
+
+        VThreadPoolWorker(VThreadPool& pool, int index, VManagementInterface* manager)
+            : VThread(VSTRING_FORMAT("%s.%d", pool.getName().chars(), index), pool.mLoggerName.getName(), kDontDeleteSelfAtEnd, kCreateThreadJoinable, manager)
+            , mPool(pool)
+            {}
+        virtual ~VThreadPoolWorker() {}
+
+        virtual void run() {
+            VThreadPoolTaskPtr task = mPool._takeNextTask();
+            while (task != nullptr) {
+                bool didRun = task->_execute();
+                mPool._taskFinished(task, didRun);
+                task = mPool._takeNextTask();
+            }
+        }
+
+    private:
+
+        VThreadPoolWorker(const VThreadPoolWorker&); // not copyable
+        VThreadPoolWorker& operator=(const VThreadPoolWorker&); // not assignable
+
+        VThreadPool& mPool;
+};
+
+// VThreadPoolTask ------------------------------------------------------------
+
+VThreadPoolTask::VThreadPoolTask(const VString& name)
+    : mName(name)
+    , mMutex(VSTRING_FORMAT("VThreadPoolTask(%s)", name.chars()))
+    , mDoneSemaphore()
+    , mState(kPending)
+    , mCancelRequested(false)
+    , mErrorMessage()
+    , mSubmitMicroseconds(0)
+    , mStartMicroseconds(0)
+    , mEndMicroseconds(0)
+    {
+}
+
+VThreadPoolTask::~VThreadPoolTask() {
+}
+
+VThreadPoolTask::State VThreadPoolTask::getState() const {
+    VMutexLocker locker(&mMutex, "VThreadPoolTask::getState");
+    return mState;
+}
+
+bool VThreadPoolTask::isDone() const {
+    VMutexLocker locker(&mMutex, "VThreadPoolTask::isDone");
+    return (mState != kPending) && (mState != kRunning);
+}
+
+bool VThreadPoolTask::wait(const VDuration& timeout) {
+    VMutexLocker locker(&mMutex, "VThreadPoolTask::wait");
+    VDeadline deadline(timeout);
+    while ((mState == kPending || mState == kRunning) && ! deadline.hasExpired()) {
+        mDoneSemaphore.wait(&mMutex, deadline);
+    }
+
+    bool done = (mState != kPending) && (mState != kRunning);
+    if (done) {
+        // A signal wakes only one waiter, so pass it on in case others are waiting too.
+        mDoneSemaphore.signal();
+    }
+
+    return done;
+}
+
+bool VThreadPoolTask::cancel() {
+    VMutexLocker locker(&mMutex, "VThreadPoolTask::cancel");
+    mCancelRequested = true;
+    if (mState != kPending) {
+        return false;
+    }
+
+    this->_lockedFinish(kCancelled);
+    return true;
+}
+
+VString VThreadPoolTask::getErrorMessage() const {
+    VMutexLocker locker(&mMutex, "VThreadPoolTask::getErrorMessage");
+    return mErrorMessage;
+}
+
+Vs64 VThreadPoolTask::getQueueMicroseconds() const {
+    VMutexLocker locker(&mMutex, "VThreadPoolTask::getQueueMicroseconds");
+    return (mStartMicroseconds == 0) ? 0 : mStartMicroseconds - mSubmitMicroseconds;
+}
+
+Vs64 VThreadPoolTask::getRunMicroseconds() const {
+    VMutexLocker locker(&mMutex, "VThreadPoolTask::getRunMicroseconds");
+    return (mEndMicroseconds == 0) ? 0 : mEndMicroseconds - mStartMicroseconds;
+}
+
+void VThreadPoolTask::_submitted() {
+    VMutexLocker locker(&mMutex, "VThreadPoolTask::_submitted");
+    mSubmitMicroseconds = VDeadline::monotonicMicroseconds();
+}
+
+bool VThreadPoolTask::_execute() {
+    /* locker scope */ {
+        VMutexLocker locker(&mMutex, "VThreadPoolTask::_execute");
+        if (mState != kPending) {
+            return false; // cancelled while queued
+        }
+
+        mState = kRunning;
+        mStartMicroseconds = VDeadline::monotonicMicroseconds();
+    }
+
+    State finalState = kCompleted;
+    VString errorMessage;
+    try {
+        this->run();
+    } catch (const VException& ex) {
+        finalState = kFailed;
+        errorMessage.format("Error %d: %s", ex.getError(), ex.what());
+    } catch (const std::exception& ex) {
+        finalState = kFailed;
+        errorMessage = ex.what();
+    } catch (...) {
+        finalState = kFailed;
+        errorMessage = "Unknown exception.";
+    }
+
+    VMutexLocker locker(&mMutex, "VThreadPoolTask::_execute");
+    mEndMicroseconds = VDeadline::monotonicMicroseconds();
+    mErrorMessage = errorMessage;
+    this->_lockedFinish(finalState);
+    return true;
+}
+
+void VThreadPoolTask::_lockedFinish(State state) {
+    mState = state;
+    mDoneSemaphore.signal();
+}
+
+// VThreadPoolStats -----------------------------------------------------------
+
+VThreadPoolStats::VThreadPoolStats()
+    : mNumThreads(0)
+    , mNumBusyThreads(0)
+    , mQueueDepth(0)
+    , mMaxQueueDepthSeen(0)
+    , mNumTasksSubmitted(0)
+    , mNumTasksRejected(0)
+    , mNumTasksCompleted(0)
+    , mNumTasksFailed(0)
+    , mNumTasksCancelled(0)
+    , mTotalQueueMicroseconds(0)
+    , mTotalRunMicroseconds(0)
+    , mUtilization(0.0)
+    {
+}
+
+Vs64 VThreadPoolStats::getAverageQueueMicroseconds() const {
+    Vs64 numStarted = mNumTasksCompleted + mNumTasksFailed;
+    return (numStarted == 0) ? 0 : mTotalQueueMicroseconds / numStarted;
+}
+
+Vs64 VThreadPoolStats::getAverageRunMicroseconds() const {
+    Vs64 numStarted = mNumTasksCompleted + mNumTasksFailed;
+    return (numStarted == 0) ? 0 : mTotalRunMicroseconds / numStarted;
+}
+
+// VThreadPool ----------------------------------------------------------------
+
+const int VThreadPool::kUnboundedQueue; // V_MAX takes it by reference, so it needs a definition
+
+VThreadPool::VThreadPool(const VString& name, int numThreads, int maxQueueDepth, VManagementInterface* manager)
+    : mName(name)
+    , mLoggerName(VSTRING_FORMAT("vault.threads.VThreadPool.%s", name.chars()))
+    , mNumThreads(V_MAX(1, numThreads))
+    , mMaxQueueDepth(V_MAX(kUnboundedQueue, maxQueueDepth))
+    , mManager(manager)
+    , mMutex(VSTRING_FORMAT("VThreadPool(%s)", name.chars()))
+    , mWorkAvailable()
+    , mSpaceAvailable()
+    , mQueue()
+    , mRunningTasks()
+    , mWorkers()
+    , mShuttingDown(false)
+    , mStartMicroseconds(0)
+    , mStats()
+    {
+}
+
+VThreadPool::~VThreadPool() {
+    try {
+        this->shutdown(true);
+    } catch (...) {} // prevent exception from propagating
+}
+
+void VThreadPool::start() {
+    VMutexLocker locker(&mMutex, "VThreadPool::start");
+
+    if (mShuttingDown) {
+        throw VStackTraceException(VSTRING_FORMAT("VThreadPool::start: Pool '%s' has been shut down.", mName.chars()));
+    }
+
+    if (! mWorkers.empty()) {
+        return;
+    }
+
+    mStartMicroseconds = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < mNumThreads; ++i) {
+        VThreadPoolWorker* worker = new VThreadPoolWorker(*this, i, mManager);
+        mWorkers.push_back(worker);
+        worker->start();
+    }
+}
+
+bool VThreadPool::submit(VThreadPoolTaskPtr task, const VDuration& timeout) {
+    VMutexLocker locker(&mMutex, "VThreadPool::submit");
+
+    VDeadline deadline(timeout);
+    while ((! mShuttingDown) && (mMaxQueueDepth != kUnboundedQueue) && ((int) mQueue.size() >= mMaxQueueDepth) && ! deadline.hasExpired()) {
+        mSpaceAvailable.wait(&mMutex, deadline);
+    }
+
+    if (mShuttingDown || ((mMaxQueueDepth != kUnboundedQueue) && ((int) mQueue.size() >= mMaxQueueDepth))) {
+        ++mStats.mNumTasksRejected;
+        if (mShuttingDown) {
+            mSpaceAvailable.signal(); // pass the shutdown wake-up on to any other blocked submitter
+        }
+
+        locker.unlock();
+
+        (void) task->cancel();
+        return false;
+    }
+
+    task->_submitted();
+    mQueue.push_back(task);
+    ++mStats.mNumTasksSubmitted;
+    mStats.mMaxQueueDepthSeen = V_MAX(mStats.mMaxQueueDepthSeen, (int) mQueue.size());
+    mWorkAvailable.signal();
+
+    // A signal wakes at most one waiter; if there is still room, let the next blocked submitter in too.
+    if ((mMaxQueueDepth != kUnboundedQueue) && ((int) mQueue.size() < mMaxQueueDepth)) {
+        mSpaceAvailable.signal();
+    }
+
+    return true;
+}
+
+void VThreadPool::shutdown(bool cancelQueuedTasks) {
+    WorkerList workers;
+    TaskQueue cancelledTasks;
+    TaskQueue runningTasks;
+
+    /* locker scope */ {
+        VMutexLocker locker(&mMutex, "VThreadPool::shutdown");
+        mShuttingDown = true;
+
+        // Without threads nobody would ever drain the queue, so its tasks must be cancelled regardless.
+        if (cancelQueuedTasks || mWorkers.empty()) {
+            cancelledTasks.swap(mQueue);
+        }
+
+        if (cancelQueuedTasks) {
+            runningTasks = mRunningTasks;
+        }
+
+        workers.swap(mWorkers);
+        mWorkAvailable.signal();
+        mSpaceAvailable.signal();
+    }
+
+    // Cancel outside our lock, since it takes each task's lock.
+    int numCancelled = 0;
+    for (TaskQueue::const_iterator i = cancelledTasks.begin(); i != cancelledTasks.end(); ++i) {
+        (void) (*i)->cancel();
+        if ((*i)->getState() == VThreadPoolTask::kCancelled) {
+            ++numCancelled;
+        }
+    }
+
+    for (TaskQueue::const_iterator i = runningTasks.begin(); i != runningTasks.end(); ++i) {
+        (void) (*i)->cancel(); // already running, so this just asks it to stop
+    }
+
+    if (numCancelled != 0) {
+        VMutexLocker locker(&mMutex, "VThreadPool::shutdown");
+        mStats.mNumTasksCancelled += numCancelled;
+    }
+
+    for (WorkerList::const_iterator i = workers.begin(); i != workers.end(); ++i) {
+        VThread::threadJoin((*i)->threadID(), NULL);
+        delete (*i);
+    }
+}
+
+VThreadPoolStats VThreadPool::getStats() const {
+    VMutexLocker locker(&mMutex, "VThreadPool::getStats");
+
+    VThreadPoolStats stats(mStats);
+    stats.mNumThreads = (int) mWorkers.size();
+    stats.mQueueDepth = (int) mQueue.size();
+
+    Vs64 elapsedMicroseconds = (mStartMicroseconds == 0) ? 0 : VDeadline::monotonicMicroseconds() - mStartMicroseconds;
+    if ((elapsedMicroseconds > 0) && (stats.mNumThreads > 0)) {
+        stats.mUtilization = V_MIN(1.0, ((double) stats.mTotalRunMicroseconds) / ((double) elapsedMicroseconds * (double) stats.mNumThreads));
+    }
+
+    return stats;
+}
+
+VThreadPoolTaskPtr VThreadPool::_takeNextTask() {
+    VMutexLocker locker(&mMutex, "VThreadPool::_takeNextTask");
+
+    while (mQueue.empty() && ! mShuttingDown) {
+        mWorkAvailable.wait(&mMutex, VDuration::POSITIVE_INFINITY());
+    }
+
+    if (mQueue.empty()) {
+        // Shutting down and nothing left to do. Pass the wake-up on to the next thread.
+        mWorkAvailable.signal();
+        return VThreadPoolTaskPtr();
+    }
+
+    VThreadPoolTaskPtr task = mQueue.front();
+    mQueue.pop_front();
+    mRunningTasks.push_back(task);
+    ++mStats.mNumBusyThreads;
+    mSpaceAvailable.signal();
+
+    // A signal wakes at most one waiter; if there is more work, wake another thread for it.
+    if (! mQueue.empty()) {
+        mWorkAvailable.signal();
+    }
+
+    return task;
+}
+
+void VThreadPool::_taskFinished(const VThreadPoolTaskPtr& task, bool didRun) {
+    VThreadPoolTask::State state = task->getState();
+    Vs64 queueMicroseconds = task->getQueueMicroseconds();
+    Vs64 runMicroseconds = task->getRunMicroseconds();
+
+    if (state == VThreadPoolTask::kFailed) {
+        VLOGGER_NAMED_DEBUG(mLoggerName, VSTRING_FORMAT("VThreadPool '%s' task '%s' failed: %s", mName.chars(), task->getName().chars(), task->getErrorMessage().chars()));
+    }
+
+    VMutexLocker locker(&mMutex, "VThreadPool::_taskFinished");
+    TaskQueue::iterator position = std::find(mRunningTasks.begin(), mRunningTasks.end(), task);
+    if (position != mRunningTasks.end()) {
+        mRunningTasks.erase(position);
+    }
+
+    --mStats.mNumBusyThreads;
+
+    if (! didRun) {
+        ++mStats.mNumTasksCancelled;
+        return;
+    }
+
+    if (state == VThreadPoolTask::kFailed) {
+        ++mStats.mNumTasksFailed;
+    } else {
+        ++mStats.mNumTasksCompleted;
+    }
+
+    mStats.mTotalQueueMicroseconds += queueMicroseconds;
+    mStats.mTotalRunMicroseconds += runMicroseconds;
+}
@@ -0,0 +1,320 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+#ifndef vthreadpool_h
+#define vthreadpool_h
+
+/** @file */
+
+#include "vtypes.h"
+
+#include "vstring.h"
+#include "vmutex.h"
+#include "vsemaphore.h"
+#include "vinstant.h"
+#include "vlogger.h"
+
+class VManagementInterface;
+class VThreadPool;
+class VThreadPoolWorker;
+
+/**
+    @ingroup vthread
+*/
+
+// VThreadPoolTask -------------------------------------------------------------
+
+/**
+VThreadPoolTask is a unit of work to be run by a VThreadPool. Subclass it,
+implement run(), and hand an instance to VThreadPool::submit(). The task
+object is also its own "future": the submitter can keep its reference to
+wait() for the task to finish, examine its state, retrieve any results the
+subclass stores in its own members, or cancel() it.
+
+Tasks are shared (VThreadPoolTaskPtr) between the submitter and the pool, so
+a task stays alive until both are done with it.
+
+A task that throws an exception from run() ends in the kFailed state, with
+the exception's message available from getErrorMessage(). Cancellation is
+cooperative: a task that has not started yet will never start, while a task
+that is already running is only asked to stop, and must check
+isCancelRequested() if it wants to honor that.
+*/
+class VThreadPoolTask {
+    public:
+
+        /**
+        The states a task goes through. A task starts out kPending, becomes
+        kRunning when a pool thread picks it up, and finishes in one of the
+        other states.
+        */
+        enum State {
+            kPending,   ///< Queued, or not yet submitted.
+            kRunning,   ///< A pool thread is executing run().
+            kCompleted, ///< run() returned normally.
+            kFailed,    ///< run() threw an exception.
+            kCancelled  ///< Cancelled or rejected before it started; run() was never called.
+        };
+
+        /**
+        Constructs the task.
+        @param  name    a name for the task, for diagnostic purposes
+        */
+        VThreadPoolTask(const VString& name);
+        /**
+        Destructor.
+        */
+        virtual ~VThreadPoolTask();
+
+        /**
+        Performs the task's work on a pool thread. Throw an exception to
+        indicate failure.
+        */
+        virtual void run() = 0;
+
+        /**
+        Returns the task's name.
+        @return the name
+        */
+        const VString& getName() const { return mName; }
+        /**
+        Returns the task's current state.
+        @return the state
+        */
+        State getState() const;
+        /**
+        Returns true if the task has finished, in any fashion.
+        @return true if the state is kCompleted, kFailed, or kCancelled
+        */
+        bool isDone() const;
+        /**
+        Waits for the task to finish.
+        @param  timeout the maximum time to wait; POSITIVE_INFINITY to wait as long as it takes
+        @return true if the task has finished; false if the timeout elapsed first
+        */
+        bool wait(const VDuration& timeout = VDuration::POSITIVE_INFINITY());
+        /**
+        Cancels the task. If it has not started, it is marked kCancelled and
+        will not run. If it is running, it is asked to stop; @see isCancelRequested().
+        @return true if the task was prevented from running; false if it had
+                    already started or finished
+        */
+        bool cancel();
+        /**
+        Returns true if cancel() has been called, so that a long-running
+        run() can stop early.
+        @return obvious
+        */
+        bool isCancelRequested() const { return mCancelRequested; }
+        /**
+        Returns the message of the exception that run() threw, if the task failed.
+        @return the error message, or empty
+        */
+        VString getErrorMessage() const;
+        /**
+        Returns how long the task waited in the queue before a thread started it.
+        @return the queue delay in microseconds, or 0 if it has not started
+        */
+        Vs64 getQueueMicroseconds() const;
+        /**
+        Returns how long run() took.
+        @return the run time in microseconds, or 0 if it has not finished running
+        */
+        Vs64 getRunMicroseconds() const;
+
+    private:
+
+        VThreadPoolTask(const VThreadPoolTask&); // not copyable
+        VThreadPoolTask& operator=(const VThreadPoolTask&); // not assignable
+
+        friend class VThreadPool;
+        friend class VThreadPoolWorker;
+
+        /**
+        Records that the task has been queued.
+        */
+        void _submitted();
+        /**
+        Called by a pool thread: runs the task unless it was cancelled.
+        @return true if run() was called; false if the task had been cancelled
+        */
+        bool _execute();
+        /**
+        Moves the task to a finished state, and wakes any waiters. Assumes mMutex is held.
+        @param  state   the finished state
+        */
+        void _lockedFinish(State state);
+
+        VString         mName;                  ///< The task name, for diagnostics.
+        mutable VMutex  mMutex;                 ///< Protects the state and timing values.
+        VSemaphore      mDoneSemaphore;         ///< Signaled when the task finishes.
+        State           mState;                 ///< The current state.
+        volatile bool   mCancelRequested;       ///< True once cancel() has been called.
+        VString         mErrorMessage;          ///< The exception message if run() failed.
+        Vs64            mSubmitMicroseconds;    ///< VDeadline::monotonicMicroseconds() when queued.
+        Vs64            mStartMicroseconds;     ///< VDeadline::monotonicMicroseconds() when run() began.
+        Vs64            mEndMicroseconds;       ///< VDeadline::monotonicMicroseconds() when run() ended.
+};
+
+/**
+VThreadPoolTaskPtr is how tasks are shared between submitters and the pool.
+*/
+typedef VSharedPtr<VThreadPoolTask> VThreadPoolTaskPtr;
+
+// VThreadPoolStats ------------------------------------------------------------
+
+/**
+VThreadPoolStats is a snapshot of a VThreadPool's activity, returned by
+VThreadPool::getStats(). Counts are since the pool was constructed.
+*/
+class VThreadPoolStats {
+    public:
+
+        VThreadPoolStats();
+        ~VThreadPoolStats() {}
+
+        /**
+        Returns the average time tasks waited in the queue before starting.
+        @return microseconds
+        */
+        Vs64 getAverageQueueMicroseconds() const;
+        /**
+        Returns the average time tasks took to run.
+        @return microseconds
+        */
+        Vs64 getAverageRunMicroseconds() const;
+
+        int     mNumThreads;                ///< The number of pool threads.
+        int     mNumBusyThreads;            ///< The number of pool threads currently running a task.
+        int     mQueueDepth;                ///< The number of tasks currently queued (including cancelled ones not yet discarded).
+        int     mMaxQueueDepthSeen;         ///< The largest queue depth seen.
+        Vs64    mNumTasksSubmitted;         ///< Tasks accepted into the queue.
+        Vs64    mNumTasksRejected;          ///< Tasks not accepted because the queue was full or the pool was shut down.
+        Vs64    mNumTasksCompleted;         ///< Tasks whose run() returned normally.
+        Vs64    mNumTasksFailed;            ///< Tasks whose run() threw.
+        Vs64    mNumTasksCancelled;         ///< Tasks discarded because they were cancelled before starting.
+        Vs64    mTotalQueueMicroseconds;    ///< Sum of the queue delays of all started tasks.
+        Vs64    mTotalRunMicroseconds;      ///< Sum of the run times of all finished tasks.
+        double  mUtilization;               ///< Fraction (0 to 1) of the threads' time since start() spent running tasks.
+};
+
+// VThreadPool -----------------------------------------------------------------
+
+/**
+VThreadPool runs VThreadPoolTask objects on a fixed set of threads, so that
+short-lived concurrent work does not have to create a VThread each time.
+
+Construct the pool, call start() to create its threads, and submit() tasks.
+Tasks are run in the order submitted. The queue can be bounded, in which case
+submit() waits for space (up to a timeout) when it is full, rather than letting
+a burst of work grow the queue without limit.
+
+The pool's threads are VThreads, so if you supply a VManagementInterface it
+receives the usual threadStarting() and threadEnded() notifications for them.
+
+Call shutdown() (or just destruct the pool) to stop it; shutdown waits for
+running tasks to finish, and either runs or cancels the tasks still queued.
+A task must not call shutdown() on its own pool.
+*/
+class VThreadPool {
+    public:
+
+        /**
+        Constructs the pool. The threads are not created until start().
+        @param  name            a name for the pool, used for its threads' names and logger
+        @param  numThreads      the number of threads to run tasks on; at least 1
+        @param  maxQueueDepth   the most tasks that may be queued awaiting a thread;
+                                    kUnboundedQueue for no limit
+        @param  manager         the object that receives notifications for the pool's threads, or NULL
+        */
+        VThreadPool(const VString& name, int numThreads, int maxQueueDepth = kUnboundedQueue, VManagementInterface* manager = NULL);
+        /**
+        Destructor. Shuts the pool down if necessary, cancelling queued tasks.
+        */
+        ~VThreadPool();
+
+        /**
+        Creates the pool's threads. Tasks submitted earlier start running now.
+        */
+        void start();
+        /**
+        Queues a task to be run. If the queue is full, waits for space.
+        @param  task    the task to run
+        @param  timeout how long to wait for space in a full queue; ZERO to not wait
+        @return true if the task was queued; false if it was rejected because the
+                    queue stayed full or the pool has been shut down, in which case
+                    the task is marked kCancelled
+        */
+        bool submit(VThreadPoolTaskPtr task, const VDuration& timeout = VDuration::POSITIVE_INFINITY());
+        /**
+        Stops accepting tasks, waits for the threads to finish, and ends them.
+        Calling it again has no effect.
+        @param  cancelQueuedTasks   if true, tasks still in the queue are cancelled and
+                                    running tasks are asked to stop; if false, the queue
+                                    is drained first
+        */
+        void shutdown(bool cancelQueuedTasks = false);
+
+        /**
+        Returns the pool's name.
+        @return the name
+        */
+        const VString& getName() const { return mName; }
+        /**
+        Returns the number of threads the pool runs tasks on.
+        @return the thread count
+        */
+        int getNumThreads() const { return mNumThreads; }
+        /**
+        Returns a snapshot of the pool's statistics. A finished task is counted
+        just after its waiters are woken, so a wait() may return slightly before
+        the counts reflect that task.
+        @return the statistics
+        */
+        VThreadPoolStats getStats() const;
+
+        static const int kUnboundedQueue = 0; ///< maxQueueDepth value for an unbounded queue.
+
+    private:
+
+        VThreadPool(const VThreadPool&); // not copyable
+        VThreadPool& operator=(const VThreadPool&); // not assignable
+
+        friend class VThreadPoolWorker;
+
+        /**
+        Called by a pool thread to get its next task. Blocks until there is one.
+        @return the task, or null if the thread should end
+        */
+        VThreadPoolTaskPtr _takeNextTask();
+        /**
+        Called by a pool thread after it has finished with a task.
+        @param  task    the task
+        @param  didRun  true if the task ran; false if it was skipped because it was cancelled
+        */
+        void _taskFinished(const VThreadPoolTaskPtr& task, bool didRun);
+
+        typedef std::deque<VThreadPoolTaskPtr> TaskQueue;
+        typedef std::vector<VThreadPoolWorker*> WorkerList;
+
+        VString                 mName;                  ///< The pool name.
+        VNamedLoggerHandle      mLoggerName;            ///< The logger for this pool's diagnostics: "vault.threads.VThreadPool.<name>".
+        int                     mNumThreads;            ///< The number of threads to create.
+        int                     mMaxQueueDepth;         ///< The queue limit, or kUnboundedQueue.
+        VManagementInterface*   mManager;               ///< Notified of the threads' lifecycle, or NULL.
+        mutable VMutex          mMutex;                 ///< Protects everything below.
+        VSemaphore              mWorkAvailable;         ///< Signaled when a task is queued or the pool is shutting down.
+        VSemaphore              mSpaceAvailable;        ///< Signaled when a bounded queue has room or the pool is shutting down.
+        TaskQueue               mQueue;                 ///< Tasks awaiting a thread.
+        TaskQueue               mRunningTasks;          ///< Tasks the threads are running, so shutdown() can ask them to stop.
+        WorkerList              mWorkers;               ///< The pool threads.
+        bool                    mShuttingDown;          ///< True once shutdown() has begun; no more tasks are accepted.
+        Vs64                    mStartMicroseconds;     ///< When start() was called, for utilization.
+        VThreadPoolStats        mStats;                 ///< Counters; the snapshot fields are filled in by getStats().
+};
+
+#endif /* vthreadpool_h */
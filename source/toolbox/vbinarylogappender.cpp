@@ -0,0 +1,525 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+/** @file */
+
+#include "vbinarylogappender.h"
+
+#include "vthread.h"
+#include "vmutexlocker.h"
+#include "vbento.h"
+#include "vexception.h"
+#include "vbufferedfilestream.h"
+#include "vsettings.h"
+
+#include <atomic> // for the signal fence that orders a record's type byte after its contents
+
+/*
+A segment starts with an 8-byte header, BINARY_LOG_MAGIC followed by the format version.
+After that come the records, each starting with a record type byte:
+
+kNameRecord:    table (U8), ID (U32), text (String)
+kMessageRecord: time (S64, VInstant value), level (U8), thread name ID (U32), specified logger
+                name ID (U32), actual logger name ID (U32), file name ID (U32), line (S32),
+                format ID (U32), value count (U8), and for each value its type (U8, a
+                VLogDeferredMessage::ArgumentType) and contents
+kRawLineRecord: text (String)
+
+Multi-byte values are in VBinaryIOStream's network byte order. An ID of 0 means none (an
+empty name, or no file). A zero byte where a record type is expected marks the end of the records;
+that is what the unused, zero-filled part of a segment looks like if the segment was not trimmed.
+*/
+
+static const VString BINARY_LOG_EXTENSION(".vlogbin");
+static const char BINARY_LOG_MAGIC[] = "VLOGBIN";
+static const Vu8 BINARY_LOG_VERSION = 1;
+static const int BINARY_LOG_HEADER_LENGTH = 8;
+static const char PLAIN_MESSAGE_FORMAT[] = "{}";
+
+enum {
+    kEndOfRecords = 0,
+    kNameRecord = 1,
+    kMessageRecord = 2,
+    kRawLineRecord = 3
+};
+
+enum {
+    kLoggerNameTable = 1,
+    kThreadNameTable = 2,
+    kFileNameTable = 3,
+    kFormatTable = 4
+};
+
+static VString _getCurrentThreadName() {
+    try {
+        return VThread::getCurrentThreadName();
+    } catch (...) {
+        return VString::EMPTY();
+    }
+}
+
+static void _encodeArgument(VBinaryIOStream& stream, const VLogDeferredMessage::Argument& argument) {
+    switch (argument.mType) {
+        case VLogDeferredMessage::kSigned:
+            stream.writeU8(VLogDeferredMessage::kSigned);
+            stream.writeS64(argument.mValue.mSigned);
+            break;
+        case VLogDeferredMessage::kUnsigned:
+            stream.writeU8(VLogDeferredMessage::kUnsigned);
+            stream.writeU64(argument.mValue.mUnsigned);
+            break;
+        case VLogDeferredMessage::kDouble:
+            stream.writeU8(VLogDeferredMessage::kDouble);
+            stream.writeDouble(argument.mValue.mDouble);
+            break;
+        case VLogDeferredMessage::kBool:
+            stream.writeU8(VLogDeferredMessage::kBool);
+            stream.writeBool(argument.mValue.mBool);
+            break;
+        case VLogDeferredMessage::kChar:
+            stream.writeU8(VLogDeferredMessage::kChar);
+            stream.writeS8(argument.mValue.mChar);
+            break;
+        case VLogDeferredMessage::kPointer:
+            stream.writeU8(VLogDeferredMessage::kPointer);
+            stream.writeU64(static_cast<Vu64>(reinterpret_cast<size_t>(argument.mValue.mPointer)));
+            break;
+        case VLogDeferredMessage::kCString:
+            // A C string is written as a VString; only NULL is written as a C string, with no contents.
+            if (argument.mValue.mCString == NULL) {
+                stream.writeU8(VLogDeferredMessage::kCString);
+            } else {
+                stream.writeU8(VLogDeferredMessage::kVString);
+                stream.writeString(VString(argument.mValue.mCString));
+            }
+            break;
+        case VLogDeferredMessage::kVString:
+            stream.writeU8(VLogDeferredMessage::kVString);
+            stream.writeString(*(argument.mValue.mVString));
+            break;
+    }
+}
+
+// VBinaryLogAppender ---------------------------------------------------------
+
+VBinaryLogAppender::VBinaryLogAppender(const VString& name, const VString& dirPath, const VString& fileNamePrefix, Vs64 segmentSize, int maxNumSegments)
+    : VLogAppender(name, DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY())
+    , mFileSeries(name, dirPath, fileNamePrefix, BINARY_LOG_EXTENSION)
+    , mSegmentSize(V_MAX(CONST_S64(4096), segmentSize))
+    , mMaxNumSegments(maxNumSegments)
+    , mSegment()
+    , mSegmentOffset(0)
+    , mNextID(1)
+    , mLoggerNameIDs()
+    , mThreadNameIDs()
+    , mFileIDs()
+    , mFormatIDs()
+    , mDefinitionsBuffer()
+    , mDefinitionsStream(mDefinitionsBuffer)
+    , mRecordBuffer()
+    , mRecordStream(mRecordBuffer)
+    {
+    VMutexLocker locker(&mMutex, "VBinaryLogAppender::VBinaryLogAppender");
+    this->_openNewSegment(0);
+}
+
+VBinaryLogAppender::VBinaryLogAppender(const VSettingsNode& settings, const VSettingsNode& defaults)
+    : VLogAppender(settings, defaults)
+    , mFileSeries(settings.getString("name"),
+        VLogAppender::_getStringInitSetting("dir", settings, defaults, VLogger::getBaseLogDirectory().getPath()),
+        VLogAppender::_getStringInitSetting("prefix", settings, defaults, settings.getString("name")),
+        BINARY_LOG_EXTENSION)
+    , mSegmentSize(V_MAX(CONST_S64(4096), VLogAppender::_getS64InitSetting("segment-size", settings, defaults, kDefaultSegmentSize)))
+    , mMaxNumSegments(VLogAppender::_getIntInitSetting("max-segments", settings, defaults, 0))
+    , mSegment()
+    , mSegmentOffset(0)
+    , mNextID(1)
+    , mLoggerNameIDs()
+    , mThreadNameIDs()
+    , mFileIDs()
+    , mFormatIDs()
+    , mDefinitionsBuffer()
+    , mDefinitionsStream(mDefinitionsBuffer)
+    , mRecordBuffer()
+    , mRecordStream(mRecordBuffer)
+    {
+    VMutexLocker locker(&mMutex, "VBinaryLogAppender::VBinaryLogAppender");
+    this->_openNewSegment(0);
+}
+
+VBinaryLogAppender::~VBinaryLogAppender() {
+    try {
+        this->_closeSegment();
+    } catch (...) {} // Prevent all exceptions from escaping destructor.
+}
+
+void VBinaryLogAppender::addInfo(VBentoNode& infoNode) const {
+    VLogAppender::addInfo(infoNode);
+    infoNode.addString("type", "VBinaryLogAppender");
+    infoNode.addString("dir", mFileSeries.getDirectory().getPath());
+    infoNode.addString("prefix", mFileSeries.getFileNamePrefix());
+    infoNode.addS64("segment-size", mSegmentSize);
+    infoNode.addInt("max-segments", mMaxNumSegments);
+    infoNode.addString("file", mSegment.getNode().getPath());
+}
+
+void VBinaryLogAppender::emit(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName, bool emitRawLine, const VString& rawLine) {
+    /* locker scope */ {
+        VMutexLocker locker(&mMutex, "VBinaryLogAppender::emit");
+
+        if (emitMessage) {
+            this->_writeMessage(VInstant(), _getCurrentThreadName(), level, file, line, NULL, &message, specifiedLoggerName, actualLoggerName);
+        }
+
+        if (emitRawLine) {
+            this->_writeRawLine(rawLine);
+        }
+    }
+
+    this->_removeOldSegments();
+}
+
+void VBinaryLogAppender::emitRecord(const VLogRecord& record) {
+    /* locker scope */ {
+        VMutexLocker locker(&mMutex, "VBinaryLogAppender::emitRecord");
+
+        if (record.mEmitMessage) {
+            this->_writeMessage(record.mWhen, record.mThreadName, record.mLevel, record.mFile, record.mLine,
+                record.mMessageIsDeferred ? &record.mDeferredMessage : NULL, record.mMessageIsDeferred ? NULL : &record.mMessage, record.mSpecifiedLoggerName, record.mActualLoggerName);
+        }
+
+        if (record.mEmitRawLine) {
+            this->_writeRawLine(record.mRawLine);
+        }
+    }
+
+    this->_removeOldSegments();
+}
+
+void VBinaryLogAppender::emitDeferred(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName, const VString& actualLoggerName) {
+    /* locker scope */ {
+        VMutexLocker locker(&mMutex, "VBinaryLogAppender::emitDeferred");
+        this->_writeMessage(VInstant(), _getCurrentThreadName(), level, file, line, &message, NULL, specifiedLoggerName, actualLoggerName);
+    }
+
+    this->_removeOldSegments();
+}
+
+void VBinaryLogAppender::roll() {
+    /* locker scope */ {
+        VMutexLocker locker(&mMutex, "VBinaryLogAppender::roll");
+        this->_openNewSegment(0);
+    }
+
+    this->_removeOldSegments();
+}
+
+void VBinaryLogAppender::flush() {
+    VMutexLocker locker(&mMutex, "VBinaryLogAppender::flush");
+    mSegment.flush(true);
+}
+
+VString VBinaryLogAppender::getCurrentFilePath() const {
+    VMutexLocker locker(const_cast<VMutex*>(&mMutex), "VBinaryLogAppender::getCurrentFilePath");
+    return mSegment.getNode().getPath();
+}
+
+void VBinaryLogAppender::_writeMessage(const VInstant& when, const VString& threadName, int level, const char* file, int line, const VLogDeferredMessage* deferredMessage, const VString* message, const VString& specifiedLoggerName, const VString& actualLoggerName) {
+    this->_encodeMessage(when, threadName, level, file, line, deferredMessage, message, specifiedLoggerName, actualLoggerName);
+    while (! this->_commit()) {
+        this->_encodeMessage(when, threadName, level, file, line, deferredMessage, message, specifiedLoggerName, actualLoggerName);
+    }
+}
+
+void VBinaryLogAppender::_writeRawLine(const VString& rawLine) {
+    do {
+        (void) mDefinitionsBuffer.seek0();
+        (void) mRecordBuffer.seek0();
+        mRecordStream.writeU8(kRawLineRecord);
+        mRecordStream.writeString(rawLine);
+    } while (! this->_commit());
+}
+
+void VBinaryLogAppender::_encodeMessage(const VInstant& when, const VString& threadName, int level, const char* file, int line, const VLogDeferredMessage* deferredMessage, const VString* message, const VString& specifiedLoggerName, const VString& actualLoggerName) {
+    (void) mDefinitionsBuffer.seek0();
+    (void) mRecordBuffer.seek0();
+
+    Vu32 threadNameID = this->_internName(kThreadNameTable, mThreadNameIDs, threadName);
+    Vu32 specifiedLoggerNameID = this->_internName(kLoggerNameTable, mLoggerNameIDs, specifiedLoggerName);
+    Vu32 actualLoggerNameID = this->_internName(kLoggerNameTable, mLoggerNameIDs, actualLoggerName);
+    Vu32 fileID = this->_internLiteral(kFileNameTable, mFileIDs, file);
+    Vu32 formatID = this->_internLiteral(kFormatTable, mFormatIDs, (deferredMessage == NULL) ? PLAIN_MESSAGE_FORMAT : deferredMessage->getFormat());
+
+    mRecordStream.writeU8(kMessageRecord);
+    mRecordStream.writeS64(when.getValue());
+    mRecordStream.writeU8(static_cast<Vu8>(V_MAX(0, V_MIN(255, level))));
+    mRecordStream.writeU32(threadNameID);
+    mRecordStream.writeU32(specifiedLoggerNameID);
+    mRecordStream.writeU32(actualLoggerNameID);
+    mRecordStream.writeU32(fileID);
+    mRecordStream.writeS32(line);
+    mRecordStream.writeU32(formatID);
+
+    if (deferredMessage == NULL) {
+        mRecordStream.writeU8(1);
+        mRecordStream.writeU8(VLogDeferredMessage::kVString);
+        mRecordStream.writeString(*message);
+    } else {
+        mRecordStream.writeU8(static_cast<Vu8>(deferredMessage->getNumArguments()));
+        for (int i = 0; i < deferredMessage->getNumArguments(); ++i) {
+            _encodeArgument(mRecordStream, deferredMessage->getArgument(i));
+        }
+    }
+}
+
+Vu32 VBinaryLogAppender::_internName(Vu8 table, NameIDMap& ids, const VString& name) {
+    if (name.isEmpty()) {
+        return 0;
+    }
+
+    NameIDMap::const_iterator position = ids.find(name);
+    if (position != ids.end()) {
+        return position->second;
+    }
+
+    Vu32 id = mNextID++;
+    ids[name] = id;
+
+    mDefinitionsStream.writeU8(kNameRecord);
+    mDefinitionsStream.writeU8(table);
+    mDefinitionsStream.writeU32(id);
+    mDefinitionsStream.writeString(name);
+
+    return id;
+}
+
+Vu32 VBinaryLogAppender::_internLiteral(Vu8 table, LiteralIDMap& ids, const char* text) {
+    if (text == NULL) {
+        return 0;
+    }
+
+    LiteralIDMap::const_iterator position = ids.find(text);
+    if (position != ids.end()) {
+        return position->second;
+    }
+
+    Vu32 id = mNextID++;
+    ids[text] = id;
+
+    mDefinitionsStream.writeU8(kNameRecord);
+    mDefinitionsStream.writeU8(table);
+    mDefinitionsStream.writeU32(id);
+    mDefinitionsStream.writeString(VString(text));
+
+    return id;
+}
+
+bool VBinaryLogAppender::_commit() {
+    Vs64 definitionsLength = mDefinitionsBuffer.getIOOffset();
+    Vs64 recordLength = mRecordBuffer.getIOOffset();
+    Vs64 totalLength = definitionsLength + recordLength;
+
+    if (! mSegment.isOpen()) {
+        this->_openNewSegment(0);
+        return false;
+    }
+
+    if (mSegmentOffset + totalLength > mSegment.getLength()) {
+        if (mSegmentOffset != BINARY_LOG_HEADER_LENGTH) {
+            // Make the next segment big enough for this record, in case a normal one isn't.
+            this->_openNewSegment(BINARY_LOG_HEADER_LENGTH + totalLength);
+            return false;
+        }
+
+        // The segment is empty, so rather than leave an empty file behind, recreate it big enough.
+        // What we encoded is still right for it, since no names have been defined in it.
+        VFSNode segmentNode = mSegment.getNode();
+        mSegment.close();
+        this->_createSegmentFile(segmentNode, BINARY_LOG_HEADER_LENGTH + totalLength);
+    }
+
+    /*
+    Copy everything but the first byte, which is the first record's type, and then the first byte.
+    Until then, a reader sees a zero there, meaning the end of the records, so if we crash part way
+    through copying, the partial records are never decoded.
+    */
+    Vu8* target = mSegment.getBuffer() + mSegmentOffset;
+    const Vu8* definitions = mDefinitionsBuffer.getBuffer();
+    const Vu8* record = mRecordBuffer.getBuffer();
+    Vu8 firstByte;
+    if (definitionsLength > 0) {
+        firstByte = definitions[0];
+        ::memcpy(target + 1, definitions + 1, static_cast<size_t>(definitionsLength - 1));
+        ::memcpy(target + definitionsLength, record, static_cast<size_t>(recordLength));
+    } else {
+        firstByte = record[0];
+        ::memcpy(target + 1, record + 1, static_cast<size_t>(recordLength - 1));
+    }
+
+    std::atomic_signal_fence(std::memory_order_release);
+    target[0] = firstByte;
+
+    mSegmentOffset += totalLength;
+    return true;
+}
+
+void VBinaryLogAppender::_openNewSegment(Vs64 minLength) {
+    this->_closeSegment();
+
+    VFSNode segmentNode = mFileSeries.nextFileNode();
+    this->_createSegmentFile(segmentNode, V_MAX(minLength, mSegmentSize));
+
+    mNextID = 1;
+    mLoggerNameIDs.clear();
+    mThreadNameIDs.clear();
+    mFileIDs.clear();
+    mFormatIDs.clear();
+}
+
+void VBinaryLogAppender::_createSegmentFile(const VFSNode& segmentNode, Vs64 length) {
+    mSegment.openReadWrite(segmentNode, length);
+    ::memcpy(mSegment.getBuffer(), BINARY_LOG_MAGIC, BINARY_LOG_HEADER_LENGTH - 1);
+    mSegment.getBuffer()[BINARY_LOG_HEADER_LENGTH - 1] = BINARY_LOG_VERSION;
+    mSegmentOffset = BINARY_LOG_HEADER_LENGTH;
+}
+
+void VBinaryLogAppender::_closeSegment() {
+    if (mSegment.isOpen()) {
+        mSegment.close(mSegmentOffset);
+    }
+}
+
+void VBinaryLogAppender::_removeOldSegments() {
+    mFileSeries.removeOldFiles(mMaxNumSegments);
+}
+
+// VBinaryLogDecoder ----------------------------------------------------------
+
+VBinaryLogDecoder::VBinaryLogDecoder(VLogAppender& target)
+    : mTarget(target)
+    , mNames()
+    , mStringValues()
+    {
+}
+
+int VBinaryLogDecoder::decodeFile(const VFSNode& file) {
+    VBufferedFileStream fileStream(file);
+    fileStream.openReadOnly();
+    VBinaryIOStream stream(fileStream);
+    return this->decodeStream(stream);
+}
+
+int VBinaryLogDecoder::decodeStream(VBinaryIOStream& stream) {
+    char header[BINARY_LOG_HEADER_LENGTH];
+    stream.readGuaranteed(reinterpret_cast<Vu8*>(header), BINARY_LOG_HEADER_LENGTH);
+    if (::memcmp(header, BINARY_LOG_MAGIC, BINARY_LOG_HEADER_LENGTH - 1) != 0) {
+        throw VException("VBinaryLogDecoder: the data is not a binary log.");
+    }
+
+    if (static_cast<Vu8>(header[BINARY_LOG_HEADER_LENGTH - 1]) != BINARY_LOG_VERSION) {
+        throw VException(VSTRING_FORMAT("VBinaryLogDecoder: unsupported binary log version %d.", (int) static_cast<Vu8>(header[BINARY_LOG_HEADER_LENGTH - 1])));
+    }
+
+    mNames.clear();
+    int numRecords = 0;
+
+    try {
+        for (;;) {
+            Vu8 recordType = stream.readU8();
+            if (recordType == kEndOfRecords) {
+                break;
+            }
+
+            if (recordType == kNameRecord) {
+                (void) stream.readU8(); // the table; IDs are unique across tables, so we don't need it
+                Vu32 id = stream.readU32();
+                stream.readString(mNames[id]);
+            } else if (recordType == kMessageRecord) {
+                this->_decodeMessage(stream);
+                ++numRecords;
+            } else if (recordType == kRawLineRecord) {
+                VLogRecord record;
+                record.mEmitMessage = false;
+                record.mEmitRawLine = true;
+                stream.readString(record.mRawLine);
+                mTarget.emitRecord(record);
+                ++numRecords;
+            } else {
+                throw VException(VSTRING_FORMAT("VBinaryLogDecoder: unknown record type %d after %d records.", (int) recordType, numRecords));
+            }
+        }
+    } catch (const VEOFException& /*ex*/) {
+        // A trimmed segment has no end marker; its records just end at the end of the data.
+    }
+
+    return numRecords;
+}
+
+const VString& VBinaryLogDecoder::_lookUpName(Vu32 id) const {
+    NameMap::const_iterator position = mNames.find(id);
+    return (position == mNames.end()) ? VString::EMPTY() : position->second;
+}
+
+void VBinaryLogDecoder::_decodeMessage(VBinaryIOStream& stream) {
+    VLogRecord record;
+    record.mWhen.setValue(stream.readS64());
+    record.mTrueWhen = record.mWhen;
+    record.mLevel = stream.readU8();
+    record.mThreadName = this->_lookUpName(stream.readU32());
+    record.mSpecifiedLoggerName = this->_lookUpName(stream.readU32());
+    record.mActualLoggerName = this->_lookUpName(stream.readU32());
+    Vu32 fileID = stream.readU32();
+    record.mFile = (fileID == 0) ? NULL : this->_lookUpName(fileID).chars(); // the string stays in mNames while we emit
+    record.mLine = stream.readS32();
+
+    VLogDeferredMessage message(this->_lookUpName(stream.readU32()).chars());
+    mStringValues.clear();
+    int numArguments = stream.readU8();
+    for (int i = 0; i < numArguments; ++i) {
+        VLogDeferredMessage::Argument argument;
+        argument.mType = static_cast<VLogDeferredMessage::ArgumentType>(stream.readU8());
+        switch (argument.mType) {
+            case VLogDeferredMessage::kSigned:
+                argument.mValue.mSigned = stream.readS64();
+                break;
+            case VLogDeferredMessage::kUnsigned:
+                argument.mValue.mUnsigned = stream.readU64();
+                break;
+            case VLogDeferredMessage::kDouble:
+                argument.mValue.mDouble = stream.readDouble();
+                break;
+            case VLogDeferredMessage::kBool:
+                argument.mValue.mBool = stream.readBool();
+                break;
+            case VLogDeferredMessage::kChar:
+                argument.mValue.mChar = stream.readS8();
+                break;
+            case VLogDeferredMessage::kPointer:
+                argument.mValue.mPointer = reinterpret_cast<const void*>(static_cast<size_t>(stream.readU64()));
+                break;
+            case VLogDeferredMessage::kCString:
+                argument.mValue.mCString = NULL;
+                break;
+            case VLogDeferredMessage::kVString:
+                mStringValues.push_back(stream.readString());
+                argument.mValue.mVString = &mStringValues.back();
+                break;
+            default:
+                throw VException(VSTRING_FORMAT("VBinaryLogDecoder: unknown value type %d.", (int) argument.mType));
+        }
+
+        message.addArgument(argument);
+    }
+
+    record.mEmitMessage = true;
+    record.mEmitRawLine = false;
+    record.mDeferredMessage = message;
+    record.mMessageIsDeferred = true;
+
+    mTarget.emitRecord(record);
+}
+
@@ -0,0 +1,178 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+#ifndef vbinarylogappender_h
+#define vbinarylogappender_h
+
+/** @file */
+
+#include "vlogger.h"
+#include "vmemorymappedfile.h"
+#include "vmemorystream.h"
+#include "vbinaryiostream.h"
+
+#include <map>
+#include <deque>
+
+/**
+    @ingroup vlogger
+*/
+
+/**
+VBinaryLogAppender writes log records in a compact binary form rather than as text, so that
+logging a message costs little more than copying its values. Nothing is formatted when a message
+is logged: a record holds the time as a raw Vs64, the level, IDs for the thread name, logger names,
+source file and format string, and the message's values as they were passed to a _FMT macro
+(see VLogDeferredMessage). A plain message is recorded as a "{}" format with the string as its value.
+Each name or format string is written out once per file, the first time it is used, and is referred
+to by its ID after that.
+
+The records are written to a series of segment files in a directory, named with a prefix and a
+UTC time stamp by a VLogFileSeries, like VRollingFileLogAppender's files. Each segment is allocated at its full size
+when it is created, and memory mapped (see VMemoryMappedFile), so writing a record is a memory
+copy with no system call. When a record doesn't fit, the segment is trimmed to the length used
+and the next one is started. Each segment stands alone; it can be decoded without the others.
+
+Use VBinaryLogDecoder, or the vlogdecode tool built on it, to turn the records back into text.
+The decoder emits the records to an ordinary appender, whose format spec determines the output.
+
+Format strings are recognized by their address, since they are normally string literals. A
+format string that is not a literal must not be freed and reused for different text.
+
+In addition to the VLogAppender settings properties (other than the formatting ones, which do
+not apply), this appender defines:
+- "dir" the directory for the segments; default is VLogger::getBaseLogDirectory()
+- "prefix" the start of each segment's name; default is the appender name
+- "segment-size" the size of each segment, in bytes; default is kDefaultSegmentSize
+- "max-segments" how many segments to keep, deleting the oldest; default is 0, to keep all
+*/
+class VBinaryLogAppender : public VLogAppender {
+    public:
+        static const Vs64 kDefaultSegmentSize = CONST_S64(16777216); ///< The default segment size, 16MB.
+
+        /**
+        Constructs the appender and creates its first segment.
+        @param  name            the appender name
+        @param  dirPath         the directory for the segments
+        @param  fileNamePrefix  the start of each segment's name
+        @param  segmentSize     the size of each segment, in bytes
+        @param  maxNumSegments  how many segments to keep; 0 to keep all
+        */
+        VBinaryLogAppender(const VString& name, const VString& dirPath, const VString& fileNamePrefix, Vs64 segmentSize = kDefaultSegmentSize, int maxNumSegments = 0);
+        VBinaryLogAppender(const VSettingsNode& settings, const VSettingsNode& defaults);
+        virtual ~VBinaryLogAppender();
+        virtual void addInfo(VBentoNode& infoNode) const;
+        virtual void emit(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName, bool emitRawLine, const VString& rawLine);
+        virtual void emitRecord(const VLogRecord& record);
+        virtual void emitDeferred(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName, const VString& actualLoggerName);
+
+        /**
+        Closes the current segment and starts a new one.
+        */
+        void roll();
+        /**
+        Waits until the records written so far are on disk. This isn't necessary for them to
+        survive the process exiting or crashing, only the system crashing.
+        */
+        void flush();
+        /**
+        Returns the path of the segment currently being written.
+        @return obvious
+        */
+        VString getCurrentFilePath() const;
+
+    private:
+
+        VBinaryLogAppender(const VBinaryLogAppender&); // not copyable
+        VBinaryLogAppender& operator=(const VBinaryLogAppender&); // not assignable
+
+        typedef std::map<VString, Vu32> NameIDMap;
+        typedef std::map<const char*, Vu32> LiteralIDMap;
+
+        /**
+        Encodes a message record, along with any name definitions it needs, and writes them.
+        Exactly one of deferredMessage and message is not NULL. Assumes mMutex is held.
+        */
+        void _writeMessage(const VInstant& when, const VString& threadName, int level, const char* file, int line, const VLogDeferredMessage* deferredMessage, const VString* message, const VString& specifiedLoggerName, const VString& actualLoggerName);
+        void _writeRawLine(const VString& rawLine); ///< Encodes and writes a raw line record. Assumes mMutex is held.
+        void _encodeMessage(const VInstant& when, const VString& threadName, int level, const char* file, int line, const VLogDeferredMessage* deferredMessage, const VString* message, const VString& specifiedLoggerName, const VString& actualLoggerName);
+        Vu32 _internName(Vu8 table, NameIDMap& ids, const VString& name);    ///< Returns a name's ID, encoding its definition if it is new to this segment.
+        Vu32 _internLiteral(Vu8 table, LiteralIDMap& ids, const char* text); ///< Returns a string literal's ID, encoding its definition if it is new to this segment.
+        /**
+        Copies the encoded definitions and record into the segment, starting a new segment first if
+        they don't fit. Returns false if a new segment was started, in which case the caller must
+        encode again, because the new segment doesn't have the definitions it used.
+        */
+        bool _commit();
+        void _openNewSegment(Vs64 minLength); ///< Closes any current segment and creates one of at least the specified length. Assumes mMutex is held.
+        void _createSegmentFile(const VFSNode& segmentNode, Vs64 length); ///< Creates the segment file, maps it, and writes the header. Assumes mMutex is held.
+        void _closeSegment(); ///< Trims and closes the current segment, if any. Assumes mMutex is held.
+        void _removeOldSegments(); ///< If a new segment has been started since the last call, deletes segments beyond mMaxNumSegments. Must not be called with mMutex held.
+
+        VLogFileSeries      mFileSeries;                ///< Names the segments and deletes old ones.
+        Vs64                mSegmentSize;               ///< The size of each segment.
+        int                 mMaxNumSegments;            ///< How many segments to keep; 0 to keep all.
+        VMemoryMappedFile   mSegment;                   ///< The current segment.
+        Vs64                mSegmentOffset;             ///< How much of the current segment is used.
+        Vu32                mNextID;                    ///< The next name ID to hand out in this segment.
+        NameIDMap           mLoggerNameIDs;             ///< Logger names defined in this segment.
+        NameIDMap           mThreadNameIDs;             ///< Thread names defined in this segment.
+        LiteralIDMap        mFileIDs;                   ///< Source file names defined in this segment, by address.
+        LiteralIDMap        mFormatIDs;                 ///< Format strings defined in this segment, by address.
+        VMemoryStream       mDefinitionsBuffer;         ///< Holds the definitions being encoded for the current record.
+        VBinaryIOStream     mDefinitionsStream;         ///< Encodes into mDefinitionsBuffer.
+        VMemoryStream       mRecordBuffer;              ///< Holds the record being encoded.
+        VBinaryIOStream     mRecordStream;              ///< Encodes into mRecordBuffer.
+};
+
+/**
+VBinaryLogDecoder reads files written by VBinaryLogAppender and emits their records to another
+appender, as if they were being logged for the first time: the output has the original time
+stamps, thread names, levels and logger names, formatted by the target appender's format spec.
+*/
+class VBinaryLogDecoder {
+    public:
+
+        /**
+        Constructs a decoder that emits to the specified appender.
+        @param  target  the appender to emit decoded records to
+        */
+        VBinaryLogDecoder(VLogAppender& target);
+        ~VBinaryLogDecoder() {}
+
+        /**
+        Decodes a segment file, emitting its records to the target appender. Decoding stops at the end
+        of the records, including at a record that was only partly written when a process crashed.
+        Throws a VException if the file can't be read or is not a binary log.
+        @param  file    the segment file
+        @return the number of message and raw line records emitted
+        */
+        int decodeFile(const VFSNode& file);
+        /**
+        Decodes a segment from a stream. See decodeFile().
+        @param  stream  the stream, positioned at the start of a segment
+        @return the number of message and raw line records emitted
+        */
+        int decodeStream(VBinaryIOStream& stream);
+
+    private:
+
+        VBinaryLogDecoder(const VBinaryLogDecoder&); // not copyable
+        VBinaryLogDecoder& operator=(const VBinaryLogDecoder&); // not assignable
+
+        typedef std::map<Vu32, VString> NameMap;
+
+        const VString& _lookUpName(Vu32 id) const; ///< Returns the name defined for an ID, or empty for 0 or an unknown ID.
+        void _decodeMessage(VBinaryIOStream& stream); ///< Decodes a message record and emits it.
+
+        VLogAppender&       mTarget;        ///< Where decoded records are emitted.
+        NameMap             mNames;         ///< The names and format strings defined so far in the current segment.
+        std::deque<VString> mStringValues;  ///< The current record's string values, which its message refers to.
+};
+
+#endif /* vbinarylogappender_h */
+
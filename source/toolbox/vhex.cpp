@@ -13,6 +13,14 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vbinaryiostream.h"
 #include "vchar.h"
 
+// SSE2 is always present on x86-64, and on 32-bit x86 when the compiler is told to use it.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #define VHEX_USE_SSE2
+    #include <emmintrin.h>
+#endif
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
 // static
 void VHex::bufferToHexString(const Vu8* buffer, Vs64 bufferLength, VString& s, bool wantLeading0x) {
     int hexStringLength = (int)(bufferLength * 2);  // note we don't support string lengths > 32 bits
@@ -24,23 +32,43 @@ void VHex::bufferToHexString(const Vu8* buffer, Vs64 bufferLength, VString& s, b
 
     char*   hexStringBuffer = s.buffer();
     int     hexStringIndex = 0;
-    int     bufferIndex = 0;
-    char    highNibbleChar;
-    char    lowNibbleChar;
 
     if (wantLeading0x) {
         hexStringBuffer[hexStringIndex++] = '0';
         hexStringBuffer[hexStringIndex++] = 'x';
     }
 
-    while (bufferIndex < bufferLength) {
-        VHex::byteToHexChars(buffer[bufferIndex++], &highNibbleChar, &lowNibbleChar);
+    VHex::bufferToHexChars(buffer, (int) bufferLength, &hexStringBuffer[hexStringIndex]);
 
-        hexStringBuffer[hexStringIndex++] = highNibbleChar;
-        hexStringBuffer[hexStringIndex++] = lowNibbleChar;
+    s.postflight(hexStringLength);
+}
+
+// static
+void VHex::bufferToHexChars(const Vu8* buffer, int bufferLength, char* hexChars) {
+    int i = 0;
+
+#ifdef VHEX_USE_SSE2
+    // Split 16 bytes into their high and low nibbles, turn each nibble into its digit by adding '0',
+    // plus the gap from '9' to 'A' where it is above 9, and interleave the high and low digits.
+    const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i digitZero = _mm_set1_epi8('0');
+    const __m128i letterGap = _mm_set1_epi8('A' - '9' - 1);
+    for (; i + 16 <= bufferLength; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&buffer[i]));
+        __m128i highNibbles = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibbleMask);
+        __m128i lowNibbles = _mm_and_si128(bytes, nibbleMask);
+        __m128i highDigits = _mm_add_epi8(_mm_add_epi8(highNibbles, digitZero), _mm_and_si128(_mm_cmpgt_epi8(highNibbles, nine), letterGap));
+        __m128i lowDigits = _mm_add_epi8(_mm_add_epi8(lowNibbles, digitZero), _mm_and_si128(_mm_cmpgt_epi8(lowNibbles, nine), letterGap));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&hexChars[2 * i]), _mm_unpacklo_epi8(highDigits, lowDigits));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&hexChars[(2 * i) + 16]), _mm_unpackhi_epi8(highDigits, lowDigits));
     }
+#endif
 
-    s.postflight(hexStringLength);
+    for (; i < bufferLength; ++i) {
+        hexChars[2 * i] = HEX_DIGITS[buffer[i] >> 4];
+        hexChars[(2 * i) + 1] = HEX_DIGITS[buffer[i] & 0x0F];
+    }
 }
 
 // static
@@ -247,54 +275,80 @@ void VHex::flush() {
     this->_printPending();
 }
 
+void VHex::_emitLine(const VString& line) {
+    if (mOutputStream == NULL) {
+        std::cout << line.chars() << std::endl;
+    } else {
+        mOutputStream->writeLine(line);
+    }
+}
+
 void VHex::_printPending() {
     if (mPendingBufferUsed > 0) {
-        char highNibbleChar;
-        char lowNibbleChar;
-
-        mLineBuffer = VString::EMPTY();
-
-        // Add spaces to indent.
-        for (int i = 0; i < mIndentCount; ++i) {
-            mLineBuffer += ' ';
-        }
-
-        // Add the label.
+        // Format the label by hand; this runs for every row of what may be a very large dump.
+        char label[32];
+        int labelLength = 0;
         if (mLabelsInHex) {
-            VString label(VSTRING_ARGS("0x%08X: ", (int) mOffset));
-            mLineBuffer += label;
+            Vu32 labelValue = static_cast<Vu32>(mOffset);
+            label[labelLength++] = '0';
+            label[labelLength++] = 'x';
+            for (int shift = 28; shift >= 0; shift -= 4) {
+                label[labelLength++] = HEX_DIGITS[(labelValue >> shift) & 0x0F];
+            }
         } else {
-            VString label(VSTRING_ARGS("%08lld: ", mOffset));
-            mLineBuffer += label;
+            char digits[24];
+            int numDigits = 0;
+            Vs64 labelValue = V_MAX(CONST_S64(0), mOffset);
+            do {
+                digits[numDigits++] = static_cast<char>('0' + (labelValue % 10));
+                labelValue /= 10;
+            } while (labelValue != 0);
+
+            for (int i = numDigits; i < 8; ++i) {
+                label[labelLength++] = '0';
+            }
+
+            while (numDigits > 0) {
+                label[labelLength++] = digits[--numDigits];
+            }
         }
 
-        // If we're starting mid-row, add spaces to indent.
-        for (int i = 0; i < mStartColumn; ++i) {
-            mLineBuffer += "   ";
+        label[labelLength++] = ':';
+        label[labelLength++] = ' ';
+
+        // The row is the indent, the label, 3 columns for each byte (including any we are starting
+        // the row after), and then if showing ASCII, 3 columns for each byte not on this row, 3 more,
+        // and a column per byte. Anything we don't fill in is a space.
+        const int numTrailingBytes = mShowASCIIValues ? V_MAX(0, mNumBytesPerRow - mStartColumn - mPendingBufferUsed) : 0;
+        int lineLength = mIndentCount + labelLength + (3 * mStartColumn) + (3 * mPendingBufferUsed);
+        if (mShowASCIIValues) {
+            lineLength += (3 * numTrailingBytes) + 3 + mStartColumn + mPendingBufferUsed;
         }
 
-        // Now append our hex data.
-        for (int i = 0; i < mPendingBufferUsed; ++i) {
-            VHex::byteToHexChars(mPendingBuffer[i], &highNibbleChar, &lowNibbleChar);
-            mLineBuffer += highNibbleChar;
-            mLineBuffer += lowNibbleChar;
-            mLineBuffer += ' ';
+        mLineBuffer.preflight(lineLength);
+        char* lineChars = mLineBuffer.buffer();
+        ::memset(lineChars, ' ', static_cast<size_t>(lineLength));
+
+        int column = mIndentCount;
+        ::memcpy(&lineChars[column], label, static_cast<size_t>(labelLength));
+        column += labelLength + (3 * mStartColumn);
+
+        // Now append our hex data, converting up to 16 bytes at a time.
+        char hexChars[32];
+        for (int i = 0; i < mPendingBufferUsed; i += 16) {
+            int numBytes = V_MIN(16, mPendingBufferUsed - i);
+            VHex::bufferToHexChars(&mPendingBuffer[i], numBytes, hexChars);
+            for (int j = 0; j < numBytes; ++j) {
+                lineChars[column] = hexChars[2 * j];
+                lineChars[column + 1] = hexChars[(2 * j) + 1];
+                column += 3;
+            }
         }
 
         // Now do the ASCII stuff if necessary.
         if (mShowASCIIValues) {
-            // If we're starting mid-row, add spaces to indent.
-            for (int i = mPendingBufferUsed; i < mNumBytesPerRow - mStartColumn; ++i) {
-                mLineBuffer += "   ";
-            }
-
-            mLineBuffer += "   ";
-
-            for (int i = 0; i < mStartColumn; ++i) {
-                mLineBuffer += ' ';
-            }
+            column += (3 * numTrailingBytes) + 3 + mStartColumn;
 
-            // Append the ASCII data
             for (int i = 0; i < mPendingBufferUsed; ++i) {
                 char    asciiValue = (char) mPendingBuffer[i];
 
@@ -302,10 +356,12 @@ void VHex::_printPending() {
                     asciiValue = '.';
                 }
 
-                mLineBuffer += asciiValue;
+                lineChars[column++] = asciiValue;
             }
         }
 
+        mLineBuffer.postflight(lineLength);
+
         // Keep track of column in case of split lines
         if (mNumBytesPerRow == 0) {
             mStartColumn = 0;
@@ -317,12 +373,7 @@ void VHex::_printPending() {
         mOffset += mPendingBufferUsed;
         mPendingBufferUsed = 0;
 
-        // Finally, shove the string out to the stream or output pipe.
-        if (mOutputStream == NULL) {
-            std::cout << mLineBuffer.chars() << std::endl;
-        } else {
-            mOutputStream->writeLine(mLineBuffer);
-        }
+        // Finally, shove the string out.
+        this->_emitLine(mLineBuffer);
     }
 }
-
@@ -44,6 +44,14 @@ class VHex {
         */
         static void bufferToHexString(const Vu8* buffer, Vs64 bufferLength, VString& s, bool wantLeading0x = false);
         /**
+        Produces two uppercase hexadecimal characters for each byte of the specified buffer data.
+        Where the processor supports it (SSE2), sixteen bytes are converted at a time.
+        @param    buffer        pointer to the data to convert
+        @param    bufferLength  the number of bytes to convert
+        @param    hexChars      the chars to fill (must have room for 2 * bufferLength; not null terminated)
+        */
+        static void bufferToHexChars(const Vu8* buffer, int bufferLength, char* hexChars);
+        /**
         Produces a buffer of bytes as specified by a supplied hexadecimal string representation.
         @param    hexDigits        the hexadecimal string
         @param    buffer            the buffer to fill (must be big enough!)
@@ -165,13 +173,22 @@ class VHex {
         */
         void flush();
 
+    protected:
+
+        /**
+        Writes one row of the hex dump. By default this writes to the output stream, or stdout
+        if there is none; a subclass can override it to send the rows elsewhere.
+        @param    line    the row of text, without a line ending
+        */
+        virtual void _emitLine(const VString& line);
+
     private:
 
         VHex(const VHex&); // not copyable
         VHex& operator=(const VHex&); // not assignable
 
         /**
-        Prints the pending data to the output stream or stdout.
+        Formats the pending data as a row and emits it.
         */
         void _printPending();
 
@@ -0,0 +1,796 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+/** @file */
+
+#include "vlogflightrecorder.h"
+
+#include "vthread.h"
+#include "vmutexlocker.h"
+#include "vexception.h"
+#include "vtypes_internal.h"
+
+#include <atomic> // for the sequence numbers that let a dump read a ring while its thread writes to it
+#include <signal.h>
+
+/*
+A ring is written only by its own thread, and read by whichever thread dumps it, without a lock.
+Each slot has a sequence number: while record n is being written into it the number is 2n+1, and
+once the record is complete it is 2n+2. A reader that wants record n checks for 2n+2, copies the
+record, and checks again; if the number changed, the writer came around and overwrote the slot
+while it was being copied, so the copy is discarded.
+
+String values of a deferred message are copied into the record's text buffer; their argument then
+holds the offset of the copy in mValue.mSigned, or -1 for a NULL C string.
+
+Rings are never deleted, so that the crash handler can walk them without a lock. They form a list
+that only grows, at its head. When a thread ends, its ring is marked unused, and the next thread
+that needs a ring of the same capacity claims it. A dump skips unused rings.
+*/
+
+static const VString FLIGHT_RECORDER_TIME_FORMAT("yMMddHHmmssSSS");
+static const VString FLIGHT_RECORDER_FORMAT_SPEC("$localtime $level | $thread | $actuallogger | $location$message");
+static const int kMaxThreadNameLength = 63; // the longest thread name a ring holds
+static const int kMaxCrashLineLength = 1023; // the longest line the crash handler writes
+
+struct VLogFlightRecord {
+    Vs64        mWhen;              ///< The VInstant value when the message was logged.
+    Vs64        mTrueWhen;          ///< The true VInstant value, if time was simulated or frozen.
+    int         mLevel;             ///< The message level.
+    const char* mFile;              ///< The __FILE__ value, or NULL.
+    int         mLine;              ///< The __LINE__ value, or 0.
+    const char* mFormat;            ///< A deferred message's format string, or NULL if mText is the message.
+    int         mNumArguments;      ///< How many of mArguments are in use.
+    VLogDeferredMessage::Argument mArguments[VLogDeferredMessage::kMaxArguments]; ///< A deferred message's values.
+    char        mLoggerName[VLogFlightRecorder::kMaxLoggerNameLength + 1];  ///< The logger name, null terminated.
+    char        mText[VLogFlightRecorder::kMaxTextLength + 1];              ///< The message, or a deferred message's string values, null terminated.
+};
+
+struct VLogFlightRecorderSlot {
+    std::atomic<Vu64>   mSequence;  ///< See above; 0 if the slot has never been written.
+    VLogFlightRecord    mRecord;    ///< The record.
+};
+
+class VLogFlightRecorderRing {
+    public:
+
+        VLogFlightRecorderRing(int capacity, VLogFlightRecorderRing* next);
+        // Never destroyed; see above.
+
+        void claim(const VString& threadName); ///< Empties the ring and marks it in use by the named thread. Assumes the mutex is held.
+        void release() { mInUse.store(false, std::memory_order_release); } ///< Marks the ring unused, when its thread ends.
+        bool isInUse() const { return mInUse.load(std::memory_order_acquire); }
+
+        VLogFlightRecord& beginWrite(); ///< Returns the slot's record for the next message, marking it as being written.
+        void endWrite();                ///< Marks the record returned by beginWrite() as complete.
+        int emit(VLogAppender& appender) const;  ///< Emits the complete records, oldest first. Returns the number emitted.
+        void writeCrashDump(int fd) const;  ///< Writes the complete records to the file, oldest first. Async-signal-safe.
+
+        int getCapacity() const { return mCapacity; }
+        const char* getThreadName() const { return mThreadName; }
+        VLogFlightRecorderRing* getNext() const { return mNext; }
+
+    private:
+
+        VLogFlightRecorderRing(const VLogFlightRecorderRing&); // not copyable
+        VLogFlightRecorderRing& operator=(const VLogFlightRecorderRing&); // not assignable
+
+        bool _copyRecord(Vu64 index, VLogFlightRecord& r) const; ///< Copies record index if it is complete and not overwritten while copying.
+
+        const int               mCapacity;  ///< The number of slots.
+        VLogFlightRecorderSlot* mSlots;     ///< The slots.
+        std::atomic<Vu64>       mNextIndex; ///< The number of records begun so far; the next record's index.
+        std::atomic<bool>       mInUse;     ///< False once the owning thread has ended, until another thread claims the ring.
+        char                    mThreadName[kMaxThreadNameLength + 1]; ///< The name of the thread that owns the ring, null terminated.
+        VLogFlightRecorderRing* const mNext; ///< The next ring in the list.
+};
+
+/**
+Builds one line of the crash dump in a fixed buffer, truncating what doesn't fit, and writes it
+with a single write(2). Everything it does is async-signal-safe: no allocation, locks or stdio.
+*/
+class VLogFlightRecorderCrashLine {
+    public:
+
+        VLogFlightRecorderCrashLine() : mLength(0) {}
+        ~VLogFlightRecorderCrashLine() {}
+
+        void append(const char* s);
+        void append(const char* s, int length);
+        void appendChar(char c);
+        void appendUnsigned(Vu64 value, int minDigits = 1);
+        void appendSigned(Vs64 value);
+        void appendHex(Vu64 value);
+        void appendDouble(VDouble value);
+        void appendUTCTime(Vs64 when); ///< Appends a VInstant value as "yyyy-MM-dd HH:mm:ss.SSS" in UTC.
+        void appendLevel(int level);   ///< Appends the level name like VLoggerLevel::getName().
+        void appendArgument(const VLogDeferredMessage::Argument& argument, const char* text);
+        void appendDeferredMessage(const VLogFlightRecord& r);
+        void write(int fd);            ///< Writes the line and a line ending, and empties the buffer.
+
+    private:
+
+        VLogFlightRecorderCrashLine(const VLogFlightRecorderCrashLine&); // not copyable
+        VLogFlightRecorderCrashLine& operator=(const VLogFlightRecorderCrashLine&); // not assignable
+
+        char    mBuffer[kMaxCrashLineLength + 1];  ///< The line so far, with room for the line ending.
+        int     mLength;                            ///< The length of the line so far.
+};
+
+// This style of static mutex declaration and access ensures correct
+// initialization if accessed during the static initialization phase.
+static VMutex* _mutexInstance() {
+    static VMutex gMutex("VLogFlightRecorder _mutexInstance() gMutex", true/*suppress logging; we are called from the logger*/);
+    return &gMutex;
+}
+
+static std::atomic<VLogFlightRecorderRing*> gRings(NULL); // the head of the list; changed only with _mutexInstance() held
+static int gCapacity = VLogFlightRecorder::kDefaultCapacity; // guarded by _mutexInstance()
+static VFSNode gDumpDirectory; // guarded by _mutexInstance(); empty path means the base log directory
+static V_THREAD_LOCAL VLogFlightRecorderRing* gCurrentRing = NULL;
+static volatile int gCrashDumpFD = -1; // opened by installCrashHandler(), for the crash handler to write to
+static VString gCrashDumpPath; // guarded by _mutexInstance(); the path of gCrashDumpFD's file
+static std::atomic<bool> gCrashDumpStarted(false);
+
+static void _copyString(char* buffer, int bufferLength, const char* s, int length) {
+    int numToCopy = V_MIN(length, bufferLength - 1);
+    if (numToCopy > 0) {
+        ::memcpy(buffer, s, static_cast<size_t>(numToCopy));
+    }
+
+    buffer[V_MAX(0, numToCopy)] = 0;
+}
+
+// VLogFlightRecorderRing -----------------------------------------------------
+
+VLogFlightRecorderRing::VLogFlightRecorderRing(int capacity, VLogFlightRecorderRing* next)
+    : mCapacity(capacity)
+    , mSlots(new VLogFlightRecorderSlot[capacity])
+    , mNextIndex(0)
+    , mInUse(false)
+    , mNext(next)
+    {
+    mThreadName[0] = 0;
+    mThreadName[kMaxThreadNameLength] = 0; // never overwritten, so a torn read still ends here
+}
+
+void VLogFlightRecorderRing::claim(const VString& threadName) {
+    for (int i = 0; i < mCapacity; ++i) {
+        mSlots[i].mSequence.store(0, std::memory_order_relaxed);
+    }
+
+    mNextIndex.store(0, std::memory_order_relaxed);
+    _copyString(mThreadName, kMaxThreadNameLength + 1, threadName.chars(), threadName.length());
+    mInUse.store(true, std::memory_order_release);
+}
+
+VLogFlightRecord& VLogFlightRecorderRing::beginWrite() {
+    Vu64 index = mNextIndex.load(std::memory_order_relaxed);
+    VLogFlightRecorderSlot& slot = mSlots[index % static_cast<Vu64>(mCapacity)];
+    slot.mSequence.store((2 * index) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release); // a reader that sees the old record complete must not see our writes to it
+    return slot.mRecord;
+}
+
+void VLogFlightRecorderRing::endWrite() {
+    Vu64 index = mNextIndex.load(std::memory_order_relaxed);
+    mSlots[index % static_cast<Vu64>(mCapacity)].mSequence.store((2 * index) + 2, std::memory_order_release);
+    mNextIndex.store(index + 1, std::memory_order_release);
+}
+
+bool VLogFlightRecorderRing::_copyRecord(Vu64 index, VLogFlightRecord& r) const {
+    const VLogFlightRecorderSlot& slot = mSlots[index % static_cast<Vu64>(mCapacity)];
+    Vu64 expectedSequence = (2 * index) + 2;
+    if (slot.mSequence.load(std::memory_order_acquire) != expectedSequence) {
+        return false;
+    }
+
+    r = slot.mRecord;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.mSequence.load(std::memory_order_relaxed) == expectedSequence;
+}
+
+int VLogFlightRecorderRing::emit(VLogAppender& appender) const {
+    Vu64 endIndex = mNextIndex.load(std::memory_order_acquire);
+    Vu64 capacity = static_cast<Vu64>(mCapacity);
+    Vu64 startIndex = (endIndex > capacity) ? (endIndex - capacity) : 0;
+    int numEmitted = 0;
+
+    for (Vu64 index = startIndex; index < endIndex; ++index) {
+        VLogFlightRecord r;
+        if (! this->_copyRecord(index, r)) {
+            continue;
+        }
+
+        VLogRecord record;
+        record.mLevel = r.mLevel;
+        record.mFile = r.mFile;
+        record.mLine = r.mLine;
+        record.mEmitMessage = true;
+        record.mActualLoggerName = r.mLoggerName;
+        record.mEmitRawLine = false;
+        record.mWhen.setValue(r.mWhen);
+        record.mTrueWhen.setValue(r.mTrueWhen);
+        record.mThreadName = mThreadName;
+
+        if (r.mFormat == NULL) {
+            record.mMessage = r.mText;
+        } else {
+            // Point the string values back into our copy of the text; assigning the message to the record copies them.
+            VLogDeferredMessage message(r.mFormat);
+            for (int i = 0; i < r.mNumArguments; ++i) {
+                VLogDeferredMessage::Argument argument = r.mArguments[i];
+                if (argument.mType == VLogDeferredMessage::kCString) {
+                    Vs64 offset = argument.mValue.mSigned;
+                    argument.mValue.mCString = (offset < 0) ? NULL : (r.mText + offset);
+                }
+
+                message.addArgument(argument);
+            }
+
+            record.mDeferredMessage = message;
+            record.mMessageIsDeferred = true;
+        }
+
+        appender.emitRecord(record);
+        ++numEmitted;
+    }
+
+    return numEmitted;
+}
+
+void VLogFlightRecorderRing::writeCrashDump(int fd) const {
+    VLogFlightRecorderCrashLine line;
+    line.append("--- Thread '");
+    line.append(mThreadName);
+    line.append("' ---");
+    line.write(fd);
+
+    Vu64 endIndex = mNextIndex.load(std::memory_order_acquire);
+    Vu64 capacity = static_cast<Vu64>(mCapacity);
+    Vu64 startIndex = (endIndex > capacity) ? (endIndex - capacity) : 0;
+
+    for (Vu64 index = startIndex; index < endIndex; ++index) {
+        VLogFlightRecord r;
+        if (! this->_copyRecord(index, r)) {
+            continue;
+        }
+
+        // The same layout as FLIGHT_RECORDER_FORMAT_SPEC, but in UTC, since local time can't be looked up safely here.
+        line.appendUTCTime(r.mWhen);
+        line.appendChar(' ');
+        line.appendLevel(r.mLevel);
+        line.append(" | ");
+        line.append(mThreadName);
+        line.append(" | ");
+        line.append(r.mLoggerName);
+        line.append(" | ");
+        if (r.mFile != NULL) {
+            line.append("@ ");
+            line.append(r.mFile);
+            line.appendChar(':');
+            line.appendSigned(r.mLine);
+            line.append(": ");
+        }
+
+        if (r.mFormat == NULL) {
+            line.append(r.mText);
+        } else {
+            line.appendDeferredMessage(r);
+        }
+
+        line.write(fd);
+    }
+}
+
+// VLogFlightRecorderCrashLine ------------------------------------------------
+
+void VLogFlightRecorderCrashLine::append(const char* s) {
+    if (s == NULL) {
+        this->append("(null)");
+        return;
+    }
+
+    while ((*s != 0) && (mLength < kMaxCrashLineLength)) {
+        mBuffer[mLength++] = *s++;
+    }
+}
+
+void VLogFlightRecorderCrashLine::append(const char* s, int length) {
+    for (int i = 0; (i < length) && (mLength < kMaxCrashLineLength); ++i) {
+        mBuffer[mLength++] = s[i];
+    }
+}
+
+void VLogFlightRecorderCrashLine::appendChar(char c) {
+    if (mLength < kMaxCrashLineLength) {
+        mBuffer[mLength++] = c;
+    }
+}
+
+void VLogFlightRecorderCrashLine::appendUnsigned(Vu64 value, int minDigits) {
+    char digits[24];
+    int numDigits = 0;
+    do {
+        digits[numDigits++] = static_cast<char>('0' + (value % 10));
+        value /= 10;
+    } while ((value != 0) || (numDigits < minDigits));
+
+    while (numDigits > 0) {
+        this->appendChar(digits[--numDigits]);
+    }
+}
+
+void VLogFlightRecorderCrashLine::appendSigned(Vs64 value) {
+    if (value < 0) {
+        this->appendChar('-');
+        this->appendUnsigned(static_cast<Vu64>(-(value + 1)) + 1); // avoids overflow for the most negative value
+    } else {
+        this->appendUnsigned(static_cast<Vu64>(value));
+    }
+}
+
+void VLogFlightRecorderCrashLine::appendHex(Vu64 value) {
+    static const char kHexDigits[] = "0123456789abcdef";
+    char digits[16];
+    int numDigits = 0;
+    do {
+        digits[numDigits++] = kHexDigits[value & 0x0F];
+        value >>= 4;
+    } while (value != 0);
+
+    this->append("0x");
+    while (numDigits > 0) {
+        this->appendChar(digits[--numDigits]);
+    }
+}
+
+void VLogFlightRecorderCrashLine::appendDouble(VDouble value) {
+    // Plain fixed point with 6 decimals; snprintf is not async-signal-safe.
+    if (value != value) {
+        this->append("nan");
+        return;
+    }
+
+    if (value < 0.0) {
+        this->appendChar('-');
+        value = -value;
+    }
+
+    if (value >= 1.0e18) {
+        this->append("inf"); // or merely too big to show this way
+        return;
+    }
+
+    Vu64 wholePart = static_cast<Vu64>(value);
+    Vu64 fraction = static_cast<Vu64>(((value - static_cast<VDouble>(wholePart)) * 1000000.0) + 0.5);
+    if (fraction >= 1000000) {
+        ++wholePart;
+        fraction -= 1000000;
+    }
+
+    this->appendUnsigned(wholePart);
+    this->appendChar('.');
+    this->appendUnsigned(fraction, 6);
+}
+
+void VLogFlightRecorderCrashLine::appendUTCTime(Vs64 when) {
+    // gmtime() is not async-signal-safe, so convert days to a civil date ourselves.
+    Vs64 days = when / CONST_S64(86400000);
+    Vs64 millisecondOfDay = when % CONST_S64(86400000);
+    if (millisecondOfDay < 0) {
+        millisecondOfDay += CONST_S64(86400000);
+        --days;
+    }
+
+    // Days since 1970-01-01 to year, month and day, in the proleptic Gregorian calendar.
+    days += 719468;
+    Vs64 era = ((days >= 0) ? days : (days - 146096)) / 146097;
+    Vs64 dayOfEra = days - (era * 146097);
+    Vs64 yearOfEra = (dayOfEra - (dayOfEra / 1460) + (dayOfEra / 36524) - (dayOfEra / 146096)) / 365;
+    Vs64 dayOfYear = dayOfEra - ((365 * yearOfEra) + (yearOfEra / 4) - (yearOfEra / 100));
+    Vs64 monthIndex = ((5 * dayOfYear) + 2) / 153; // March is 0
+    Vs64 day = dayOfYear - (((153 * monthIndex) + 2) / 5) + 1;
+    Vs64 month = (monthIndex < 10) ? (monthIndex + 3) : (monthIndex - 9);
+    Vs64 year = yearOfEra + (era * 400) + ((month <= 2) ? 1 : 0);
+
+    this->appendSigned(year);
+    this->appendChar('-');
+    this->appendUnsigned(static_cast<Vu64>(month), 2);
+    this->appendChar('-');
+    this->appendUnsigned(static_cast<Vu64>(day), 2);
+    this->appendChar(' ');
+    this->appendUnsigned(static_cast<Vu64>(millisecondOfDay / 3600000), 2);
+    this->appendChar(':');
+    this->appendUnsigned(static_cast<Vu64>((millisecondOfDay / 60000) % 60), 2);
+    this->appendChar(':');
+    this->appendUnsigned(static_cast<Vu64>((millisecondOfDay / 1000) % 60), 2);
+    this->appendChar('.');
+    this->appendUnsigned(static_cast<Vu64>(millisecondOfDay % 1000), 3);
+}
+
+void VLogFlightRecorderCrashLine::appendLevel(int level) {
+    switch (level) {
+        case VLoggerLevel::FATAL: this->append("FATAL"); break;
+        case VLoggerLevel::ERROR: this->append("ERROR"); break;
+        case VLoggerLevel::WARN:  this->append("WARN "); break;
+        case VLoggerLevel::INFO:  this->append("INFO "); break;
+        case VLoggerLevel::DEBUG: this->append("DEBUG"); break;
+        case VLoggerLevel::TRACE: this->append("TRACE"); break;
+        default:                  this->appendSigned(level); break;
+    }
+}
+
+void VLogFlightRecorderCrashLine::appendArgument(const VLogDeferredMessage::Argument& argument, const char* text) {
+    switch (argument.mType) {
+        case VLogDeferredMessage::kSigned:   this->appendSigned(argument.mValue.mSigned); break;
+        case VLogDeferredMessage::kUnsigned: this->appendUnsigned(argument.mValue.mUnsigned); break;
+        case VLogDeferredMessage::kDouble:   this->appendDouble(argument.mValue.mDouble); break;
+        case VLogDeferredMessage::kBool:     this->append(argument.mValue.mBool ? "true" : "false"); break;
+        case VLogDeferredMessage::kChar:     this->appendChar(argument.mValue.mChar); break;
+        case VLogDeferredMessage::kPointer:  this->appendHex(reinterpret_cast<Vu64>(argument.mValue.mPointer)); break;
+        // The recorder stores every string value as a kCString offset into the record's text.
+        case VLogDeferredMessage::kCString:  this->append((argument.mValue.mSigned < 0) ? NULL : (text + argument.mValue.mSigned)); break;
+        default:                             this->append("?"); break;
+    }
+}
+
+void VLogFlightRecorderCrashLine::appendDeferredMessage(const VLogFlightRecord& r) {
+    // Like VLogDeferredMessage::format(), but each value is written plainly, ignoring its format spec.
+    int nextArgument = 0;
+    const char* p = r.mFormat;
+    while (*p != 0) {
+        if (((p[0] == '{') || (p[0] == '}')) && (p[0] == p[1])) { // "{{" or "}}"
+            this->appendChar(p[0]);
+            p += 2;
+            continue;
+        }
+
+        const char* closingBrace = NULL;
+        if ((p[0] == '{') && (nextArgument < r.mNumArguments)) {
+            for (const char* q = p + 1; *q != 0; ++q) {
+                if (*q == '}') {
+                    closingBrace = q;
+                    break;
+                }
+            }
+        }
+
+        if (closingBrace == NULL) {
+            this->appendChar(*p++);
+            continue;
+        }
+
+        this->appendArgument(r.mArguments[nextArgument++], r.mText);
+        p = closingBrace + 1;
+    }
+}
+
+void VLogFlightRecorderCrashLine::write(int fd) {
+    mBuffer[mLength++] = '\n';
+    (void) vault::write(fd, mBuffer, static_cast<size_t>(mLength));
+    mLength = 0;
+}
+
+// VLogFlightRecorder ---------------------------------------------------------
+
+volatile int VLogFlightRecorder::gLevel = VLoggerLevel::OFF;
+
+// static
+void VLogFlightRecorder::setLevel(int level) {
+    int oldLevel = gLevel;
+    gLevel = level;
+
+    // The logger's fast level check must let through anything we record.
+    VLogger::checkMaxActiveLogLevelForChangedLogger(oldLevel, level);
+}
+
+// static
+void VLogFlightRecorder::setCapacity(int numRecords) {
+    VMutexLocker locker(_mutexInstance(), "VLogFlightRecorder::setCapacity");
+    gCapacity = V_MAX(1, numRecords);
+}
+
+// static
+int VLogFlightRecorder::getCapacity() {
+    VMutexLocker locker(_mutexInstance(), "VLogFlightRecorder::getCapacity");
+    return gCapacity;
+}
+
+// static
+void VLogFlightRecorder::setDumpDirectory(const VFSNode& directory) {
+    VMutexLocker locker(_mutexInstance(), "VLogFlightRecorder::setDumpDirectory");
+    gDumpDirectory = directory;
+}
+
+// static
+VFSNode VLogFlightRecorder::getDumpDirectory() {
+    VMutexLocker locker(_mutexInstance(), "VLogFlightRecorder::getDumpDirectory");
+    return VLogFlightRecorder::_getDumpDirectory();
+}
+
+static VLogFlightRecorderRing* _getCurrentRing() {
+    if (gCurrentRing == NULL) {
+        VString threadName;
+        try {
+            threadName = VThread::getCurrentThreadName();
+        } catch (...) {} // leave it empty
+
+        VMutexLocker locker(_mutexInstance(), "VLogFlightRecorder _getCurrentRing()");
+        VLogFlightRecorderRing* ring = gRings.load(std::memory_order_relaxed);
+        while ((ring != NULL) && (ring->isInUse() || (ring->getCapacity() != gCapacity))) {
+            ring = ring->getNext();
+        }
+
+        if (ring == NULL) {
+            ring = new VLogFlightRecorderRing(gCapacity, gRings.load(std::memory_order_relaxed));
+            gRings.store(ring, std::memory_order_release);
+        }
+
+        ring->claim(threadName);
+        gCurrentRing = ring;
+    }
+
+    return gCurrentRing;
+}
+
+static void _beginRecord(VLogFlightRecord& r, int level, const char* file, int line, const VString& loggerName) {
+    VInstant when;
+    r.mWhen = when.getValue();
+    r.mTrueWhen = r.mWhen;
+    if ((VInstant::getSimulatedClockOffset() != VDuration::ZERO()) || VInstant::isTimeFrozen()) {
+        when.setTrueNow();
+        r.mTrueWhen = when.getValue();
+    }
+
+    r.mLevel = level;
+    r.mFile = file;
+    r.mLine = line;
+    _copyString(r.mLoggerName, sizeof(r.mLoggerName), loggerName.chars(), loggerName.length());
+}
+
+// static
+void VLogFlightRecorder::record(int level, const char* file, int line, const VString& message, const VString& loggerName) {
+    VLogFlightRecorderRing* ring = _getCurrentRing();
+    VLogFlightRecord& r = ring->beginWrite();
+
+    _beginRecord(r, level, file, line, loggerName);
+    r.mFormat = NULL;
+    r.mNumArguments = 0;
+    _copyString(r.mText, sizeof(r.mText), message.chars(), message.length());
+
+    ring->endWrite();
+}
+
+// static
+void VLogFlightRecorder::record(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& loggerName) {
+    VLogFlightRecorderRing* ring = _getCurrentRing();
+    VLogFlightRecord& r = ring->beginWrite();
+
+    _beginRecord(r, level, file, line, loggerName);
+    r.mFormat = message.getFormat();
+    r.mNumArguments = message.getNumArguments();
+
+    int textOffset = 0;
+    for (int i = 0; i < r.mNumArguments; ++i) {
+        VLogDeferredMessage::Argument argument = message.getArgument(i);
+        const char* s = NULL;
+        int length = 0;
+        if (argument.mType == VLogDeferredMessage::kVString) {
+            s = argument.mValue.mVString->chars();
+            length = argument.mValue.mVString->length();
+        } else if ((argument.mType == VLogDeferredMessage::kCString) && (argument.mValue.mCString != NULL)) {
+            s = argument.mValue.mCString;
+            length = static_cast<int>(::strlen(s));
+        }
+
+        if (s != NULL) {
+            _copyString(r.mText + textOffset, static_cast<int>(sizeof(r.mText)) - textOffset, s, length);
+            argument.mType = VLogDeferredMessage::kCString;
+            argument.mValue.mSigned = textOffset;
+            textOffset = V_MIN(textOffset + length + 1, static_cast<int>(sizeof(r.mText)) - 1); // once full, later values share the final null
+        } else if (argument.mType == VLogDeferredMessage::kCString) {
+            argument.mValue.mSigned = -1;
+        }
+
+        r.mArguments[i] = argument;
+    }
+
+    if (textOffset == 0) {
+        r.mText[0] = 0;
+    }
+
+    ring->endWrite();
+}
+
+// static
+int VLogFlightRecorder::emitCurrentThread(VLogAppender& appender) {
+    return (gCurrentRing == NULL) ? 0 : gCurrentRing->emit(appender);
+}
+
+// static
+int VLogFlightRecorder::emitAllThreads(VLogAppender& appender) {
+    VMutexLocker locker(_mutexInstance(), "VLogFlightRecorder::emitAllThreads");
+    return VLogFlightRecorder::_emitAllThreads(appender);
+}
+
+// static
+VString VLogFlightRecorder::dumpCurrentThread(const VString& reason) {
+    if (gCurrentRing == NULL) {
+        return VString::EMPTY();
+    }
+
+    VMutexLocker locker(_mutexInstance(), "VLogFlightRecorder::dumpCurrentThread");
+    return VLogFlightRecorder::_dump(false, reason);
+}
+
+// static
+VString VLogFlightRecorder::dumpAllThreads(const VString& reason) {
+    VMutexLocker locker(_mutexInstance(), "VLogFlightRecorder::dumpAllThreads");
+    return VLogFlightRecorder::_dump(true, reason);
+}
+
+// static
+void VLogFlightRecorder::dumpCurrentThreadOnException(const VString& loggerName, const VString& reason) {
+    if (gLevel == VLoggerLevel::OFF) {
+        return;
+    }
+
+    VString path = VLogFlightRecorder::dumpCurrentThread(reason);
+    if (path.isNotEmpty()) {
+        VLOGGER_NAMED_ERROR(loggerName, VSTRING_FORMAT("Wrote flight recorder dump to '%s'.", path.chars()));
+    }
+}
+
+static void _removeUnusedCrashDumpFile() {
+    // Registered with atexit(): if we never crashed, the file is empty, so don't leave it behind.
+    VMutexLocker locker(_mutexInstance(), "VLogFlightRecorder _removeUnusedCrashDumpFile()");
+    int fd = gCrashDumpFD;
+    if ((fd == -1) || gCrashDumpStarted.load()) {
+        return;
+    }
+
+    gCrashDumpFD = -1;
+    bool isEmpty = (VFileSystem::lseek(fd, 0, SEEK_END) == 0);
+    (void) VFileSystem::close(fd);
+    if (isEmpty) {
+        (void) VFileSystem::unlink(gCrashDumpPath);
+    }
+}
+
+// static
+void VLogFlightRecorder::installCrashHandler() {
+    /* locker scope */ {
+        VMutexLocker locker(_mutexInstance(), "VLogFlightRecorder::installCrashHandler");
+        if (gCrashDumpFD == -1) {
+            // The handler can't safely create a file, so create it now.
+            try {
+                VFSNode directory = VLogFlightRecorder::_getDumpDirectory();
+                directory.mkdirs();
+                VFSNode fileNode(directory, VSTRING_FORMAT("flightrecorder_crash_%s.log", VInstant().getUTCString(VInstantFormatter(FLIGHT_RECORDER_TIME_FORMAT)).chars()));
+                int fd = VFileSystem::open(fileNode.getPath(), WRITE_CREATE_MODE);
+                if (fd != -1) {
+                    gCrashDumpPath = fileNode.getPath();
+                    gCrashDumpFD = fd;
+                    (void) ::atexit(_removeUnusedCrashDumpFile);
+                }
+            } catch (...) {} // Without the file, the handler just lets the signal take its course.
+        }
+    }
+
+    const int kSignals[] = {
+        SIGSEGV, SIGILL, SIGFPE, SIGABRT,
+#ifdef SIGBUS
+        SIGBUS,
+#endif
+    };
+
+    for (size_t i = 0; i < sizeof(kSignals) / sizeof(kSignals[0]); ++i) {
+#ifdef VPLATFORM_WIN
+        (void) ::signal(kSignals[i], VLogFlightRecorder::_crashSignalHandler);
+#else
+        // SA_RESETHAND restores the default action on entry, so a crash inside the handler ends the process.
+        struct sigaction action;
+        ::memset(&action, 0, sizeof(action));
+        action.sa_handler = VLogFlightRecorder::_crashSignalHandler;
+        ::sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESETHAND;
+        (void) ::sigaction(kSignals[i], &action, NULL);
+#endif
+    }
+}
+
+// static
+void VLogFlightRecorder::threadEnded() {
+    if (gCurrentRing == NULL) {
+        return;
+    }
+
+    gCurrentRing->release();
+    gCurrentRing = NULL;
+}
+
+// static
+VFSNode VLogFlightRecorder::_getDumpDirectory() {
+    return gDumpDirectory.getPath().isEmpty() ? VLogger::getBaseLogDirectory() : gDumpDirectory;
+}
+
+// static
+int VLogFlightRecorder::_emitAllThreads(VLogAppender& appender) {
+    int numEmitted = 0;
+    for (const VLogFlightRecorderRing* ring = gRings.load(std::memory_order_acquire); ring != NULL; ring = ring->getNext()) {
+        if (ring->isInUse()) {
+            appender.emit(VLoggerLevel::OFF, NULL, 0, false, VString::EMPTY(), VString::EMPTY(), VString::EMPTY(), true, VSTRING_FORMAT("--- Thread '%s' ---", ring->getThreadName()));
+            numEmitted += ring->emit(appender);
+        }
+    }
+
+    return numEmitted;
+}
+
+// static
+VString VLogFlightRecorder::_dump(bool allThreads, const VString& reason) {
+    VString path;
+
+    try {
+        VFSNode directory = VLogFlightRecorder::_getDumpDirectory();
+        VInstant fileTime;
+        VFSNode fileNode;
+        for (;;) {
+            fileNode = VFSNode(directory, VSTRING_FORMAT("flightrecorder_%s.log", fileTime.getLocalString(VInstantFormatter(FLIGHT_RECORDER_TIME_FORMAT)).chars()));
+            if (! fileNode.exists()) {
+                break;
+            }
+
+            fileTime += VDuration::MILLISECOND();
+        }
+
+        path = fileNode.getPath();
+        VFileLogAppender appender("flight-recorder", VLogAppender::DO_FORMAT_OUTPUT, FLIGHT_RECORDER_FORMAT_SPEC, VString::EMPTY(), path);
+        appender.emit(VLoggerLevel::OFF, NULL, 0, false, VString::EMPTY(), VString::EMPTY(), VString::EMPTY(), true, reason);
+
+        if (allThreads) {
+            (void) VLogFlightRecorder::_emitAllThreads(appender);
+        } else {
+            appender.emit(VLoggerLevel::OFF, NULL, 0, false, VString::EMPTY(), VString::EMPTY(), VString::EMPTY(), true, VSTRING_FORMAT("--- Thread '%s' ---", gCurrentRing->getThreadName()));
+            (void) gCurrentRing->emit(appender);
+        }
+    } catch (...) {
+        return VString::EMPTY(); // We are typically called while handling a failure; don't make it worse.
+    }
+
+    return path;
+}
+
+// static
+void VLogFlightRecorder::_crashSignalHandler(int signalNumber) {
+    /*
+    Only async-signal-safe calls from here on: the crashed thread may hold any lock, including the
+    allocator's. We write to the file opened by installCrashHandler(), formatting each record in a
+    stack buffer, and walk the rings without the mutex; they are never freed, and ended ones are
+    skipped. If another thread crashes too, only the first one dumps.
+    */
+    int fd = gCrashDumpFD;
+    if ((fd != -1) && ! gCrashDumpStarted.exchange(true)) {
+        VLogFlightRecorderCrashLine line;
+        line.append("Received fatal signal ");
+        line.appendSigned(signalNumber);
+        line.append(". Times are UTC.");
+        line.write(fd);
+
+        for (const VLogFlightRecorderRing* ring = gRings.load(std::memory_order_acquire); ring != NULL; ring = ring->getNext()) {
+            if (ring->isInUse()) {
+                ring->writeCrashDump(fd);
+            }
+        }
+    }
+
+#ifdef VPLATFORM_WIN
+    (void) ::signal(signalNumber, SIG_DFL);
+#endif
+    (void) ::raise(signalNumber); // the default action, restored by SA_RESETHAND, runs once we return
+}
@@ -0,0 +1,152 @@
+/*
+Copyright c1997-2014 Trygve Isaacson. All rights reserved.
+This file is part of the Code Vault version 4.1
+http://www.bombaydigital.com/
+License: MIT. See LICENSE.md in the Vault top level directory.
+*/
+
+#ifndef vlogflightrecorder_h
+#define vlogflightrecorder_h
+
+/** @file */
+
+#include "vlogger.h"
+
+/**
+    @ingroup vlogger
+*/
+
+/**
+VLogFlightRecorder keeps each thread's most recent log messages in memory, so that they can be
+written out after something goes wrong, without the cost of emitting them all the time. While the
+recorder level is above OFF, every message logged at or below that level through a VNamedLogger is
+recorded, whether or not the logger's own level lets it through to the appenders. Typically the
+recorder is set to TRACE while the loggers are at INFO.
+
+Each thread has its own ring of records, created the first time the thread logs, so recording a
+message takes no lock and involves no appender. A record holds the time, level, location and logger
+name, and the message's text; for a deferred message (see VLogDeferredMessage), the format string
+and values are recorded instead, and only formatted if the ring is dumped. Text, including a deferred
+message's string values, is truncated to kMaxTextLength bytes per record.
+
+The rings are dumped to a file in the dump directory:
+- VThread::threadMain() dumps the current thread's ring when the thread's run() throws.
+- VMessageInputThread::run() does the same when it ends on an exception.
+- installCrashHandler() installs handlers for fatal signals that dump all the rings before the
+  process dies. The handler only makes async-signal-safe calls: it writes to a file opened when
+  it was installed, formats each record itself (deferred values are written plainly, ignoring
+  their format specs), and shows times in UTC.
+A ring can also be emitted to any appender with emitCurrentThread() or emitAllThreads().
+
+A VThread's ring is released when the thread ends, and is reused by a later thread. Threads not
+started by VThread keep theirs. Rings are never freed, so that the crash handler can read them
+without a lock.
+
+The VLogger::configure() settings may include a "flight-recorder" child node with these properties:
+- "level" the recorder level; default is OFF
+- "capacity" the number of records per thread; default is kDefaultCapacity
+- "dir" the dump directory; default is VLogger::getBaseLogDirectory()
+- "crash-handler" true to call installCrashHandler(); default is false
+*/
+class VLogFlightRecorder {
+    public:
+
+        static const int kDefaultCapacity = 256;    ///< The default number of records per thread.
+        static const int kMaxTextLength = 255;      ///< The most text a record holds, including a deferred message's string values.
+        static const int kMaxLoggerNameLength = 63; ///< The longest logger name a record holds.
+
+        /**
+        Sets the level at or below which messages are recorded. Use VLoggerLevel::OFF to stop
+        recording; the rings keep what they hold.
+        @param  level   the recorder level
+        */
+        static void setLevel(int level);
+        static int getLevel() { return gLevel; }                                ///< Returns the recorder level. @return obvious
+        static bool isRecording(int level) { return level <= gLevel; }         ///< Returns true if a message at the level would be recorded. @param level obvious @return obvious
+        /**
+        Sets the number of records in each thread's ring. It applies to rings created afterward.
+        @param  numRecords  the number of records
+        */
+        static void setCapacity(int numRecords);
+        static int getCapacity();                                               ///< Returns the number of records in a new ring. @return obvious
+        static void setDumpDirectory(const VFSNode& directory);                 ///< Sets the directory that dump files are created in. @param directory obvious
+        static VFSNode getDumpDirectory();                                      ///< Returns the directory that dump files are created in. @return obvious
+
+        /**
+        Records a message in the current thread's ring. VNamedLogger calls this; it does not check
+        the level.
+        @param  level       the message level
+        @param  file        the __FILE__ value, or NULL; must be a string literal
+        @param  line        the __LINE__ value, or 0
+        @param  message     the message
+        @param  loggerName  the name of the logger
+        */
+        static void record(int level, const char* file, int line, const VString& message, const VString& loggerName);
+        /**
+        Records a deferred message in the current thread's ring, without formatting it.
+        @param  level       the message level
+        @param  file        the __FILE__ value, or NULL; must be a string literal
+        @param  line        the __LINE__ value, or 0
+        @param  message     the message; its format string must outlive the ring
+        @param  loggerName  the name of the logger
+        */
+        static void record(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& loggerName);
+
+        /**
+        Emits the current thread's records to an appender, oldest first. The records remain in the ring.
+        @param  appender    the appender
+        @return the number of records emitted
+        */
+        static int emitCurrentThread(VLogAppender& appender);
+        /**
+        Emits every thread's records to an appender, a thread at a time, each preceded by a raw
+        line naming the thread.
+        @param  appender    the appender
+        @return the number of records emitted
+        */
+        static int emitAllThreads(VLogAppender& appender);
+        /**
+        Writes the current thread's records to a new file in the dump directory.
+        @param  reason  a line of text written at the top of the file
+        @return the path of the file, or empty if the thread has recorded nothing or the file could not be written
+        */
+        static VString dumpCurrentThread(const VString& reason);
+        /**
+        Writes every thread's records to a new file in the dump directory.
+        @param  reason  a line of text written at the top of the file
+        @return the path of the file, or empty if the file could not be written
+        */
+        static VString dumpAllThreads(const VString& reason);
+        /**
+        If recording, calls dumpCurrentThread() and logs the file's path. Call this where a thread
+        catches an exception at its top level, after logging the exception.
+        @param  loggerName  the logger to log the file's path to, at ERROR level
+        @param  reason      a line of text written at the top of the file
+        */
+        static void dumpCurrentThreadOnException(const VString& loggerName, const VString& reason);
+        /**
+        Installs handlers for SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT that write every thread's
+        records to a file and then let the signal take its default action. The file is created in
+        the dump directory now, since the handler can't safely create it; it is removed at exit if
+        the process doesn't crash.
+        */
+        static void installCrashHandler();
+
+        /**
+        Discards the current thread's records, as when the thread ends. VThread calls this.
+        */
+        static void threadEnded();
+
+    private:
+
+        VLogFlightRecorder(); // not instantiable; all static
+
+        static VFSNode _getDumpDirectory(); ///< Returns the dump directory. Assumes the mutex is held.
+        static int _emitAllThreads(VLogAppender& appender); ///< Implements emitAllThreads(). Assumes the mutex is held.
+        static VString _dump(bool allThreads, const VString& reason); ///< Implements the dump functions. Assumes the mutex is held.
+        static void _crashSignalHandler(int signalNumber); ///< The handler installed by installCrashHandler(). Async-signal-safe.
+
+        static volatile int gLevel; ///< The recorder level; read without locking on every log call.
+};
+
+#endif /* vlogflightrecorder_h */
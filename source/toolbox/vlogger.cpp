@@ -9,20 +9,372 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 
 #include "vlogger.h"
 
+#include "vbinarylogappender.h"
+#include "vlogflightrecorder.h"
 #include "vthread.h"
 #include "vmutexlocker.h"
 #include "vsettings.h"
 #include "vbento.h"
 #include "vchar.h"
+#include "vsemaphore.h"
+#include "vexception.h"
+
+#include <atomic> // for VAsyncLogQueue's lock-free slots and counters
 
 static const VNamedLoggerPtr NULL_NAMED_LOGGER_PTR;
 static const VLogAppenderPtr NULL_LOG_APPENDER_PTR;
 
-volatile int VLogger::gMaxActiveLevel = 0;
-VNamedLoggerPtr VLogger::gDefaultLogger = NULL_NAMED_LOGGER_PTR;
-VLogAppenderPtr VLogger::gDefaultAppender = NULL_LOG_APPENDER_PTR;
+// A logger must be handed messages that it won't emit if the flight recorder would record them.
+static bool _isLoggerActiveForLevel(const VNamedLoggerPtr& logger, int level) {
+    return logger->isEnabledFor(level) || VLogFlightRecorder::isRecording(level);
+}
+
+std::atomic<int> VLogger::gMaxActiveLevel(0);
+std::atomic<int> VLogger::gLoggersGeneration(0);
 VFSNode VLogger::gBaseLogDirectory(".");
 
+typedef std::map<VString, VNamedLoggerPtr> VNamedLoggerMap;
+typedef std::map<VString, VLogAppenderPtr> VLogAppendersMap;
+
+// VLoggerConfiguration -------------------------------------------------------
+
+/**
+The loggers and appenders registered with VLogger. A configuration is never modified once it has
+been published: to change it, VLoggerConfigurationEditor copies the current one, modifies the copy,
+and publishes that in its place. So finding a logger or appender, which every log statement does,
+takes no lock; the reader only has to keep the configuration it found from being deleted while it
+uses it, which VLoggerConfigurationReadScope does.
+*/
+class VLoggerConfiguration {
+    public:
+
+        VLoggerConfiguration()
+            : mGeneration(0)
+            , mLoggers()
+            , mAppenders()
+            , mGlobalAppenders()
+            , mDefaultLogger()
+            , mDefaultAppender()
+            {}
+        VLoggerConfiguration(const VLoggerConfiguration& other) // copied by VLoggerConfigurationEditor
+            : mGeneration(other.mGeneration)
+            , mLoggers(other.mLoggers)
+            , mAppenders(other.mAppenders)
+            , mGlobalAppenders(other.mGlobalAppenders)
+            , mDefaultLogger(other.mDefaultLogger)
+            , mDefaultAppender(other.mDefaultAppender)
+            {}
+        ~VLoggerConfiguration() {}
+
+        void clear() {
+            mLoggers.clear();
+            mAppenders.clear();
+            mGlobalAppenders.clear();
+            mDefaultLogger.reset();
+            mDefaultAppender.reset();
+        }
+
+        int                 mGeneration;        ///< The VLogger::gLoggersGeneration value this configuration was published with.
+        VNamedLoggerMap     mLoggers;           ///< The registered loggers, by name.
+        VLogAppendersMap    mAppenders;         ///< The registered appenders, by name, including the global ones.
+        VLogAppendersMap    mGlobalAppenders;   ///< The appenders that every logger emits to, by name.
+        VNamedLoggerPtr     mDefaultLogger;     ///< The logger used when a name is not found; created on first reference if needed. (@ Nullable)
+        VLogAppenderPtr     mDefaultAppender;   ///< The appender used by a logger that names none; created on first reference if needed. (@ Nullable)
+
+    private:
+
+        VLoggerConfiguration& operator=(const VLoggerConfiguration&); // not assignable
+};
+
+// This style of static mutex declaration and access ensures correct
+// initialization if accessed during the static initialization phase.
+// Only changes to the configuration take this mutex; lookups don't.
+static VMutex* _mutexInstance() {
+    static VMutex* gVLoggerMutex = new VMutex("gVLoggerMutex", true/*suppress logging; we are the logger*/);
+    return gVLoggerMutex;
+}
+
+// The published configuration. Only a thread holding _mutexInstance() replaces it, so such a thread may read it without a VLoggerConfigurationReadScope.
+static std::atomic<const VLoggerConfiguration*>& _getCurrentConfiguration() {
+    static std::atomic<const VLoggerConfiguration*>* gCurrentConfiguration = new std::atomic<const VLoggerConfiguration*>(new VLoggerConfiguration());
+    return *gCurrentConfiguration;
+}
+
+struct VNamedLoggerResolution;
+
+/**
+One thread's claim on the configuration it is reading. A replaced configuration is not deleted
+while any thread's reader points to it. Each thread has its own, so that reading doesn't write to
+memory shared with other threads. VNamedLoggerHandle claims its resolutions the same way.
+*/
+class VLoggerConfigurationReader {
+    public:
+
+        VLoggerConfigurationReader()
+            : mInUse(NULL)
+            , mResolutionInUse(NULL)
+            , mDepth(0)
+            , mOwned(true)
+            , mDeferred()
+            {}
+        ~VLoggerConfigurationReader() {}
+
+        std::atomic<const VLoggerConfiguration*>    mInUse;     ///< The configuration this thread is reading, or NULL.
+        std::atomic<const VNamedLoggerResolution*>  mResolutionInUse; ///< The VNamedLoggerHandle resolution this thread is reading, or NULL.
+        int                                         mDepth;     ///< How many read scopes are open on this thread; only the outermost sets mInUse. Used only by the thread.
+        bool                                        mOwned;     ///< False after the thread has ended, until another thread takes this reader. Guarded by _readersMutexInstance().
+        std::vector<const VLoggerConfiguration*>    mDeferred;  ///< Configurations this thread replaced while reading; retired when its outermost scope ends. Used only by the thread.
+
+    private:
+
+        VLoggerConfigurationReader(const VLoggerConfigurationReader&); // not copyable
+        VLoggerConfigurationReader& operator=(const VLoggerConfigurationReader&); // not assignable
+};
+
+typedef std::vector<VLoggerConfigurationReader*> VLoggerConfigurationReaderList;
+
+static VMutex* _readersMutexInstance() {
+    static VMutex* gReadersMutex = new VMutex("gVLoggerReadersMutex", true/*suppress logging; we are the logger*/);
+    return gReadersMutex;
+}
+
+// Guarded by _readersMutexInstance(). Readers are never deleted; a thread that ends releases its reader for reuse.
+static VLoggerConfigurationReaderList& _getReaders() {
+    static VLoggerConfigurationReaderList* gReaders = new VLoggerConfigurationReaderList();
+    return *gReaders;
+}
+
+static V_THREAD_LOCAL VLoggerConfigurationReader* gCurrentReader = NULL;
+
+static VLoggerConfigurationReader* _getCurrentReader() {
+    if (gCurrentReader == NULL) {
+        VMutexLocker locker(_readersMutexInstance(), "_getCurrentReader");
+        VLoggerConfigurationReaderList& readers = _getReaders();
+        for (VLoggerConfigurationReaderList::const_iterator i = readers.begin(); i != readers.end(); ++i) {
+            if (! (*i)->mOwned) {
+                (*i)->mOwned = true;
+                gCurrentReader = *i;
+                return gCurrentReader;
+            }
+        }
+
+        gCurrentReader = new VLoggerConfigurationReader();
+        readers.push_back(gCurrentReader);
+    }
+
+    return gCurrentReader;
+}
+
+static void _retireConfiguration(const VLoggerConfiguration* configuration);
+
+/**
+Gives the current thread the published configuration to read for the life of the object. Scopes
+may nest, as when an appender logs while emitting; the inner ones see the same configuration as the
+outermost, so a change published meanwhile is seen by the thread's next log statement.
+*/
+class VLoggerConfigurationReadScope {
+    public:
+
+        VLoggerConfigurationReadScope()
+            : mReader(_getCurrentReader())
+            , mConfiguration(NULL)
+            {
+            if (mReader->mDepth++ == 0) {
+                // Claim the configuration, then make sure it wasn't replaced before the claim was visible;
+                // a writer that replaces it looks for claims only after publishing the new one.
+                std::atomic<const VLoggerConfiguration*>& current = _getCurrentConfiguration();
+                const VLoggerConfiguration* configuration = current.load();
+                do {
+                    mConfiguration = configuration;
+                    mReader->mInUse.store(configuration);
+                    configuration = current.load();
+                } while (configuration != mConfiguration);
+            } else {
+                mConfiguration = mReader->mInUse.load(std::memory_order_relaxed);
+            }
+        }
+
+        ~VLoggerConfigurationReadScope() {
+            if (--mReader->mDepth == 0) {
+                mReader->mInUse.store(NULL, std::memory_order_release);
+
+                if (! mReader->mDeferred.empty()) {
+                    std::vector<const VLoggerConfiguration*> deferred;
+                    deferred.swap(mReader->mDeferred);
+                    for (std::vector<const VLoggerConfiguration*>::const_iterator i = deferred.begin(); i != deferred.end(); ++i) {
+                        _retireConfiguration(*i);
+                    }
+                }
+            }
+        }
+
+        const VLoggerConfiguration& operator*() const { return *mConfiguration; }
+        const VLoggerConfiguration* operator->() const { return mConfiguration; }
+
+    private:
+
+        VLoggerConfigurationReadScope(const VLoggerConfigurationReadScope&); // not copyable
+        VLoggerConfigurationReadScope& operator=(const VLoggerConfigurationReadScope&); // not assignable
+
+        VLoggerConfigurationReader*     mReader;
+        const VLoggerConfiguration*     mConfiguration;
+};
+
+// Deletes a configuration that has been replaced, once no thread is reading it. If the current thread is
+// reading one itself (an appender changed the configuration while emitting), it must not wait for the others,
+// which might be waiting for it in the same way, so it retires the configuration when its reading is done.
+static void _retireConfiguration(const VLoggerConfiguration* configuration) {
+    if ((gCurrentReader != NULL) && (gCurrentReader->mDepth != 0)) {
+        gCurrentReader->mDeferred.push_back(configuration);
+        return;
+    }
+
+    for (;;) {
+        bool inUse = false;
+        /* locker scope */ {
+            VMutexLocker locker(_readersMutexInstance(), "_retireConfiguration");
+            const VLoggerConfigurationReaderList& readers = _getReaders();
+            for (VLoggerConfigurationReaderList::const_iterator i = readers.begin(); i != readers.end(); ++i) {
+                if ((*i)->mInUse.load() == configuration) {
+                    inUse = true;
+                    break;
+                }
+            }
+        }
+
+        if (! inUse) {
+            break;
+        }
+
+        VThread::yield(); // A reader only holds a configuration for the length of one log statement.
+    }
+
+    delete configuration;
+}
+
+/**
+Changes the configuration. The editor holds _mutexInstance() for its lifetime, so that changes are
+serialized, and gives the caller a copy of the current configuration to modify; publish() makes the
+copy current. The configuration it replaced is deleted when the editor is destroyed, after the mutex
+is released, because that may destroy appenders whose destructors log or wait for a thread that logs
+(VAsyncLogAppender).
+*/
+class VLoggerConfigurationEditor {
+    public:
+
+        VLoggerConfigurationEditor(const VString& name)
+            : mLocker(_mutexInstance(), name)
+            , mConfiguration(new VLoggerConfiguration(*_getCurrentConfiguration().load()))
+            , mReplaced(NULL)
+            {}
+
+        ~VLoggerConfigurationEditor() {
+            mLocker.unlock();
+
+            delete mConfiguration; // not NULL only if it was not published
+
+            if (mReplaced != NULL) {
+                _retireConfiguration(mReplaced);
+            }
+        }
+
+        VLoggerConfiguration& operator*() { return *mConfiguration; }
+        VLoggerConfiguration* operator->() { return mConfiguration; }
+
+        void publish() {
+            mConfiguration->mGeneration = VLogger::gLoggersGeneration + 1;
+            mReplaced = _getCurrentConfiguration().exchange(mConfiguration);
+            VLogger::gLoggersGeneration = mConfiguration->mGeneration;
+            mConfiguration = NULL;
+        }
+
+    private:
+
+        VLoggerConfigurationEditor(const VLoggerConfigurationEditor&); // not copyable
+        VLoggerConfigurationEditor& operator=(const VLoggerConfigurationEditor&); // not assignable
+
+        VMutexLocker                    mLocker;
+        VLoggerConfiguration*           mConfiguration;
+        const VLoggerConfiguration*     mReplaced;
+};
+
+// Returns the appender that an entry in a logger's appender names refers to, as VLogger::getAppender()
+// does, but as the configuration's own reference, so that loggers on many threads don't contend on
+// the appender's reference count. It's null only if there is no default appender yet.
+static const VLogAppenderPtr& _getAppenderForName(const VLoggerConfiguration& configuration, const VString& appenderName) {
+    if (appenderName.isNotEmpty()) {
+        VLogAppendersMap::const_iterator pos = configuration.mAppenders.find(appenderName);
+        if (pos != configuration.mAppenders.end()) {
+            return pos->second;
+        }
+    }
+
+    return configuration.mDefaultAppender;
+}
+
+// VNamedLoggerHexDump --------------------------------------------------------
+
+/**
+Sends the rows of VNamedLogger::logHexDump()'s dump to the logger's appenders as they are
+generated, as raw lines of up to about kChunkLength chars, so that the memory a dump takes
+doesn't depend on the size of the buffer. The caller holds the logger's appenders mutex.
+*/
+class VNamedLoggerHexDump : public VHex {
+    public:
+
+        static const int kChunkLength = 16384; ///< The length at which accumulated rows are emitted.
+
+        VNamedLoggerHexDump(VNamedLogger& logger, int level)
+            : VHex(NULL)
+            , mLogger(logger)
+            , mLevel(level)
+            , mChunk()
+            {}
+        virtual ~VNamedLoggerHexDump() {}
+
+        /**
+        Emits any rows not emitted yet, after a line saying how many bytes were left out, if any.
+        @param  numBytesOmitted the number of bytes that were not dumped
+        */
+        void finish(Vs64 numBytesOmitted) {
+            if (numBytesOmitted > 0) {
+                this->_emitLine(VSTRING_FORMAT("  (" VSTRING_FORMATTER_S64 " more bytes not shown)", numBytesOmitted));
+            }
+
+            this->_emitChunk();
+        }
+
+    protected:
+
+        virtual void _emitLine(const VString& line) {
+            if (mChunk.isNotEmpty()) {
+                mChunk += VString::NATIVE_LINE_ENDING();
+            }
+
+            mChunk += line;
+
+            if (mChunk.length() >= kChunkLength) {
+                this->_emitChunk();
+            }
+        }
+
+    private:
+
+        VNamedLoggerHexDump(const VNamedLoggerHexDump&); // not copyable
+        VNamedLoggerHexDump& operator=(const VNamedLoggerHexDump&); // not assignable
+
+        void _emitChunk() {
+            if (mChunk.isNotEmpty()) {
+                mLogger._emitToAppenders(mLevel, NULL, 0, false, VString::EMPTY(), VString::EMPTY(), true, mChunk);
+                mChunk = VString::EMPTY(); // keeps the buffer for the next chunk
+            }
+        }
+
+        VNamedLogger&   mLogger;    ///< The logger whose appenders we emit to.
+        int             mLevel;     ///< The level of the hex dump.
+        VString         mChunk;     ///< The rows not emitted yet, separated by line endings.
+};
+
 // VNamedLogger ---------------------------------------------------------------
 
 VNamedLogger::VNamedLogger(const VString& name, int level, const VStringVector& appenderNames, VLogAppenderPtr specificAppender)
@@ -33,7 +385,9 @@ VNamedLogger::VNamedLogger(const VString& name, int level, const VStringVector&
     , mAppenderNames(appenderNames)
     , mSpecificAppender(specificAppender)
     , mRepetitionFilter()
-    , mPrintStackConfig() {
+    , mPrintStackConfig()
+    , mRateLimiter()
+    , mHexDumpMaxBytes(0) {
     if (appenderNames.empty() && (specificAppender == NULL_LOG_APPENDER_PTR)) {
         mAppenderNames.push_back(VString::EMPTY());
     }
@@ -56,12 +410,24 @@ void VNamedLogger::addAppender(const VString& appenderName) {
 }
 
 void VNamedLogger::log(int level, const char* file, int line, const VString& message, const VString& specifiedLoggerName) {
+    if (VLogFlightRecorder::isRecording(level)) {
+        VLogFlightRecorder::record(level, file, line, message, mName);
+    }
+
     if (level > mLevel) {
         return;
     }
 
     VNamedLogger::_breakpointLocationForLog();
 
+    if (mRateLimiter.isEnabled() && !this->_checkRateLimit(level)) {
+        return;
+    }
+
+    this->_logText(level, file, line, message, specifiedLoggerName);
+}
+
+void VNamedLogger::_logText(int level, const char* file, int line, const VString& message, const VString& specifiedLoggerName) {
     if (mRepetitionFilter.isEnabled()) { // avoid mutex if no need to check filter
         VMutexLocker timeoutLocker(&mAppendersMutex, "VNamedLogger::log() checkTimeout");
         mRepetitionFilter.checkTimeout(*this);
@@ -93,34 +459,78 @@ void VNamedLogger::addInfo(VBentoNode& infoNode) const {
 
     infoNode.addBool("repetition-filter-enabled", mRepetitionFilter.isEnabled());
     infoNode.addInt("print-stack-level", mPrintStackConfig.getLevel());
+
+    if (mHexDumpMaxBytes > 0) {
+        infoNode.addS64("hex-dump-max-bytes", mHexDumpMaxBytes);
+    }
+
+    VMutexLocker locker(&mAppendersMutex, "VNamedLogger::addInfo");
+    mRateLimiter.addInfo(infoNode);
 }
 
 void VNamedLogger::log(int level, const VString& message) {
     this->log(level, NULL, 0, message);
 }
 
+void VNamedLogger::log(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName) {
+    if (VLogFlightRecorder::isRecording(level)) {
+        VLogFlightRecorder::record(level, file, line, message, mName);
+    }
+
+    if (level > mLevel) {
+        return;
+    }
+
+    VNamedLogger::_breakpointLocationForLog();
+
+    // Checked before anything else, so that a dropped message is never formatted.
+    if (mRateLimiter.isEnabled() && !this->_checkRateLimit(level)) {
+        return;
+    }
+
+    // The repetition filter compares message text, so it needs the message formatted now.
+    if (mRepetitionFilter.isEnabled()) {
+        this->_logText(level, file, line, message.getText(), specifiedLoggerName);
+        return;
+    }
+
+    VMutexLocker locker(&mAppendersMutex, "VNamedLogger::log");
+    this->_emitDeferredToAppenders(level, file, line, message, specifiedLoggerName);
+    if (mPrintStackConfig.shouldPrintStack(level, *this)) {
+        locker.unlock(); // avoid recursive deadlock, we're done with our data until we recur
+        VThread::logStackCrawl(message.getText(), VNamedLoggerPtr(shared_from_this()), false);
+    }
+}
+
 void VNamedLogger::logHexDump(int level, const VString& message, const VString& specifiedLoggerName, const Vu8* buffer, Vs64 length) {
+    if (VLogFlightRecorder::isRecording(level)) {
+        VLogFlightRecorder::record(level, NULL, 0, message, mName); // just the message; the hex dump would not fit
+    }
+
     if (level > mLevel) {
         return;
     }
 
     VNamedLogger::_breakpointLocationForLog();
 
-    // Try to be efficient here:
-    // Form the hex dump only if the length is > 0.
-    // But do it once ahead of time, then interate over the appenders, writing to each one.
+    if (mRateLimiter.isEnabled() && !this->_checkRateLimit(level)) {
+        return;
+    }
 
-    VString hexString;
-    if (length > 0) {
-        VMemoryStream   tempBuffer;
-        VTextIOStream   stream(tempBuffer);
-        VHex            hex(&stream);
-        hex.printHex(buffer, length);
-        hexString.copyFromBuffer((const char*)tempBuffer.getBuffer(), 0, (int) tempBuffer.getEOFOffset());
+    Vs64 numBytesToDump = length;
+    if ((mHexDumpMaxBytes > 0) && (length > mHexDumpMaxBytes)) {
+        numBytesToDump = mHexDumpMaxBytes;
     }
 
+    // Holding the lock throughout keeps our other messages from landing in the middle of the dump.
     VMutexLocker locker(&mAppendersMutex, "VNamedLogger::logHexDump");
-    this->_emitToAppenders(level, NULL, 0, true, message, specifiedLoggerName, true, hexString);
+    this->_emitToAppenders(level, NULL, 0, true, message, specifiedLoggerName, false, VString::EMPTY());
+
+    if (numBytesToDump > 0) {
+        VNamedLoggerHexDump hexDump(*this, level);
+        hexDump.printHex(buffer, numBytesToDump);
+        hexDump.finish(length - numBytesToDump);
+    }
 }
 
 void VNamedLogger::emitStackCrawlLine(const VString& message) {
@@ -134,8 +544,14 @@ void VNamedLogger::setLevel(int level) {
     VLogger::checkMaxActiveLogLevelForChangedLogger(oldLevel, level);
 }
 
+void VNamedLogger::setRateLimit(VDouble messagesPerSecond, int burstSize, VDouble sampleRate, int limitLevel, const VDuration& reportInterval) {
+    VMutexLocker locker(&mAppendersMutex, "VNamedLogger::setRateLimit");
+    mRateLimiter.configure(*this, messagesPerSecond, burstSize, sampleRate, limitLevel, reportInterval);
+}
+
 bool VNamedLogger::isDefaultLogger() const {
-    return VLogger::gDefaultLogger.get() == this;
+    VLoggerConfigurationReadScope configuration;
+    return configuration->mDefaultLogger.get() == this;
 }
 
 void VNamedLogger::_emitToAppenders(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, bool emitRawLine, const VString& rawLine) {
@@ -143,14 +559,43 @@ void VNamedLogger::_emitToAppenders(int level, const char* file, int line, bool
         mSpecificAppender->emit(level, file, line, emitMessage, message, specifiedLoggerName, mName, emitRawLine, rawLine);
     }
 
+    // The configuration keeps the appenders alive while we emit, including in emitToGlobalAppenders(), whose scope nests in ours.
+    VLoggerConfigurationReadScope configuration;
     for (VStringVector::const_iterator i = mAppenderNames.begin(); i != mAppenderNames.end(); ++i) {
-        VLogAppenderPtr appender = (*i).isEmpty() ? VLogger::getDefaultAppender() : VLogger::getAppender(*i);
-        appender->emit(level, file, line, emitMessage, message, specifiedLoggerName, mName, emitRawLine, rawLine);
+        const VLogAppenderPtr& appender = _getAppenderForName(*configuration, *i);
+        if (appender != nullptr) {
+            appender->emit(level, file, line, emitMessage, message, specifiedLoggerName, mName, emitRawLine, rawLine);
+        } else {
+            VLogger::getDefaultAppender()->emit(level, file, line, emitMessage, message, specifiedLoggerName, mName, emitRawLine, rawLine);
+        }
     }
 
     VLogger::emitToGlobalAppenders(level, file, line, emitMessage, message, specifiedLoggerName, mName, emitRawLine, rawLine);
 }
 
+void VNamedLogger::_emitDeferredToAppenders(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName) {
+    if (mSpecificAppender != NULL_LOG_APPENDER_PTR) {
+        mSpecificAppender->emitDeferred(level, file, line, message, specifiedLoggerName, mName);
+    }
+
+    VLoggerConfigurationReadScope configuration;
+    for (VStringVector::const_iterator i = mAppenderNames.begin(); i != mAppenderNames.end(); ++i) {
+        const VLogAppenderPtr& appender = _getAppenderForName(*configuration, *i);
+        if (appender != nullptr) {
+            appender->emitDeferred(level, file, line, message, specifiedLoggerName, mName);
+        } else {
+            VLogger::getDefaultAppender()->emitDeferred(level, file, line, message, specifiedLoggerName, mName);
+        }
+    }
+
+    VLogger::emitDeferredToGlobalAppenders(level, file, line, message, specifiedLoggerName, mName);
+}
+
+bool VNamedLogger::_checkRateLimit(int level) {
+    VMutexLocker locker(&mAppendersMutex, "VNamedLogger::_checkRateLimit");
+    return mRateLimiter.checkMessage(*this, level);
+}
+
 VString VNamedLogger::_toString() const {
     VString s(VSTRING_ARGS("VNamedLogger '%s' (%d) ->", mName.chars(), mLevel));
 
@@ -168,6 +613,161 @@ void VNamedLogger::_breakpointLocationForLog() {
     // once basic level filtering has been passed.
 }
 
+// VNamedLoggerHandle ---------------------------------------------------------
+
+/**
+What a VNamedLoggerHandle has resolved its name to, and the generation of the configuration it was found in.
+*/
+struct VNamedLoggerResolution {
+    VNamedLoggerPtr mLogger;
+    int             mGeneration;
+};
+
+// Deletes a resolution that a handle has replaced, once no thread's reader claims it. A claim lasts only
+// as long as it takes to copy the logger pointer out, so unlike _retireConfiguration() this never defers.
+static void _retireResolution(const VNamedLoggerResolution* resolution) {
+    for (;;) {
+        bool inUse = false;
+        /* locker scope */ {
+            VMutexLocker locker(_readersMutexInstance(), "_retireResolution");
+            const VLoggerConfigurationReaderList& readers = _getReaders();
+            for (VLoggerConfigurationReaderList::const_iterator i = readers.begin(); i != readers.end(); ++i) {
+                if ((*i)->mResolutionInUse.load() == resolution) {
+                    inUse = true;
+                    break;
+                }
+            }
+        }
+
+        if (! inUse) {
+            break;
+        }
+
+        VThread::yield();
+    }
+
+    delete resolution;
+}
+
+/**
+A handle's current resolution. Readers load mCurrent without locking, claiming it in their
+VLoggerConfigurationReader while they copy the logger out. A resolution that is replaced is
+deleted, dropping its reference to the logger, as soon as no reader claims it.
+*/
+class VNamedLoggerHandleState {
+    public:
+
+        VNamedLoggerHandleState()
+            : mCurrent(NULL)
+            , mMutex("VNamedLoggerHandleState", true/*this mutex itself must not log*/)
+            {}
+        ~VNamedLoggerHandleState() {
+            delete mCurrent.load();
+        }
+
+        std::atomic<const VNamedLoggerResolution*>  mCurrent;   ///< The current resolution, or NULL before the first use.
+        VMutex                                      mMutex;     ///< Serializes re-resolution.
+
+    private:
+
+        VNamedLoggerHandleState(const VNamedLoggerHandleState&); // not copyable
+        VNamedLoggerHandleState& operator=(const VNamedLoggerHandleState&); // not assignable
+};
+
+VNamedLoggerHandle::VNamedLoggerHandle(const VString& name)
+    : mName(name)
+    , mState(new VNamedLoggerHandleState())
+    {
+}
+
+VNamedLoggerHandle::VNamedLoggerHandle(const VNamedLoggerHandle& other)
+    : mName(other.mName)
+    , mState(new VNamedLoggerHandleState())
+    {
+}
+
+VNamedLoggerHandle::~VNamedLoggerHandle() {
+    delete mState;
+}
+
+VNamedLoggerHandle& VNamedLoggerHandle::operator=(const VNamedLoggerHandle& other) {
+    if (this != &other) {
+        VNamedLoggerHandleState* newState = new VNamedLoggerHandleState();
+        delete mState;
+        mState = newState;
+        mName = other.mName;
+    }
+
+    return *this;
+}
+
+VNamedLoggerPtr VNamedLoggerHandle::getLogger() const {
+    /* claim scope */ {
+        // Claim the resolution, then make sure it wasn't replaced before the claim was visible,
+        // as VLoggerConfigurationReadScope does for the configuration.
+        VLoggerConfigurationReader* reader = _getCurrentReader();
+        const VNamedLoggerResolution* resolution = mState->mCurrent.load();
+        const VNamedLoggerResolution* claimed;
+        do {
+            claimed = resolution;
+            reader->mResolutionInUse.store(claimed);
+            resolution = mState->mCurrent.load();
+        } while (resolution != claimed);
+
+        VNamedLoggerPtr logger;
+        if ((resolution != NULL) && (resolution->mGeneration == VLogger::gLoggersGeneration)) {
+            logger = resolution->mLogger;
+        }
+
+        reader->mResolutionInUse.store(NULL, std::memory_order_release);
+
+        if (logger != nullptr) {
+            return logger;
+        }
+    }
+
+    VMutexLocker locker(&mState->mMutex, "VNamedLoggerHandle::getLogger");
+
+    // Another thread may have resolved it while we waited. We hold the mutex, so nobody can replace it under us.
+    const VNamedLoggerResolution* resolution = mState->mCurrent.load(std::memory_order_acquire);
+    if ((resolution != NULL) && (resolution->mGeneration == VLogger::gLoggersGeneration)) {
+        return resolution->mLogger;
+    }
+
+    VNamedLoggerResolution* newResolution = new VNamedLoggerResolution();
+    /* read scope */ {
+        // The configuration's generation describes exactly what we found in it.
+        VLoggerConfigurationReadScope configuration;
+        newResolution->mLogger = VLogger::_findNamedLoggerFromPathName(*configuration, mName);
+        newResolution->mGeneration = configuration->mGeneration;
+    }
+
+    if (newResolution->mLogger == nullptr) {
+        // Creating the default logger, if needed, changes the generation; we'll just resolve once more next time.
+        newResolution->mLogger = VLogger::getDefaultLogger();
+    }
+
+    mState->mCurrent.store(newResolution, std::memory_order_release);
+    VNamedLoggerPtr logger = newResolution->mLogger; // once we unlock, another thread may replace it
+    locker.unlock();
+
+    if (resolution != NULL) {
+        _retireResolution(resolution);
+    }
+
+    return logger;
+}
+
+VNamedLoggerPtr VNamedLoggerHandle::getLoggerForLevel(int level) const {
+    // Fast as possible short-circuit, as in VLogger::findNamedLoggerForLevel().
+    if (! VLogger::isLogLevelActive(level)) {
+        return NULL_NAMED_LOGGER_PTR;
+    }
+
+    VNamedLoggerPtr logger = this->getLogger();
+    return _isLoggerActiveForLevel(logger, level) ? logger : NULL_NAMED_LOGGER_PTR;
+}
+
 // Provided factories ---------------------------------------------------------
 
 class VCoutLogAppenderFactory : public VLogAppenderFactory {
@@ -236,32 +836,31 @@ class VStringVectorLogAppenderFactory : public VLogAppenderFactory {
             { infoNode.addString("type", "VStringVectorLogAppenderFactory"); }
 };
 
-// VLogger -------------------------------------------------------------------
+class VAsyncLogAppenderFactory : public VLogAppenderFactory {
+    public:
+        VAsyncLogAppenderFactory() : VLogAppenderFactory() {}
+        virtual ~VAsyncLogAppenderFactory() {}
 
-// This style of static mutex declaration and access ensures correct
-// initialization if accessed during the static initialization phase.
-static VMutex* _mutexInstance() {
-    static VMutex* gVLoggerMutex = new VMutex("gVLoggerMutex", true/*suppress logging of the logger mutex*/);
-    return gVLoggerMutex;
-}
+        virtual VLogAppenderPtr instantiateLogAppender(const VSettingsNode& settings, const VSettingsNode& defaults) const
+            { return VLogAppenderPtr(new VAsyncLogAppender(settings, defaults)); }
+        virtual void addInfo(VBentoNode& infoNode) const
+            { infoNode.addString("type", "VAsyncLogAppenderFactory"); }
+};
 
-// _mutexInstance() must be used internally whenever referencing these static accessors:
+class VBinaryLogAppenderFactory : public VLogAppenderFactory {
+    public:
+        VBinaryLogAppenderFactory() : VLogAppenderFactory() {}
+        virtual ~VBinaryLogAppenderFactory() {}
 
-typedef std::map<VString, VNamedLoggerPtr> VNamedLoggerMap;
-static VNamedLoggerMap& _getLoggerMap() {
-    static VNamedLoggerMap* gLoggerMap = new VNamedLoggerMap();
-    return *gLoggerMap;
+        virtual VLogAppenderPtr instantiateLogAppender(const VSettingsNode& settings, const VSettingsNode& defaults) const
+            { return VLogAppenderPtr(new VBinaryLogAppender(settings, defaults)); }
+        virtual void addInfo(VBentoNode& infoNode) const
+            { infoNode.addString("type", "VBinaryLogAppenderFactory"); }
 };
 
-typedef std::map<VString, VLogAppenderPtr> VLogAppendersMap;
-static VLogAppendersMap& _getAppendersMap() {
-    static VLogAppendersMap* gAppendersMap = new VLogAppendersMap();
-    return *gAppendersMap;
-}
-static VLogAppendersMap& _getGlobalAppendersMap() {
-    static VLogAppendersMap* gGlobalAppendersMap = new VLogAppendersMap();
-    return *gGlobalAppendersMap;
-}
+// VLogger -------------------------------------------------------------------
+
+// _mutexInstance() must be used internally whenever referencing this static accessor:
 
 typedef std::map<VString, VLogAppenderFactoryPtr> VLogAppenderFactoriesMap;
 static VLogAppenderFactoriesMap& _getAppenderFactoriesMap() {
@@ -362,16 +961,24 @@ void VLogger::installNewNamedLogger(const VSettingsNode& loggerSettings) {
         logger->setPrintStackInfo(printStackLevel, maxNumOccurrences, timeLimit);
     }
 
-    VMutexLocker locker(_mutexInstance(), "VLogger::installNewNamedLogger");
-    VLogger::_registerLogger(logger, false);
+    VDouble rateLimit = loggerSettings.getDouble("rate-limit", 0.0);
+    VDouble sampleRate = loggerSettings.getDouble("sample-rate", 1.0);
+    if ((rateLimit > 0.0) || (sampleRate < 1.0)) {
+        int burstSize = loggerSettings.getInt("rate-limit-burst", 0);
+        int limitLevel = loggerSettings.getInt("rate-limit-level", VLoggerLevel::ERROR);
+        VDuration reportInterval = loggerSettings.getDuration("rate-limit-report-interval", VDuration::MINUTE());
+        logger->setRateLimit(rateLimit, burstSize, sampleRate, limitLevel, reportInterval);
+    }
+
+    logger->setHexDumpMaxBytes(loggerSettings.getS64("hex-dump-max-bytes", 0));
+
+    VLogger::registerLogger(logger, false);
 }
 
 // static
 void VLogger::installNewNamedLogger(const VString& name, int level, const VStringVector& appenderNames) {
     VNamedLoggerPtr logger(new VNamedLogger(name, level, appenderNames));
-
-    VMutexLocker locker(_mutexInstance(), "VLogger::installNewNamedLogger");
-    VLogger::_registerLogger(logger, false);
+    VLogger::registerLogger(logger, false);
 }
 
 // static
@@ -399,6 +1006,8 @@ void VLogger::configure(const VFSNode& baseLogDirectory, const VSettingsNode& lo
     VLogger::registerLogAppenderFactory("silent", VLogAppenderFactoryPtr(new VSilentLogAppenderFactory()));
     VLogger::registerLogAppenderFactory("string", VLogAppenderFactoryPtr(new VStringLogAppenderFactory()));
     VLogger::registerLogAppenderFactory("string-vector", VLogAppenderFactoryPtr(new VStringVectorLogAppenderFactory()));
+    VLogger::registerLogAppenderFactory("async", VLogAppenderFactoryPtr(new VAsyncLogAppenderFactory()));
+    VLogger::registerLogAppenderFactory("binary", VLogAppenderFactoryPtr(new VBinaryLogAppenderFactory()));
 
     // Stash any per-appender defaults in a map while we configure, so we can pass them to the factories we call.
     std::map<VString, const VSettingsNode*> defaultsForAppenders;
@@ -425,58 +1034,76 @@ void VLogger::configure(const VFSNode& baseLogDirectory, const VSettingsNode& lo
         const VSettingsNode* loggerNode = loggingSettings.getNamedChild("logger", i);
         VLogger::installNewNamedLogger(*loggerNode);
     }
+
+    const VSettingsNode* flightRecorderNode = loggingSettings.findNode("flight-recorder");
+    if (flightRecorderNode != NULL) {
+        VLogFlightRecorder::setCapacity(flightRecorderNode->getInt("capacity", VLogFlightRecorder::kDefaultCapacity));
+        VString dumpDirectoryPath = flightRecorderNode->getString("dir", VString::EMPTY());
+        if (dumpDirectoryPath.isNotEmpty()) {
+            VLogFlightRecorder::setDumpDirectory(VFSNode(dumpDirectoryPath));
+        }
+
+        if (flightRecorderNode->getBoolean("crash-handler", false)) {
+            VLogFlightRecorder::installCrashHandler();
+        }
+
+        VLogFlightRecorder::setLevel(flightRecorderNode->getInt("level", VLoggerLevel::OFF));
+    }
 }
 
 // static
 void VLogger::shutdown() {
-    VMutexLocker locker(_mutexInstance(), "VLogger::shutdown");
-
-    // Clear all shared_ptr references. This will allow all referenced objects to be deleted (unless someone outside retains a reference).
-    gDefaultLogger.reset();
-    gDefaultAppender.reset();
-    _getLoggerMap().clear();
-    _getAppendersMap().clear();
+    // The configuration we replace is deleted after the editor releases the lock, along with all the references
+    // it holds, since an appender's destructor may need to log or wait for another thread that logs (VAsyncLogAppender).
+    // Anyone outside who retains a reference keeps that object alive.
+    VLoggerConfigurationEditor configuration("VLogger::shutdown");
+    configuration->clear();
     _getAppenderFactoriesMap().clear();
 
     gMaxActiveLevel = 0;
+    configuration.publish();
 }
 
 // static
 void VLogger::registerLogAppender(VLogAppenderPtr appender, bool asDefaultAppender) {
-    VMutexLocker locker(_mutexInstance(), "VLogger::registerLogAppender");
-    VLogger::_registerAppender(appender, asDefaultAppender, false);
+    VLoggerConfigurationEditor configuration("VLogger::registerLogAppender");
+    VLogger::_registerAppender(*configuration, appender, asDefaultAppender, false);
+    configuration.publish();
 }
 
 // static
 void VLogger::registerGlobalAppender(VLogAppenderPtr appender, bool asDefaultAppender) {
-    VMutexLocker locker(_mutexInstance(), "VLogger::registerLogAppender");
-    VLogger::_registerAppender(appender, asDefaultAppender, true);
+    VLoggerConfigurationEditor configuration("VLogger::registerGlobalAppender");
+    VLogger::_registerAppender(*configuration, appender, asDefaultAppender, true);
+    configuration.publish();
 }
 
 // static
 void VLogger::registerLogger(VNamedLoggerPtr namedLogger, bool asDefaultLogger) {
-    VMutexLocker locker(_mutexInstance(), "VLogger::registerLogger");
-    VLogger::_registerLogger(namedLogger, asDefaultLogger);
+    VLoggerConfigurationEditor configuration("VLogger::registerLogger");
+    VLogger::_registerLogger(*configuration, namedLogger, asDefaultLogger);
+    configuration.publish();
 }
 
 // static
 void VLogger::deregisterLogAppender(VLogAppenderPtr appender) {
-    VMutexLocker locker(_mutexInstance(), "VLogger::deregisterLogAppender");
+    VLoggerConfigurationEditor configuration("VLogger::deregisterLogAppender");
 
-    if (gDefaultAppender == appender) {
-        gDefaultAppender.reset();
+    if (configuration->mDefaultAppender == appender) {
+        configuration->mDefaultAppender.reset();
     }
 
-    VLogAppendersMap::iterator pos = _getAppendersMap().find(appender->getName());
-    if (pos != _getAppendersMap().end()) {
-        _getAppendersMap().erase(pos);
+    VLogAppendersMap::iterator pos = configuration->mAppenders.find(appender->getName());
+    if (pos != configuration->mAppenders.end()) {
+        configuration->mAppenders.erase(pos);
     }
 
-    pos = _getGlobalAppendersMap().find(appender->getName());
-    if (pos != _getGlobalAppendersMap().end()) {
-        _getGlobalAppendersMap().erase(pos);
+    pos = configuration->mGlobalAppenders.find(appender->getName());
+    if (pos != configuration->mGlobalAppenders.end()) {
+        configuration->mGlobalAppenders.erase(pos);
     }
 
+    configuration.publish();
 }
 
 // static
@@ -489,18 +1116,19 @@ void VLogger::deregisterLogAppender(const VString& name) {
 
 // static
 void VLogger::deregisterLogger(VNamedLoggerPtr namedLogger) {
-    VMutexLocker locker(_mutexInstance(), "VLogger::deregisterLogger");
+    VLoggerConfigurationEditor configuration("VLogger::deregisterLogger");
 
-    if (gDefaultLogger == namedLogger) {
-        gDefaultLogger.reset();
+    if (configuration->mDefaultLogger == namedLogger) {
+        configuration->mDefaultLogger.reset();
     }
 
-    VNamedLoggerMap::iterator pos = _getLoggerMap().find(namedLogger->getName());
-    if (pos != _getLoggerMap().end()) {
-        _getLoggerMap().erase(pos);
+    VNamedLoggerMap::iterator pos = configuration->mLoggers.find(namedLogger->getName());
+    if (pos != configuration->mLoggers.end()) {
+        configuration->mLoggers.erase(pos);
     }
 
-    VLogger::_checkMaxActiveLogLevelForRemovedLogger(namedLogger->getLevel());
+    VLogger::_checkMaxActiveLogLevelForRemovedLogger(*configuration, namedLogger->getLevel());
+    configuration.publish();
 }
 
 // static
@@ -511,26 +1139,48 @@ void VLogger::deregisterLogger(const VString& name) {
     }
 }
 
+// static
+void VLogger::threadEnded() {
+    if (gCurrentReader == NULL) {
+        return;
+    }
+
+    VMutexLocker locker(_readersMutexInstance(), "VLogger::threadEnded");
+    gCurrentReader->mOwned = false;
+    gCurrentReader = NULL;
+}
+
 // static
 bool VLogger::isDefaultLogLevelActive(int level) {
-    return VLogger::isLogLevelActive(level) && VLogger::getDefaultLogger()->isEnabledFor(level);
+    return VLogger::isLogLevelActive(level) && _isLoggerActiveForLevel(VLogger::getDefaultLogger(), level);
 }
 
 // static
 bool VLogger::isLogLevelActive(int level) {
-    // No locking necessary to simply read this volatile value.
-    return (level <= gMaxActiveLevel);
+    // No locking necessary to simply read this atomic value.
+    return (level <= gMaxActiveLevel.load(std::memory_order_relaxed));
 }
 
 // static
 VNamedLoggerPtr VLogger::getDefaultLogger() {
-    VMutexLocker locker(_mutexInstance(), "VLogger::getDefaultLogger");
+    /* read scope */ {
+        VLoggerConfigurationReadScope configuration;
+        if (configuration->mDefaultLogger != nullptr) {
+            return configuration->mDefaultLogger;
+        }
+    }
 
-    if (gDefaultLogger == nullptr) {
-        VLogger::_registerLogger(VNamedLoggerPtr(new VNamedLogger("auto-default-logger", VLoggerLevel::INFO, VStringVector())), true);
+    // It doesn't exist yet. Create it, unless another thread beats us to it.
+    VLoggerConfigurationEditor configuration("VLogger::getDefaultLogger");
+
+    if (configuration->mDefaultLogger == nullptr) {
+        VLogger::_registerLogger(*configuration, VNamedLoggerPtr(new VNamedLogger("auto-default-logger", VLoggerLevel::INFO, VStringVector())), true);
+        VNamedLoggerPtr defaultLogger = configuration->mDefaultLogger;
+        configuration.publish();
+        return defaultLogger;
     }
 
-    return gDefaultLogger;
+    return configuration->mDefaultLogger;
 }
 
 #ifdef VLOGGER_INTERNAL_DEBUGGING
@@ -545,10 +1195,11 @@ void VLogger::_reportLoggerChange(bool before, const VString& label, const VName
 
 // static
 void VLogger::setDefaultLogger(VNamedLoggerPtr namedLogger) {
-    VMutexLocker locker(_mutexInstance(), "VLogger::getDefaultLogger");
-    VLogger::_reportLoggerChange(true, "setDefaultLogger", gDefaultLogger, namedLogger);
-    gDefaultLogger = namedLogger;
-    VLogger::_reportLoggerChange(false, "setDefaultLogger", gDefaultLogger, namedLogger);
+    VLoggerConfigurationEditor configuration("VLogger::setDefaultLogger");
+    VLogger::_reportLoggerChange(true, "setDefaultLogger", configuration->mDefaultLogger, namedLogger);
+    configuration->mDefaultLogger = namedLogger;
+    VLogger::_reportLoggerChange(false, "setDefaultLogger", configuration->mDefaultLogger, namedLogger);
+    configuration.publish();
 }
 
 // static
@@ -564,25 +1215,40 @@ VNamedLoggerPtr VLogger::getLogger(const VString& name) {
 
 // static
 VNamedLoggerPtr VLogger::findDefaultLogger() {
-    VMutexLocker locker(_mutexInstance(), "VLogger::findDefaultLogger");
-    return gDefaultLogger;
+    VLoggerConfigurationReadScope configuration;
+    return configuration->mDefaultLogger;
 }
 
 // static
 VNamedLoggerPtr VLogger::findDefaultLoggerForLevel(int level) {
-    VMutexLocker locker(_mutexInstance(), "VLogger::findDefaultLoggerForLevel");
+    /* read scope */ {
+        VLoggerConfigurationReadScope configuration;
+        if (configuration->mDefaultLogger != nullptr) {
+            return _isLoggerActiveForLevel(configuration->mDefaultLogger, level) ? configuration->mDefaultLogger : NULL_NAMED_LOGGER_PTR;
+        }
+    }
+
+    // It doesn't exist yet. Create it, unless another thread beats us to it.
+    VNamedLoggerPtr defaultLogger;
+    /* editor scope */ {
+        VLoggerConfigurationEditor configuration("VLogger::findDefaultLoggerForLevel");
 
-    if (gDefaultLogger == nullptr) {
-        VLogger::_registerLogger(VNamedLoggerPtr(new VNamedLogger("default", VLoggerLevel::INFO, VStringVector())), true);
+        if (configuration->mDefaultLogger == nullptr) {
+            VLogger::_registerLogger(*configuration, VNamedLoggerPtr(new VNamedLogger("default", VLoggerLevel::INFO, VStringVector())), true);
+            defaultLogger = configuration->mDefaultLogger;
+            configuration.publish();
+        } else {
+            defaultLogger = configuration->mDefaultLogger;
+        }
     }
 
-    return gDefaultLogger->isEnabledFor(level) ? gDefaultLogger : NULL_NAMED_LOGGER_PTR;
+    return _isLoggerActiveForLevel(defaultLogger, level) ? defaultLogger : NULL_NAMED_LOGGER_PTR;
 }
 
 // static
 VNamedLoggerPtr VLogger::findNamedLogger(const VString& name) {
-    VMutexLocker locker(_mutexInstance(), "VLogger::findNamedLogger");
-    return VLogger::_findNamedLoggerFromPathName(name);
+    VLoggerConfigurationReadScope configuration;
+    return VLogger::_findNamedLoggerFromPathName(*configuration, name);
 }
 
 // static
@@ -595,7 +1261,7 @@ VNamedLoggerPtr VLogger::findNamedLoggerForLevel(const VString& name, int level)
     VNamedLoggerPtr logger = VLogger::findNamedLogger(name);
 
     // If found but level is too high, return null so it won't log.
-    if ((logger != nullptr) && (logger->getLevel() < level)) {
+    if ((logger != nullptr) && !_isLoggerActiveForLevel(logger, level)) {
         return NULL_NAMED_LOGGER_PTR;
     }
 
@@ -607,6 +1273,11 @@ VNamedLoggerPtr VLogger::findNamedLoggerForLevel(const VString& name, int level)
     return logger;
 }
 
+// static
+VNamedLoggerPtr VLogger::findNamedLoggerForLevel(const VNamedLoggerHandle& handle, int level) {
+    return handle.getLoggerForLevel(level);
+}
+
 #ifdef VLOGGER_INTERNAL_DEBUGGING
 // static
 void VLogger::_reportAppenderChange(bool before, const VString& label, const VLogAppenderPtr& was, const VLogAppenderPtr& is) {
@@ -619,21 +1290,32 @@ void VLogger::_reportAppenderChange(bool before, const VString& label, const VLo
 
 // static
 VLogAppenderPtr VLogger::getDefaultAppender() {
-    VMutexLocker locker(_mutexInstance(), "VLogger::getDefaultAppender");
+    /* read scope */ {
+        VLoggerConfigurationReadScope configuration;
+        if (configuration->mDefaultAppender != nullptr) {
+            return configuration->mDefaultAppender;
+        }
+    }
 
-    if (gDefaultAppender == nullptr) {
-        VLogger::_registerAppender(VLogAppenderPtr(new VCoutLogAppender("auto-default-cout-appender", VLogAppender::DO_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY())), true);
+    // It doesn't exist yet. Create it, unless another thread beats us to it.
+    VLoggerConfigurationEditor configuration("VLogger::getDefaultAppender");
+
+    if (configuration->mDefaultAppender == nullptr) {
+        VLogger::_registerAppender(*configuration, VLogAppenderPtr(new VCoutLogAppender("auto-default-cout-appender", VLogAppender::DO_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY())), true);
+        VLogAppenderPtr defaultAppender = configuration->mDefaultAppender;
+        configuration.publish();
+        return defaultAppender;
     }
 
-    return gDefaultAppender;
+    return configuration->mDefaultAppender;
 }
 
 // static
 VLogAppenderPtr VLogger::getAppender(const VString& appenderName) {
-    /* locker scope */ {
-        VMutexLocker locker(_mutexInstance(), "VLogger::getAppender");
-        VLogAppendersMap::const_iterator pos = _getAppendersMap().find(appenderName);
-        if (pos != _getAppendersMap().end()) {
+    /* read scope */ {
+        VLoggerConfigurationReadScope configuration;
+        VLogAppendersMap::const_iterator pos = configuration->mAppenders.find(appenderName);
+        if (pos != configuration->mAppenders.end()) {
             return pos->second;
         }
     }
@@ -646,14 +1328,14 @@ VLogAppenderPtr VLogger::getAppender(const VString& appenderName) {
 VLogAppenderPtrList VLogger::getAllAppenders() {
     VLogAppenderPtrList result;
 
-    /* locker scope */ {
-        VMutexLocker locker(_mutexInstance(), "VLogger::getAllAppenders");
+    /* read scope */ {
+        VLoggerConfigurationReadScope configuration;
 
-        for (VLogAppendersMap::const_iterator i = _getAppendersMap().begin(); i != _getAppendersMap().end(); ++i) {
+        for (VLogAppendersMap::const_iterator i = configuration->mAppenders.begin(); i != configuration->mAppenders.end(); ++i) {
             result.push_back((*i).second);
         }
 
-        for (VLogAppendersMap::const_iterator i = _getGlobalAppendersMap().begin(); i != _getGlobalAppendersMap().end(); ++i) {
+        for (VLogAppendersMap::const_iterator i = configuration->mGlobalAppenders.begin(); i != configuration->mGlobalAppenders.end(); ++i) {
             result.push_back((*i).second);
         }
     }
@@ -663,14 +1345,15 @@ VLogAppenderPtrList VLogger::getAllAppenders() {
 
 // static
 VLogAppenderPtr VLogger::findDefaultAppender() {
-    VMutexLocker locker(_mutexInstance(), "VLogger::findDefaultAppender");
-    return gDefaultAppender;
+    VLoggerConfigurationReadScope configuration;
+    return configuration->mDefaultAppender;
 }
 
 // static
 VLogAppenderPtr VLogger::findAppender(const VString& name) {
-    VLogAppendersMap::iterator pos = _getAppendersMap().find(name);
-    if (pos != _getAppendersMap().end()) {
+    VLoggerConfigurationReadScope configuration;
+    VLogAppendersMap::const_iterator pos = configuration->mAppenders.find(name);
+    if (pos != configuration->mAppenders.end()) {
         return pos->second;
     }
 
@@ -695,7 +1378,7 @@ VBentoNode* VLogger::_commandGetInfo() {
     VBentoNode* appendersNode = rootNode->addNewChildNode("appenders");
     VBentoNode* loggersNode = rootNode->addNewChildNode("loggers");
 
-    rootNode->addInt("max-active-log-level", gMaxActiveLevel);
+    rootNode->addInt("max-active-log-level", gMaxActiveLevel.load());
 
     const VLogAppenderFactoriesMap& factories = _getAppenderFactoriesMap();
     for (VLogAppenderFactoriesMap::const_iterator i = factories.begin(); i != factories.end(); ++i) {
@@ -703,13 +1386,15 @@ VBentoNode* VLogger::_commandGetInfo() {
         (*i).second->addInfo(*factoryNode);
     }
 
-    const VLogAppendersMap& appenders = _getAppendersMap();
+    const VLoggerConfiguration& configuration = *_getCurrentConfiguration().load();
+
+    const VLogAppendersMap& appenders = configuration.mAppenders;
     for (VLogAppendersMap::const_iterator i = appenders.begin(); i != appenders.end(); ++i) {
         VBentoNode* appenderNode = appendersNode->addNewChildNode("appender");
         (*i).second->addInfo(*appenderNode);
     }
 
-    const VNamedLoggerMap& loggers = _getLoggerMap();
+    const VNamedLoggerMap& loggers = configuration.mLoggers;
     for (VNamedLoggerMap::const_iterator i = loggers.begin(); i != loggers.end(); ++i) {
         VBentoNode* loggerNode = loggersNode->addNewChildNode("logger");
         (*i).second->addInfo(*loggerNode);
@@ -737,10 +1422,10 @@ void VLogger::commandSetLogLevel(const VString& loggerName, int level) {
 
     std::vector<VNamedLoggerPtr> targetLoggers;
 
-    // First, get all the desired loggers, with required locking in place.
-    /* locker scope */ {
-        VMutexLocker locker(_mutexInstance(), "VLogger::commandSetLogLevel()");
-        const VNamedLoggerMap& loggers = _getLoggerMap();
+    // First, get all the desired loggers from the current configuration.
+    /* read scope */ {
+        VLoggerConfigurationReadScope configuration;
+        const VNamedLoggerMap& loggers = configuration->mLoggers;
         for (VNamedLoggerMap::const_iterator i = loggers.begin(); i != loggers.end(); ++i) {
             VNamedLoggerPtr logger = (*i).second;
             if (loggerName.isEmpty() || (logger->getName() == loggerName)) {
@@ -755,10 +1440,27 @@ void VLogger::commandSetLogLevel(const VString& loggerName, int level) {
     }
 }
 
+// static
+void VLogger::commandRollAppender(const VString& appenderName) {
+    std::vector<VRollingFileLogAppender*> targetAppenders;
+    VLogAppenderPtrList appenders = VLogger::getAllAppenders(); // keeps them alive while we roll them outside the lock
+
+    for (VLogAppenderPtrList::const_iterator i = appenders.begin(); i != appenders.end(); ++i) {
+        VRollingFileLogAppender* rollingAppender = dynamic_cast<VRollingFileLogAppender*>((*i).get());
+        if ((rollingAppender != NULL) && (appenderName.isEmpty() || (rollingAppender->getName() == appenderName))) {
+            targetAppenders.push_back(rollingAppender);
+        }
+    }
+
+    for (std::vector<VRollingFileLogAppender*>::const_iterator i = targetAppenders.begin(); i != targetAppenders.end(); ++i) {
+        (*i)->roll();
+    }
+}
+
 // static
 void VLogger::commandSetPrintStackLevel(const VString& loggerName, int printStackLevel, int count, const VDuration& timeLimit) {
-    VMutexLocker locker(_mutexInstance(), "VLogger::commandSetLogLevel()");
-    const VNamedLoggerMap& loggers = _getLoggerMap();
+    VLoggerConfigurationReadScope configuration;
+    const VNamedLoggerMap& loggers = configuration->mLoggers;
     for (VNamedLoggerMap::const_iterator i = loggers.begin(); i != loggers.end(); ++i) {
         VNamedLoggerPtr logger = (*i).second;
         if (loggerName.isEmpty() || (logger->getName() == loggerName)) {
@@ -767,12 +1469,41 @@ void VLogger::commandSetPrintStackLevel(const VString& loggerName, int printStac
     }
 }
 
+// static
+void VLogger::commandSetRateLimit(const VString& loggerName, VDouble messagesPerSecond, int burstSize, VDouble sampleRate, int limitLevel, const VDuration& reportInterval) {
+
+    std::vector<VNamedLoggerPtr> targetLoggers;
+
+    // Like commandSetLogLevel(), collect the loggers first: reconfiguring may emit a report, which logs.
+    /* read scope */ {
+        VLoggerConfigurationReadScope configuration;
+        const VNamedLoggerMap& loggers = configuration->mLoggers;
+        for (VNamedLoggerMap::const_iterator i = loggers.begin(); i != loggers.end(); ++i) {
+            VNamedLoggerPtr logger = (*i).second;
+            if (loggerName.isEmpty() || (logger->getName() == loggerName)) {
+                targetLoggers.push_back(logger);
+            }
+        }
+    }
+
+    for (std::vector<VNamedLoggerPtr>::const_iterator i = targetLoggers.begin(); i != targetLoggers.end(); ++i) {
+        (*i)->setRateLimit(messagesPerSecond, burstSize, sampleRate, limitLevel, reportInterval);
+    }
+}
+
 // static
 void VLogger::emitToGlobalAppenders(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName, bool emitRawLine, const VString& rawLine) {
-    VMutexLocker locker(_mutexInstance(), "VLogger::emitToGlobalAppenders");
-    for (VLogAppendersMap::const_iterator i = _getGlobalAppendersMap().begin(); i != _getGlobalAppendersMap().end(); ++i) {
-        VLogAppenderPtr appender = (*i).second;
-        appender->emit(level, file, line, emitMessage, message, specifiedLoggerName, actualLoggerName, emitRawLine, rawLine);
+    VLoggerConfigurationReadScope configuration;
+    for (VLogAppendersMap::const_iterator i = configuration->mGlobalAppenders.begin(); i != configuration->mGlobalAppenders.end(); ++i) {
+        (*i).second->emit(level, file, line, emitMessage, message, specifiedLoggerName, actualLoggerName, emitRawLine, rawLine);
+    }
+}
+
+// static
+void VLogger::emitDeferredToGlobalAppenders(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName, const VString& actualLoggerName) {
+    VLoggerConfigurationReadScope configuration;
+    for (VLogAppendersMap::const_iterator i = configuration->mGlobalAppenders.begin(); i != configuration->mGlobalAppenders.end(); ++i) {
+        (*i).second->emitDeferred(level, file, line, message, specifiedLoggerName, actualLoggerName);
     }
 }
 
@@ -784,40 +1515,40 @@ VString VLogger::getCleansedLoggerName(const VString& s) {
 }
 
 // static
-void VLogger::_registerAppender(VLogAppenderPtr appender, bool asDefaultAppender, bool asGlobalAppender) {
-    // ASSUMES CALLER HOLDS _mutexInstance().
+void VLogger::_registerAppender(VLoggerConfiguration& configuration, VLogAppenderPtr appender, bool asDefaultAppender, bool asGlobalAppender) {
+    // ASSUMES CALLER HOLDS _mutexInstance() AND WILL PUBLISH THE CONFIGURATION.
 
-    VLogger::_reportAppenderChange(true, "_registerAppender", gDefaultAppender, appender);
+    VLogger::_reportAppenderChange(true, "_registerAppender", configuration.mDefaultAppender, appender);
 
-    if (asDefaultAppender || (gDefaultAppender == nullptr)) {
-        gDefaultAppender = appender;
+    if (asDefaultAppender || (configuration.mDefaultAppender == nullptr)) {
+        configuration.mDefaultAppender = appender;
     }
 
-    _getAppendersMap()[appender->getName()] = appender;
+    configuration.mAppenders[appender->getName()] = appender;
 
     if (asGlobalAppender) {
-        _getGlobalAppendersMap()[appender->getName()] = appender;
+        configuration.mGlobalAppenders[appender->getName()] = appender;
     }
 
-    VLogger::_reportAppenderChange(false, "_registerAppender", gDefaultAppender, appender);
+    VLogger::_reportAppenderChange(false, "_registerAppender", configuration.mDefaultAppender, appender);
 }
 
 
 // static
-void VLogger::_registerLogger(VNamedLoggerPtr namedLogger, bool asDefaultLogger) {
-    // ASSUMES CALLER HOLDS _mutexInstance().
+void VLogger::_registerLogger(VLoggerConfiguration& configuration, VNamedLoggerPtr namedLogger, bool asDefaultLogger) {
+    // ASSUMES CALLER HOLDS _mutexInstance() AND WILL PUBLISH THE CONFIGURATION.
 
-    VLogger::_reportLoggerChange(true, "_registerLogger", gDefaultLogger, namedLogger);
+    VLogger::_reportLoggerChange(true, "_registerLogger", configuration.mDefaultLogger, namedLogger);
 
-    if (asDefaultLogger || (gDefaultLogger == nullptr)) {
-        gDefaultLogger = namedLogger;
+    if (asDefaultLogger || (configuration.mDefaultLogger == nullptr)) {
+        configuration.mDefaultLogger = namedLogger;
     }
 
-    _getLoggerMap()[namedLogger->getName()] = namedLogger;
+    configuration.mLoggers[namedLogger->getName()] = namedLogger;
 
     VLogger::_checkMaxActiveLogLevelForNewLogger(namedLogger->getLevel());
 
-    VLogger::_reportLoggerChange(false, "_registerLogger", gDefaultLogger, namedLogger);
+    VLogger::_reportLoggerChange(false, "_registerLogger", configuration.mDefaultLogger, namedLogger);
 }
 
 // static
@@ -833,27 +1564,27 @@ void VLogger::_checkMaxActiveLogLevelForNewLogger(int newActiveLevel) {
 // static
 void VLogger::checkMaxActiveLogLevelForRemovedLogger(int removedActiveLevel) {
     VMutexLocker locker(_mutexInstance(), "checkMaxActiveLogLevelForRemovedLogger");
-    _checkMaxActiveLogLevelForRemovedLogger(removedActiveLevel);
+    _checkMaxActiveLogLevelForRemovedLogger(*_getCurrentConfiguration().load(), removedActiveLevel);
 }
 
 // static
-void VLogger::_checkMaxActiveLogLevelForRemovedLogger(int removedActiveLevel) {
+void VLogger::_checkMaxActiveLogLevelForRemovedLogger(const VLoggerConfiguration& configuration, int removedActiveLevel) {
     // ASSUMES CALLER HOLDS _mutexInstance().
 
     // If the logger had the highest level, we need to search to find the new max.
     if (removedActiveLevel >= gMaxActiveLevel) {
-        VLogger::_recalculateMaxActiveLogLevel();
+        VLogger::_recalculateMaxActiveLogLevel(configuration);
     }
 }
 
 // static
 void VLogger::checkMaxActiveLogLevelForChangedLogger(int oldActiveLevel, int newActiveLevel) {
     VMutexLocker locker(_mutexInstance(), "checkMaxActiveLogLevelForChangedLogger");
-    _checkMaxActiveLogLevelForChangedLogger(oldActiveLevel, newActiveLevel);
+    _checkMaxActiveLogLevelForChangedLogger(*_getCurrentConfiguration().load(), oldActiveLevel, newActiveLevel);
 }
 
 // static
-void VLogger::_checkMaxActiveLogLevelForChangedLogger(int oldActiveLevel, int newActiveLevel) {
+void VLogger::_checkMaxActiveLogLevelForChangedLogger(const VLoggerConfiguration& configuration, int oldActiveLevel, int newActiveLevel) {
     // ASSUMES CALLER HOLDS _mutexInstance().
 
     // If the logger's new level is higher than current max, then its level is the new max.
@@ -861,17 +1592,18 @@ void VLogger::_checkMaxActiveLogLevelForChangedLogger(int oldActiveLevel, int ne
     if (newActiveLevel > gMaxActiveLevel) {
         gMaxActiveLevel = newActiveLevel;
     } else if ((oldActiveLevel >= gMaxActiveLevel) && (newActiveLevel < gMaxActiveLevel)) {
-        VLogger::_recalculateMaxActiveLogLevel();
+        VLogger::_recalculateMaxActiveLogLevel(configuration);
     }
 }
 
 // static
-void VLogger::_recalculateMaxActiveLogLevel() {
+void VLogger::_recalculateMaxActiveLogLevel(const VLoggerConfiguration& configuration) {
     // ASSUMES CALLER HOLDS _mutexInstance().
 
     // This value is less than previous max. Scan all loggers to see what the new max is.
-    int newMax = 0;
-    for (VNamedLoggerMap::const_iterator i = _getLoggerMap().begin(); i != _getLoggerMap().end(); ++i) {
+    // The flight recorder counts as a logger here, since messages at its level must get as far as a logger to be recorded.
+    int newMax = VLogFlightRecorder::getLevel();
+    for (VNamedLoggerMap::const_iterator i = configuration.mLoggers.begin(); i != configuration.mLoggers.end(); ++i) {
         newMax = V_MAX(newMax, (*i).second->getLevel());
     }
 
@@ -879,9 +1611,9 @@ void VLogger::_recalculateMaxActiveLogLevel() {
 }
 
 // static
-VNamedLoggerPtr VLogger::_findNamedLoggerFromExactName(const VString& name) {
-    VNamedLoggerMap::const_iterator pos = _getLoggerMap().find(name);
-    if (pos == _getLoggerMap().end()) {
+VNamedLoggerPtr VLogger::_findNamedLoggerFromExactName(const VLoggerConfiguration& configuration, const VString& name) {
+    VNamedLoggerMap::const_iterator pos = configuration.mLoggers.find(name);
+    if (pos == configuration.mLoggers.end()) {
         return NULL_NAMED_LOGGER_PTR;
     }
 
@@ -889,11 +1621,11 @@ VNamedLoggerPtr VLogger::_findNamedLoggerFromExactName(const VString& name) {
 }
 
 // static
-VNamedLoggerPtr VLogger::_findNamedLoggerFromPathName(const VString& pathName) {
+VNamedLoggerPtr VLogger::_findNamedLoggerFromPathName(const VLoggerConfiguration& configuration, const VString& pathName) {
     VString nextNameToSearch(pathName);
 
     while (nextNameToSearch.contains('.')) {
-        VNamedLoggerPtr foundLogger = VLogger::_findNamedLoggerFromExactName(nextNameToSearch);
+        VNamedLoggerPtr foundLogger = VLogger::_findNamedLoggerFromExactName(configuration, nextNameToSearch);
         if (foundLogger != nullptr) {
             return foundLogger;
         }
@@ -901,7 +1633,314 @@ VNamedLoggerPtr VLogger::_findNamedLoggerFromPathName(const VString& pathName) {
         nextNameToSearch.substringInPlace(0, nextNameToSearch.lastIndexOf('.'));
     }
 
-    return VLogger::_findNamedLoggerFromExactName(nextNameToSearch);
+    return VLogger::_findNamedLoggerFromExactName(configuration, nextNameToSearch);
+}
+
+// VLogDeferredMessage -------------------------------------------------------
+
+VLogDeferredMessage::VLogDeferredMessage(const char* format)
+    : mFormat(format)
+    , mNumArguments(0)
+    , mOwnedStrings()
+    , mText()
+    , mHasText(false)
+    {
+}
+
+VLogDeferredMessage::VLogDeferredMessage(const VLogDeferredMessage& other)
+    : mFormat(NULL)
+    , mNumArguments(0)
+    , mOwnedStrings()
+    , mText()
+    , mHasText(false)
+    {
+    this->_copyFrom(other);
+}
+
+VLogDeferredMessage& VLogDeferredMessage::operator=(const VLogDeferredMessage& other) {
+    if (this != &other) {
+        this->_copyFrom(other);
+    }
+
+    return *this;
+}
+
+const VString& VLogDeferredMessage::getText() const {
+    if (! mHasText) {
+        mText = VString::EMPTY();
+        this->_format(mText);
+        mHasText = true;
+    }
+
+    return mText;
+}
+
+void VLogDeferredMessage::addArgument(const Argument& argument) {
+    if (mNumArguments == kMaxArguments) {
+        throw VRangeException(VSTRING_FORMAT("VLogDeferredMessage::addArgument: a message holds at most %d values.", kMaxArguments));
+    }
+
+    mArguments[mNumArguments++] = argument;
+    mHasText = false;
+}
+
+void VLogDeferredMessage::_copyFrom(const VLogDeferredMessage& other) {
+    mFormat = other.mFormat;
+    mNumArguments = other.mNumArguments;
+    mText = other.mText;
+    mHasText = other.mHasText;
+
+    // The copied arguments point into mOwnedStrings, so it must not reallocate as we fill it.
+    int numStrings = 0;
+    for (int i = 0; i < mNumArguments; ++i) {
+        if ((other.mArguments[i].mType == kVString) || ((other.mArguments[i].mType == kCString) && (other.mArguments[i].mValue.mCString != NULL))) {
+            ++numStrings;
+        }
+    }
+
+    mOwnedStrings.clear();
+    mOwnedStrings.reserve(numStrings);
+
+    for (int i = 0; i < mNumArguments; ++i) {
+        mArguments[i] = other.mArguments[i];
+        if (mArguments[i].mType == kVString) {
+            mOwnedStrings.push_back(*(mArguments[i].mValue.mVString));
+        } else if ((mArguments[i].mType == kCString) && (mArguments[i].mValue.mCString != NULL)) {
+            mOwnedStrings.push_back(VString(mArguments[i].mValue.mCString));
+        } else {
+            continue;
+        }
+
+        mArguments[i].mType = kVString;
+        mArguments[i].mValue.mVString = &mOwnedStrings.back();
+    }
+}
+
+// Appends length chars to a string without making a temporary string of them.
+static void _appendChars(VString& s, const char* chars, int length) {
+    if (length > 0) {
+        int oldLength = s.length();
+        s.preflight(oldLength + length);
+        ::memcpy(s.buffer() + oldLength, chars, static_cast<VSizeType>(length));
+        s.postflight(oldLength + length);
+    }
+}
+
+// Appends an argument formatted the default way.
+static void _appendDefaultText(VString& s, const VLogDeferredMessage::Argument& argument) {
+    char buffer[64];
+    int length = 0;
+
+    switch (argument.mType) {
+        case VLogDeferredMessage::kSigned:
+            length = ::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(argument.mValue.mSigned));
+            break;
+        case VLogDeferredMessage::kUnsigned:
+            length = ::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(argument.mValue.mUnsigned));
+            break;
+        case VLogDeferredMessage::kDouble:
+            length = ::snprintf(buffer, sizeof(buffer), "%g", argument.mValue.mDouble);
+            break;
+        case VLogDeferredMessage::kBool:
+            s += (argument.mValue.mBool ? "true" : "false");
+            return;
+        case VLogDeferredMessage::kChar:
+            s += argument.mValue.mChar;
+            return;
+        case VLogDeferredMessage::kPointer:
+            length = ::snprintf(buffer, sizeof(buffer), "%p", argument.mValue.mPointer);
+            break;
+        case VLogDeferredMessage::kCString:
+            s += ((argument.mValue.mCString == NULL) ? "(null)" : argument.mValue.mCString);
+            return;
+        case VLogDeferredMessage::kVString:
+            s += *(argument.mValue.mVString);
+            return;
+    }
+
+    _appendChars(s, buffer, V_MIN(length, static_cast<int>(sizeof(buffer)) - 1));
+}
+
+// Appends printf-formatted text, using a stack buffer unless the result is unusually long.
+static void _appendPrintf(VString& s, const char* format, ...) {
+    char buffer[128];
+    va_list args;
+    va_start(args, format);
+    int length = ::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (length < static_cast<int>(sizeof(buffer))) {
+        _appendChars(s, buffer, length);
+    } else {
+        int oldLength = s.length();
+        s.preflight(oldLength + length);
+        va_start(args, format);
+        (void) ::vsnprintf(s.buffer() + oldLength, static_cast<VSizeType>(length + 1), format, args);
+        va_end(args);
+        s.postflight(oldLength + length);
+    }
+}
+
+// Appends an argument formatted per a placeholder's printf conversion, such as "08X" from "{:08X}".
+static void _appendConvertedText(VString& s, const VLogDeferredMessage::Argument& argument, const char* conversion, int conversionLength) {
+    char type = conversion[conversionLength - 1];
+    int flagsLength = conversionLength - 1;
+    if (::strchr("diouxXceEfFgGaAsp", type) == NULL) {
+        type = 's'; // no type letter, e.g. "{:8}", so the whole thing is flags and width for the default text
+        flagsLength = conversionLength;
+    }
+
+    // Build the printf format: '%', the flags, a length modifier for integers, and the type.
+    char format[32];
+    if (flagsLength > static_cast<int>(sizeof(format)) - 5) {
+        _appendDefaultText(s, argument); // no sensible conversion is this long
+        return;
+    }
+
+    // Only flags, width, and precision may precede the type. Anything else, such as '*', a length
+    // modifier, or 'n', would make printf read arguments we don't pass, or write through one.
+    for (int i = 0; i < flagsLength; ++i) {
+        if (::strchr("-+ #0123456789.", conversion[i]) == NULL) {
+            _appendDefaultText(s, argument);
+            return;
+        }
+    }
+
+    format[0] = '%';
+    ::memcpy(format + 1, conversion, static_cast<VSizeType>(flagsLength));
+    char* modifier = format + 1 + flagsLength;
+
+    bool isNumeric = (argument.mType == VLogDeferredMessage::kSigned) || (argument.mType == VLogDeferredMessage::kUnsigned) || (argument.mType == VLogDeferredMessage::kDouble) ||
+                     (argument.mType == VLogDeferredMessage::kBool) || (argument.mType == VLogDeferredMessage::kChar);
+    Vs64 integerValue = 0;
+    VDouble doubleValue = 0.0;
+    switch (argument.mType) {
+        case VLogDeferredMessage::kSigned: integerValue = argument.mValue.mSigned; doubleValue = static_cast<VDouble>(integerValue); break;
+        case VLogDeferredMessage::kUnsigned: integerValue = static_cast<Vs64>(argument.mValue.mUnsigned); doubleValue = static_cast<VDouble>(argument.mValue.mUnsigned); break;
+        case VLogDeferredMessage::kDouble: doubleValue = argument.mValue.mDouble; integerValue = static_cast<Vs64>(doubleValue); break;
+        case VLogDeferredMessage::kBool: integerValue = argument.mValue.mBool ? 1 : 0; doubleValue = static_cast<VDouble>(integerValue); break;
+        case VLogDeferredMessage::kChar: integerValue = argument.mValue.mChar; doubleValue = static_cast<VDouble>(integerValue); break;
+        default: break;
+    }
+
+    if ((type == 'p') && (argument.mType == VLogDeferredMessage::kPointer)) {
+        modifier[0] = 'p'; modifier[1] = 0;
+        _appendPrintf(s, format, argument.mValue.mPointer);
+    } else if (isNumeric && (::strchr("diouxX", type) != NULL)) {
+        modifier[0] = 'l'; modifier[1] = 'l'; modifier[2] = type; modifier[3] = 0;
+        if ((type == 'd') || (type == 'i')) {
+            _appendPrintf(s, format, static_cast<long long>(integerValue));
+        } else {
+            _appendPrintf(s, format, static_cast<unsigned long long>(integerValue));
+        }
+    } else if (isNumeric && (type == 'c')) {
+        modifier[0] = 'c'; modifier[1] = 0;
+        _appendPrintf(s, format, static_cast<int>(integerValue));
+    } else if (isNumeric && (::strchr("eEfFgGaA", type) != NULL)) {
+        modifier[0] = type; modifier[1] = 0;
+        _appendPrintf(s, format, doubleValue);
+    } else {
+        // A string conversion, or one that doesn't suit the argument: pad the default text.
+        VString text;
+        _appendDefaultText(text, argument);
+        modifier[0] = 's'; modifier[1] = 0;
+        _appendPrintf(s, format, text.chars());
+    }
+}
+
+void VLogDeferredMessage::_format(VString& text) const {
+    if (mFormat == NULL) {
+        return;
+    }
+
+    int nextArgument = 0;
+    const char* p = mFormat;
+    while (*p != 0) {
+        // Copy the literal text up to the next brace in one go.
+        const char* brace = ::strpbrk(p, "{}");
+        if (brace == NULL) {
+            text += p;
+            break;
+        }
+
+        _appendChars(text, p, static_cast<int>(brace - p));
+        p = brace;
+
+        if (p[0] == p[1]) { // "{{" or "}}"
+            text += p[0];
+            p += 2;
+            continue;
+        }
+
+        const char* closingBrace = (p[0] == '{') ? ::strchr(p, '}') : NULL;
+        if ((closingBrace == NULL) || (nextArgument == mNumArguments)) {
+            // A stray brace, or a placeholder with no value left for it: leave it as is.
+            const char* end = (closingBrace == NULL) ? (p + 1) : (closingBrace + 1);
+            _appendChars(text, p, static_cast<int>(end - p));
+            p = end;
+            continue;
+        }
+
+        const Argument& argument = mArguments[nextArgument++];
+        if ((p[1] == ':') && (closingBrace > p + 2)) {
+            _appendConvertedText(text, argument, p + 2, static_cast<int>(closingBrace - (p + 2)));
+        } else {
+            _appendDefaultText(text, argument);
+        }
+
+        p = closingBrace + 1;
+    }
+}
+
+// VLogRecord ------------------------------------------------------
+
+VLogRecord::VLogRecord()
+    : mLevel(0)
+    , mFile(NULL)
+    , mLine(0)
+    , mEmitMessage(false)
+    , mMessage()
+    , mMessageIsDeferred(false)
+    , mDeferredMessage("")
+    , mSpecifiedLoggerName()
+    , mActualLoggerName()
+    , mEmitRawLine(false)
+    , mRawLine()
+    , mWhen()
+    , mTrueWhen(mWhen)
+    , mThreadName()
+    {
+}
+
+void VLogRecord::capture(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName, bool emitRawLine, const VString& rawLine) {
+    mLevel = level;
+    mFile = file;
+    mLine = line;
+    mEmitMessage = emitMessage;
+    mMessage = message;
+    mMessageIsDeferred = false;
+    mSpecifiedLoggerName = specifiedLoggerName;
+    mActualLoggerName = actualLoggerName;
+    mEmitRawLine = emitRawLine;
+    mRawLine = rawLine;
+
+    mWhen.setNow();
+    mTrueWhen = mWhen;
+    if ((VInstant::getSimulatedClockOffset() != VDuration::ZERO()) || VInstant::isTimeFrozen()) {
+        mTrueWhen.setTrueNow();
+    }
+
+    try {
+        mThreadName = VThread::getCurrentThreadName();
+    } catch (...) {
+        mThreadName = VString::EMPTY();
+    }
+}
+
+void VLogRecord::captureDeferred(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName, const VString& actualLoggerName) {
+    this->capture(level, file, line, true, VString::EMPTY(), specifiedLoggerName, actualLoggerName, false, VString::EMPTY());
+    mDeferredMessage = message;
+    mMessageIsDeferred = true;
 }
 
 // VLogAppender ------------------------------------------------------
@@ -923,7 +1962,13 @@ VLogAppender::VLogAppender(const VString& name, bool formatOutput, const VString
     , mFormatUsesLocation(mFormatSpec.contains("$location"))
     , mFormatUsesSpecifiedLoggerName(mFormatSpec.contains("$specifiedlogger"))
     , mFormatUsesActualLoggerName(mFormatSpec.contains("$actuallogger"))
+    , mCapturedRecord(NULL)
+    , mFormatElements()
+    , mFormatBuffer()
+    , mLocalTimeStampCache()
+    , mUTCTimeStampCache()
     {
+    VLogAppender::_compileFormatSpec(mFormatSpec, mFormatElements);
 }
 
 VLogAppender::VLogAppender(const VSettingsNode& settings, const VSettingsNode& defaults)
@@ -939,7 +1984,13 @@ VLogAppender::VLogAppender(const VSettingsNode& settings, const VSettingsNode& d
     , mFormatUsesLocation(mFormatSpec.contains("$location"))
     , mFormatUsesSpecifiedLoggerName(mFormatSpec.contains("$specifiedlogger"))
     , mFormatUsesActualLoggerName(mFormatSpec.contains("$actuallogger"))
+    , mCapturedRecord(NULL)
+    , mFormatElements()
+    , mFormatBuffer()
+    , mLocalTimeStampCache()
+    , mUTCTimeStampCache()
     {
+    VLogAppender::_compileFormatSpec(mFormatSpec, mFormatElements);
 }
 
 VLogAppender::~VLogAppender() {
@@ -978,8 +2029,37 @@ void VLogAppender::emitRaw(const VString& message) {
     this->emit(VLoggerLevel::TRACE, NULL, 0, false, VString::EMPTY(), VString::EMPTY(), VString::EMPTY(), true, message);
 }
 
+void VLogAppender::emitRecord(const VLogRecord& record) {
+    VLogAppender::_breakpointLocationForEmit();
+
+    VMutexLocker locker(&mMutex, "emitRecord");
+
+    // While we hold the mutex, _formatMessage() takes the time and thread name from the record.
+    mCapturedRecord = &record;
+
+    try {
+        if (record.mEmitMessage) {
+            this->_emitMessage(record.mLevel, record.mFile, record.mLine, record.getMessage(), record.mSpecifiedLoggerName, record.mActualLoggerName);
+        }
+
+        if (record.mEmitRawLine) {
+            this->_emitRawLine(record.mRawLine);
+        }
+    } catch (...) {
+        mCapturedRecord = NULL;
+        throw;
+    }
+
+    mCapturedRecord = NULL;
+}
+
+void VLogAppender::emitDeferred(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName, const VString& actualLoggerName) {
+    this->emit(level, file, line, true, message.getText(), specifiedLoggerName, actualLoggerName, false, VString::EMPTY());
+}
+
 bool VLogAppender::isDefaultAppender() const {
-    return VLogger::gDefaultAppender.get() == this;
+    VLoggerConfigurationReadScope configuration;
+    return configuration->mDefaultAppender.get() == this;
 }
 
 // static
@@ -992,6 +2072,16 @@ int VLogAppender::_getIntInitSetting(const VString& attributePath, const VSettin
     return settings.getInt(attributePath, defaults.getInt(attributePath, defaultValue));
 }
 
+// static
+Vs64 VLogAppender::_getS64InitSetting(const VString& attributePath, const VSettingsNode& settings, const VSettingsNode& defaults, Vs64 defaultValue) {
+    return settings.getS64(attributePath, defaults.getS64(attributePath, defaultValue));
+}
+
+// static
+VDuration VLogAppender::_getDurationInitSetting(const VString& attributePath, const VSettingsNode& settings, const VSettingsNode& defaults, const VDuration& defaultValue) {
+    return settings.getDuration(attributePath, defaults.getDuration(attributePath, defaultValue));
+}
+
 // static
 VString VLogAppender::_getStringInitSetting(const VString& attributePath, const VSettingsNode& settings, const VSettingsNode& defaults, const VString& defaultValue) {
     return settings.getString(attributePath, defaults.getString(attributePath, defaultValue));
@@ -999,76 +2089,163 @@ VString VLogAppender::_getStringInitSetting(const VString& attributePath, const
 
 void VLogAppender::_emitMessage(int level, const char* file, int line, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName) {
     if (mFormatOutput) {
-        VString formattedMessage = this->_formatMessage(level, file, line, message, specifiedLoggerName, actualLoggerName);
-        this->_emitRawLine(formattedMessage);
+        this->_emitRawLine(this->_formatMessage(level, file, line, message, specifiedLoggerName, actualLoggerName));
     } else {
         this->_emitRawLine(message); // directly, without applying formatting
     }
 }
 
-VString VLogAppender::_formatMessage(int level, const char* file, int line, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName) {
+const VString& VLogAppender::_formatMessage(int level, const char* file, int line, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName) {
     VInstant now;
     VInstant trueNow(now); // copy constructor avoids another call to read the clock
+    if (mCapturedRecord != NULL) {
+        now = mCapturedRecord->mWhen;
+        trueNow = mCapturedRecord->mTrueWhen;
+    }
 
     // If we are running in simulated time, display both the current and simulated time.
     bool prependTrueTime = (mFormatUsesLocalTime || mFormatUsesUTCTime) && ((VInstant::getSimulatedClockOffset() != VDuration::ZERO()) || VInstant::isTimeFrozen());
-    if (prependTrueTime) {
+    if (prependTrueTime && (mCapturedRecord == NULL)) {
         trueNow.setTrueNow();
     }
 
-    VString formattedMessage = mFormatSpec;
-    
-    // I am do replacement in this order (mainly with $message last) to be sure that
-    // none of the replacements put a $ specifier into the string.
-    if (mFormatUsesLocalTime) {
-        VString localTimeStampString;
-        if (prependTrueTime) {
-            localTimeStampString = trueNow.getLocalString(mTimeFormatter) + " ";
+    // We are called with mMutex held, so the buffer and time stamp caches are ours to use.
+    // Emptying the buffer keeps its allocation for the next line.
+    mFormatBuffer = VString::EMPTY();
+
+    for (FormatElementList::const_iterator i = mFormatElements.begin(); i != mFormatElements.end(); ++i) {
+        switch (i->mKind) {
+            case kLiteralText:
+                mFormatBuffer += i->mText;
+                break;
+
+            case kLocalTime:
+                if (prependTrueTime) {
+                    mFormatBuffer += trueNow.getLocalString(mTimeFormatter);
+                    mFormatBuffer += ' ';
+                }
+                mFormatBuffer += this->_getTimeStampString(now, mLocalTimeStampCache, false);
+                break;
+
+            case kUTCTime:
+                if (prependTrueTime) {
+                    mFormatBuffer += trueNow.getUTCString(mTimeFormatter);
+                    mFormatBuffer += ' ';
+                }
+                mFormatBuffer += this->_getTimeStampString(now, mUTCTimeStampCache, true);
+                break;
+
+            case kLevel:
+                mFormatBuffer += VLoggerLevel::getName(level);
+                break;
+
+            case kThread:
+                if (mCapturedRecord != NULL) {
+                    mFormatBuffer += mCapturedRecord->mThreadName;
+                } else {
+                    try {
+                        mFormatBuffer += VThread::getCurrentThreadName();
+                    } catch (...) {
+                    }
+                }
+                break;
+
+            case kLocation:
+                if (file != NULL) {
+                    mFormatBuffer += "@ ";
+                    mFormatBuffer += file;
+                    mFormatBuffer += ':';
+                    mFormatBuffer += line;
+                    mFormatBuffer += ": ";
+                }
+                break;
+
+            case kSpecifiedLoggerName:
+                mFormatBuffer += specifiedLoggerName;
+                break;
+
+            case kActualLoggerName:
+                mFormatBuffer += actualLoggerName;
+                break;
+
+            case kMessage:
+                mFormatBuffer += message;
+                break;
         }
-
-        localTimeStampString += now.getLocalString(mTimeFormatter);
-        formattedMessage.replace("$localtime", localTimeStampString);
     }
 
-    if (mFormatUsesUTCTime) {
-        VString utcTimeStampString;
-        if (prependTrueTime) {
-            utcTimeStampString = trueNow.getUTCString(mTimeFormatter) + " ";
-        }
-        utcTimeStampString += now.getUTCString(mTimeFormatter);
-        formattedMessage.replace("$utctime", utcTimeStampString);
-    }
+    return mFormatBuffer;
+}
 
-    if (mFormatUsesLevel) {
-        formattedMessage.replace("$level", VLoggerLevel::getName(level));
-    }
+// static
+void VLogAppender::_compileFormatSpec(const VString& formatSpec, FormatElementList& elements) {
+    static const struct {
+        const char*         mSpecifier;
+        FormatElementKind   mKind;
+    } kSpecifiers[] = {
+        { "$localtime",         kLocalTime },
+        { "$utctime",           kUTCTime },
+        { "$level",             kLevel },
+        { "$thread",            kThread },
+        { "$location",          kLocation },
+        { "$specifiedlogger",   kSpecifiedLoggerName },
+        { "$actuallogger",      kActualLoggerName },
+        { "$message",           kMessage }
+    };
+    static const size_t kNumSpecifiers = sizeof(kSpecifiers) / sizeof(kSpecifiers[0]);
+
+    elements.clear();
+
+    const char* spec = formatSpec.chars();
+    const char* literalStart = spec;
+    const char* p = spec;
+    while (*p != 0) {
+        size_t specifierIndex = kNumSpecifiers;
+        if (*p == '$') {
+            for (size_t i = 0; i < kNumSpecifiers; ++i) {
+                if (::strncmp(p, kSpecifiers[i].mSpecifier, ::strlen(kSpecifiers[i].mSpecifier)) == 0) {
+                    specifierIndex = i;
+                    break;
+                }
+            }
+        }
 
-    if (mFormatUsesLocation) {
-        if (file == NULL) {
-            formattedMessage.replace("$location", VString::EMPTY());
-        } else {
-            formattedMessage.replace("$location", VSTRING_FORMAT("@ %s:%d: ", file, line));
+        if (specifierIndex == kNumSpecifiers) {
+            ++p; // ordinary text, including a '$' that isn't one of ours
+            continue;
         }
-    }
 
-    if (mFormatUsesThread) {
-        try {
-            formattedMessage.replace("$thread", VThread::getCurrentThreadName());
-        } catch (...) {
+        if (p != literalStart) {
+            FormatElement literal;
+            literal.mKind = kLiteralText;
+            literal.mText.copyFromBuffer(literalStart, 0, static_cast<int>(p - literalStart));
+            elements.push_back(literal);
         }
-    }
 
-    if (mFormatUsesSpecifiedLoggerName) {
-        formattedMessage.replace("$specifiedlogger", specifiedLoggerName);
+        FormatElement element;
+        element.mKind = kSpecifiers[specifierIndex].mKind;
+        elements.push_back(element);
+
+        p += ::strlen(kSpecifiers[specifierIndex].mSpecifier);
+        literalStart = p;
     }
 
-    if (mFormatUsesActualLoggerName) {
-        formattedMessage.replace("$actuallogger", actualLoggerName);
+    if (p != literalStart) {
+        FormatElement literal;
+        literal.mKind = kLiteralText;
+        literal.mText.copyFromBuffer(literalStart, 0, static_cast<int>(p - literalStart));
+        elements.push_back(literal);
     }
+}
 
-    formattedMessage.replace("$message", message);
+const VString& VLogAppender::_getTimeStampString(const VInstant& when, TimeStampCache& cache, bool utc) {
+    if ((! cache.mValid) || (cache.mWhen != when.getValue())) {
+        cache.mString = utc ? when.getUTCString(mTimeFormatter) : when.getLocalString(mTimeFormatter);
+        cache.mWhen = when.getValue();
+        cache.mValid = true;
+    }
 
-    return formattedMessage;
+    return cache.mString;
 }
 
 VString VLogAppender::_toString() const {
@@ -1151,31 +2328,320 @@ void VFileLogAppender::_emitRawLine(const VString& line) {
     mOutputStream.flush();
 }
 
+// VLogFileSeries -------------------------------------------------------------
+
+static const VString LOG_FILE_SERIES_TIME_FORMAT("yMMddHHmmssSSS");
+static const int LOG_FILE_SERIES_TIME_LENGTH = 17; // LOG_FILE_SERIES_TIME_FORMAT with a four-digit year
+
+VLogFileSeries::VLogFileSeries(const VString& name, const VString& dirPath, const VString& fileNamePrefix, const VString& extension)
+    : mDirectory(dirPath)
+    , mFileNamePrefix(fileNamePrefix)
+    , mExtension(extension)
+    , mFileTime(VInstant::INFINITE_PAST())
+    , mRemoveOldFilesPending(false)
+    , mHousekeepingMutex(VSTRING_FORMAT("VLogFileSeries(%s) housekeeping", name.chars()), true/*this mutex itself must not log*/)
+    {
+}
+
+VFSNode VLogFileSeries::nextFileNode() {
+    if (mFileTime != VInstant::INFINITE_PAST()) {
+        mRemoveOldFilesPending = true;
+    }
+
+    mDirectory.mkdirs();
+
+    // Name the file for the current time. The names must sort by age for removeOldFiles(), so if we
+    // rolled over within the same millisecond, or a file by that name exists, use a later time.
+    VInstant fileTime = V_MAX(VInstant(), mFileTime + VDuration::MILLISECOND());
+    VFSNode fileNode;
+    for (;;) {
+        fileNode = VFSNode(mDirectory, VSTRING_FORMAT("%s_%s%s", mFileNamePrefix.chars(), fileTime.getUTCString(VInstantFormatter(LOG_FILE_SERIES_TIME_FORMAT)).chars(), mExtension.chars()));
+        if (! fileNode.exists()) {
+            break;
+        }
+
+        fileTime += VDuration::MILLISECOND();
+    }
+
+    mFileTime = fileTime;
+    return fileNode;
+}
+
+void VLogFileSeries::removeOldFiles(int maxNumFiles) {
+    if (! mRemoveOldFilesPending) {
+        return;
+    }
+
+    VMutexLocker locker(&mHousekeepingMutex, "VLogFileSeries::removeOldFiles");
+
+    if (! mRemoveOldFilesPending.exchange(false)) {
+        return; // another thread did it while we waited
+    }
+
+    if (maxNumFiles <= 0) {
+        return;
+    }
+
+    // Our file names sort by age, and the current file is the newest, so it is never deleted.
+    VStringVector fileNames;
+    try {
+        VStringVector children;
+        mDirectory.list(children);
+        for (VStringVector::const_iterator i = children.begin(); i != children.end(); ++i) {
+            if (this->isSeriesFileName(*i)) {
+                fileNames.push_back(*i);
+            }
+        }
+
+        std::sort(fileNames.begin(), fileNames.end());
+        for (int i = 0; i < ((int) fileNames.size()) - maxNumFiles; ++i) {
+            (void) VFSNode(mDirectory, fileNames[i]).rm();
+        }
+    } catch (...) {} // Failing to delete old files must not prevent logging.
+}
+
+bool VLogFileSeries::isSeriesFileName(const VString& fileName) const {
+    const int timeStart = mFileNamePrefix.length() + 1;
+
+    if ((fileName.length() != timeStart + LOG_FILE_SERIES_TIME_LENGTH + mExtension.length()) ||
+            ! fileName.startsWith(mFileNamePrefix) || (fileName.charAt(timeStart - 1) != '_') || ! fileName.endsWith(mExtension)) {
+        return false;
+    }
+
+    for (int i = timeStart; i < timeStart + LOG_FILE_SERIES_TIME_LENGTH; ++i) {
+        if (! fileName.at(i).isNumeric()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// VRollingFileLogFlushThread -------------------------------------------------
+
+/**
+Writes a VRollingFileLogAppender's buffered output once it has waited for the flush interval,
+even if nothing more is logged to make the appender check.
+*/
+class VRollingFileLogFlushThread : public VThread {
+    public:
+
+        VRollingFileLogFlushThread(VRollingFileLogAppender& appender)
+            : VThread(VSTRING_FORMAT("VRollingFileLogAppender.%s", appender.getName().chars()), "vault.logging.VRollingFileLogAppender", VThread::kDontDeleteSelfAtEnd, VThread::kCreateThreadJoinable, NULL)
+            , mAppender(appender)
+            , mStopMutex("VRollingFileLogFlushThread", true/*this mutex itself must not log*/)
+            , mStopSemaphore()
+            , mStopRequested(false)
+            {}
+        virtual ~VRollingFileLogFlushThread() {}
+
+        virtual void run() {
+            VMutexLocker locker(&mStopMutex, "VRollingFileLogFlushThread::run");
+            while (! mStopRequested) {
+                mStopSemaphore.wait(&mStopMutex, mAppender.mFlushInterval);
+
+                if (! mStopRequested) {
+                    locker.unlock(); // don't hold up requestStop() while we wait for the appender
+                    mAppender._flushIfDue();
+                    locker.lock();
+                }
+            }
+        }
+
+        /**
+        Tells the thread to end, without waiting for it to do so.
+        */
+        void requestStop() {
+            VMutexLocker locker(&mStopMutex, "VRollingFileLogFlushThread::requestStop");
+            mStopRequested = true;
+            mStopSemaphore.signal();
+        }
+
+    private:
+
+        VRollingFileLogFlushThread(const VRollingFileLogFlushThread&); // not copyable
+        VRollingFileLogFlushThread& operator=(const VRollingFileLogFlushThread&); // not assignable
+
+        VRollingFileLogAppender&    mAppender;
+        VMutex                      mStopMutex;         ///< Guards mStopRequested, and is the mutex we wait on.
+        VSemaphore                  mStopSemaphore;     ///< Signaled to wake us early to stop.
+        bool                        mStopRequested;     ///< True once the appender is being destroyed.
+};
+
 // VRollingFileLogAppender ---------------------------------------------------
 
-VRollingFileLogAppender::VRollingFileLogAppender(const VString& name, bool formatOutput, const VString& formatSpec, const VString& timeFormat, const VString& /*dirPath*/, const VString& /*fileNamePrefix*/, int /*maxNumLines*/)
+static const VString ROLLING_FILE_EXTENSION(".log");
+
+VRollingFileLogAppender::VRollingFileLogAppender(const VString& name, bool formatOutput, const VString& formatSpec, const VString& timeFormat, const VString& dirPath, const VString& fileNamePrefix, int maxNumLines,
+        Vs64 maxNumBytes, const VDuration& rollInterval, int maxNumFiles, const VDuration& flushInterval)
     : VLogAppender(name, formatOutput, formatSpec, timeFormat)
+    , mFileSeries(name, dirPath, fileNamePrefix, ROLLING_FILE_EXTENSION)
+    , mMaxNumLines(maxNumLines)
+    , mMaxNumBytes(maxNumBytes)
+    , mRollInterval(rollInterval)
+    , mMaxNumFiles(maxNumFiles)
+    , mFlushInterval(flushInterval)
+    , mFileStream()
+    , mOutputStream(mFileStream)
+    , mNumLines(0)
+    , mNumBytes(0)
+    , mRollTime()
+    , mNextFlushTime()
+    , mFlushNow(false)
+    , mFlushThread(NULL)
     {
+    /* locker scope */ {
+        VMutexLocker locker(&mMutex, "VRollingFileLogAppender::VRollingFileLogAppender");
+        this->_openNewFile();
+    }
+
+    this->_startFlushThread();
 }
 
 VRollingFileLogAppender::VRollingFileLogAppender(const VSettingsNode& settings, const VSettingsNode& defaults)
     : VLogAppender(settings, defaults)
+    , mFileSeries(settings.getString("name"),
+        VLogAppender::_getStringInitSetting("dir", settings, defaults, VLogger::getBaseLogDirectory().getPath()),
+        VLogAppender::_getStringInitSetting("prefix", settings, defaults, settings.getString("name")),
+        ROLLING_FILE_EXTENSION)
+    , mMaxNumLines(VLogAppender::_getIntInitSetting("max-lines", settings, defaults, kDefaultMaxNumLines))
+    , mMaxNumBytes(VLogAppender::_getS64InitSetting("max-bytes", settings, defaults, CONST_S64(0)))
+    , mRollInterval(VLogAppender::_getDurationInitSetting("roll-interval", settings, defaults, VDuration::ZERO()))
+    , mMaxNumFiles(VLogAppender::_getIntInitSetting("max-files", settings, defaults, 0))
+    , mFlushInterval(VLogAppender::_getDurationInitSetting("flush-interval", settings, defaults, VDuration::SECOND()))
+    , mFileStream()
+    , mOutputStream(mFileStream)
+    , mNumLines(0)
+    , mNumBytes(0)
+    , mRollTime()
+    , mNextFlushTime()
+    , mFlushNow(false)
+    , mFlushThread(NULL)
     {
-    /* todo: use these settings properties to construct, something like:
-        mDirPath = VLogAppender::_getStringInitSetting("dir", settings, defaults, VLogger::getBaseLogDirectory().getPath());
-        mPrefix = VLogAppender::_getStringInitSetting("prefix", settings, defaults, settings.getString("name"));
-        mMaxLines = VLogAppender::_getIntInitSetting("max-lines", settings, defaults, 10000);
-    */
+    /* locker scope */ {
+        VMutexLocker locker(&mMutex, "VRollingFileLogAppender::VRollingFileLogAppender");
+        this->_openNewFile();
+    }
+
+    this->_startFlushThread();
+}
+
+VRollingFileLogAppender::~VRollingFileLogAppender() {
+    if (mFlushThread != NULL) {
+        mFlushThread->requestStop();
+        (void) mFlushThread->join();
+        delete mFlushThread;
+    }
+
+    try {
+        mOutputStream.flush();
+        mFileStream.close();
+    } catch (...) {} // Prevent all exceptions from escaping destructor.
 }
 
 void VRollingFileLogAppender::addInfo(VBentoNode& infoNode) const {
     VLogAppender::addInfo(infoNode);
     infoNode.addString("type", "VRollingFileLogAppender");
-    // TODO: current file etc.
+    infoNode.addString("dir", mFileSeries.getDirectory().getPath());
+    infoNode.addString("prefix", mFileSeries.getFileNamePrefix());
+    infoNode.addInt("max-lines", mMaxNumLines);
+    infoNode.addS64("max-bytes", mMaxNumBytes);
+    infoNode.addString("roll-interval", mRollInterval.getDurationString());
+    infoNode.addInt("max-files", mMaxNumFiles);
+    infoNode.addString("flush-interval", mFlushInterval.getDurationString());
+    infoNode.addString("file", mFileStream.getNode().getPath());
+}
+
+void VRollingFileLogAppender::emit(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName, bool emitRawLine, const VString& rawLine) {
+    VLogAppender::emit(level, file, line, emitMessage, message, specifiedLoggerName, actualLoggerName, emitRawLine, rawLine);
+    this->_removeOldFiles();
+}
+
+void VRollingFileLogAppender::emitRecord(const VLogRecord& record) {
+    VLogAppender::emitRecord(record);
+    this->_removeOldFiles();
+}
+
+void VRollingFileLogAppender::roll() {
+    /* locker scope */ {
+        VMutexLocker locker(&mMutex, "VRollingFileLogAppender::roll");
+        this->_openNewFile();
+    }
+
+    this->_removeOldFiles();
+}
+
+void VRollingFileLogAppender::flush() {
+    VMutexLocker locker(&mMutex, "VRollingFileLogAppender::flush");
+    mOutputStream.flush();
+    mNextFlushTime = VInstant() + mFlushInterval;
+}
+
+VString VRollingFileLogAppender::getCurrentFilePath() const {
+    VMutexLocker locker(const_cast<VMutex*>(&mMutex), "VRollingFileLogAppender::getCurrentFilePath");
+    return mFileStream.getNode().getPath();
+}
+
+void VRollingFileLogAppender::_emitMessage(int level, const char* file, int line, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName) {
+    mFlushNow = (level <= VLoggerLevel::ERROR);
+    VLogAppender::_emitMessage(level, file, line, message, specifiedLoggerName, actualLoggerName);
+    mFlushNow = false;
+}
+
+void VRollingFileLogAppender::_emitRawLine(const VString& line) {
+    VInstant now;
+
+    if (((mMaxNumLines > 0) && (mNumLines >= mMaxNumLines)) ||
+        ((mMaxNumBytes > 0) && (mNumBytes >= mMaxNumBytes)) ||
+        ((mRollInterval != VDuration::ZERO()) && (now >= mRollTime))) {
+        this->_openNewFile();
+    }
+
+    mOutputStream.writeLine(line);
+    ++mNumLines;
+    mNumBytes += line.length() + VString::NATIVE_LINE_ENDING().length();
+
+    if (mFlushNow || (now >= mNextFlushTime)) {
+        mOutputStream.flush();
+        mNextFlushTime = now + mFlushInterval;
+    }
+}
+
+void VRollingFileLogAppender::_openNewFile() {
+    if (mFileStream.isOpen()) {
+        mOutputStream.flush();
+        mFileStream.close();
+    }
+
+    mFileStream.setNode(mFileSeries.nextFileNode());
+    mFileStream.openWrite();
+
+    VInstant now;
+    mNumLines = 0;
+    mNumBytes = 0;
+    mRollTime = now + mRollInterval;
+    mNextFlushTime = now + mFlushInterval;
 }
 
-void VRollingFileLogAppender::_emitRawLine(const VString& /*line*/) {
-    // TODO!
+void VRollingFileLogAppender::_removeOldFiles() {
+    mFileSeries.removeOldFiles(mMaxNumFiles);
+}
+
+void VRollingFileLogAppender::_flushIfDue() {
+    VMutexLocker locker(&mMutex, "VRollingFileLogAppender::_flushIfDue");
+
+    VInstant now;
+    if (mFileStream.isOpen() && (now >= mNextFlushTime)) {
+        mOutputStream.flush();
+        mNextFlushTime = now + mFlushInterval;
+    }
+}
+
+void VRollingFileLogAppender::_startFlushThread() {
+    if (mFlushInterval > VDuration::ZERO()) {
+        mFlushThread = new VRollingFileLogFlushThread(*this);
+        mFlushThread->start();
+    }
 }
 
 // VSilentLogAppender ----------------------------------------------------------
@@ -1243,6 +2709,469 @@ void VStringVectorLogAppender::_emitRawLine(const VString& line) {
     mStorage->push_back(line);
 }
 
+// VAsyncLogQueue -------------------------------------------------------------
+
+/**
+The bounded queue between the threads that log to a VAsyncLogAppender and its writer thread.
+Adding and removing records does not take a lock: each slot carries a sequence number that
+says whether it is free for the producer at a given position, or filled for the consumer at
+that position, and the producers claim positions with a compare-and-swap. (This is Dmitry
+Vyukov's bounded MPMC queue; we use it with a single consumer.) The writer thread only takes
+the park mutex when it runs out of records and goes to sleep, and a producer only takes it to
+wake a sleeping writer.
+*/
+class VAsyncLogQueue {
+    public:
+
+        VAsyncLogQueue(int capacity);
+        ~VAsyncLogQueue();
+
+        /**
+        Adds a copy of the record if there is room.
+        @param  record  the record
+        @return true if it was added; false if the queue is full
+        */
+        bool tryPush(const VLogRecord& record);
+        /**
+        Removes the oldest record, if there is one. Called only by the writer thread.
+        @param  record  receives the record
+        @return true if a record was removed
+        */
+        bool tryPop(VLogRecord& record);
+        /**
+        Returns how many records are queued; approximate while other threads are active.
+        @return obvious
+        */
+        int size() const;
+        int getCapacity() const { return (int) (mMask + 1); } ///< Returns the capacity. @return obvious
+
+        /**
+        Called by the writer thread when the queue is empty: sleeps until a record is added, stop is
+        requested, or the interval elapses.
+        @param  maxWait the longest to sleep
+        */
+        void parkWriter(const VDuration& maxWait);
+        /**
+        Wakes the writer thread if it is parked.
+        */
+        void wakeWriter();
+        /**
+        Tells the writer thread to write what remains and end.
+        */
+        void requestStop();
+        bool isStopRequested() const { return mStopRequested; } ///< Returns true once requestStop() has been called. @return obvious
+
+        std::atomic<Vs64>   mNumQueued;             ///< Records added.
+        std::atomic<Vs64>   mNumWritten;            ///< Records removed and emitted by the writer.
+        std::atomic<Vs64>   mNumRemoved;            ///< Records removed by the writer, whether emitted or dropped for lack of a target.
+        std::atomic<Vs64>   mNumDropped;            ///< Records discarded by the overflow policy.
+        std::atomic<Vs64>   mNumBlocked;            ///< Times a producer waited for room.
+        std::atomic<Vs64>   mSampleCounter;         ///< Counts congested messages for kSample.
+        Vs64                mNumDroppedReported;    ///< How much of mNumDropped the writer has reported; writer thread only.
+
+    private:
+
+        VAsyncLogQueue(const VAsyncLogQueue&); // not copyable
+        VAsyncLogQueue& operator=(const VAsyncLogQueue&); // not assignable
+
+        struct Slot {
+            std::atomic<size_t> mSequence;
+            VLogRecord          mRecord;
+        };
+
+        Slot*               mSlots;         ///< The ring of capacity slots.
+        size_t              mMask;          ///< Capacity - 1; the capacity is a power of 2.
+        std::atomic<size_t> mEnqueuePos;    ///< The next position producers will claim.
+        std::atomic<size_t> mDequeuePos;    ///< The next position the writer will take.
+        VMutex              mParkMutex;     ///< Guards parking and waking the writer.
+        VSemaphore          mParkSemaphore; ///< The writer sleeps on this when the queue is empty.
+        std::atomic<bool>   mWriterParked;  ///< True while the writer is parked or about to be.
+        volatile bool       mStopRequested; ///< True once the appender is being destroyed.
+};
+
+VAsyncLogQueue::VAsyncLogQueue(int capacity)
+    : mNumQueued(0)
+    , mNumWritten(0)
+    , mNumRemoved(0)
+    , mNumDropped(0)
+    , mNumBlocked(0)
+    , mSampleCounter(0)
+    , mNumDroppedReported(0)
+    , mSlots(NULL)
+    , mMask(0)
+    , mEnqueuePos(0)
+    , mDequeuePos(0)
+    , mParkMutex("VAsyncLogQueue", true/*this mutex itself must not log*/)
+    , mParkSemaphore()
+    , mWriterParked(false)
+    , mStopRequested(false)
+    {
+    size_t actualCapacity = 2;
+    while (actualCapacity < (size_t) capacity) {
+        actualCapacity <<= 1;
+    }
+
+    mMask = actualCapacity - 1;
+    mSlots = new Slot[actualCapacity];
+    for (size_t i = 0; i < actualCapacity; ++i) {
+        mSlots[i].mSequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+VAsyncLogQueue::~VAsyncLogQueue() {
+    delete [] mSlots;
+}
+
+bool VAsyncLogQueue::tryPush(const VLogRecord& record) {
+    Slot* slot;
+    size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &mSlots[pos & mMask];
+        size_t sequence = slot->mSequence.load(std::memory_order_acquire);
+        Vs64 diff = (Vs64) sequence - (Vs64) pos;
+        if (diff == 0) {
+            if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // full
+        } else {
+            pos = mEnqueuePos.load(std::memory_order_relaxed); // another producer claimed it
+        }
+    }
+
+    slot->mRecord = record;
+    slot->mSequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool VAsyncLogQueue::tryPop(VLogRecord& record) {
+    Slot* slot;
+    size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        slot = &mSlots[pos & mMask];
+        size_t sequence = slot->mSequence.load(std::memory_order_acquire);
+        Vs64 diff = (Vs64) sequence - (Vs64) (pos + 1);
+        if (diff == 0) {
+            if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // empty, or the producer has claimed the slot but not filled it yet
+        } else {
+            pos = mDequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    record = slot->mRecord;
+    slot->mSequence.store(pos + mMask + 1, std::memory_order_release);
+    return true;
+}
+
+int VAsyncLogQueue::size() const {
+    size_t enqueuePos = mEnqueuePos.load(std::memory_order_relaxed);
+    size_t dequeuePos = mDequeuePos.load(std::memory_order_relaxed);
+    return (enqueuePos > dequeuePos) ? (int) (enqueuePos - dequeuePos) : 0;
+}
+
+void VAsyncLogQueue::parkWriter(const VDuration& maxWait) {
+    VMutexLocker locker(&mParkMutex, "VAsyncLogQueue::parkWriter");
+
+    // Announce that we are parking before the final check for records. A producer adds its record
+    // before checking whether we are parked, so one of us is sure to see the other.
+    mWriterParked.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if ((this->size() == 0) && !mStopRequested) {
+        mParkSemaphore.wait(&mParkMutex, maxWait);
+    }
+
+    mWriterParked.store(false);
+}
+
+void VAsyncLogQueue::wakeWriter() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (mWriterParked.load()) {
+        VMutexLocker locker(&mParkMutex, "VAsyncLogQueue::wakeWriter");
+        mParkSemaphore.signal();
+    }
+}
+
+void VAsyncLogQueue::requestStop() {
+    VMutexLocker locker(&mParkMutex, "VAsyncLogQueue::requestStop");
+    mStopRequested = true;
+    mParkSemaphore.signal();
+}
+
+// VAsyncLogWriterThread ------------------------------------------------------
+
+/**
+The thread that drains a VAsyncLogAppender's queue to its target appender.
+*/
+class VAsyncLogWriterThread : public VThread {
+    public:
+
+        VAsyncLogWriterThread(VAsyncLogAppender& appender)
+            : VThread(VSTRING_FORMAT("VAsyncLogAppender.%s", appender.getName().chars()), "vault.logging.VAsyncLogAppender", VThread::kDontDeleteSelfAtEnd, VThread::kCreateThreadJoinable, NULL)
+            , mAppender(appender)
+            {}
+        virtual ~VAsyncLogWriterThread() {}
+
+        virtual void run() {
+            while (! mAppender.mQueue->isStopRequested()) {
+                if (! mAppender._writeQueuedRecords()) {
+                    mAppender.mQueue->parkWriter(VDuration::MILLISECOND() * 100);
+                }
+            }
+
+            // Write what was queued before we were told to stop.
+            (void) mAppender._writeQueuedRecords();
+        }
+
+    private:
+
+        VAsyncLogWriterThread(const VAsyncLogWriterThread&); // not copyable
+        VAsyncLogWriterThread& operator=(const VAsyncLogWriterThread&); // not assignable
+
+        VAsyncLogAppender& mAppender;
+};
+
+// VAsyncLogAppender ----------------------------------------------------------
+
+VAsyncLogAppender::VAsyncLogAppender(const VString& name, VLogAppenderPtr target, int queueSize, OverflowPolicy overflowPolicy, int sampleRate)
+    : VLogAppender(name, DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY())
+    , mTarget(target)
+    , mTargetName(VAsyncLogAppender::_validateTargetName(name, (target == nullptr) ? VString::EMPTY() : target->getName()))
+    , mOverflowPolicy(overflowPolicy)
+    , mSampleRate(V_MAX(1, sampleRate))
+    , mQueue(new VAsyncLogQueue(queueSize))
+    , mWriterThread(NULL)
+    {
+    mWriterThread = new VAsyncLogWriterThread(*this);
+    mWriterThread->start();
+}
+
+VAsyncLogAppender::VAsyncLogAppender(const VSettingsNode& settings, const VSettingsNode& defaults)
+    : VLogAppender(settings, defaults)
+    , mTarget()
+    , mTargetName(VAsyncLogAppender::_validateTargetName(mName, VLogAppender::_getStringInitSetting("appender", settings, defaults, VString::EMPTY())))
+    , mOverflowPolicy(VAsyncLogAppender::overflowPolicyFromString(VLogAppender::_getStringInitSetting("overflow", settings, defaults, "drop")))
+    , mSampleRate(V_MAX(1, VLogAppender::_getIntInitSetting("sample-rate", settings, defaults, kDefaultSampleRate)))
+    , mQueue(new VAsyncLogQueue(VLogAppender::_getIntInitSetting("queue-size", settings, defaults, kDefaultQueueSize)))
+    , mWriterThread(NULL)
+    {
+    mWriterThread = new VAsyncLogWriterThread(*this);
+    mWriterThread->start();
+}
+
+VAsyncLogAppender::~VAsyncLogAppender() {
+    mQueue->requestStop();
+    (void) mWriterThread->join();
+
+    delete mWriterThread;
+    delete mQueue;
+}
+
+void VAsyncLogAppender::addInfo(VBentoNode& infoNode) const {
+    VLogAppender::addInfo(infoNode);
+    infoNode.addString("type", "VAsyncLogAppender");
+    infoNode.addString("appender", mTargetName);
+    infoNode.addString("overflow", VAsyncLogAppender::overflowPolicyToString(mOverflowPolicy));
+    infoNode.addInt("queue-size", mQueue->getCapacity());
+    infoNode.addInt("queue-depth", mQueue->size());
+    infoNode.addS64("num-queued", this->getNumQueued());
+    infoNode.addS64("num-written", this->getNumWritten());
+    infoNode.addS64("num-dropped", this->getNumDropped());
+    infoNode.addS64("num-blocked", this->getNumBlocked());
+}
+
+void VAsyncLogAppender::emit(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName, bool emitRawLine, const VString& rawLine) {
+    // The writer thread can't wait on its own queue, so anything it logs goes straight out.
+    if (VThread::threadSelf() == mWriterThread->threadID()) {
+        VLogAppenderPtr target = this->_getTarget();
+        if (target != nullptr) {
+            target->emit(level, file, line, emitMessage, message, specifiedLoggerName, actualLoggerName, emitRawLine, rawLine);
+        }
+
+        return;
+    }
+
+    VLogRecord record;
+    record.capture(level, file, line, emitMessage, message, specifiedLoggerName, actualLoggerName, emitRawLine, rawLine);
+    this->_enqueue(record);
+}
+
+void VAsyncLogAppender::emitDeferred(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName, const VString& actualLoggerName) {
+    if (VThread::threadSelf() == mWriterThread->threadID()) {
+        VLogAppenderPtr target = this->_getTarget();
+        if (target != nullptr) {
+            target->emitDeferred(level, file, line, message, specifiedLoggerName, actualLoggerName);
+        }
+
+        return;
+    }
+
+    // The message is formatted on the writer thread, when the target emits the record.
+    VLogRecord record;
+    record.captureDeferred(level, file, line, message, specifiedLoggerName, actualLoggerName);
+    this->_enqueue(record);
+}
+
+void VAsyncLogAppender::emitRecord(const VLogRecord& record) {
+    if (VThread::threadSelf() == mWriterThread->threadID()) {
+        VLogAppenderPtr target = this->_getTarget();
+        if (target != nullptr) {
+            target->emitRecord(record);
+        }
+
+        return;
+    }
+
+    this->_enqueue(record);
+}
+
+bool VAsyncLogAppender::flush(const VDuration& timeout) {
+    Vs64 numQueued = mQueue->mNumQueued.load();
+    VDeadline deadline(timeout);
+    while (mQueue->mNumRemoved.load() < numQueued) {
+        if (deadline.hasExpired()) {
+            return false;
+        }
+
+        mQueue->wakeWriter();
+        VThread::sleep(VDuration::MILLISECOND());
+    }
+
+    return true;
+}
+
+int VAsyncLogAppender::getQueueSize() const {
+    return mQueue->getCapacity();
+}
+
+Vs64 VAsyncLogAppender::getNumQueued() const {
+    return mQueue->mNumQueued.load();
+}
+
+Vs64 VAsyncLogAppender::getNumWritten() const {
+    return mQueue->mNumWritten.load();
+}
+
+Vs64 VAsyncLogAppender::getNumDropped() const {
+    return mQueue->mNumDropped.load();
+}
+
+Vs64 VAsyncLogAppender::getNumBlocked() const {
+    return mQueue->mNumBlocked.load();
+}
+
+// static
+VAsyncLogAppender::OverflowPolicy VAsyncLogAppender::overflowPolicyFromString(const VString& value) {
+    if (value.equalsIgnoreCase("block")) {
+        return kBlock;
+    } else if (value.equalsIgnoreCase("drop")) {
+        return kDrop;
+    } else if (value.equalsIgnoreCase("sample")) {
+        return kSample;
+    }
+
+    throw VRangeException(VSTRING_FORMAT("VAsyncLogAppender: invalid overflow policy '%s'; must be block, drop, or sample.", value.chars()));
+}
+
+// static
+VString VAsyncLogAppender::overflowPolicyToString(OverflowPolicy policy) {
+    switch (policy) {
+        case kBlock: return "block";
+        case kSample: return "sample";
+        default: return "drop";
+    }
+}
+
+void VAsyncLogAppender::_enqueue(const VLogRecord& record) {
+    // Under kSample, thin out the messages once the queue is three-quarters full.
+    if ((mOverflowPolicy == kSample) && (mQueue->size() >= (mQueue->getCapacity() / 4) * 3)) {
+        if ((mQueue->mSampleCounter.fetch_add(1) % mSampleRate) != 0) {
+            ++(mQueue->mNumDropped);
+            return;
+        }
+    }
+
+    if (! mQueue->tryPush(record)) {
+        if (mOverflowPolicy != kBlock) {
+            ++(mQueue->mNumDropped);
+            return;
+        }
+
+        ++(mQueue->mNumBlocked);
+        int numAttempts = 0;
+        do {
+            mQueue->wakeWriter();
+            if (++numAttempts < 10) {
+                VThread::yield();
+            } else {
+                VThread::sleep(VDuration::MILLISECOND());
+            }
+        } while (! mQueue->tryPush(record));
+    }
+
+    ++(mQueue->mNumQueued);
+    mQueue->wakeWriter();
+}
+
+bool VAsyncLogAppender::_writeQueuedRecords() {
+    VLogAppenderPtr target = this->_getTarget();
+
+    bool wroteAny = false;
+    VLogRecord record;
+    while (mQueue->tryPop(record)) {
+        if (target == nullptr) {
+            ++(mQueue->mNumDropped); // We are our own target (as the default appender); there is nowhere to write it.
+        } else {
+            try {
+                target->emitRecord(record);
+            } catch (...) {} // There is nowhere to report a failure to write a log message.
+
+            ++(mQueue->mNumWritten);
+        }
+
+        ++(mQueue->mNumRemoved);
+        wroteAny = true;
+    }
+
+    Vs64 numDropped = mQueue->mNumDropped.load();
+    if ((numDropped > mQueue->mNumDroppedReported) && (target != nullptr)) {
+        VString message(VSTRING_ARGS("VAsyncLogAppender '%s' dropped " VSTRING_FORMATTER_S64 " log messages because its queue was full or it had no target.", mName.chars(), numDropped - mQueue->mNumDroppedReported));
+        mQueue->mNumDroppedReported = numDropped;
+
+        try {
+            target->emit(VLoggerLevel::WARN, NULL, 0, true, message, VString::EMPTY(), mName, false, VString::EMPTY());
+        } catch (...) {}
+    }
+
+    return wroteAny;
+}
+
+VLogAppenderPtr VAsyncLogAppender::_getTarget() {
+    if (mTarget == nullptr) {
+        VLogAppenderPtr target = VLogger::findAppender(mTargetName);
+        if (target == nullptr) {
+            return VLogger::findDefaultAppender().get() == this ? VLogAppenderPtr() : VLogger::getDefaultAppender();
+        }
+
+        mTarget = target;
+    }
+
+    return (mTarget.get() == this) ? VLogAppenderPtr() : mTarget;
+}
+
+// static
+const VString& VAsyncLogAppender::_validateTargetName(const VString& appenderName, const VString& targetName) {
+    if (targetName.isNotEmpty() && (targetName == appenderName)) {
+        throw VRangeException(VSTRING_FORMAT("VAsyncLogAppender '%s' cannot use itself as its target appender.", appenderName.chars()));
+    }
+
+    return targetName;
+}
+
 // VStringLogger -------------------------------------------------------------
 
 VStringLogger::VStringLogger(const VString& name, int level, bool formatOutput, const VString& formatSpec, const VString& timeFormat)
@@ -1260,6 +3189,10 @@ void VStringLogger::_emitToAppenders(int level, const char* file, int line, bool
     mAppender.emit(level, file, line, emitMessage, message, specifiedLoggerName, this->getName(), emitRawLine, rawLine);
 }
 
+void VStringLogger::_emitDeferredToAppenders(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName) {
+    mAppender.emitDeferred(level, file, line, message, specifiedLoggerName, this->getName());
+}
+
 // VStringVectorLogger -------------------------------------------------------------
 
 VStringVectorLogger::VStringVectorLogger(const VString& name, int level, /*@Nullable*/VStringVector* storage, bool formatOutput, const VString& formatSpec, const VString& timeFormat)
@@ -1277,6 +3210,10 @@ void VStringVectorLogger::_emitToAppenders(int level, const char* file, int line
     mAppender.emit(level, file, line, emitMessage, message, specifiedLoggerName, this->getName(), emitRawLine, rawLine);
 }
 
+void VStringVectorLogger::_emitDeferredToAppenders(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName) {
+    mAppender.emitDeferred(level, file, line, message, specifiedLoggerName, this->getName());
+}
+
 // VLoggerRepetitionFilter ---------------------------------------------------
 
 VLoggerRepetitionFilter::VLoggerRepetitionFilter()
@@ -1468,3 +3405,120 @@ bool VLoggerPrintStackConfig::shouldPrintStack(int level, VNamedLogger& logger)
     return printStack;
 }
 
+// VLoggerRateLimiter ---------------------------------------------------------
+
+VLoggerRateLimiter::VLoggerRateLimiter()
+    : mEnabled(false)
+    , mMessagesPerSecond(0.0)
+    , mBurstSize(0.0)
+    , mSampleRate(1.0)
+    , mLevel(VLoggerLevel::ERROR)
+    , mReportInterval(VDuration::MINUTE())
+    , mTokens(0.0)
+    , mLastRefillTime()
+    , mRandomState(0)
+    , mNumOverRate(0)
+    , mNumNotSampled(0)
+    , mTotalDropped(0)
+    , mReportTime(VInstant::INFINITE_FUTURE())
+    {
+}
+
+void VLoggerRateLimiter::configure(VNamedLogger& logger, VDouble messagesPerSecond, int burstSize, VDouble sampleRate, int limitLevel, const VDuration& reportInterval) {
+    if ((mNumOverRate + mNumNotSampled) > 0) {
+        this->_emitReport(logger);
+    }
+
+    mMessagesPerSecond = V_MAX(0.0, messagesPerSecond);
+    mBurstSize = (burstSize > 0) ? static_cast<VDouble>(burstSize) : V_MAX(1.0, ::ceil(mMessagesPerSecond));
+    mSampleRate = V_MAX(0.0, V_MIN(1.0, sampleRate));
+    mLevel = limitLevel;
+    mReportInterval = reportInterval;
+    mTokens = mBurstSize;
+    mLastRefillTime.setNow();
+    mTotalDropped = 0;
+    mReportTime = VInstant::INFINITE_FUTURE();
+
+    // Any non-zero seed will do for the xorshift generator; this one differs between loggers and runs.
+    mRandomState = static_cast<Vu64>(mLastRefillTime.getValue()) ^ static_cast<Vu64>(reinterpret_cast<size_t>(this)) ^ CONST_U64(0x9E3779B97F4A7C15);
+    if (mRandomState == 0) {
+        mRandomState = 1;
+    }
+
+    mEnabled = (mMessagesPerSecond > 0.0) || (mSampleRate < 1.0);
+}
+
+bool VLoggerRateLimiter::checkMessage(VNamedLogger& logger, int level) {
+    if (!mEnabled) {
+        return true;
+    }
+
+    VInstant now;
+    if (now >= mReportTime) {
+        this->_emitReport(logger);
+    }
+
+    if (level < mLevel) {
+        return true;
+    }
+
+    bool pass = true;
+    if ((mSampleRate < 1.0) && !this->_sample()) {
+        ++mNumNotSampled;
+        pass = false;
+    } else if (mMessagesPerSecond > 0.0) {
+        // Replenish the bucket for the time since the last message. If the clock went backward, just start over from now.
+        Vs64 elapsedMilliseconds = (now - mLastRefillTime).getDurationMilliseconds();
+        if (elapsedMilliseconds > 0) {
+            mTokens = V_MIN(mBurstSize, mTokens + (mMessagesPerSecond * static_cast<VDouble>(elapsedMilliseconds) / 1000.0));
+        }
+
+        mLastRefillTime = now;
+
+        if (mTokens >= 1.0) {
+            mTokens -= 1.0;
+        } else {
+            ++mNumOverRate;
+            pass = false;
+        }
+    }
+
+    if (!pass) {
+        ++mTotalDropped;
+        if (mReportTime == VInstant::INFINITE_FUTURE()) {
+            mReportTime = now + mReportInterval;
+        }
+    }
+
+    return pass;
+}
+
+void VLoggerRateLimiter::addInfo(VBentoNode& infoNode) const {
+    infoNode.addBool("rate-limit-enabled", mEnabled);
+    if (mEnabled) {
+        infoNode.addDouble("rate-limit", mMessagesPerSecond);
+        infoNode.addDouble("rate-limit-burst", mBurstSize);
+        infoNode.addDouble("sample-rate", mSampleRate);
+        infoNode.addInt("rate-limit-level", mLevel);
+        infoNode.addS64("rate-limit-dropped", mTotalDropped);
+    }
+}
+
+void VLoggerRateLimiter::_emitReport(VNamedLogger& logger) {
+    VString report(VSTRING_ARGS("Rate limiting dropped " VSTRING_FORMATTER_S64 " messages (" VSTRING_FORMATTER_S64 " over the rate limit, " VSTRING_FORMATTER_S64 " not sampled).",
+        mNumOverRate + mNumNotSampled, mNumOverRate, mNumNotSampled));
+    logger._emitToAppenders(VLoggerLevel::WARN, NULL, 0, true, report, VString::EMPTY(), false, VString::EMPTY());
+
+    mNumOverRate = 0;
+    mNumNotSampled = 0;
+    mReportTime = VInstant::INFINITE_FUTURE();
+}
+
+bool VLoggerRateLimiter::_sample() {
+    // xorshift64*: plenty random enough for sampling, and cheap.
+    mRandomState ^= mRandomState >> 12;
+    mRandomState ^= mRandomState << 25;
+    mRandomState ^= mRandomState >> 27;
+    Vu64 value = mRandomState * CONST_U64(2685821657736338717);
+    return (static_cast<VDouble>(value >> 11) / 9007199254740992.0) < mSampleRate; // top 53 bits as a fraction in [0, 1)
+}
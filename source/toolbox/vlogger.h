@@ -16,6 +16,8 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vbufferedfilestream.h"
 #include "vtextiostream.h"
 
+#include <atomic>
+
 // Microsoft steals this symbol name globally. Take it back.
 #ifdef VPLATFORM_WIN
     #undef ERROR
@@ -83,6 +85,22 @@ class VBentoNode;
     value to be used in subsequent logging), you can simply call VLOGGER_WOULD_LOG(level) or
     VLOGGER_NAMED_WOULD_LOG(name, level) in advance.
 
+    The VLOGGER_NAMED macros check the named logger's own level before evaluating the message, so
+    turning on DEBUG for one logger doesn't cause every other logger's DEBUG messages to be built.
+    That check does mean finding the logger for the name, though; code that logs often under a
+    particular name should keep a VNamedLoggerHandle rather than a VString so that this is cheap.
+
+    Each macro also has a form ending in _FMT that takes a format string with {} placeholders and
+    the values to substitute, instead of a finished message string:
+
+    <pre>
+        VLOGGER_NAMED_DEBUG_FMT(mLoggerName, "Session {} sent {} bytes.", sessionName, numBytes);
+    </pre>
+
+    The values are captured without being converted to text, and the text is only produced when an
+    appender writes the message; an appender that writes on another thread does it on that thread.
+    See VLogDeferredMessage for the placeholder syntax.
+
     If a specified named logger is not found, the system emits to another logger. In the simple case,
     this just means using the default logger. However, you can set up a naming hierarchy where logger
     names use a "dot.separated.naming.convention", because the fallback search is done by repeatedly
@@ -194,6 +212,27 @@ class VBentoNode;
       long stack tracing will continue to emit once triggered. It is another way of preventing runaway
       repeated stack tracing.
 
+    A logger can also be configured to drop messages during a flood, so that the appenders can keep up
+    (see VLoggerRateLimiter). These settings are specified on the logger:
+    - "rate-limit" (double)
+      Defaults to 0, meaning no limit. If positive, the number of messages per second the logger emits
+      over time; messages beyond that are dropped.
+    - "rate-limit-burst" (int)
+      Defaults to the rate limit, rounded up. The number of messages that may be emitted at once after
+      the logger has been quiet for a while.
+    - "sample-rate" (double)
+      Defaults to 1.0, meaning no sampling. If less than 1.0, the fraction of messages to emit, chosen
+      at random; for example, 0.01 to emit one in a hundred.
+    - "rate-limit-level" (int)
+      Defaults to 20 (VLoggerLevel::ERROR). Messages more severe than this level are never dropped.
+    - "rate-limit-report-interval" (duration string such as "30s")
+      Defaults to one minute. How often the logger reports how many messages it has dropped.
+
+    A logger can also limit the size of its hex dumps (see VNamedLogger::logHexDump()):
+    - "hex-dump-max-bytes" (int)
+      Defaults to 0, meaning no limit. If positive, the most bytes of a buffer that a hex dump shows;
+      a final line says how many more there were.
+
     <h1>Custom Appenders</h1>
 
     Call VLogger::registerLogAppenderFactory() to make your custom appender available to the system.
@@ -238,9 +277,215 @@ class VBentoNode;
 #define VLOGGER_NAMED_HEXDUMP(loggername, level, message, buffer, length) do { if (!VLogger::isLogLevelActive(level)) break; VNamedLoggerPtr nl = VLogger::findNamedLoggerForLevel(loggername, level); if (nl != nullptr) nl->logHexDump(level, message, loggername, buffer, length); } while (false)
 #define VLOGGER_NAMED_WOULD_LOG(loggername, level) (VLogger::isLogLevelActive(level) && (VLogger::findNamedLoggerForLevel(loggername, level) != nullptr))
 
+// These macros take a format string with {} placeholders, followed by the values to substitute, rather than a message string.
+// The values are only evaluated if the message will be logged, and are only formatted when an appender writes the message.
+#define VLOGGER_LEVEL_FMT(level, ...) do { if (!VLogger::isDefaultLogLevelActive(level)) break; VLogger::getDefaultLogger()->log(level, NULL, 0, VLogDeferredMessage(__VA_ARGS__), VString::EMPTY()); } while (false)
+#define VLOGGER_LEVEL_FILELINE_FMT(level, file, line, ...) do { if (!VLogger::isDefaultLogLevelActive(level)) break; VLogger::getDefaultLogger()->log(level, file, line, VLogDeferredMessage(__VA_ARGS__), VString::EMPTY()); } while (false)
+#define VLOGGER_FATAL_FMT(...) VLOGGER_LEVEL_FILELINE_FMT(VLoggerLevel::FATAL, __FILE__, __LINE__, __VA_ARGS__)
+#define VLOGGER_ERROR_FMT(...) VLOGGER_LEVEL_FILELINE_FMT(VLoggerLevel::ERROR, __FILE__, __LINE__, __VA_ARGS__)
+#define VLOGGER_WARN_FMT(...) VLOGGER_LEVEL_FMT(VLoggerLevel::WARN, __VA_ARGS__)
+#define VLOGGER_INFO_FMT(...) VLOGGER_LEVEL_FMT(VLoggerLevel::INFO, __VA_ARGS__)
+#define VLOGGER_DEBUG_FMT(...) VLOGGER_LEVEL_FMT(VLoggerLevel::DEBUG, __VA_ARGS__)
+#define VLOGGER_TRACE_FMT(...) VLOGGER_LEVEL_FMT(VLoggerLevel::TRACE, __VA_ARGS__)
+
+#define VLOGGER_NAMED_LEVEL_FMT(loggername, level, ...) do { if (!VLogger::isLogLevelActive(level)) break; VNamedLoggerPtr nl = VLogger::findNamedLoggerForLevel(loggername, level); if (nl != nullptr) nl->log(level, NULL, 0, VLogDeferredMessage(__VA_ARGS__), loggername); } while (false)
+#define VLOGGER_NAMED_LEVEL_FILELINE_FMT(loggername, level, file, line, ...) do { if (!VLogger::isLogLevelActive(level)) break; VNamedLoggerPtr nl = VLogger::findNamedLoggerForLevel(loggername, level); if (nl != nullptr) nl->log(level, file, line, VLogDeferredMessage(__VA_ARGS__), loggername); } while (false)
+#define VLOGGER_NAMED_FATAL_FMT(loggername, ...) VLOGGER_NAMED_LEVEL_FILELINE_FMT(loggername, VLoggerLevel::FATAL, __FILE__, __LINE__, __VA_ARGS__)
+#define VLOGGER_NAMED_ERROR_FMT(loggername, ...) VLOGGER_NAMED_LEVEL_FILELINE_FMT(loggername, VLoggerLevel::ERROR, __FILE__, __LINE__, __VA_ARGS__)
+#define VLOGGER_NAMED_WARN_FMT(loggername, ...) VLOGGER_NAMED_LEVEL_FMT(loggername, VLoggerLevel::WARN, __VA_ARGS__)
+#define VLOGGER_NAMED_INFO_FMT(loggername, ...) VLOGGER_NAMED_LEVEL_FMT(loggername, VLoggerLevel::INFO, __VA_ARGS__)
+#define VLOGGER_NAMED_DEBUG_FMT(loggername, ...) VLOGGER_NAMED_LEVEL_FMT(loggername, VLoggerLevel::DEBUG, __VA_ARGS__)
+#define VLOGGER_NAMED_TRACE_FMT(loggername, ...) VLOGGER_NAMED_LEVEL_FMT(loggername, VLoggerLevel::TRACE, __VA_ARGS__)
+
 #define VLOGGER_APPENDER_EMIT(appender, level, message) do { (appender).emit(level, (level <= VLoggerLevel::ERROR) ? __FILE__ : NULL, (level <= VLoggerLevel::ERROR) ? __LINE__ : 0, true, message, VString::EMPTY(), VString::EMPTY(), false, VString::EMPTY()); } while (false)
 #define VLOGGER_APPENDER_EMIT_FILELINE(appender, level, message, file, line) do { (appender).emit(level, file, line, true, message, VString::EMPTY(), VString::EMPTY(), false, VString::EMPTY()); } while (false)
 
+/**
+VLogDeferredMessage is a log message that has not been formatted yet: a format string and the
+values to substitute into it. Creating one just copies the values, without converting any of them
+to text; the text is produced by getText() when an appender needs it. The VLOGGER_xxx_FMT macros
+create one only once the level checks have passed.
+
+The format string uses {} placeholders, which are replaced by the arguments in order. A placeholder
+may hold a printf conversion after a colon, such as {:08X}, {:.3f}, or {:-20s}; a conversion without
+a type letter, such as {:8}, pads the normal text. Use {{ and }} for literal braces. By default,
+integers are formatted in decimal, floating point values as %g, bools as true or false, chars as
+the character, and other pointers as their address.
+
+Arguments may be integers, floating point values, bools, chars, C strings, VStrings, and pointers.
+Strings are referenced, not copied, so a message depends on its caller's strings until it is
+copied; a copy holds copies of them, so it can be kept and formatted later, on another thread.
+The format string itself is never copied, and must be a string literal or otherwise outlive every
+copy of the message.
+*/
+class VLogDeferredMessage {
+    public:
+
+        static const int kMaxArguments = 10; ///< The most values a message can hold.
+
+        /**
+        The kinds of value an argument holds.
+        */
+        enum ArgumentType {
+            kSigned,    ///< A signed integer, held as a Vs64.
+            kUnsigned,  ///< An unsigned integer, held as a Vu64.
+            kDouble,    ///< A floating point value.
+            kBool,      ///< A bool.
+            kChar,      ///< A char.
+            kPointer,   ///< A pointer other than a string.
+            kCString,   ///< A C string, which may be NULL.
+            kVString    ///< A VString.
+        };
+
+        /**
+        One captured value.
+        */
+        struct Argument {
+            ArgumentType mType;
+            union {
+                Vs64            mSigned;
+                Vu64            mUnsigned;
+                VDouble         mDouble;
+                bool            mBool;
+                char            mChar;
+                const void*     mPointer;
+                const char*     mCString;
+                const VString*  mVString;
+            } mValue;
+        };
+
+        /**
+        Constructs a message with no values to substitute.
+        @param  format  the format string, which must outlive the message
+        */
+        explicit VLogDeferredMessage(const char* format);
+        /**
+        Constructs a message, capturing the values to substitute.
+        @param  format  the format string, which must outlive the message
+        @param  args    the values; strings must outlive the message, though not its copies
+        */
+        template <typename... ARGS>
+        explicit VLogDeferredMessage(const char* format, const ARGS&... args)
+            : mFormat(format)
+            , mNumArguments(0)
+            , mOwnedStrings()
+            , mText()
+            , mHasText(false)
+            {
+            static_assert(sizeof...(ARGS) <= kMaxArguments, "VLogDeferredMessage supports at most kMaxArguments values.");
+            this->_addArguments(args...);
+        }
+        VLogDeferredMessage(const VLogDeferredMessage& other);
+        ~VLogDeferredMessage() {}
+        VLogDeferredMessage& operator=(const VLogDeferredMessage& other);
+
+        const char* getFormat() const { return mFormat; }                                   ///< Returns the format string. @return obvious
+        int getNumArguments() const { return mNumArguments; }                               ///< Returns the number of values. @return obvious
+        const Argument& getArgument(int index) const { return mArguments[index]; }          ///< Returns one of the values. @param index 0 to getNumArguments()-1 @return obvious
+        /**
+        Returns the formatted text. It is formatted on the first call and kept for later ones.
+        A message is not meant to be shared between threads; copy it instead.
+        @return the text
+        */
+        const VString& getText() const;
+        /**
+        Adds a value, as when rebuilding a message that was recorded elsewhere, such as by
+        VBinaryLogDecoder. As with the constructor, a string value must outlive the message.
+        Throws a VRangeException if the message already holds kMaxArguments values.
+        @param  argument    the value
+        */
+        void addArgument(const Argument& argument);
+
+    private:
+
+        void _addArguments() {}
+        template <typename T, typename... REST>
+        void _addArguments(const T& first, const REST&... rest) { this->_addArgument(first); this->_addArguments(rest...); }
+
+        void _addArgument(signed char value) { this->_addSigned(value); }
+        void _addArgument(short value) { this->_addSigned(value); }
+        void _addArgument(int value) { this->_addSigned(value); }
+        void _addArgument(long value) { this->_addSigned(value); }
+        void _addArgument(long long value) { this->_addSigned(value); }
+        void _addArgument(unsigned char value) { this->_addUnsigned(value); }
+        void _addArgument(unsigned short value) { this->_addUnsigned(value); }
+        void _addArgument(unsigned int value) { this->_addUnsigned(value); }
+        void _addArgument(unsigned long value) { this->_addUnsigned(value); }
+        void _addArgument(unsigned long long value) { this->_addUnsigned(value); }
+        void _addArgument(float value) { Argument& a = mArguments[mNumArguments++]; a.mType = kDouble; a.mValue.mDouble = value; }
+        void _addArgument(double value) { Argument& a = mArguments[mNumArguments++]; a.mType = kDouble; a.mValue.mDouble = value; }
+        void _addArgument(bool value) { Argument& a = mArguments[mNumArguments++]; a.mType = kBool; a.mValue.mBool = value; }
+        void _addArgument(char value) { Argument& a = mArguments[mNumArguments++]; a.mType = kChar; a.mValue.mChar = value; }
+        void _addArgument(const char* value) { Argument& a = mArguments[mNumArguments++]; a.mType = kCString; a.mValue.mCString = value; }
+        void _addArgument(const VString& value) { Argument& a = mArguments[mNumArguments++]; a.mType = kVString; a.mValue.mVString = &value; }
+        template <typename T>
+        void _addArgument(const T* value) { Argument& a = mArguments[mNumArguments++]; a.mType = kPointer; a.mValue.mPointer = value; }
+        void _addSigned(Vs64 value) { Argument& a = mArguments[mNumArguments++]; a.mType = kSigned; a.mValue.mSigned = value; }
+        void _addUnsigned(Vu64 value) { Argument& a = mArguments[mNumArguments++]; a.mType = kUnsigned; a.mValue.mUnsigned = value; }
+
+        /**
+        Copies another message's format and values, taking copies of its strings.
+        @param  other   the message to copy
+        */
+        void _copyFrom(const VLogDeferredMessage& other);
+        /**
+        Formats the message.
+        @param  text    the string to append the text to
+        */
+        void _format(VString& text) const;
+
+        const char*             mFormat;                    ///< The format string; not owned.
+        int                     mNumArguments;              ///< How many of mArguments are in use.
+        Argument                mArguments[kMaxArguments];  ///< The values.
+        std::vector<VString>    mOwnedStrings;              ///< In a copy, the strings that string arguments point to.
+        mutable VString         mText;                      ///< The formatted text, once getText() has been called.
+        mutable bool            mHasText;                   ///< True once mText has been formatted.
+};
+
+/**
+VLogRecord holds one log emission captured for later output, typically on another
+thread: the arguments to VLogAppender::emit(), plus the time and thread name, which an
+appender would otherwise take at the moment it formats the message.
+@see VAsyncLogAppender
+*/
+class VLogRecord {
+    public:
+
+        VLogRecord();
+        ~VLogRecord() {}
+
+        /**
+        Fills in the record from the arguments to VLogAppender::emit(), and captures the
+        current time and thread name.
+        */
+        void capture(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName, bool emitRawLine, const VString& rawLine);
+        /**
+        Fills in the record from the arguments to VLogAppender::emitDeferred(), and captures the
+        current time and thread name. The message is copied, not formatted.
+        */
+        void captureDeferred(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName, const VString& actualLoggerName);
+        /**
+        Returns the message to be emitted, formatting a deferred message if necessary.
+        @return the message
+        */
+        const VString& getMessage() const { return mMessageIsDeferred ? mDeferredMessage.getText() : mMessage; }
+
+        int         mLevel;                 ///< The level at which the message was logged.
+        const char* mFile;                  ///< The __FILE__ value, or NULL; a string literal, so it remains valid.
+        int         mLine;                  ///< The __LINE__ value, or 0.
+        bool        mEmitMessage;           ///< True if mMessage is to be emitted.
+        VString     mMessage;               ///< The message to be formatted and emitted, unless it is deferred.
+        bool        mMessageIsDeferred;     ///< True if the message is mDeferredMessage rather than mMessage.
+        VLogDeferredMessage mDeferredMessage; ///< The message, if it is deferred; not yet formatted.
+        VString     mSpecifiedLoggerName;   ///< The logger name supplied by the original caller, or empty.
+        VString     mActualLoggerName;      ///< The name of the logger that emitted the message, or empty.
+        bool        mEmitRawLine;           ///< True if mRawLine is to be emitted.
+        VString     mRawLine;               ///< The raw line to be emitted as is.
+        VInstant    mWhen;                  ///< When the message was logged (simulated or frozen time, if in effect).
+        VInstant    mTrueWhen;              ///< When the message was logged, in true time.
+        VString     mThreadName;            ///< The name of the thread that logged the message.
+};
+
 /**
 VLogAppender is an abstract base class that defines the API for writing output to a destination.
 */
@@ -303,6 +548,24 @@ class VLogAppender {
         @param  message     the message to be emitted in raw form
         */
         void emitRaw(const VString& message);
+        /**
+        Emits a record that was captured earlier, possibly on another thread. The output is the same as
+        if emit() had been called with the record's values at the time and on the thread it was captured.
+        A subclass that overrides emit() rather than the protected methods should override this too.
+        @param  record  the captured record
+        */
+        virtual void emitRecord(const VLogRecord& record);
+        /**
+        Emits a message that has not been formatted yet. The base class formats it and calls emit().
+        An appender that can do better, for example by formatting later on another thread, overrides this.
+        @param  level       the level at which the message is being logged, and has already been filtered
+        @param  file        if not null, the __FILE__ value indicating the source file that emitted the message
+        @param  line        if not 0, the __LINE__ value indicating the line number in the source file that emitted the message
+        @param  message     the message; an override that keeps it beyond the call must copy it
+        @param  specifiedLoggerName if not empty, the logger name supplied by the original caller
+        @param  actualLoggerName if not empty, the name of the logger that is actually calling us
+        */
+        virtual void emitDeferred(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName, const VString& actualLoggerName);
 
         /**
         For diagnostic purposes, adds the properties/state of this appender to the supplied Bento node.
@@ -337,9 +600,10 @@ class VLogAppender {
         @param  message     the message to format
         @param  specifiedLoggerName if not empty, the logger name supplied by the original caller
         @param  actualLoggerName if not empty, the name of the logger that is actually calling us
-        @return the formatted message string
+        @return the formatted message string, which the base class builds in mFormatBuffer; it is
+                valid only until the next call, and so only while mMutex is held
         */
-        virtual VString _formatMessage(int level, const char* file, int line, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName);
+        virtual const VString& _formatMessage(int level, const char* file, int line, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName);
         /**
         This is the method that most concrete appenders must implement in order to write a message
         (whether it is in raw form or has already been formatted) to the output medium.
@@ -354,6 +618,8 @@ class VLogAppender {
         static bool _getBooleanInitSetting(const VString& attributePath, const VSettingsNode& settings, const VSettingsNode& defaults, bool defaultValue);
         static int _getIntInitSetting(const VString& attributePath, const VSettingsNode& settings, const VSettingsNode& defaults, int defaultValue);
         static VString _getStringInitSetting(const VString& attributePath, const VSettingsNode& settings, const VSettingsNode& defaults, const VString& defaultValue);
+        static Vs64 _getS64InitSetting(const VString& attributePath, const VSettingsNode& settings, const VSettingsNode& defaults, Vs64 defaultValue);
+        static VDuration _getDurationInitSetting(const VString& attributePath, const VSettingsNode& settings, const VSettingsNode& defaults, const VDuration& defaultValue);
 
         VMutex              mMutex;          ///< A mutex to protect against multiple threads' messages from being intertwined;
                                                 // subclasses may access this carefully; note that it is locked prior to any
@@ -377,6 +643,61 @@ class VLogAppender {
 
     private:
 
+        /**
+        The format spec is compiled at construction into a list of elements, so that formatting a
+        message is a series of appends rather than a search-and-replace for each $ specifier.
+        */
+        enum FormatElementKind {
+            kLiteralText,           ///< Text copied as is.
+            kLocalTime,             ///< $localtime
+            kUTCTime,               ///< $utctime
+            kLevel,                 ///< $level
+            kThread,                ///< $thread
+            kLocation,              ///< $location
+            kSpecifiedLoggerName,   ///< $specifiedlogger
+            kActualLoggerName,      ///< $actuallogger
+            kMessage                ///< $message
+        };
+
+        struct FormatElement {
+            FormatElementKind   mKind;
+            VString             mText;  ///< For kLiteralText, the text.
+        };
+
+        typedef std::vector<FormatElement> FormatElementList;
+
+        /**
+        The most recently formatted time stamp. Many lines are logged within the same millisecond,
+        so this saves running the time formatter for each of them.
+        */
+        struct TimeStampCache {
+            TimeStampCache() : mValid(false), mWhen(0), mString() {}
+            bool    mValid;     ///< False until the first time stamp is formatted.
+            Vs64    mWhen;      ///< The VInstant value that mString shows.
+            VString mString;    ///< The formatted time stamp.
+        };
+
+        /**
+        Breaks a format spec into elements.
+        @param  formatSpec  the format spec
+        @param  elements    the list to fill in
+        */
+        static void _compileFormatSpec(const VString& formatSpec, FormatElementList& elements);
+        /**
+        Returns a formatted time stamp, reusing the cached one if it is for the same instant. Assumes mMutex is held.
+        @param  when    the time to format
+        @param  cache   the cache for local or UTC time
+        @param  utc     true to format as UTC, false for local time
+        @return the formatted time stamp
+        */
+        const VString& _getTimeStampString(const VInstant& when, TimeStampCache& cache, bool utc);
+
+        const VLogRecord* mCapturedRecord; ///< While emitRecord() holds mMutex, the record whose time and thread name _formatMessage() uses.
+        FormatElementList mFormatElements; ///< mFormatSpec, compiled.
+        VString           mFormatBuffer;   ///< _formatMessage() builds lines here under mMutex, so the buffer's capacity is reused from line to line.
+        TimeStampCache    mLocalTimeStampCache; ///< The last $localtime value.
+        TimeStampCache    mUTCTimeStampCache;   ///< The last $utctime value.
+
         VString _toString() const; ///< For diagnostics, returns a string representation of this appender and its name.
 
         static void _breakpointLocationForEmit(); ///< A convenient place to set a debugger breakpoint for any appender emitting output.
@@ -494,6 +815,65 @@ class VLoggerPrintStackConfig {
         VInstant    mExpiration;    ///< Internal instant for when the configured duration expires and we turn back to OFF
 };
 
+/**
+VLoggerRateLimiter keeps a flood of log messages from overwhelming a logger's appenders. Unlike
+VLoggerRepetitionFilter, it doesn't care whether the messages are alike. It can limit the rate with
+a token bucket: each message uses up a token, tokens are replenished at the configured rate up to
+the burst size, and a message that finds no token is dropped. It can also sample, passing each
+message with a configured probability. Messages more severe than the limit level are never dropped.
+A message is dropped before it is formatted, if it was logged with a _FMT macro.
+
+How many messages were dropped is reported by a WARN message to the logger's appenders, once the
+report interval has passed since the first of them was dropped; the report is made when the logger
+is next asked to log something. See how VNamedLogger::mRateLimiter is used.
+*/
+class VLoggerRateLimiter {
+    public:
+
+        VLoggerRateLimiter();
+        ~VLoggerRateLimiter() {}
+
+        bool isEnabled() const { return mEnabled; } ///< Returns true if the limiter is dropping any messages. @return obvious
+        /**
+        Changes the limits, first reporting any messages dropped under the old ones. The limiter is
+        disabled if there is neither a rate limit nor sampling.
+        @param  logger              the logger to which the report is emitted
+        @param  messagesPerSecond   the steady rate of messages allowed; 0 for no rate limit
+        @param  burstSize           how many messages may be logged at once after a quiet period; 0 to use the rate
+        @param  sampleRate          the fraction of messages to pass, from 0.0 to 1.0; 1.0 for no sampling
+        @param  limitLevel          the most severe level that is limited; more severe messages always pass
+        @param  reportInterval      how often to report the number of messages dropped
+        */
+        void configure(VNamedLogger& logger, VDouble messagesPerSecond, int burstSize, VDouble sampleRate, int limitLevel, const VDuration& reportInterval);
+        /**
+        Decides whether a message may be emitted, and reports dropped messages if it's time.
+        @param  logger  the logger to which any report is emitted
+        @param  level   the level of the message
+        @return true if the caller should proceed to emit the message, false if it is dropped
+        */
+        bool checkMessage(VNamedLogger& logger, int level);
+        void addInfo(VBentoNode& infoNode) const; ///< Adds the limits and counts to a logger's diagnostic info.
+
+    private:
+
+        void _emitReport(VNamedLogger& logger); ///< Emits the number of messages dropped, and resets the counts.
+        bool _sample(); ///< Returns true with probability mSampleRate.
+
+        bool        mEnabled;               ///< True if either limit is in effect.
+        VDouble     mMessagesPerSecond;     ///< The rate at which tokens are replenished; 0 for no rate limit.
+        VDouble     mBurstSize;             ///< The most tokens the bucket holds.
+        VDouble     mSampleRate;            ///< The probability of passing a message; 1.0 for no sampling.
+        int         mLevel;                 ///< Messages at this level and less severe are limited.
+        VDuration   mReportInterval;        ///< How often dropped messages are reported.
+        VDouble     mTokens;                ///< The tokens in the bucket; a message needs 1.
+        VInstant    mLastRefillTime;        ///< When tokens were last added to the bucket.
+        Vu64        mRandomState;           ///< State of the sampling random number generator.
+        Vs64        mNumOverRate;           ///< Messages dropped by the rate limit since the last report.
+        Vs64        mNumNotSampled;         ///< Messages dropped by sampling since the last report.
+        Vs64        mTotalDropped;          ///< Messages dropped since the limiter was configured.
+        VInstant    mReportTime;            ///< When to report the messages dropped since the last report.
+};
+
 /**
 VNamedLogger defines an object to which log output is initially sent. A logger has a name (that is used
 to locate it and direct output to it) and a level (which the logger uses to filter what it receives).
@@ -556,7 +936,20 @@ class VNamedLogger : public VEnableSharedFromThis<VNamedLogger> {
         */
         void log(int level, const VString& message);
         /**
-        Logs a hex dump of the specified data (subject to filtering).
+        Logs a message that has not been formatted yet (subject to filtering). Usually called via the
+        VLOGGER_xxx_FMT macros. The message is formatted only if and when an appender needs the text;
+        if repetition filtering is enabled, that is immediately, since the filter compares messages.
+        @param  level   the level of the message
+        @param  file    the source file name where the message was logged (from __FILE__ symbol)
+        @param  line    the line in the source file where the message was logged (from __LINE__ symbol)
+        @param  message the message to be logged
+        @param  specifiedLoggerName if not empty, the logger name supplied by caller
+        */
+        void log(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName = VString::EMPTY());
+        /**
+        Logs a hex dump of the specified data (subject to filtering). The dump is emitted to the
+        appenders as raw lines, a chunk at a time as it is generated, so dumping a large buffer
+        doesn't require memory for the whole dump. See setHexDumpMaxBytes().
         @param  level               the level of the message
         @param  message             the message to be logged as the line of output preceding the hex data
         @param  specifiedLoggerName if not empty, the logger name supplied by caller
@@ -592,6 +985,22 @@ class VNamedLogger : public VEnableSharedFromThis<VNamedLogger> {
         */
         void setPrintStackInfo(int printStackLevel, int maxNumOccurrences, const VDuration& timeLimit) { mPrintStackConfig.configure(printStackLevel, maxNumOccurrences, timeLimit); }
         /**
+        Configures rate limiting and sampling for this logger (see VLoggerRateLimiter). Passing a
+        messagesPerSecond of 0 and a sampleRate of 1.0 turns both off.
+        @param  messagesPerSecond   the steady rate of messages allowed; 0 for no rate limit
+        @param  burstSize           how many messages may be logged at once after a quiet period; 0 to use the rate
+        @param  sampleRate          the fraction of messages to pass, from 0.0 to 1.0; 1.0 for no sampling
+        @param  limitLevel          the most severe level that is limited; more severe messages always pass
+        @param  reportInterval      how often to report the number of messages dropped
+        */
+        void setRateLimit(VDouble messagesPerSecond, int burstSize, VDouble sampleRate, int limitLevel, const VDuration& reportInterval);
+        /**
+        Limits how much of a buffer logHexDump() dumps; the rest is summarized in a final line.
+        @param  maxNumBytes the most bytes to dump; 0 for no limit
+        */
+        void setHexDumpMaxBytes(Vs64 maxNumBytes) { mHexDumpMaxBytes = maxNumBytes; }
+        Vs64 getHexDumpMaxBytes() const { return mHexDumpMaxBytes; } ///< Returns the most bytes logHexDump() dumps, or 0 for no limit. @return obvious
+        /**
         Returns true if this logger is currently the default logger.
         @return obvious
         */
@@ -619,9 +1028,20 @@ class VNamedLogger : public VEnableSharedFromThis<VNamedLogger> {
         @param  rawLine     the raw line to be emitted if emitRawLine is true (the appenders should not format the raw line)
         */
         virtual void _emitToAppenders(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, bool emitRawLine, const VString& rawLine);
+        /**
+        Emits a message that has not been formatted yet to all appenders appropriate to this logger.
+        @param  level       the level of the message
+        @param  file        the source file name where the message was logged (from __FILE__ symbol)
+        @param  line        the line in the source file where the message was logged (from __LINE__ symbol)
+        @param  message     the message to be emitted
+        @param  specifiedLoggerName if not empty, the logger name supplied by caller
+        */
+        virtual void _emitDeferredToAppenders(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName);
 
     private:
 
+        bool _checkRateLimit(int level); ///< Returns true if the rate limiter lets a message through.
+        void _logText(int level, const char* file, int line, const VString& message, const VString& specifiedLoggerName); ///< Emits a message that has passed the level and rate limit checks, subject to repetition filtering.
         VString _toString() const; ///< For diagnostics, returns a string representation of this appender and its name.
 
         static void _breakpointLocationForLog(); ///< A convenient place to set a debugger breakpoint for any appender emitting output.
@@ -633,14 +1053,66 @@ class VNamedLogger : public VEnableSharedFromThis<VNamedLogger> {
         VLogAppenderPtr         mSpecificAppender;  ///< If not null, a specific appender instance we emit to.
         VLoggerRepetitionFilter mRepetitionFilter;  ///< Used to prevent repetitive info from clogging output.
         VLoggerPrintStackConfig mPrintStackConfig;  ///< Settings that control whether we add a stack trace for log messages at certain levels.
+        VLoggerRateLimiter      mRateLimiter;       ///< Used to keep a flood of messages from overwhelming the appenders.
+        Vs64                    mHexDumpMaxBytes;   ///< The most bytes logHexDump() dumps; 0 for no limit.
 
         friend class VLoggerRepetitionFilter; // it can call our _emitToAppenders when we call it from our log() function
         friend class VLoggerPrintStackConfig; // ditto
+        friend class VLoggerRateLimiter; // ditto
+        friend class VNamedLoggerHexDump; // ditto, from our logHexDump function
 };
 
 typedef VSharedPtr<VNamedLogger> VNamedLoggerPtr;
 typedef VSharedPtr<const VNamedLogger> VNamedLoggerConstPtr;
 
+class VNamedLoggerHandleState;
+class VLoggerConfiguration;
+
+/**
+VNamedLoggerHandle is a logger name that remembers which logger it resolves to. Looking up a
+name with VLogger::findNamedLoggerForLevel() searches up the dotted path every time; a handle
+does that once, and thereafter, until the set of registered loggers changes, finding its logger
+is a pointer read. Code that logs repeatedly to a
+computed name, such as a per-session name, should keep a handle rather than a VString.
+
+The VLOGGER_NAMED macros accept a handle wherever they accept a name. A handle may be used by
+several threads at once.
+*/
+class VNamedLoggerHandle {
+    public:
+
+        /**
+        Constructs a handle for a logger name. The name is resolved when the handle is first used.
+        @param  name    the logger name, which may be a dotted path
+        */
+        VNamedLoggerHandle(const VString& name);
+        VNamedLoggerHandle(const VNamedLoggerHandle& other);
+        ~VNamedLoggerHandle();
+        VNamedLoggerHandle& operator=(const VNamedLoggerHandle& other);
+
+        const VString& getName() const { return mName; } ///< Returns the logger name. @return obvious
+        operator const VString&() const { return mName; } ///< Lets a handle be passed where a logger name is expected. @return the name
+
+        /**
+        Returns the logger the name resolves to: the registered logger with the longest matching
+        path, or the default logger if there is none.
+        @return a logger (@ NotNull)
+        */
+        VNamedLoggerPtr getLogger() const;
+        /**
+        Returns the logger the name resolves to, if it is active for the specified level; null otherwise.
+        This is the handle equivalent of VLogger::findNamedLoggerForLevel().
+        @param  level   the level to check
+        @return a logger (@ Nullable)
+        */
+        VNamedLoggerPtr getLoggerForLevel(int level) const;
+
+    private:
+
+        VString                     mName;  ///< The logger name.
+        VNamedLoggerHandleState*    mState; ///< The current resolution; defined in vlogger.cpp.
+};
+
 /**
 The abstract base class is what you implement to allow an appender class to be
 dynamically instantiated from settings, typically during a call to configure() at startup.
@@ -714,6 +1186,11 @@ class VLoggerLevel {
 The VLogger class provides the static APIs for configuring the logging system, adding, removing, and
 finding appenders and loggers, etc. This is the primary outward facing class for logging beyond the
 use of the macros that generate output.
+
+The registered loggers and appenders are published as an immutable configuration. Finding a logger
+or appender, which every log statement does, reads the current configuration without locking;
+registering, removing, or replacing a default copies the configuration, changes the copy, and
+publishes it in place of the old one, which is deleted once no thread is still reading it.
 */
 class VLogger {
     public:
@@ -746,6 +1223,7 @@ class VLogger {
           - Typically they also have an "appender" string property that defines the appender to use.
           - For multiple appenders, the logger node can have child nodes named "appender" that have
             a "name" string property.
+        - An optional child node named "flight-recorder" configuring VLogFlightRecorder.
         @param  baseLogDirectory    the directory structure where file-based appenders should write (see description above)
         @param  loggingSettings     the settings to process
         */
@@ -756,6 +1234,12 @@ class VLogger {
         logging objects.
         */
         static void shutdown();
+        /**
+        Releases the current thread's slot for reading the logger configuration, so that a thread
+        started later can reuse it. VThread calls this when a thread ends; the thread must not log
+        afterward, or it will take a slot again.
+        */
+        static void threadEnded();
 
         /**
         Instantiates and registers an appender from settings, via the already-registered factory for the
@@ -904,6 +1388,14 @@ class VLogger {
         @return a logger (@ Nullable)
         */
         static VNamedLoggerPtr findNamedLoggerForLevel(const VString& name, int level);
+        /**
+        Returns the logger a handle resolves to, if it is active for the specified level; null otherwise.
+        This overload is what the VLOGGER_NAMED macros call when given a handle instead of a name.
+        @param  handle  the handle
+        @param  level   the level to check as active for the found logger
+        @return a logger (@ Nullable)
+        */
+        static VNamedLoggerPtr findNamedLoggerForLevel(const VNamedLoggerHandle& handle, int level);
 
         // Appenders:
         /**
@@ -955,9 +1447,12 @@ class VLogger {
         static void commandRemoveLoggerAppenders(const VString& loggerName, const VStringVector& appenderNames);        ///< Calls through to removeAppender() for the specified logger.
         static void commandSetLogLevel(const VString& loggerName, int level);                                           ///< Calls through to setLevel for the specified (or all, if loggerName is empty) loggers.
         static void commandSetPrintStackLevel(const VString& loggerName, int printStackLevel, int count, const VDuration& timeLimit); ///< Calls through to setPrintStackInfo() for the specified (or all, if loggerName is empty) loggers.
+        static void commandSetRateLimit(const VString& loggerName, VDouble messagesPerSecond, int burstSize, VDouble sampleRate, int limitLevel, const VDuration& reportInterval); ///< Calls through to setRateLimit() for the specified (or all, if loggerName is empty) loggers.
 
         // Used specifically by VNamedLogger::_emitToAppenders to emit to all "global appenders" with correct locking. Should not be called elsewhere.
         static void emitToGlobalAppenders(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName, bool emitRawLine, const VString& rawLine);
+        // Likewise, used by VNamedLogger::_emitDeferredToAppenders.
+        static void emitDeferredToGlobalAppenders(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName, const VString& actualLoggerName);
         
         // Utility function useful in forming a logger name; returns a copy of the input string with dots (our path separators) converted to dashes.
         static VString getCleansedLoggerName(const VString& s);
@@ -967,31 +1462,32 @@ class VLogger {
         VLogger(const VLogger&); // not copyable
         VLogger& operator=(const VLogger&); // not assignable
 
-        // These helper methods, like private methods in general, assume the caller has locked.
-        static void _registerAppender(VLogAppenderPtr appender, bool asDefaultAppender = false, bool asGlobalAppender = false);
-        static void _registerLogger(VNamedLoggerPtr namedLogger, bool asDefaultLogger = false);
+        // These helper methods, like private methods in general, assume the caller has locked. The
+        // _register methods modify a configuration that the caller will publish.
+        static void _registerAppender(VLoggerConfiguration& configuration, VLogAppenderPtr appender, bool asDefaultAppender = false, bool asGlobalAppender = false);
+        static void _registerLogger(VLoggerConfiguration& configuration, VNamedLoggerPtr namedLogger, bool asDefaultLogger = false);
         static VBentoNode* _commandGetInfo();
         static VString _commandGetInfoString();
 
         // These methods maintain the gMaxActiveLogLevel.
         static void _checkMaxActiveLogLevelForNewLogger(int newActiveLevel); // Called when a new logger is created, since that may change the max active log level.
-        static void _checkMaxActiveLogLevelForRemovedLogger(int removedActiveLevel); // Called when a logger is removed, since that may change the max active log level.
-        static void _checkMaxActiveLogLevelForChangedLogger(int oldActiveLevel, int newActiveLevel); // Called when a logger's level is changed, since that may change the max active log level.
-        static void _recalculateMaxActiveLogLevel(); // Called when one of the _check... methods decides the max active log level may indeed have changed, and must be recalculated.
+        static void _checkMaxActiveLogLevelForRemovedLogger(const VLoggerConfiguration& configuration, int removedActiveLevel); // Called when a logger is removed, since that may change the max active log level.
+        static void _checkMaxActiveLogLevelForChangedLogger(const VLoggerConfiguration& configuration, int oldActiveLevel, int newActiveLevel); // Called when a logger's level is changed, since that may change the max active log level.
+        static void _recalculateMaxActiveLogLevel(const VLoggerConfiguration& configuration); // Called when one of the _check... methods decides the max active log level may indeed have changed, and must be recalculated.
 
         // These two methods are how we really search for a specified named logger.
-        static VNamedLoggerPtr _findNamedLoggerFromExactName(const VString& name);      ///< Return the logger with the specified name, or null if it doesn't exist. (@ Nullable)
-        static VNamedLoggerPtr _findNamedLoggerFromPathName(const VString& pathName);   ///< Return a logger using a dot-separated path name, falling back to an exact name find. (@ Nullable)
+        static VNamedLoggerPtr _findNamedLoggerFromExactName(const VLoggerConfiguration& configuration, const VString& name);      ///< Return the logger with the specified name, or null if it doesn't exist. (@ Nullable)
+        static VNamedLoggerPtr _findNamedLoggerFromPathName(const VLoggerConfiguration& configuration, const VString& pathName);   ///< Return a logger using a dot-separated path name, falling back to an exact name find. (@ Nullable)
 
-        // _mutexInstance() must be used internally whenever referencing these variables:
-        volatile static int     gMaxActiveLevel;    ///< The max level of any registered logger. Used to optimize the VLOGGER macros so they can return early if a log statement won't pass level filters.
-        static VNamedLoggerPtr  gDefaultLogger;     ///< The default logger that is logged to by the simple VLOGGER macros and by the VLOGGER_NAMED macros if the named logger is not found. Created on first reference if needed.
-        static VLogAppenderPtr  gDefaultAppender;   ///< The default appender that is emitted to by a logger if the logger has no appender specified. A VCoutAppender is created on first reference if needed.
+        // These are read without locking; _mutexInstance() must be held to change them. The loggers, appenders,
+        // and default logger and appender are in the VLoggerConfiguration that vlogger.cpp publishes.
+        static std::atomic<int> gMaxActiveLevel;    ///< The max level of any registered logger. Used to optimize the VLOGGER macros so they can return early if a log statement won't pass level filters.
+        static std::atomic<int> gLoggersGeneration; ///< Incremented whenever a new configuration is published, so VNamedLoggerHandle knows to resolve its name again.
         static VFSNode          gBaseLogDirectory;  ///< The directory within which any file-oriented loggers should write all their data.
 
         friend class VLoggerUnit;  // unit tests directly examine our state
-        friend bool VNamedLogger::isDefaultLogger() const;
-        friend bool VLogAppender::isDefaultAppender() const;
+        friend class VNamedLoggerHandle; // it resolves names with our internal functions and checks gLoggersGeneration
+        friend class VLoggerConfigurationEditor; // it advances gLoggersGeneration when it publishes
 
         // Internal development debugging methods. Only enabled as needed.
 //#define VLOGGER_INTERNAL_DEBUGGING
@@ -1039,24 +1535,152 @@ class VFileLogAppender : public VLogAppender {
 };
 
 /**
-Not yet implemented. An appender that emits to rolling log files.
-It will define several properties to control the limits on log file size
-and the lifecycle for cleaning up "old" files. I plan to define a class
-that has a global housekeeping object which all rolling file appenders register with,
-to indicate their file patterns, directories, lifetimes, and currently in use file.
-The housekeeper task will periodically remove sufficiently old files as long as they
-are not currently in use. Another approach might be to only fire a cleaning job upon
-rollover, since although a file can become old due to the passing of time, if no rollover
-occurs then there is no growth in the number of files on disk.
+VLogFileSeries names and prunes the files of an appender that writes a series of files in one
+directory, such as VRollingFileLogAppender and VBinaryLogAppender. Each file is named with the
+prefix and the UTC time it was started, "<prefix>_<yyyyMMddHHmmssSSS><extension>", so the names
+sort by age, even across a daylight saving time change. Pruning only considers names of exactly
+that form, so it leaves alone the files of another series whose prefix starts with this one's.
+The appender serializes calls to nextFileNode() with its own mutex; removeOldFiles() has a lock
+of its own, so that it can be called after the appender's mutex is released.
+*/
+class VLogFileSeries {
+    public:
+
+        /**
+        Constructs the series. No files are touched until nextFileNode() is called.
+        @param  name            the name of the owning appender, for the mutex name
+        @param  dirPath         the directory the files go in
+        @param  fileNamePrefix  the start of each file's name
+        @param  extension       the end of each file's name, including the dot
+        */
+        VLogFileSeries(const VString& name, const VString& dirPath, const VString& fileNamePrefix, const VString& extension);
+        ~VLogFileSeries() {}
+
+        /**
+        Creates the directory if needed and returns a node for the next file, named for the current
+        time, or a later one if needed so that it sorts after the previous file and is not taken.
+        Each call after the first makes removeOldFiles() due. The file itself is not created.
+        @return the new file's node
+        */
+        VFSNode nextFileNode();
+        /**
+        If a new file has been started since the last call, deletes the oldest files of the series
+        so that at most the specified number remain. Failures are ignored, because they must not
+        prevent logging.
+        @param  maxNumFiles how many files to keep; 0 to keep all
+        */
+        void removeOldFiles(int maxNumFiles);
+        /**
+        Returns true if a file name is of the form this series uses.
+        @param  fileName    the file name, without the directory
+        @return obvious
+        */
+        bool isSeriesFileName(const VString& fileName) const;
+
+        const VFSNode& getDirectory() const { return mDirectory; }              ///< Returns the directory. @return obvious
+        const VString& getFileNamePrefix() const { return mFileNamePrefix; }    ///< Returns the file name prefix. @return obvious
+
+    private:
+
+        VLogFileSeries(const VLogFileSeries&); // not copyable
+        VLogFileSeries& operator=(const VLogFileSeries&); // not assignable
+
+        VFSNode             mDirectory;                 ///< The directory the files go in.
+        VString             mFileNamePrefix;            ///< The start of each file's name.
+        VString             mExtension;                 ///< The end of each file's name.
+        VInstant            mFileTime;                  ///< The time in the newest file's name; only used under the appender's mutex.
+        std::atomic<bool>   mRemoveOldFilesPending;     ///< True if a file has been started since removeOldFiles() last ran.
+        VMutex              mHousekeepingMutex;         ///< Serializes removeOldFiles(), separately from the appender's mutex.
+};
+
+class VRollingFileLogFlushThread;
+
+/**
+An appender that emits to a series of log files in a directory, starting a new file when the
+current one reaches a limit on lines, bytes, or age. The files are named by a VLogFileSeries with
+the extension ".log", so the names sort by age and a rollover never renames existing files.
+Deleting old files is done after the emitting thread has released the appender, so other threads
+logging to it are held up only while the new file is opened.
+
+Output is buffered and written to disk every flush interval, rather than for each line; messages at
+ERROR level or more severe are written immediately. A background thread writes buffered output once
+the flush interval has passed, so the last lines logged before a quiet period are not left waiting
+for the next message. Pending output is also written when the file rolls over and when the appender
+is destroyed.
+
+A limit of 0 means no limit; with no limits at all, the appender keeps writing its first file.
+It defines the following additional properties:
+- "dir" (string)
+  Defaults to the base log directory. The directory to create the files in.
+- "prefix" (string)
+  Defaults to the appender name. The start of each file name.
+- "max-lines" (int)
+  Defaults to 10000. Roll over after this many lines.
+- "max-bytes" (int)
+  Defaults to 0. Roll over once the file reaches this size.
+- "roll-interval" (duration)
+  Defaults to 0. Roll over when the file is this old, such as "1d".
+- "max-files" (int)
+  Defaults to 0. After rolling over, delete the oldest files so that at most this many remain.
+- "flush-interval" (duration)
+  Defaults to 1s. The longest buffered output waits to be written; 0 writes every line.
 */
 class VRollingFileLogAppender : public VLogAppender {
     public:
-        VRollingFileLogAppender(const VString& name, bool formatOutput, const VString& formatSpec, const VString& timeFormat, const VString& dirPath, const VString& fileNamePrefix, int maxNumLines);
+        static const int kDefaultMaxNumLines = 10000; ///< The default line limit.
+
+        VRollingFileLogAppender(const VString& name, bool formatOutput, const VString& formatSpec, const VString& timeFormat, const VString& dirPath, const VString& fileNamePrefix, int maxNumLines,
+            Vs64 maxNumBytes = 0, const VDuration& rollInterval = VDuration::ZERO(), int maxNumFiles = 0, const VDuration& flushInterval = VDuration::SECOND());
         VRollingFileLogAppender(const VSettingsNode& settings, const VSettingsNode& defaults);
-        virtual ~VRollingFileLogAppender() {}
+        virtual ~VRollingFileLogAppender();
         virtual void addInfo(VBentoNode& infoNode) const;
+        virtual void emit(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName, bool emitRawLine, const VString& rawLine);
+        virtual void emitRecord(const VLogRecord& record);
+
+        /**
+        Closes the current file and starts a new one, regardless of the limits.
+        */
+        void roll();
+        /**
+        Writes any buffered output to disk.
+        */
+        void flush();
+        /**
+        Returns the path of the file currently being written.
+        @return obvious
+        */
+        VString getCurrentFilePath() const;
+
     protected:
+        virtual void _emitMessage(int level, const char* file, int line, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName);
         virtual void _emitRawLine(const VString& line);
+
+    private:
+
+        VRollingFileLogAppender(const VRollingFileLogAppender&); // not copyable
+        VRollingFileLogAppender& operator=(const VRollingFileLogAppender&); // not assignable
+
+        friend class VRollingFileLogFlushThread;
+
+        void _openNewFile(); ///< Closes any current file and opens a new one. Assumes mMutex is held.
+        void _removeOldFiles(); ///< If a rollover has happened since the last call, deletes files beyond mMaxNumFiles. Must not be called with mMutex held.
+        void _flushIfDue(); ///< Writes buffered output if the flush interval has passed. Called by mFlushThread.
+        void _startFlushThread(); ///< Constructor helper: starts mFlushThread if output is buffered.
+
+        VLogFileSeries      mFileSeries;            ///< Names the files and deletes old ones.
+        int                 mMaxNumLines;           ///< Roll over after this many lines; 0 for no limit.
+        Vs64                mMaxNumBytes;           ///< Roll over after this many bytes; 0 for no limit.
+        VDuration           mRollInterval;          ///< Roll over when the file is this old; ZERO for no limit.
+        int                 mMaxNumFiles;           ///< How many files to keep; 0 to keep all.
+        VDuration           mFlushInterval;         ///< How long output may stay buffered; ZERO to flush every line.
+        VBufferedFileStream mFileStream;            ///< The current file.
+        VTextIOStream       mOutputStream;          ///< The text stream we write to mFileStream through.
+        int                 mNumLines;              ///< Lines written to the current file.
+        Vs64                mNumBytes;              ///< Bytes written to the current file.
+        VInstant            mRollTime;              ///< When the current file reaches mRollInterval.
+        VInstant            mNextFlushTime;         ///< When buffered output is next due to be written.
+        bool                mFlushNow;              ///< True if the line being written must be written immediately.
+        VRollingFileLogFlushThread* mFlushThread;   ///< Writes buffered output when it has waited mFlushInterval; NULL if every line is flushed.
 };
 
 /**
@@ -1070,6 +1694,7 @@ class VSilentLogAppender : public VLogAppender {
         virtual ~VSilentLogAppender() {}
         virtual void addInfo(VBentoNode& infoNode) const;
         virtual void emit(int /*level*/, const char* /*file*/, int /*line*/, bool /*emitMessage*/, const VString& /*message*/, const VString& /*specifiedLoggerName*/, const VString& /*actualLoggerName*/, bool /*emitRawLine*/, const VString& /*rawLine*/) {}
+        virtual void emitRecord(const VLogRecord& /*record*/) {}
 };
 
 /**
@@ -1119,6 +1744,128 @@ class VStringVectorLogAppender : public VLogAppender {
         VStringVector mLines;
 };
 
+class VAsyncLogQueue;
+class VAsyncLogWriterThread;
+
+/**
+An appender that hands each message to a background thread, which emits it to another
+("target") appender. A thread that logs only captures the message, the time, and its thread
+name into a VLogRecord, and adds that to a bounded lock-free queue; the formatting and I/O
+happen on the writer thread. So a slow destination, such as a file on a busy disk, no longer
+holds up the threads that log. Messages logged by any one thread keep their order.
+
+When the queue is full, the overflow policy decides what happens to a new message:
+- kBlock waits for the writer to make room, so nothing is lost.
+- kDrop discards the message.
+- kSample starts thinning out messages before the queue fills: once it is three-quarters
+  full, only one message in every "sample rate" is queued; when it is full, messages are dropped.
+Discarded messages are counted, and the writer notes how many were lost in the target's output.
+
+Messages logged by the writer thread itself are emitted to the target directly. On destruction,
+messages still queued are written before the writer thread ends.
+
+It defines the following additional properties:
+- "appender" (string)
+  The name of the target appender. If it is not registered when the first message is written,
+  the default appender is used until it is. Naming this appender itself throws a VRangeException.
+  If the target would still be this appender (because it is also the default appender), queued
+  messages have nowhere to go and are discarded; they are counted by getNumDropped().
+- "queue-size" (int)
+  Defaults to 8192. The most messages that can be queued; rounded up to a power of 2.
+- "overflow" (string)
+  Defaults to "drop". One of "block", "drop", or "sample".
+- "sample-rate" (int)
+  Defaults to 10. For the "sample" policy, keep one message in this many while the queue is congested.
+*/
+class VAsyncLogAppender : public VLogAppender {
+    public:
+
+        /**
+        What to do with a message logged when the queue is full.
+        */
+        enum OverflowPolicy {
+            kBlock,     ///< Wait for the writer to make room.
+            kDrop,      ///< Discard the message.
+            kSample     ///< Keep one message in every sample rate once the queue is congested; discard when full.
+        };
+
+        static const int kDefaultQueueSize = 8192;  ///< The default queue capacity.
+        static const int kDefaultSampleRate = 10;   ///< The default sample rate for kSample.
+
+        /**
+        Constructs the appender and starts its writer thread.
+        @param  name            the name of this appender
+        @param  target          the appender to which messages are emitted
+        @param  queueSize       the most messages that can be queued; rounded up to a power of 2
+        @param  overflowPolicy  what to do with a message logged when the queue is full
+        @param  sampleRate      for kSample, keep one message in this many while the queue is congested
+        */
+        VAsyncLogAppender(const VString& name, VLogAppenderPtr target, int queueSize = kDefaultQueueSize, OverflowPolicy overflowPolicy = kDrop, int sampleRate = kDefaultSampleRate);
+        VAsyncLogAppender(const VSettingsNode& settings, const VSettingsNode& defaults);
+        /**
+        Destructor. Writes any messages still queued, then ends the writer thread.
+        */
+        virtual ~VAsyncLogAppender();
+        virtual void addInfo(VBentoNode& infoNode) const;
+        virtual void emit(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, const VString& actualLoggerName, bool emitRawLine, const VString& rawLine);
+        virtual void emitRecord(const VLogRecord& record);
+        virtual void emitDeferred(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName, const VString& actualLoggerName);
+
+        /**
+        Waits until every message queued before the call has been emitted to the target.
+        @param  timeout the longest to wait
+        @return true if the messages were written; false if the timeout elapsed first
+        */
+        bool flush(const VDuration& timeout = VDuration::POSITIVE_INFINITY());
+
+        OverflowPolicy getOverflowPolicy() const { return mOverflowPolicy; } ///< Returns the overflow policy. @return obvious
+        int getQueueSize() const;       ///< Returns the queue capacity. @return obvious
+        Vs64 getNumQueued() const;      ///< Returns how many messages have been queued. @return obvious
+        Vs64 getNumWritten() const;     ///< Returns how many queued messages have been emitted to the target. @return obvious
+        Vs64 getNumDropped() const;     ///< Returns how many messages were discarded by the overflow policy or for lack of a target. @return obvious
+        Vs64 getNumBlocked() const;     ///< Returns how many times a thread waited for room under kBlock. @return obvious
+
+        static OverflowPolicy overflowPolicyFromString(const VString& value); ///< Converts "block", "drop", or "sample"; throws VRangeException for anything else. @param value the string @return the policy
+        static VString overflowPolicyToString(OverflowPolicy policy); ///< Returns the settings string for a policy. @param policy the policy @return the string
+
+    private:
+
+        VAsyncLogAppender(const VAsyncLogAppender&); // not copyable
+        VAsyncLogAppender& operator=(const VAsyncLogAppender&); // not assignable
+
+        friend class VAsyncLogWriterThread;
+
+        /**
+        Queues a captured record, applying the overflow policy if the queue is full.
+        @param  record  the record
+        */
+        void _enqueue(const VLogRecord& record);
+        /**
+        Called on the writer thread: emits everything currently queued to the target.
+        @return true if anything was written
+        */
+        bool _writeQueuedRecords();
+        /**
+        Returns the target appender, looking it up by name until it is found.
+        @return the target, or null if it would be this appender
+        */
+        VLogAppenderPtr _getTarget();
+        /**
+        Returns the target name, after checking that it does not name the appender itself.
+        @param  appenderName    the name of this appender
+        @param  targetName      the name of the target appender
+        @return targetName
+        */
+        static const VString& _validateTargetName(const VString& appenderName, const VString& targetName);
+
+        VLogAppenderPtr         mTarget;            ///< The appender we emit to, once known; only the writer thread uses it after construction.
+        VString                 mTargetName;        ///< The name of the target, to look it up if mTarget is not yet known.
+        OverflowPolicy          mOverflowPolicy;    ///< What to do when the queue is full.
+        int                     mSampleRate;        ///< For kSample, keep one message in this many.
+        VAsyncLogQueue*         mQueue;             ///< The lock-free queue and its counters.
+        VAsyncLogWriterThread*  mWriterThread;      ///< The thread that drains the queue.
+};
+
 /**
 A special logger subclass meant to be declared on the stack (not "registered") and explicitly logged
 to, which uses an embedded VStringLogAppender to capture the emitted messages to a multi-line string.
@@ -1136,6 +1883,15 @@ class VStringLogger : public VNamedLogger {
     protected:
 
         virtual void _emitToAppenders(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, bool emitRawLine, const VString& rawLine);
+        /**
+        Emits a message that has not been formatted yet to all appenders appropriate to this logger.
+        @param  level       the level of the message
+        @param  file        the source file name where the message was logged (from __FILE__ symbol)
+        @param  line        the line in the source file where the message was logged (from __LINE__ symbol)
+        @param  message     the message to be emitted
+        @param  specifiedLoggerName if not empty, the logger name supplied by caller
+        */
+        virtual void _emitDeferredToAppenders(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName);
 
     private:
 
@@ -1162,6 +1918,15 @@ class VStringVectorLogger : public VNamedLogger {
     protected:
 
         virtual void _emitToAppenders(int level, const char* file, int line, bool emitMessage, const VString& message, const VString& specifiedLoggerName, bool emitRawLine, const VString& rawLine);
+        /**
+        Emits a message that has not been formatted yet to all appenders appropriate to this logger.
+        @param  level       the level of the message
+        @param  file        the source file name where the message was logged (from __FILE__ symbol)
+        @param  line        the line in the source file where the message was logged (from __LINE__ symbol)
+        @param  message     the message to be emitted
+        @param  specifiedLoggerName if not empty, the logger name supplied by caller
+        */
+        virtual void _emitDeferredToAppenders(int level, const char* file, int line, const VLogDeferredMessage& message, const VString& specifiedLoggerName);
 
     private:
 
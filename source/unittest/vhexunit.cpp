@@ -43,6 +43,23 @@ void VHexUnit::run() {
 
     VUNIT_ASSERT_EQUAL_LABELED(hexString, zeroTo255HexString, "bufferToHexString");
 
+    // The bulk conversion must agree with the byte-at-a-time one at every length, including those
+    // that are not a multiple of the 16 bytes it converts at once, and from an unaligned start.
+    bool bulkConversionMatches = true;
+    for (int length = 0; length <= 40; ++length) {
+        char hexChars[80];
+        VHex::bufferToHexChars(memoryStream.getBuffer() + 201, length, hexChars);
+        VString bulkHex;
+        VString expectedHex;
+        bulkHex.copyFromBuffer(hexChars, 0, 2 * length);
+        zeroTo255HexString.getSubstring(expectedHex, 2 * 201, 2 * (201 + length));
+        if (bulkHex != expectedHex) {
+            bulkConversionMatches = false;
+        }
+    }
+
+    VUNIT_ASSERT_TRUE_LABELED(bulkConversionMatches, "bufferToHexChars");
+
     // Convert the hex string back to bytes and validate.
     VMemoryStream    bytes(256);
     VHex::hexStringToBuffer(hexString, bytes.getBuffer());
@@ -73,5 +90,21 @@ void VHexUnit::run() {
     VHex::readHexDump(dumpStream, reconstructedStream);
 
     VUNIT_ASSERT_TRUE_LABELED(memoryStream == reconstructedBuffer, "VHex::readHexDump reconstructs data");
+
+    // Check the exact layout of partial rows, with and without the ASCII column.
+    VMemoryStream   rowBuffer;
+    VTextIOStream   rowStream(rowBuffer);
+    VHex            asciiDump(&rowStream);
+    asciiDump.printHex(reinterpret_cast<const Vu8*>("AB C"), 4);
+    VHex            hexLabelDump(&rowStream, 4, 0, true, false);
+    hexLabelDump.printHex(memoryStream.getBuffer(), 6);
+    rowStream.seek0();
+    VString row;
+    rowStream.readLine(row);
+    VUNIT_ASSERT_EQUAL_LABELED(row, VString("  00000000: 41 42 20 43                                        AB.C"), "hex dump row with ASCII");
+    rowStream.readLine(row);
+    VUNIT_ASSERT_EQUAL_LABELED(row, VString("0x00000000: 00 01 02 03 "), "hex dump row with hex label");
+    rowStream.readLine(row);
+    VUNIT_ASSERT_EQUAL_LABELED(row, VString("0x00000004: 04 05 "), "hex dump partial row");
 }
 
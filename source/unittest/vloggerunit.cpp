@@ -9,9 +9,13 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 
 #include "vloggerunit.h"
 #include "vlogger.h"
+#include "vbinarylogappender.h"
+#include "vlogflightrecorder.h"
 #include "vmessage.h"
 #include "vbento.h"
 #include "vsettings.h"
+#include "vthread.h"
+#include "vmutexlocker.h"
 
 typedef std::vector<VNamedLogger*> VLoggerUnitLoggerList;
 
@@ -38,6 +42,16 @@ void VLoggerUnit::run() {
     this->_testLoggerPathNames();
     this->_testSmartPtrLifecycle();
 //    this->_testOptimizationPerformance();
+    this->_testAsyncAppender();
+    this->_testRollingFileAppender();
+    this->_testNamedLoggerHandles();
+    this->_testFormatSpecs();
+    this->_testDeferredMessages();
+    this->_testBinaryAppender();
+    this->_testRateLimiting();
+    this->_testFlightRecorder();
+    this->_testHexDump();
+    this->_testConfigurationSnapshots();
 }
 
 void VLoggerUnit::_testMacros() {
@@ -489,6 +503,421 @@ void VLoggerUnit::_testOptimizationPerformance() {
     VLogger::deregisterLogger(loggerName);
 }
 
+// A string vector appender that takes a while to write each line, like a file on a busy disk.
+class TestSlowStringVectorLogAppender : public VStringVectorLogAppender {
+    public:
+
+        TestSlowStringVectorLogAppender(const VString& name, const VString& formatSpec, const VDuration& delayPerLine)
+            : VStringVectorLogAppender(name, VLogAppender::DO_FORMAT_OUTPUT, formatSpec, VString::EMPTY(), NULL)
+            , mDelayPerLine(delayPerLine)
+            {}
+        virtual ~TestSlowStringVectorLogAppender() {}
+
+    protected:
+
+        virtual void _emitRawLine(const VString& line) {
+            VThread::sleep(mDelayPerLine);
+            VStringVectorLogAppender::_emitRawLine(line);
+        }
+
+    private:
+
+        VDuration mDelayPerLine;
+};
+
+class TestAsyncLoggingThread : public VThread {
+    public:
+
+        TestAsyncLoggingThread(const VString& name, VLogAppender& appender, int numMessages)
+            : VThread(name, "vault.toolbox.TestAsyncLoggingThread", VThread::kDontDeleteSelfAtEnd, VThread::kCreateThreadJoinable, NULL)
+            , mAppender(appender)
+            , mNumMessages(numMessages)
+            {}
+        virtual ~TestAsyncLoggingThread() {}
+
+        virtual void run() {
+            for (int i = 0; i < mNumMessages; ++i) {
+                VLOGGER_APPENDER_EMIT(mAppender, VLoggerLevel::INFO, VSTRING_FORMAT("%d", i));
+            }
+        }
+
+    private:
+
+        TestAsyncLoggingThread(const TestAsyncLoggingThread&); // not copyable
+        TestAsyncLoggingThread& operator=(const TestAsyncLoggingThread&); // not assignable
+
+        VLogAppender&   mAppender;
+        int             mNumMessages;
+};
+
+void VLoggerUnit::_testAsyncAppender() {
+    // Messages come out in order, stamped with the thread that logged them, not the writer thread.
+    /* scope for appender lifetimes */ {
+        VSharedPtr<VStringVectorLogAppender> target(new VStringVectorLogAppender("async-test-target", VLogAppender::DO_FORMAT_OUTPUT, "$thread|$level|$message", VString::EMPTY(), NULL));
+        VAsyncLogAppender asyncAppender("async-test", target, 64, VAsyncLogAppender::kBlock);
+        VString threadName = VThread::getCurrentThreadName();
+
+        for (int i = 0; i < 500; ++i) {
+            VLOGGER_APPENDER_EMIT(asyncAppender, VLoggerLevel::INFO, VSTRING_FORMAT("message %d", i));
+        }
+
+        VUNIT_ASSERT_TRUE_LABELED(asyncAppender.flush(10 * VDuration::SECOND()), "async appender flush");
+        VUNIT_ASSERT_EQUAL_LABELED((int) target->getLines().size(), 500, "async appender wrote all messages");
+        VUNIT_ASSERT_EQUAL_LABELED(asyncAppender.getNumDropped(), CONST_S64(0), "async appender kBlock dropped none");
+        bool inOrder = true;
+        for (int i = 0; inOrder && (i < (int) target->getLines().size()); ++i) {
+            inOrder = (target->getLines()[i] == VSTRING_FORMAT("%s|%s|message %d", threadName.chars(), VLoggerLevel::getName(VLoggerLevel::INFO).chars(), i));
+        }
+        VUNIT_ASSERT_TRUE_LABELED(inOrder, "async appender messages in order with logging thread name");
+
+        // Several threads at once: nothing lost under kBlock, and each thread's messages stay in order.
+        target.reset(new VStringVectorLogAppender("async-test-target-2", VLogAppender::DO_FORMAT_OUTPUT, "$thread|$message", VString::EMPTY(), NULL));
+
+        VAsyncLogAppender multiThreadAppender("async-test-2", target, 64, VAsyncLogAppender::kBlock);
+        const int kNumThreads = 4;
+        const int kNumMessagesPerThread = 2000;
+        std::vector<TestAsyncLoggingThread*> threads;
+        for (int i = 0; i < kNumThreads; ++i) {
+            threads.push_back(new TestAsyncLoggingThread(VSTRING_FORMAT("async-logger-%d", i), multiThreadAppender, kNumMessagesPerThread));
+            threads.back()->start();
+        }
+
+        for (int i = 0; i < kNumThreads; ++i) {
+            threads[i]->join();
+            delete threads[i];
+        }
+
+        VUNIT_ASSERT_TRUE_LABELED(multiThreadAppender.flush(10 * VDuration::SECOND()), "async appender multi-thread flush");
+        VUNIT_ASSERT_EQUAL_LABELED((int) target->getLines().size(), kNumThreads * kNumMessagesPerThread, "async appender multi-thread wrote all messages");
+        std::map<VString, int> nextExpected;
+        bool threadsInOrder = true;
+        for (VStringVector::const_iterator i = target->getLines().begin(); threadsInOrder && (i != target->getLines().end()); ++i) {
+            VString name;
+            VString value;
+            (*i).getSubstring(name, 0, (*i).indexOf('|'));
+            (*i).getSubstring(value, (*i).indexOf('|') + 1);
+            threadsInOrder = (value.parseInt() == nextExpected[name]++);
+        }
+        VUNIT_ASSERT_TRUE_LABELED(threadsInOrder && ((int) nextExpected.size() == kNumThreads), "async appender multi-thread per-thread order");
+    }
+
+    // kDrop with a slow target and a small queue: the excess is dropped, counted, and reported.
+    /* scope for appender lifetimes */ {
+        VSharedPtr<TestSlowStringVectorLogAppender> target(new TestSlowStringVectorLogAppender("async-test-slow-target", "$message", VDuration::MILLISECOND()));
+        VAsyncLogAppender asyncAppender("async-test-drop", target, 16, VAsyncLogAppender::kDrop);
+
+        const int kNumMessages = 1000;
+        for (int i = 0; i < kNumMessages; ++i) {
+            VLOGGER_APPENDER_EMIT(asyncAppender, VLoggerLevel::INFO, VSTRING_FORMAT("drop test %d", i));
+        }
+
+        VUNIT_ASSERT_TRUE_LABELED(asyncAppender.flush(30 * VDuration::SECOND()), "async appender kDrop flush");
+        VUNIT_ASSERT_TRUE_LABELED(asyncAppender.getNumDropped() > 0, "async appender kDrop dropped messages");
+        VUNIT_ASSERT_EQUAL_LABELED(asyncAppender.getNumWritten() + asyncAppender.getNumDropped(), (Vs64) kNumMessages, "async appender kDrop written + dropped = logged");
+        VUNIT_ASSERT_EQUAL_LABELED(asyncAppender.getQueueSize(), 16, "async appender queue size");
+
+        VThread::sleep(50 * VDuration::MILLISECOND()); // the drop report follows the batch it was noticed in
+        bool reported = false;
+        VMutexLocker locker(&target->getMutex(), "VLoggerUnit::_testAsyncAppender");
+        for (VStringVector::const_iterator i = target->getLines().begin(); i != target->getLines().end(); ++i) {
+            reported = reported || ((*i).contains("dropped") && (*i).contains("async-test-drop"));
+        }
+        VUNIT_ASSERT_TRUE_LABELED(reported, "async appender kDrop reported drop count");
+    }
+
+    // kSample thins messages out before the queue fills.
+    /* scope for appender lifetimes */ {
+        VSharedPtr<TestSlowStringVectorLogAppender> target(new TestSlowStringVectorLogAppender("async-test-sample-target", "$message", VDuration::MILLISECOND()));
+        VAsyncLogAppender asyncAppender("async-test-sample", target, 64, VAsyncLogAppender::kSample, 4);
+
+        const int kNumMessages = 1000;
+        for (int i = 0; i < kNumMessages; ++i) {
+            VLOGGER_APPENDER_EMIT(asyncAppender, VLoggerLevel::INFO, VSTRING_FORMAT("sample test %d", i));
+        }
+
+        VUNIT_ASSERT_TRUE_LABELED(asyncAppender.flush(30 * VDuration::SECOND()), "async appender kSample flush");
+        VUNIT_ASSERT_TRUE_LABELED(asyncAppender.getNumDropped() > 0, "async appender kSample dropped messages");
+        VUNIT_ASSERT_TRUE_LABELED(asyncAppender.getNumWritten() >= 48, "async appender kSample kept everything until congested");
+        this->logStatus(VSTRING_FORMAT("kSample: " VSTRING_FORMATTER_S64 " written, " VSTRING_FORMATTER_S64 " dropped.", asyncAppender.getNumWritten(), asyncAppender.getNumDropped()));
+        VUNIT_ASSERT_EQUAL_LABELED(asyncAppender.getNumWritten() + asyncAppender.getNumDropped(), (Vs64) kNumMessages, "async appender kSample written + dropped = logged");
+    }
+
+    // An appender that would write to itself is rejected when it names itself, and drops (and counts) its
+    // messages when it only ends up as its own target by being the default appender.
+    /* scope for settings */ {
+        VSettings settings;
+        settings.addStringValue("name", "async-test-self");
+        settings.addStringValue("appender", "async-test-self");
+        VSettings defaults;
+        try {
+            VAsyncLogAppender asyncAppender(settings, defaults);
+            VUNIT_ASSERT_FAILURE("async appender targeting itself did not throw");
+        } catch (const VRangeException& /*ex*/) {
+            VUNIT_ASSERT_SUCCESS("async appender targeting itself threw");
+        }
+    }
+
+    VLogAppenderPtr oldDefaultAppender = VLogger::findDefaultAppender();
+    if (oldDefaultAppender != nullptr) {
+        VSharedPtr<VAsyncLogAppender> asyncAppender(new VAsyncLogAppender("async-test-self-default", VLogAppenderPtr(), 16, VAsyncLogAppender::kBlock));
+        VLogger::registerLogAppender(asyncAppender, true);
+        for (int i = 0; i < 10; ++i) {
+            VLOGGER_APPENDER_EMIT(*asyncAppender, VLoggerLevel::INFO, VSTRING_FORMAT("self default test %d", i));
+        }
+
+        VUNIT_ASSERT_TRUE_LABELED(asyncAppender->flush(10 * VDuration::SECOND()), "async appender as default appender flush");
+        VLogger::registerLogAppender(oldDefaultAppender, true);
+        VLogger::deregisterLogAppender(asyncAppender);
+        VUNIT_ASSERT_EQUAL_LABELED(asyncAppender->getNumWritten(), CONST_S64(0), "async appender as default appender wrote nothing");
+        VUNIT_ASSERT_EQUAL_LABELED(asyncAppender->getNumDropped(), CONST_S64(10), "async appender as default appender counted drops");
+    }
+
+    // Settings: unknown overflow policy is rejected.
+    VUNIT_ASSERT_TRUE_LABELED(VAsyncLogAppender::overflowPolicyFromString("BLOCK") == VAsyncLogAppender::kBlock, "async overflow policy from string");
+    try {
+        (void) VAsyncLogAppender::overflowPolicyFromString("discard");
+        VUNIT_ASSERT_FAILURE("async overflow policy rejects unknown value");
+    } catch (const VRangeException& /*ex*/) {
+        VUNIT_ASSERT_SUCCESS("async overflow policy rejects unknown value");
+    }
+
+    // Benchmark: what a logging thread pays per message with a slow destination, sync vs. async.
+    /* scope for appender lifetimes */ {
+        const int kNumMessages = 200;
+        VSharedPtr<TestSlowStringVectorLogAppender> target(new TestSlowStringVectorLogAppender("async-bench-target", VString::EMPTY(), VDuration::MILLISECOND()));
+
+        Vs64 start = VDeadline::monotonicMicroseconds();
+        for (int i = 0; i < kNumMessages; ++i) {
+            VLOGGER_APPENDER_EMIT(*target, VLoggerLevel::INFO, VSTRING_FORMAT("sync benchmark message %d", i));
+        }
+        Vs64 syncMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+        VAsyncLogAppender asyncAppender("async-bench", target, 1024, VAsyncLogAppender::kBlock);
+        start = VDeadline::monotonicMicroseconds();
+        for (int i = 0; i < kNumMessages; ++i) {
+            VLOGGER_APPENDER_EMIT(asyncAppender, VLoggerLevel::INFO, VSTRING_FORMAT("async benchmark message %d", i));
+        }
+        Vs64 asyncMicroseconds = VDeadline::monotonicMicroseconds() - start;
+        (void) asyncAppender.flush();
+
+        this->logStatus(VSTRING_FORMAT("Logging %d messages to a slow appender: sync " VSTRING_FORMATTER_S64 "us, async " VSTRING_FORMATTER_S64 "us.", kNumMessages, syncMicroseconds, asyncMicroseconds));
+        VUNIT_ASSERT_TRUE_LABELED(asyncMicroseconds < syncMicroseconds, "async logging returns sooner than sync logging to a slow appender");
+    }
+}
+
+static VStringVector _getRollingFileNames(const VFSNode& dir, const VString& prefix) {
+    VStringVector children;
+    VStringVector fileNames;
+    dir.list(children);
+    for (VStringVector::const_iterator i = children.begin(); i != children.end(); ++i) {
+        if ((*i).startsWith(prefix)) {
+            fileNames.push_back(*i);
+        }
+    }
+
+    std::sort(fileNames.begin(), fileNames.end());
+    return fileNames;
+}
+
+static void _createEmptyFile(const VFSNode& fileNode) {
+    VBufferedFileStream fileStream(fileNode);
+    fileStream.openWrite();
+    fileStream.close();
+}
+
+void VLoggerUnit::_testRollingFileAppender() {
+    VFSNode tempDir = VFSNode::getKnownDirectoryNode(VFSNode::CACHED_DATA_DIRECTORY, "vault", "unittest");
+    VFSNode testDir(tempDir, "vloggerunit_rolling_temp");
+    (void) testDir.rm();
+
+    // Roll by line count, keeping the newest 3 files.
+    /* scope for appender lifetime */ {
+        VRollingFileLogAppender appender("rolling-lines", VLogAppender::DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), testDir.getPath(), "lines", 5, 0, VDuration::ZERO(), 3);
+        for (int i = 0; i < 23; ++i) {
+            VLOGGER_APPENDER_EMIT(appender, VLoggerLevel::INFO, VSTRING_FORMAT("line %d", i));
+        }
+        appender.flush();
+
+        VStringVector fileNames = _getRollingFileNames(testDir, "lines_");
+        VUNIT_ASSERT_EQUAL_LABELED((int) fileNames.size(), 3, "rolling appender kept max-files");
+        if (fileNames.size() == 3) {
+            VUNIT_ASSERT_EQUAL_LABELED(VFSNode(testDir, fileNames[2]).getPath(), appender.getCurrentFilePath(), "rolling appender newest file is current");
+
+            VStringVector oldestLines;
+            VStringVector currentLines;
+            VFSNode(testDir, fileNames[0]).readAll(oldestLines);
+            VFSNode(testDir, fileNames[2]).readAll(currentLines);
+            VUNIT_ASSERT_EQUAL_LABELED((int) oldestLines.size(), 5, "rolling appender full file line count");
+            VUNIT_ASSERT_TRUE_LABELED((oldestLines.size() == 5) && (oldestLines[0] == "line 10"), "rolling appender oldest kept file content");
+            VUNIT_ASSERT_EQUAL_LABELED((int) currentLines.size(), 3, "rolling appender current file line count");
+            VUNIT_ASSERT_TRUE_LABELED((currentLines.size() == 3) && (currentLines[2] == "line 22"), "rolling appender current file content");
+        }
+
+        VString pathBeforeRoll = appender.getCurrentFilePath();
+        appender.roll();
+        VUNIT_ASSERT_NOT_EQUAL_LABELED(appender.getCurrentFilePath(), pathBeforeRoll, "rolling appender roll() starts a new file");
+        VUNIT_ASSERT_EQUAL_LABELED((int) _getRollingFileNames(testDir, "lines_").size(), 3, "rolling appender roll() kept max-files");
+    }
+
+    // Roll by size.
+    /* scope for appender lifetime */ {
+        VRollingFileLogAppender appender("rolling-bytes", VLogAppender::DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), testDir.getPath(), "bytes", 0, 100);
+        VString fortyChars("0123456789012345678901234567890123456789");
+        for (int i = 0; i < 9; ++i) {
+            VLOGGER_APPENDER_EMIT(appender, VLoggerLevel::INFO, fortyChars);
+        }
+
+        VUNIT_ASSERT_EQUAL_LABELED((int) _getRollingFileNames(testDir, "bytes_").size(), 3, "rolling appender max-bytes rollover");
+    }
+
+    // Buffered output is written at the flush interval, or at once for errors.
+    /* scope for appender lifetime */ {
+        VRollingFileLogAppender appender("rolling-flush", VLogAppender::DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), testDir.getPath(), "flush", 0, 0, VDuration::ZERO(), 0, VDuration::HOUR());
+        VFSNode fileNode(appender.getCurrentFilePath());
+        VLOGGER_APPENDER_EMIT(appender, VLoggerLevel::INFO, "buffered info line");
+        VUNIT_ASSERT_EQUAL_LABELED(fileNode.size(), (VFSize) 0, "rolling appender buffers info output");
+        VLOGGER_APPENDER_EMIT(appender, VLoggerLevel::ERROR, "error line");
+        VUNIT_ASSERT_TRUE_LABELED(fileNode.size() > 0, "rolling appender writes error output at once");
+    }
+
+    // Buffered output reaches the file at the flush interval even if nothing more is logged.
+    /* scope for appender lifetime */ {
+        VRollingFileLogAppender appender("rolling-idle-flush", VLogAppender::DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), testDir.getPath(), "idleflush", 0, 0, VDuration::ZERO(), 0, 50 * VDuration::MILLISECOND());
+        VFSNode fileNode(appender.getCurrentFilePath());
+        VLOGGER_APPENDER_EMIT(appender, VLoggerLevel::INFO, "buffered idle line");
+        for (int i = 0; (i < 100) && (fileNode.size() == 0); ++i) {
+            VThread::sleep(20 * VDuration::MILLISECOND());
+        }
+        VUNIT_ASSERT_TRUE_LABELED(fileNode.size() > 0, "rolling appender flushes idle output in the background");
+    }
+
+    // Pruning deletes only this series' files, not other files that share the prefix.
+    /* scope for appender lifetime */ {
+        VFSNode oldSeriesFile(testDir, "prune_20000101000000000.log");
+        VFSNode otherSeriesFile(testDir, "prune_extra_20000101000000000.log");
+        VFSNode otherFile(testDir, "prune_notes.log");
+        _createEmptyFile(oldSeriesFile);
+        _createEmptyFile(otherSeriesFile);
+        _createEmptyFile(otherFile);
+
+        VRollingFileLogAppender appender("rolling-prune", VLogAppender::DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), testDir.getPath(), "prune", 1, 0, VDuration::ZERO(), 2);
+        for (int i = 0; i < 4; ++i) {
+            VLOGGER_APPENDER_EMIT(appender, VLoggerLevel::INFO, VSTRING_FORMAT("line %d", i));
+        }
+
+        VUNIT_ASSERT_FALSE_LABELED(oldSeriesFile.exists(), "rolling appender prunes its old files");
+        VUNIT_ASSERT_TRUE_LABELED(otherSeriesFile.exists(), "rolling appender keeps another series' files");
+        VUNIT_ASSERT_TRUE_LABELED(otherFile.exists(), "rolling appender keeps non-series files");
+        VUNIT_ASSERT_EQUAL_LABELED((int) _getRollingFileNames(testDir, "prune_").size(), 4, "rolling appender kept max-files plus others");
+    }
+
+    // Configured from settings, and rolled by the runtime command.
+    /* scope for registered appender */ {
+        VSettings settings;
+        settings.addStringValue("name", "rolling-settings");
+        settings.addStringValue("dir", testDir.getPath());
+        settings.addStringValue("roll-interval", "1d");
+        settings.addStringValue("flush-interval", "0s");
+        VSettings defaults;
+        VSharedPtr<VRollingFileLogAppender> appender(new VRollingFileLogAppender(settings, defaults));
+        VLogger::registerLogAppender(appender);
+
+        VString pathBeforeRoll = appender->getCurrentFilePath();
+        VUNIT_ASSERT_TRUE_LABELED(VFSNode(pathBeforeRoll).getName().startsWith("rolling-settings_"), "rolling appender default prefix is the name");
+        VLogger::commandRollAppender("rolling-settings");
+        VUNIT_ASSERT_NOT_EQUAL_LABELED(appender->getCurrentFilePath(), pathBeforeRoll, "commandRollAppender rolls the appender");
+
+        VLogger::deregisterLogAppender(appender);
+    }
+
+    // Benchmark: flushing every line (like VFileLogAppender) vs. at the flush interval.
+    /* scope for appender lifetimes */ {
+        const int kNumMessages = 20000;
+        VRollingFileLogAppender perLineAppender("rolling-bench-1", VLogAppender::DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), testDir.getPath(), "bench1", 0, 0, VDuration::ZERO(), 0, VDuration::ZERO());
+        VRollingFileLogAppender bufferedAppender("rolling-bench-2", VLogAppender::DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), testDir.getPath(), "bench2", 0);
+
+        Vs64 start = VDeadline::monotonicMicroseconds();
+        for (int i = 0; i < kNumMessages; ++i) {
+            VLOGGER_APPENDER_EMIT(perLineAppender, VLoggerLevel::INFO, VSTRING_FORMAT("benchmark message %d", i));
+        }
+        Vs64 perLineMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+        start = VDeadline::monotonicMicroseconds();
+        for (int i = 0; i < kNumMessages; ++i) {
+            VLOGGER_APPENDER_EMIT(bufferedAppender, VLoggerLevel::INFO, VSTRING_FORMAT("benchmark message %d", i));
+        }
+        Vs64 bufferedMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+        this->logStatus(VSTRING_FORMAT("Writing %d lines: flush per line " VSTRING_FORMATTER_S64 "us, buffered " VSTRING_FORMATTER_S64 "us.", kNumMessages, perLineMicroseconds, bufferedMicroseconds));
+    }
+
+    (void) testDir.rm();
+}
+
+void VLoggerUnit::_testNamedLoggerHandles() {
+    VSharedPtr<VStringVectorLogAppender> appender(new VStringVectorLogAppender("handle-test-appender", VLogAppender::DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), NULL));
+    VNamedLoggerPtr parentLogger(new VNamedLogger("handletest.session", VLoggerLevel::INFO, VStringVector(), appender));
+    VLogger::registerLogger(parentLogger);
+
+    VNamedLoggerHandle handle("handletest.session.client.10_0_0_1");
+    VUNIT_ASSERT_TRUE_LABELED(handle.getLogger() == parentLogger, "handle resolves to closest registered path");
+    VUNIT_ASSERT_TRUE_LABELED(handle.getLogger() == parentLogger, "handle resolves the same when cached");
+    VUNIT_ASSERT_TRUE_LABELED(VLogger::findNamedLoggerForLevel(handle, VLoggerLevel::INFO) == parentLogger, "handle lookup at enabled level");
+    VUNIT_ASSERT_TRUE_LABELED(VLogger::findNamedLoggerForLevel(handle, VLoggerLevel::TRACE) == nullptr, "handle lookup at disabled level");
+
+    VLOGGER_NAMED_INFO(handle, "logged via handle");
+    VUNIT_ASSERT_TRUE_LABELED((appender->getLines().size() == 1) && (appender->getLines()[0] == "logged via handle"), "macro logs via handle");
+
+    // Registering a more specific logger, or removing it, is noticed by existing handles.
+    VNamedLoggerPtr childLogger(new VNamedLogger("handletest.session.client", VLoggerLevel::INFO, VStringVector(), appender));
+    VLogger::registerLogger(childLogger);
+    VUNIT_ASSERT_TRUE_LABELED(handle.getLogger() == childLogger, "handle re-resolves after logger registered");
+    VLogger::deregisterLogger(childLogger);
+    VUNIT_ASSERT_TRUE_LABELED(handle.getLogger() == parentLogger, "handle re-resolves after logger removed");
+    VUNIT_ASSERT_TRUE_LABELED(childLogger.use_count() == 1, "handle releases the removed logger once it re-resolves");
+
+    VNamedLoggerHandle copiedHandle(handle);
+    VUNIT_ASSERT_TRUE_LABELED((copiedHandle.getName() == handle.getName()) && (copiedHandle.getLogger() == parentLogger), "copied handle");
+
+    VLogger::deregisterLogger(parentLogger);
+    VUNIT_ASSERT_TRUE_LABELED(handle.getLogger() == VLogger::getDefaultLogger(), "handle falls back to default logger");
+
+    // Benchmark: resolving a deep per-session name at a level that is active somewhere but not for the
+    // resolved logger, so each iteration does the lookup and nothing else.
+    VNamedLoggerPtr activeLogger(new VNamedLogger("handletest.active", VLoggerLevel::TRACE, VStringVector(), appender));
+    VNamedLoggerPtr sessionLogger(new VNamedLogger("handletest.session", VLoggerLevel::INFO, VStringVector(), appender));
+    VLogger::registerLogger(activeLogger);
+    VLogger::registerLogger(sessionLogger);
+
+    const int kNumIterations = 200000;
+    const VString name("handletest.session.VClientSession.main.10_0_0_1");
+    VNamedLoggerHandle benchmarkHandle(name);
+    int numFound = 0;
+
+    Vs64 start = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < kNumIterations; ++i) {
+        if (VLogger::findNamedLoggerForLevel(name, VLoggerLevel::TRACE) != nullptr) {
+            ++numFound;
+        }
+    }
+    Vs64 nameMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+    start = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < kNumIterations; ++i) {
+        if (VLogger::findNamedLoggerForLevel(benchmarkHandle, VLoggerLevel::TRACE) != nullptr) {
+            ++numFound;
+        }
+    }
+    Vs64 handleMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+    VLogger::deregisterLogger(sessionLogger);
+    VLogger::deregisterLogger(activeLogger);
+
+    this->logStatus(VSTRING_FORMAT("%d named logger lookups: by name " VSTRING_FORMATTER_S64 "us, by handle " VSTRING_FORMATTER_S64 "us.", kNumIterations, nameMicroseconds, handleMicroseconds));
+    VUNIT_ASSERT_EQUAL_LABELED(numFound, 0, "lookups at disabled level found nothing");
+    VUNIT_ASSERT_TRUE_LABELED(handleMicroseconds < nameMicroseconds, "handle lookup is faster than name lookup");
+}
+
 static void _println(const VString& s) {
     std::cout << s << std::endl;
 }
@@ -560,3 +989,615 @@ void VLoggerUnit::_testNewInfrastructure() {
 
     VLogger::shutdown();
 }
+
+// Formats a line the way VLogAppender did before format specs were compiled: copy the spec, then
+// replace each specifier in turn. The format spec benchmark compares against this.
+static VString _formatByReplacement(const VString& formatSpec, const VInstantFormatter& timeFormatter, int level, const VString& message) {
+    VString formattedMessage = formatSpec;
+    formattedMessage.replace("$localtime", VInstant().getLocalString(timeFormatter));
+    formattedMessage.replace("$level", VLoggerLevel::getName(level));
+    formattedMessage.replace("$location", VString::EMPTY());
+    formattedMessage.replace("$thread", VThread::getCurrentThreadName());
+    formattedMessage.replace("$message", message);
+    return formattedMessage;
+}
+
+void VLoggerUnit::_testFormatSpecs() {
+    VStringVector lines;
+    VLogAppender* appender = new VStringVectorLogAppender("format-test-appender", VLogAppender::DO_FORMAT_OUTPUT, "[$level] $message {$thread} $unknown $$ $level", "y", &lines);
+    VLogAppenderPtr appenderPtr(appender);
+
+    // Specifiers may repeat; unknown ones, and specifiers inside the message, are left alone.
+    appender->emit(VLoggerLevel::INFO, NULL, 0, true, "costs $level 5", VString::EMPTY(), VString::EMPTY(), false, VString::EMPTY());
+    VUNIT_ASSERT_EQUAL_LABELED(lines.back(), VSTRING_FORMAT("[INFO ] costs $level 5 {%s} $unknown $$ INFO ", VThread::getCurrentThreadName().chars()), "compiled format spec");
+
+    VStringVectorLogAppender locationAppender("format-location-appender", VLogAppender::DO_FORMAT_OUTPUT, "$location$message|$specifiedlogger|$actuallogger", "y", &lines);
+    locationAppender.emit(VLoggerLevel::INFO, "file.cpp", 12, true, "msg", "spec.name", "actual.name", false, VString::EMPTY());
+    VUNIT_ASSERT_EQUAL_LABELED(lines.back(), "@ file.cpp:12: msg|spec.name|actual.name", "location and logger names");
+    locationAppender.emit(VLoggerLevel::INFO, NULL, 0, true, "msg", VString::EMPTY(), VString::EMPTY(), false, VString::EMPTY());
+    VUNIT_ASSERT_EQUAL_LABELED(lines.back(), "msg||", "empty location and logger names");
+
+    // Time stamps are cached per instant; a different instant must not reuse the cached string.
+    const VString timeFormat("y-MM-dd HH:mm:ss.SSS");
+    VStringVectorLogAppender timeAppender("format-time-appender", VLogAppender::DO_FORMAT_OUTPUT, "$utctime $message", timeFormat, &lines);
+    VLogRecord record;
+    record.capture(VLoggerLevel::INFO, NULL, 0, true, "first", VString::EMPTY(), VString::EMPTY(), false, VString::EMPTY());
+    VInstant firstWhen = record.mWhen;
+    timeAppender.emitRecord(record);
+    VUNIT_ASSERT_EQUAL_LABELED(lines.back(), firstWhen.getUTCString(VInstantFormatter(timeFormat)) + " first", "time stamp");
+    record.mMessage = "second";
+    timeAppender.emitRecord(record);
+    VUNIT_ASSERT_EQUAL_LABELED(lines.back(), firstWhen.getUTCString(VInstantFormatter(timeFormat)) + " second", "cached time stamp");
+    record.mWhen += VDuration::DAY();
+    record.mMessage = "third";
+    timeAppender.emitRecord(record);
+    VUNIT_ASSERT_EQUAL_LABELED(lines.back(), record.mWhen.getUTCString(VInstantFormatter(timeFormat)) + " third", "time stamp for a new instant");
+
+    // Benchmark: format the default spec into an appender that discards its output.
+    const int kNumIterations = 20000;
+    const VString defaultFormatSpec("$localtime $level | $thread | $location$message");
+    const VString message("benchmark message of typical length, with a value of 42 and a name of 'something'");
+    VLogAppender discardingAppender("format-benchmark-appender", VLogAppender::DO_FORMAT_OUTPUT, defaultFormatSpec, timeFormat);
+    VInstantFormatter timeFormatter(timeFormat);
+    int totalLength = 0;
+
+    Vs64 start = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < kNumIterations; ++i) {
+        totalLength += _formatByReplacement(defaultFormatSpec, timeFormatter, VLoggerLevel::INFO, message).length();
+    }
+    Vs64 replacementMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+    start = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < kNumIterations; ++i) {
+        discardingAppender.emit(VLoggerLevel::INFO, NULL, 0, true, message, VString::EMPTY(), VString::EMPTY(), false, VString::EMPTY());
+    }
+    Vs64 compiledMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+    this->logStatus(VSTRING_FORMAT("%d formatted lines (%d chars): by replacement " VSTRING_FORMATTER_S64 "us, compiled " VSTRING_FORMATTER_S64 "us.", kNumIterations, totalLength, replacementMicroseconds, compiledMicroseconds));
+    VUNIT_ASSERT_TRUE_LABELED(compiledMicroseconds < replacementMicroseconds, "compiled format is faster than replacement");
+}
+
+static int gNumArgumentEvaluations = 0;
+static int _countedArgument(int value) {
+    ++gNumArgumentEvaluations;
+    return value;
+}
+
+void VLoggerUnit::_testDeferredMessages() {
+    // Placeholders, conversions, escapes, and placeholders with no value.
+    VUNIT_ASSERT_EQUAL_LABELED(VLogDeferredMessage("no placeholders").getText(), VString("no placeholders"), "deferred message without arguments");
+    VUNIT_ASSERT_EQUAL_LABELED(VLogDeferredMessage("{} {} {} {}", 42, -7, 2.5, true).getText(), VString("42 -7 2.5 true"), "deferred message default formats");
+    VUNIT_ASSERT_EQUAL_LABELED(VLogDeferredMessage("{}{}", 'x', static_cast<Vu64>(CONST_U64(18446744073709551615))).getText(), VString("x18446744073709551615"), "deferred message char and unsigned");
+    VUNIT_ASSERT_EQUAL_LABELED(VLogDeferredMessage("[{:5d}] [{:-5d}] [{:08X}] [{:.3f}]", 12, 12, 0xBEEF, 3.14159).getText(), VString("[   12] [12   ] [0000BEEF] [3.142]"), "deferred message conversions");
+    VUNIT_ASSERT_EQUAL_LABELED(VLogDeferredMessage("[{:6}] [{:-6s}]", "ab", VString("cd")).getText(), VString("[    ab] [cd    ]"), "deferred message string widths");
+    VUNIT_ASSERT_EQUAL_LABELED(VLogDeferredMessage("[{:n}] [{:*d}] [{:l}] [{:hh5d}]", 1, 2, 3, "four").getText(), VString("[1] [2] [3] [four]"), "deferred message invalid conversions use the default text");
+    VUNIT_ASSERT_EQUAL_LABELED(VLogDeferredMessage("{{}} {} }} {{", 1).getText(), VString("{} 1 } {"), "deferred message brace escapes");
+    VUNIT_ASSERT_EQUAL_LABELED(VLogDeferredMessage("{} and {} and {:d}", 1).getText(), VString("1 and {} and {:d}"), "deferred message missing arguments");
+    VUNIT_ASSERT_EQUAL_LABELED(VLogDeferredMessage("open {", 1).getText(), VString("open {"), "deferred message unterminated placeholder");
+    VUNIT_ASSERT_EQUAL_LABELED(VLogDeferredMessage("{}", static_cast<const char*>(NULL)).getText(), VString("(null)"), "deferred message null C string");
+
+    // A copy owns its string arguments, so it can outlive the strings it was made from.
+    VLogDeferredMessage* copy = NULL;
+    /* scope for temporary strings */ {
+        VString name("session-1");
+        char buffer[16];
+        ::strcpy(buffer, "client");
+        VLogDeferredMessage original("{} {} {}", name, buffer, 3);
+        copy = new VLogDeferredMessage(original);
+        name = "overwritten";
+        ::strcpy(buffer, "XXXXXX");
+    }
+    VUNIT_ASSERT_EQUAL_LABELED(copy->getText(), VString("session-1 client 3"), "deferred message copy owns its strings");
+    VLogDeferredMessage assigned("");
+    assigned = *copy;
+    delete copy;
+    VUNIT_ASSERT_EQUAL_LABELED(assigned.getText(), VString("session-1 client 3"), "deferred message assignment owns its strings");
+
+    // The _FMT macros check the named logger's level before evaluating any argument.
+    VSharedPtr<VStringVectorLogAppender> appender(new VStringVectorLogAppender("deferred-test-appender", VLogAppender::DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), NULL));
+    VNamedLoggerPtr quietLogger(new VNamedLogger("deferredtest.quiet", VLoggerLevel::INFO, VStringVector(), appender));
+    VNamedLoggerPtr chattyLogger(new VNamedLogger("deferredtest.chatty", VLoggerLevel::TRACE, VStringVector(), appender));
+    VLogger::registerLogger(quietLogger);
+    VLogger::registerLogger(chattyLogger);
+    VNamedLoggerHandle quietHandle("deferredtest.quiet.session");
+
+    gNumArgumentEvaluations = 0;
+    VLOGGER_NAMED_DEBUG_FMT(quietHandle, "not logged {}", _countedArgument(1));
+    VLOGGER_NAMED_DEBUG(quietHandle, VSTRING_FORMAT("not logged %d", _countedArgument(2)));
+    VUNIT_ASSERT_EQUAL_LABELED(gNumArgumentEvaluations, 0, "disabled named logger evaluates no arguments");
+    VUNIT_ASSERT_TRUE_LABELED(appender->getLines().empty(), "disabled named logger emits nothing");
+
+    VLOGGER_NAMED_INFO_FMT(quietHandle, "logged {} of {}", _countedArgument(1), 2);
+    VLOGGER_NAMED_DEBUG_FMT("deferredtest.chatty", "chatty {:03d}", 7);
+    VUNIT_ASSERT_EQUAL_LABELED(gNumArgumentEvaluations, 1, "enabled named logger evaluates arguments once");
+    VUNIT_ASSERT_TRUE_LABELED((appender->getLines().size() == 2) && (appender->getLines()[0] == "logged 1 of 2") && (appender->getLines()[1] == "chatty 007"), "_FMT macros log formatted text");
+
+    VLogger::deregisterLogger(chattyLogger);
+    VLogger::deregisterLogger(quietLogger);
+
+    // An async appender queues the captured arguments and formats on its writer thread.
+    /* scope for appender lifetimes */ {
+        VSharedPtr<VStringVectorLogAppender> target(new VStringVectorLogAppender("deferred-async-target", VLogAppender::DO_FORMAT_OUTPUT, "$level|$message", VString::EMPTY(), NULL));
+        VSharedPtr<VAsyncLogAppender> asyncAppender(new VAsyncLogAppender("deferred-async", target, 64, VAsyncLogAppender::kBlock));
+        VNamedLoggerPtr asyncLogger(new VNamedLogger("deferredtest.async", VLoggerLevel::INFO, VStringVector(), asyncAppender));
+        VLogger::registerLogger(asyncLogger);
+
+        for (int i = 0; i < 100; ++i) {
+            VString transient(VSTRING_FORMAT("item-%d", i));
+            VLOGGER_NAMED_INFO_FMT("deferredtest.async", "{} is {:x}", transient, i);
+        }
+
+        VUNIT_ASSERT_TRUE_LABELED(asyncAppender->flush(10 * VDuration::SECOND()), "deferred async flush");
+        bool allFormatted = (target->getLines().size() == 100);
+        for (int i = 0; allFormatted && (i < 100); ++i) {
+            allFormatted = (target->getLines()[i] == VSTRING_FORMAT("%s|item-%d is %x", VLoggerLevel::getName(VLoggerLevel::INFO).chars(), i, i));
+        }
+        VUNIT_ASSERT_TRUE_LABELED(allFormatted, "deferred messages formatted by async appender");
+
+        VLogger::deregisterLogger(asyncLogger);
+    }
+}
+
+// Emits the same mix of messages to any appender, so binary output can be checked against text output.
+static void _emitBinaryTestMessages(VLogAppender& appender) {
+    VString sessionName("session-7");
+    VLOGGER_APPENDER_EMIT(appender, VLoggerLevel::INFO, "plain message with {braces}");
+    VLOGGER_APPENDER_EMIT(appender, VLoggerLevel::ERROR, "error message with location");
+    appender.emitDeferred(VLoggerLevel::DEBUG, NULL, 0, VLogDeferredMessage("values {} {} {:.2f} {} {} {:8}", -42, CONST_U64(7), 3.14159, true, 'c', "cstr"), "binarytest.specified", "binarytest");
+    appender.emitDeferred(VLoggerLevel::DEBUG + 2, NULL, 0, VLogDeferredMessage("{} sent {:08X} {{bytes}} to {}", sessionName, 48879, static_cast<const char*>(NULL)), "binarytest.specified", "binarytest");
+    appender.emitDeferred(VLoggerLevel::WARN, __FILE__, 1234, VLogDeferredMessage("no values"), VString::EMPTY(), "binarytest");
+    appender.emit(VLoggerLevel::INFO, NULL, 0, true, "header line", VString::EMPTY(), VString::EMPTY(), true, "raw continuation line");
+    appender.emitRaw("raw line only");
+}
+
+void VLoggerUnit::_testBinaryAppender() {
+    VFSNode tempDir = VFSNode::getKnownDirectoryNode(VFSNode::CACHED_DATA_DIRECTORY, "vault", "unittest");
+    VFSNode testDir(tempDir, "vloggerunit_binary_temp");
+    (void) testDir.rm();
+
+    const VString formatSpec("$level|$thread|$specifiedlogger|$actuallogger|$location$message");
+
+    // Decoding reproduces what a text appender with the same format spec writes.
+    VStringVectorLogAppender expected("binary-test-expected", VLogAppender::DO_FORMAT_OUTPUT, formatSpec, VString::EMPTY(), NULL);
+    VString segmentPath;
+    /* scope for appender lifetime */ {
+        VBinaryLogAppender appender("binary-test", testDir.getPath(), "roundtrip");
+        segmentPath = appender.getCurrentFilePath();
+        _emitBinaryTestMessages(expected);
+        _emitBinaryTestMessages(appender);
+
+        // The records can be read while the segment is still being written; the unused space ends them.
+        VStringVectorLogAppender partial("binary-test-partial", VLogAppender::DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), NULL);
+        VBinaryLogDecoder partialDecoder(partial);
+        VUNIT_ASSERT_EQUAL_LABELED(partialDecoder.decodeFile(VFSNode(segmentPath)), 8, "binary decode of open segment");
+        VUNIT_ASSERT_TRUE_LABELED(VFSNode(segmentPath).size() == (VFSize) VBinaryLogAppender::kDefaultSegmentSize, "binary segment is preallocated");
+    }
+
+    VUNIT_ASSERT_TRUE_LABELED(VFSNode(segmentPath).size() < (VFSize) 4096, "binary segment trimmed on close");
+    VStringVectorLogAppender decoded("binary-test-decoded", VLogAppender::DO_FORMAT_OUTPUT, formatSpec, VString::EMPTY(), NULL);
+    VBinaryLogDecoder decoder(decoded);
+    VUNIT_ASSERT_EQUAL_LABELED(decoder.decodeFile(VFSNode(segmentPath)), 8, "binary decode record count");
+    VUNIT_ASSERT_EQUAL_LABELED((int) decoded.getLines().size(), (int) expected.getLines().size(), "binary decode line count");
+    for (int i = 0; (i < (int) decoded.getLines().size()) && (i < (int) expected.getLines().size()); ++i) {
+        VUNIT_ASSERT_EQUAL_LABELED(decoded.getLines()[i], expected.getLines()[i], VSTRING_FORMAT("binary decode line %d", i));
+    }
+
+    // A record keeps the time and thread name it was logged with.
+    /* scope for appender lifetime */ {
+        VLogRecord record;
+        record.capture(VLoggerLevel::INFO, NULL, 0, true, "recorded message", VString::EMPTY(), "binarytest", false, VString::EMPTY());
+        record.mWhen -= VDuration::DAY();
+        record.mTrueWhen = record.mWhen;
+        record.mThreadName = "recorded-thread";
+
+        VStringVectorLogAppender recordExpected("binary-test-record-expected", VLogAppender::DO_FORMAT_OUTPUT, "$utctime|$thread|$message", VString::EMPTY(), NULL);
+        VBinaryLogAppender appender("binary-test-record", testDir.getPath(), "record");
+        recordExpected.emitRecord(record);
+        appender.emitRecord(record);
+
+        VStringVectorLogAppender recordDecoded("binary-test-record-decoded", VLogAppender::DO_FORMAT_OUTPUT, "$utctime|$thread|$message", VString::EMPTY(), NULL);
+        VBinaryLogDecoder recordDecoder(recordDecoded);
+        (void) recordDecoder.decodeFile(VFSNode(appender.getCurrentFilePath()));
+        VUNIT_ASSERT_TRUE_LABELED((recordDecoded.getLines().size() == 1) && (recordDecoded.getLines() == recordExpected.getLines()), "binary decode keeps time and thread name");
+    }
+
+    // Logging with the _FMT macros through a named logger.
+    /* scope for appender lifetime */ {
+        VSharedPtr<VBinaryLogAppender> appender(new VBinaryLogAppender("binary-test-logger", testDir.getPath(), "logger"));
+        VNamedLoggerPtr logger(new VNamedLogger("binarytest.logger", VLoggerLevel::DEBUG, VStringVector(), appender));
+        VLogger::registerLogger(logger);
+        VLOGGER_NAMED_DEBUG_FMT("binarytest.logger", "request {} took {:.1f}ms", 17, 2.25);
+        VLOGGER_NAMED_TRACE_FMT("binarytest.logger", "not logged {}", 1);
+        VLogger::deregisterLogger(logger);
+
+        VStringVectorLogAppender loggerOutput("binary-test-logger-output", VLogAppender::DO_FORMAT_OUTPUT, "$actuallogger|$message", VString::EMPTY(), NULL);
+        VBinaryLogDecoder loggerDecoder(loggerOutput);
+        (void) loggerDecoder.decodeFile(VFSNode(appender->getCurrentFilePath()));
+        VUNIT_ASSERT_TRUE_LABELED((loggerOutput.getLines().size() == 1) && (loggerOutput.getLines()[0] == "binarytest.logger|request 17 took 2.2ms"), "binary appender via _FMT macro");
+    }
+
+    // Small segments: each stands alone, old ones are removed, and an oversized record gets a segment of its own size.
+    VString bigMessage;
+    for (int i = 0; i < 1000; ++i) {
+        bigMessage += "0123456789";
+    }
+
+    /* scope for appender lifetime */ {
+        VBinaryLogAppender appender("binary-test-segments", testDir.getPath(), "segments", 4096, 3);
+        for (int i = 0; i < 1000; ++i) {
+            appender.emitDeferred(VLoggerLevel::INFO, NULL, 0, VLogDeferredMessage("segment test {}", i), VString::EMPTY(), "binarytest");
+        }
+
+        VLOGGER_APPENDER_EMIT(appender, VLoggerLevel::INFO, bigMessage);
+        VLOGGER_APPENDER_EMIT(appender, VLoggerLevel::INFO, "after the big message");
+    }
+
+    VStringVector segmentNames = _getRollingFileNames(testDir, "segments_");
+    VUNIT_ASSERT_EQUAL_LABELED((int) segmentNames.size(), 3, "binary appender kept max-segments");
+    VStringVectorLogAppender segmentOutput("binary-test-segment-output", VLogAppender::DO_FORMAT_OUTPUT, "$actuallogger|$message", VString::EMPTY(), NULL);
+    VBinaryLogDecoder segmentDecoder(segmentOutput);
+    bool segmentsDecoded = true;
+    for (VStringVector::const_iterator i = segmentNames.begin(); i != segmentNames.end(); ++i) {
+        segmentsDecoded = segmentsDecoded && (segmentDecoder.decodeFile(VFSNode(testDir, *i)) > 0);
+    }
+    // The first kept segment was written long after the logger name was first used, so it must have its own definition.
+    VUNIT_ASSERT_TRUE_LABELED(segmentsDecoded && (segmentOutput.getLines().size() >= 3) && segmentOutput.getLines()[0].startsWith("binarytest|segment test "), "binary segments decode independently");
+    VUNIT_ASSERT_TRUE_LABELED((segmentOutput.getLines().size() >= 3) &&
+        (segmentOutput.getLines()[segmentOutput.getLines().size() - 3] == "binarytest|segment test 999") &&
+        (segmentOutput.getLines()[segmentOutput.getLines().size() - 2] == VString("|") + bigMessage) &&
+        (segmentOutput.getLines()[segmentOutput.getLines().size() - 1] == "|after the big message"), "binary segments decode in order, with oversized record");
+
+    // Deleting old segments leaves alone another series whose prefix starts with ours.
+    /* scope for appender lifetime */ {
+        VFSNode otherSegment(testDir, "collide_other_20000101000000000.vlogbin");
+        _createEmptyFile(otherSegment);
+
+        VBinaryLogAppender appender("binary-test-collide", testDir.getPath(), "collide", 4096, 1);
+        for (int i = 0; i < 500; ++i) {
+            appender.emitDeferred(VLoggerLevel::INFO, NULL, 0, VLogDeferredMessage("collision test {}", i), VString::EMPTY(), "binarytest");
+        }
+
+        VUNIT_ASSERT_TRUE_LABELED(otherSegment.exists(), "binary appender keeps another series' segments");
+        VUNIT_ASSERT_EQUAL_LABELED((int) _getRollingFileNames(testDir, "collide_").size(), 2, "binary appender kept max-segments plus others");
+    }
+
+    // Not a binary log.
+    try {
+        VFSNode textFile(testDir, "not-binary.txt");
+        VBufferedFileStream textStream(textFile);
+        textStream.openWrite();
+        VTextIOStream(textStream).writeLine("this is a text file");
+        textStream.close();
+        (void) segmentDecoder.decodeFile(textFile);
+        VUNIT_ASSERT_FAILURE("binary decoder rejects other files");
+    } catch (const VException& /*ex*/) {
+        VUNIT_ASSERT_SUCCESS("binary decoder rejects other files");
+    }
+
+    // Configured from settings.
+    /* scope for appender lifetime */ {
+        VSettings settings;
+        settings.addStringValue("name", "binary-settings");
+        settings.addStringValue("dir", testDir.getPath());
+        settings.addIntValue("segment-size", 65536);
+        VSettings defaults;
+        VBinaryLogAppender appender(settings, defaults);
+        VUNIT_ASSERT_TRUE_LABELED(VFSNode(appender.getCurrentFilePath()).getName().startsWith("binary-settings_"), "binary appender default prefix is the name");
+        VUNIT_ASSERT_TRUE_LABELED(VFSNode(appender.getCurrentFilePath()).size() == (VFSize) 65536, "binary appender segment-size setting");
+    }
+
+    // Benchmark: what the logging thread pays per message, formatted text to a buffered file vs. binary.
+    /* scope for appender lifetimes */ {
+        const int kNumMessages = 50000;
+        VRollingFileLogAppender textAppender("binary-bench-text", VLogAppender::DO_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), testDir.getPath(), "benchtext", 0);
+        VBinaryLogAppender binaryAppender("binary-bench-binary", testDir.getPath(), "benchbinary");
+        VString sessionName("10.0.0.1:5000");
+
+        Vs64 start = VDeadline::monotonicMicroseconds();
+        for (int i = 0; i < kNumMessages; ++i) {
+            textAppender.emitDeferred(VLoggerLevel::DEBUG, NULL, 0, VLogDeferredMessage("session {} request {} took {:.3f}ms", sessionName, i, i * 0.25), VString::EMPTY(), "binarytest");
+        }
+        Vs64 textMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+        start = VDeadline::monotonicMicroseconds();
+        for (int i = 0; i < kNumMessages; ++i) {
+            binaryAppender.emitDeferred(VLoggerLevel::DEBUG, NULL, 0, VLogDeferredMessage("session {} request {} took {:.3f}ms", sessionName, i, i * 0.25), VString::EMPTY(), "binarytest");
+        }
+        Vs64 binaryMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+        this->logStatus(VSTRING_FORMAT("Logging %d messages: text " VSTRING_FORMATTER_S64 "us, binary " VSTRING_FORMATTER_S64 "us.", kNumMessages, textMicroseconds, binaryMicroseconds));
+        VUNIT_ASSERT_TRUE_LABELED(binaryMicroseconds < textMicroseconds, "binary logging is faster than text logging");
+    }
+
+    (void) testDir.rm();
+}
+
+void VLoggerUnit::_testRateLimiting() {
+    // Freezing time lets us say exactly how many tokens the bucket gets back.
+    VInstant startTime;
+    VInstant::freezeTime(startTime);
+
+    VStringVectorLogger logger("rate-limit-test", VLoggerLevel::INFO, NULL);
+    logger.setRateLimit(10.0, 5, 1.0, VLoggerLevel::ERROR, VDuration::SECOND());
+    for (int i = 0; i < 20; ++i) {
+        logger.log(VLoggerLevel::INFO, VSTRING_FORMAT("burst %d", i));
+    }
+    VUNIT_ASSERT_EQUAL_LABELED((int) logger.getLines().size(), 5, "rate limit passes the burst");
+    VUNIT_ASSERT_TRUE_LABELED(logger.getLines()[4].endsWith("burst 4"), "rate limit passes the first messages");
+
+    logger.log(VLoggerLevel::FATAL, "fatal during flood");
+    VUNIT_ASSERT_EQUAL_LABELED((int) logger.getLines().size(), 6, "rate limit passes messages more severe than its level");
+
+    // 200ms at 10 per second is 2 more tokens.
+    VInstant::freezeTime(startTime + 200 * VDuration::MILLISECOND());
+    for (int i = 0; i < 5; ++i) {
+        logger.log(VLoggerLevel::INFO, NULL, 0, VLogDeferredMessage("refill {}", i));
+    }
+    VUNIT_ASSERT_EQUAL_LABELED((int) logger.getLines().size(), 8, "rate limit refills at the rate");
+
+    // Once the report interval has passed, the next message is preceded by a report of what was dropped.
+    VInstant::freezeTime(startTime + 1500 * VDuration::MILLISECOND());
+    logger.log(VLoggerLevel::INFO, "after the report interval");
+    VUNIT_ASSERT_TRUE_LABELED((logger.getLines().size() == 10) &&
+        logger.getLines()[8].contains("Rate limiting dropped 18 messages (18 over the rate limit, 0 not sampled).") &&
+        logger.getLines()[9].endsWith("after the report interval"), "rate limit reports dropped messages");
+
+    // A burst after a quiet period gets the whole bucket again, but no more.
+    VInstant::freezeTime(startTime + 60 * VDuration::SECOND());
+    for (int i = 0; i < 10; ++i) {
+        logger.log(VLoggerLevel::WARN, VSTRING_FORMAT("second burst %d", i));
+    }
+    VUNIT_ASSERT_EQUAL_LABELED((int) logger.getLines().size(), 15, "rate limit bucket is capped at the burst size");
+
+    // Turning the limit off reports what is still pending.
+    logger.setRateLimit(0.0, 0, 1.0, VLoggerLevel::ERROR, VDuration::SECOND());
+    VUNIT_ASSERT_TRUE_LABELED((logger.getLines().size() == 16) && logger.getLines()[15].contains("Rate limiting dropped 5 messages"), "rate limit reports when reconfigured");
+    for (int i = 0; i < 50; ++i) {
+        logger.log(VLoggerLevel::INFO, VSTRING_FORMAT("unlimited %d", i));
+    }
+    VUNIT_ASSERT_EQUAL_LABELED((int) logger.getLines().size(), 66, "rate limit can be turned off");
+
+    VInstant::unfreezeTime();
+
+    // Sampling passes about the configured fraction of messages.
+    VStringVectorLogger sampledLogger("sample-rate-test", VLoggerLevel::INFO, NULL);
+    sampledLogger.setRepetitionFilterEnabled(false);
+    sampledLogger.setRateLimit(0.0, 0, 0.25, VLoggerLevel::ERROR, VDuration::MINUTE());
+    for (int i = 0; i < 4000; ++i) {
+        sampledLogger.log(VLoggerLevel::INFO, "sampled");
+    }
+    int numSampled = (int) sampledLogger.getLines().size();
+    this->logStatus(VSTRING_FORMAT("Sampling at 0.25 passed %d of 4000 messages.", numSampled));
+    VUNIT_ASSERT_TRUE_LABELED((numSampled > 800) && (numSampled < 1200), "sampling passes about the sample rate"); // more than 6 standard deviations either way
+
+    sampledLogger.setRateLimit(0.0, 0, 0.0, VLoggerLevel::ERROR, VDuration::MINUTE());
+    VUNIT_ASSERT_TRUE_LABELED(sampledLogger.getLines()[numSampled].contains(VSTRING_FORMAT("(0 over the rate limit, %d not sampled)", 4000 - numSampled)), "sampling reports dropped messages");
+    for (int i = 0; i < 100; ++i) {
+        sampledLogger.log(VLoggerLevel::ERROR, "error while sampling at zero");
+    }
+    sampledLogger.log(VLoggerLevel::FATAL, "fatal while sampling at zero");
+    VUNIT_ASSERT_TRUE_LABELED((sampledLogger.getLines().size() == (size_t) numSampled + 2) && sampledLogger.getLines().back().endsWith("fatal while sampling at zero"), "sampling at zero drops all but the exempt levels");
+
+    // Configured from settings and by command.
+    VSettings settings;
+    settings.addStringValue("name", "vloggerunit.ratelimit");
+    settings.addStringValue("level", "60");
+    settings.addStringValue("rate-limit", "100");
+    settings.addStringValue("sample-rate", "0.5");
+    settings.addIntValue("rate-limit-level", VLoggerLevel::WARN);
+    VLogger::installNewNamedLogger(settings);
+    VNamedLoggerPtr configuredLogger = VLogger::findNamedLogger("vloggerunit.ratelimit");
+    VUNIT_ASSERT_TRUE_LABELED(configuredLogger != NULL, "rate limited logger installed from settings");
+    if (configuredLogger != NULL) {
+        VBentoNode info;
+        configuredLogger->addInfo(info);
+        VUNIT_ASSERT_TRUE_LABELED(info.getBool("rate-limit-enabled", false) && (info.getDouble("rate-limit", 0.0) == 100.0) &&
+            (info.getDouble("rate-limit-burst", 0.0) == 100.0) && (info.getDouble("sample-rate", 0.0) == 0.5) && (info.getInt("rate-limit-level", 0) == VLoggerLevel::WARN), "rate limit settings");
+
+        VLogger::commandSetRateLimit("vloggerunit.ratelimit", 0.0, 0, 1.0, VLoggerLevel::ERROR, VDuration::MINUTE());
+        VBentoNode commandInfo;
+        configuredLogger->addInfo(commandInfo);
+        VUNIT_ASSERT_FALSE_LABELED(commandInfo.getBool("rate-limit-enabled", true), "rate limit turned off by command");
+        VLogger::deregisterLogger(configuredLogger);
+    }
+}
+
+void VLoggerUnit::_testFlightRecorder() {
+    // This thread has no ring yet, since nothing has been recorded; it gets the capacity in effect when it first records.
+    VLogFlightRecorder::setCapacity(8);
+    VLogFlightRecorder::setLevel(VLoggerLevel::TRACE);
+    VUNIT_ASSERT_TRUE_LABELED(VLogger::isLogLevelActive(VLoggerLevel::TRACE), "flight recorder level is active");
+
+    // Messages below the logger's level are recorded but not emitted.
+    VStringVectorLogger logger("flight-recorder-test", VLoggerLevel::INFO, NULL);
+    VString stringValue("string value");
+    logger.log(VLoggerLevel::TRACE, "trace message");
+    logger.log(VLoggerLevel::DEBUG, NULL, 0, VLogDeferredMessage("deferred {} '{}' {}", 42, stringValue, (const char*) NULL));
+    logger.log(VLoggerLevel::INFO, "info message");
+    stringValue = "changed after logging";
+    VUNIT_ASSERT_EQUAL_LABELED((int) logger.getLines().size(), 1, "flight recorder does not emit");
+
+    VStringVectorLogAppender output("flight-recorder-output", VLogAppender::DO_FORMAT_OUTPUT, "$actuallogger|$message", VString::EMPTY(), NULL);
+    VUNIT_ASSERT_EQUAL_LABELED(VLogFlightRecorder::emitCurrentThread(output), 3, "flight recorder emits recorded messages");
+    VUNIT_ASSERT_TRUE_LABELED((output.getLines().size() == 3) &&
+        output.getLines()[0].endsWith("flight-recorder-test|trace message") &&
+        output.getLines()[1].endsWith("flight-recorder-test|deferred 42 'string value' (null)") &&
+        output.getLines()[2].endsWith("flight-recorder-test|info message"), "flight recorder records messages and copies values");
+
+    // The macros pass messages that only the flight recorder wants to a registered logger.
+    VNamedLoggerPtr registeredLogger(new VStringVectorLogger("vloggerunit.flightrecorder", VLoggerLevel::INFO, NULL));
+    VLogger::registerLogger(registeredLogger);
+    VLOGGER_NAMED_TRACE("vloggerunit.flightrecorder", "trace via macro");
+    VLOGGER_NAMED_LEVEL_FMT("vloggerunit.flightrecorder", VLoggerLevel::DEBUG, "debug via {}", "macro");
+    VLogger::deregisterLogger(registeredLogger);
+    VStringVectorLogAppender macroOutput("flight-recorder-macro-output", VLogAppender::DO_FORMAT_OUTPUT, "$actuallogger|$message", VString::EMPTY(), NULL);
+    (void) VLogFlightRecorder::emitCurrentThread(macroOutput);
+    VUNIT_ASSERT_TRUE_LABELED((macroOutput.getLines().size() == 5) &&
+        macroOutput.getLines()[3].endsWith("vloggerunit.flightrecorder|trace via macro") &&
+        macroOutput.getLines()[4].endsWith("vloggerunit.flightrecorder|debug via macro"), "flight recorder records through macros");
+
+    // The ring keeps the most recent messages, and truncates long ones.
+    for (int i = 0; i < 20; ++i) {
+        logger.log(VLoggerLevel::TRACE, VSTRING_FORMAT("wrap %d", i));
+    }
+    const VString longText(std::string(1000, 'x').c_str());
+    logger.log(VLoggerLevel::TRACE, longText);
+    VStringVectorLogAppender wrapOutput("flight-recorder-wrap-output", VLogAppender::DO_FORMAT_OUTPUT, "$message", VString::EMPTY(), NULL);
+    VUNIT_ASSERT_EQUAL_LABELED(VLogFlightRecorder::emitCurrentThread(wrapOutput), 8, "flight recorder ring wraps");
+    VUNIT_ASSERT_TRUE_LABELED((wrapOutput.getLines().size() == 8) && wrapOutput.getLines()[0].endsWith("wrap 13") && wrapOutput.getLines()[6].endsWith("wrap 19") &&
+        (wrapOutput.getLines()[7].length() == VLogFlightRecorder::kMaxTextLength), "flight recorder keeps the latest messages");
+
+    VStringVectorLogAppender allOutput("flight-recorder-all-output", VLogAppender::DO_FORMAT_OUTPUT, "$message", VString::EMPTY(), NULL);
+    VUNIT_ASSERT_TRUE_LABELED(VLogFlightRecorder::emitAllThreads(allOutput) >= 8, "flight recorder emits all threads");
+    VUNIT_ASSERT_TRUE_LABELED(allOutput.getLines().size() >= 9 && allOutput.getLines()[0].startsWith("--- Thread '"), "flight recorder names each thread");
+
+    // Dumping writes a file.
+    VFSNode tempDir = VFSNode::getKnownDirectoryNode(VFSNode::CACHED_DATA_DIRECTORY, "vault", "unittest");
+    VFSNode testDir(tempDir, "vloggerunit_flightrecorder_temp");
+    (void) testDir.rm();
+    VLogFlightRecorder::setDumpDirectory(testDir);
+    VString dumpPath = VLogFlightRecorder::dumpCurrentThread("flight recorder test dump");
+    VUNIT_ASSERT_TRUE_LABELED(dumpPath.isNotEmpty() && VFSNode(dumpPath).exists(), "flight recorder dump file written");
+    if (dumpPath.isNotEmpty()) {
+        VString dumpText;
+        VFSNode(dumpPath).readAll(dumpText);
+        VUNIT_ASSERT_TRUE_LABELED(dumpText.contains("flight recorder test dump") && dumpText.contains("| flight-recorder-test | wrap 19"), "flight recorder dump file contents");
+    }
+
+    (void) testDir.rm();
+    VLogFlightRecorder::threadEnded();
+    VUNIT_ASSERT_EQUAL_LABELED(VLogFlightRecorder::emitCurrentThread(wrapOutput), 0, "flight recorder ring released");
+
+    // The released ring is kept for reuse, emptied when the next thread claims it.
+    logger.log(VLoggerLevel::TRACE, "after release");
+    VStringVectorLogAppender reuseOutput("flight-recorder-reuse-output", VLogAppender::DO_FORMAT_OUTPUT, "$message", VString::EMPTY(), NULL);
+    VUNIT_ASSERT_EQUAL_LABELED(VLogFlightRecorder::emitCurrentThread(reuseOutput), 1, "flight recorder reused ring starts empty");
+    VLogFlightRecorder::threadEnded();
+
+    // Turning it off restores the normal level checks, which later tests depend on.
+    VLogFlightRecorder::setLevel(VLoggerLevel::OFF);
+    VLogFlightRecorder::setCapacity(VLogFlightRecorder::kDefaultCapacity);
+    VLogFlightRecorder::setDumpDirectory(VFSNode());
+    logger.log(VLoggerLevel::TRACE, "not recorded");
+    VUNIT_ASSERT_EQUAL_LABELED(VLogFlightRecorder::emitCurrentThread(wrapOutput), 0, "flight recorder off");
+}
+
+void VLoggerUnit::_testHexDump() {
+    const int kDataLength = 100000;
+    std::vector<Vu8> data(kDataLength);
+    for (int i = 0; i < kDataLength; ++i) {
+        data[i] = static_cast<Vu8>(i * 7);
+    }
+
+    // A large dump reaches the appenders in several chunks, which together are the whole dump.
+    VStringVectorLogger logger("hex-dump-test", VLoggerLevel::INFO, NULL, VLogAppender::DO_FORMAT_OUTPUT, "$message");
+    logger.logHexDump(VLoggerLevel::INFO, "large dump", VString::EMPTY(), &data[0], kDataLength);
+    VStringVector lines = logger.getLines();
+    VUNIT_ASSERT_TRUE_LABELED((lines.size() > 10) && (lines[0] == "large dump"), "hex dump is emitted in chunks");
+
+    VMemoryStream   dumpBuffer;
+    VTextIOStream   dumpStream(dumpBuffer);
+    for (size_t i = 1; i < lines.size(); ++i) {
+        dumpStream.writeLine(lines[i]);
+    }
+    dumpStream.writeLine(VString::EMPTY());
+    dumpStream.seek0();
+    VMemoryStream   reconstructedBuffer;
+    VBinaryIOStream reconstructedStream(reconstructedBuffer);
+    VHex::readHexDump(dumpStream, reconstructedStream);
+    VUNIT_ASSERT_TRUE_LABELED((reconstructedBuffer.getEOFOffset() == kDataLength) && (::memcmp(reconstructedBuffer.getBuffer(), &data[0], kDataLength) == 0), "hex dump chunks reconstruct the data");
+
+    // A limit cuts the dump short and says so.
+    logger.setHexDumpMaxBytes(40);
+    logger.logHexDump(VLoggerLevel::INFO, "limited dump", VString::EMPTY(), &data[0], kDataLength);
+    lines = logger.getLines();
+    VUNIT_ASSERT_TRUE_LABELED((lines.size() >= 2) && (lines[lines.size() - 2] == "limited dump") && lines.back().contains("00000032: ") &&
+        !lines.back().contains("00000048: ") && lines.back().endsWith("(99960 more bytes not shown)"), "hex dump max bytes");
+
+    VSettings settings;
+    settings.addStringValue("name", "vloggerunit.hexdump");
+    settings.addIntValue("hex-dump-max-bytes", 1024);
+    VLogger::installNewNamedLogger(settings);
+    VNamedLoggerPtr configuredLogger = VLogger::findNamedLogger("vloggerunit.hexdump");
+    VUNIT_ASSERT_TRUE_LABELED((configuredLogger != NULL) && (configuredLogger->getHexDumpMaxBytes() == 1024), "hex dump max bytes setting");
+    if (configuredLogger != NULL) {
+        VLogger::deregisterLogger(configuredLogger);
+    }
+}
+
+class TestSnapshotLoggingThread : public VThread {
+    public:
+
+        TestSnapshotLoggingThread(const VString& name, int numMessages)
+            : VThread(name, "vault.toolbox.TestSnapshotLoggingThread", VThread::kDontDeleteSelfAtEnd, VThread::kCreateThreadJoinable, NULL)
+            , mNumMessages(numMessages)
+            {}
+        virtual ~TestSnapshotLoggingThread() {}
+
+        virtual void run() {
+            VNamedLoggerHandle handle("snapshottest.worker");
+            for (int i = 0; i < mNumMessages; ++i) {
+                if ((i % 2) == 0) {
+                    VLOGGER_NAMED_INFO("snapshottest.worker", VSTRING_FORMAT("%d", i));
+                } else {
+                    VLOGGER_NAMED_INFO(handle, VSTRING_FORMAT("%d", i));
+                }
+            }
+        }
+
+    private:
+
+        TestSnapshotLoggingThread(const TestSnapshotLoggingThread&); // not copyable
+        TestSnapshotLoggingThread& operator=(const TestSnapshotLoggingThread&); // not assignable
+
+        int mNumMessages;
+};
+
+void VLoggerUnit::_testConfigurationSnapshots() {
+    // A replaced configuration is deleted as soon as no thread is reading it, so removing an appender lets it go.
+    VSharedPtr<VStringVectorLogAppender> appender(new VStringVectorLogAppender("snapshot-test-appender", VLogAppender::DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), NULL));
+    int generation = VLogger::gLoggersGeneration;
+    VLogger::registerLogAppender(appender);
+    VUNIT_ASSERT_TRUE_LABELED(VLogger::gLoggersGeneration > generation, "registering publishes a new configuration");
+    VUNIT_ASSERT_TRUE_LABELED(VLogger::findAppender("snapshot-test-appender") == appender, "registered appender found");
+    VLogger::deregisterLogAppender(appender);
+    VUNIT_ASSERT_TRUE_LABELED(VLogger::findAppender("snapshot-test-appender") == nullptr, "removed appender not found");
+    VUNIT_ASSERT_EQUAL_LABELED((int) appender.use_count(), 1, "removed appender released by old configurations");
+
+    // Threads log through a logger that finds its appender by name, while the configuration is replaced repeatedly.
+    // Every message arrives, and every configuration is released afterward.
+    VLogger::registerLogAppender(appender);
+    VNamedLoggerPtr workerLogger(new VNamedLogger("snapshottest.worker", VLoggerLevel::INFO, VStringVector(1, "snapshot-test-appender")));
+    VLogger::registerLogger(workerLogger);
+
+    const int kNumThreads = 4;
+    const int kNumMessagesPerThread = 2000;
+    std::vector<TestSnapshotLoggingThread*> threads;
+    for (int i = 0; i < kNumThreads; ++i) {
+        threads.push_back(new TestSnapshotLoggingThread(VSTRING_FORMAT("snapshot-logger-%d", i), kNumMessagesPerThread));
+        threads.back()->start();
+    }
+
+    VSharedPtr<VStringVectorLogAppender> churnAppender(new VStringVectorLogAppender("snapshot-test-churn", VLogAppender::DONT_FORMAT_OUTPUT, VString::EMPTY(), VString::EMPTY(), NULL));
+    for (int i = 0; i < 200; ++i) {
+        VNamedLoggerPtr churnLogger(new VNamedLogger(VSTRING_FORMAT("snapshottest.worker.churn%d", i), VLoggerLevel::INFO, VStringVector(1, "snapshot-test-churn")));
+        VLogger::registerLogAppender(churnAppender);
+        VLogger::registerLogger(churnLogger);
+        VLogger::deregisterLogger(churnLogger);
+        VLogger::deregisterLogAppender(churnAppender);
+    }
+
+    for (int i = 0; i < kNumThreads; ++i) {
+        threads[i]->join();
+        delete threads[i];
+    }
+
+    VLogger::deregisterLogger(workerLogger);
+    VLogger::deregisterLogAppender(appender);
+
+    VUNIT_ASSERT_EQUAL_LABELED((int) appender->getLines().size(), kNumThreads * kNumMessagesPerThread, "messages logged during reconfiguration");
+    VUNIT_ASSERT_EQUAL_LABELED((int) churnAppender->getLines().size(), 0, "no messages to the churned logger");
+    VUNIT_ASSERT_EQUAL_LABELED((int) appender.use_count(), 1, "appender released after reconfiguration");
+    VUNIT_ASSERT_EQUAL_LABELED((int) churnAppender.use_count(), 1, "churned appender released after reconfiguration");
+    VUNIT_ASSERT_EQUAL_LABELED((int) workerLogger.use_count(), 1, "logger released after reconfiguration");
+}
@@ -43,6 +43,16 @@ class VLoggerUnit : public VUnit {
         void _testLoggerPathNames();
         void _testSmartPtrLifecycle();
         void _testOptimizationPerformance();
+        void _testAsyncAppender();
+        void _testRollingFileAppender();
+        void _testNamedLoggerHandles();
+        void _testFormatSpecs();
+        void _testDeferredMessages();
+        void _testBinaryAppender();
+        void _testRateLimiting();
+        void _testFlightRecorder();
+        void _testHexDump();
+        void _testConfigurationSnapshots();
 
 };
 
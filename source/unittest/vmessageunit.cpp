@@ -10,6 +10,7 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vmessageunit.h"
 
 #include "vmessage.h"
+#include "vmessagequeue.h"
 #include "vcompactingdeque.h"
 
 class TestMessage;
@@ -88,6 +89,36 @@ class TestMessageFactory : public VMessageFactory {
         virtual VMessagePtr instantiateNewMessage(VMessageID messageID) const { return TestMessage::factory(messageID); }
 };
 
+// Posts messages to a queue at irregular short intervals, so that some posts land while the reader is
+// spinning, some while it is parking, and some while it is parked.
+class TestMessagePosterThread : public VThread {
+    public:
+
+        TestMessagePosterThread(VMessageQueue& queue, int numMessages)
+            : VThread("TestMessagePosterThread", "vault.test.TestMessagePosterThread", kDontDeleteSelfAtEnd, kCreateThreadJoinable, NULL)
+            , mQueue(queue)
+            , mNumMessages(numMessages)
+            {}
+        virtual ~TestMessagePosterThread() {}
+
+        virtual void run() {
+            for (int i = 0; i < mNumMessages; ++i) {
+                if ((i % 3) == 0) {
+                    VThread::sleep(VDuration::MILLISECOND());
+                } else if ((i % 3) == 1) {
+                    VThread::yield();
+                }
+
+                mQueue.postMessage(TestMessage::factory(static_cast<VMessageID>(i)));
+            }
+        }
+
+    private:
+
+        VMessageQueue&  mQueue;
+        int             mNumMessages;
+};
+
 VMessageUnit::VMessageUnit(bool logOnSuccess, bool throwOnError) :
     VUnit("VMessageUnit", logOnSuccess, throwOnError) {
 }
@@ -156,5 +187,55 @@ void VMessageUnit::run() {
     VUNIT_ASSERT_EQUAL(q.mHighWaterMark, (size_t) 4); // <- verifies that pop_back updated mHighWaterMark to max before pop
     VUNIT_ASSERT_EQUAL(q.mHighWaterMarkRequired, HWM);
     VUNIT_ASSERT_EQUAL(q.mLowWaterMarkRequired, LWM);
+
+    this->_testMessageQueueBlocking();
+}
+
+void VMessageUnit::_testMessageQueueBlocking() {
+    // wakeUp() with nobody blocked makes the next block return at once.
+    /* wake up scope */ {
+        VMessageQueue queue;
+        queue.wakeUp();
+        VInstant start;
+        VMessagePtr message = queue.blockUntilNextMessage();
+        VUNIT_ASSERT_TRUE_LABELED(message == nullptr, "woken queue returns no message");
+        VUNIT_ASSERT_TRUE_LABELED(VDuration(start) < VDuration::SECOND(), "woken queue returns promptly");
+    }
+
+    // With and without spinning, every post must wake the reader promptly. A lost wake-up shows up as
+    // a multi-second stall waiting for the park timeout.
+    const int kNumMessages = 300;
+    const int oldSpinCount = VMessageQueue::getBlockingSpinCount();
+    for (int pass = 0; pass < 2; ++pass) {
+        VMessageQueue::setBlockingSpinCount((pass == 0) ? oldSpinCount : 0);
+
+        VMessageQueue queue;
+        TestMessagePosterThread poster(queue, kNumMessages);
+        VInstant start;
+        VDuration longestWait = VDuration::ZERO();
+        int numReceived = 0;
+        bool inOrder = true;
+
+        poster.start();
+        while (numReceived < kNumMessages) {
+            VInstant waitStart;
+            VMessagePtr message = queue.blockUntilNextMessage();
+            longestWait = V_MAX(longestWait, VDuration(waitStart));
+            if (message == nullptr) {
+                break; // park timeout; the assertions below report it
+            }
+
+            inOrder = inOrder && (message->getMessageID() == static_cast<VMessageID>(numReceived));
+            ++numReceived;
+        }
+        VThread::threadJoin(poster.threadID(), NULL);
+
+        VString label(VSTRING_FORMAT("message queue blocking, spin count %d", VMessageQueue::getBlockingSpinCount()));
+        VUNIT_ASSERT_EQUAL_LABELED(numReceived, kNumMessages, label + ": all messages received");
+        VUNIT_ASSERT_TRUE_LABELED(inOrder, label + ": messages in order");
+        VUNIT_ASSERT_TRUE_LABELED(longestWait < VDuration::SECOND(), VSTRING_FORMAT("%s: longest wait %s", label.chars(), longestWait.getDurationString().chars()));
+        this->logStatus(VSTRING_FORMAT("%s: %d messages in %s, longest wait %s.", label.chars(), numReceived, VDuration(start).getDurationString().chars(), longestWait.getDurationString().chars()));
+    }
+    VMessageQueue::setBlockingSpinCount(oldSpinCount);
 }
 
@@ -23,6 +23,13 @@ void VPlatformUnit::run() {
     this->_runMinMaxAbsCheck();
     this->_runTimeCheck();
     this->_runUtilitiesTest();
+    this->_runDatagramSocketTests();
+    this->_runLocalSocketTests();
+    this->_runSocketStatisticsTests();
+    this->_runSocketTuningProfileTests();
+    this->_runSocketTuningProfileBenchmark(VDuration::MILLISECOND() * 20, CONST_S64(256) * 1024); // quick smoke run of each profile
+//    this->_runSocketTuningProfileBenchmark(VDuration::MILLISECOND() * 250, CONST_S64(32) * 1024 * 1024); // enable for meaningful numbers
+    this->_runListenerDrainTests();
     this->_runSocketTests();
 }
 
@@ -433,6 +440,28 @@ static bool _isIPv6NumericString(const VString& s) {
     return VSocket::isIPv6NumericString(s) && VSocket::isIPNumericString(s) && !VSocket::isIPv4NumericString(s);
 }
 
+#include "vthreadpool.h"
+
+// Shuts down a thread pool after a delay, cancelling whatever is still queued on it.
+class TestThreadPoolCancelThread : public VThread {
+    public:
+        TestThreadPoolCancelThread(VThreadPool* pool, const VDuration& delay)
+            : VThread("TestThreadPoolCancelThread", "vault.test.TestThreadPoolCancelThread", kDontDeleteSelfAtEnd, kCreateThreadJoinable, NULL)
+            , mPool(pool)
+            , mDelay(delay)
+            {}
+        virtual ~TestThreadPoolCancelThread() {}
+
+        virtual void run() {
+            VThread::sleep(mDelay);
+            mPool->shutdown(true);
+        }
+
+    private:
+        VThreadPool*    mPool;
+        VDuration       mDelay;
+};
+
 void VPlatformUnit::_runSocketTests() {
 
     VUNIT_ASSERT_TRUE(_isIPv4NumericString("1.2.3.4"));
@@ -503,6 +532,728 @@ void VPlatformUnit::_runSocketTests() {
         }
     }
 
+    // Workers on a shared pool that is shut down, or that cancels them before they run, never report back.
+    // The strategy must still fail promptly rather than waiting out its timeout.
+    /* shut down pool scope */ {
+        VStringVector debugIPAddresses;
+        debugIPAddresses.push_back("0.2.3.4");
+        debugIPAddresses.push_back("0.2.3.5");
+        debugIPAddresses.push_back("0.2.3.6");
+
+        VThreadPool pool("TestShutDownConnectionPool", 2);
+        pool.shutdown();
+        VSocketConnectionStrategyThreaded strategy(45 * VDuration::SECOND(), 2, &pool);
+        strategy.injectDebugIPAddresses(debugIPAddresses);
+
+        VSocket sock;
+        VInstant start;
+        try {
+            sock.connectToHostName("use-debug-addresses-instead", 80, strategy);
+            VUNIT_ASSERT_FAILURE("Connect with a shut down pool incorrectly succeeded");
+        } catch (const VException& /*ex*/) {
+            VUNIT_ASSERT_SUCCESS("Connect with a shut down pool correctly failed");
+        }
+        VUNIT_ASSERT_TRUE_LABELED(VDuration(start) < 5 * VDuration::SECOND(), "connect with a shut down pool fails promptly");
+    }
+
+    /* cancelled pool scope */ {
+        VStringVector debugIPAddresses;
+        debugIPAddresses.push_back("0.2.3.4");
+        debugIPAddresses.push_back("0.2.3.5");
+        debugIPAddresses.push_back("0.2.3.6");
+
+        VThreadPool pool("TestCancelledConnectionPool", 2); // never started, so the workers stay queued until cancelled
+        VSocketConnectionStrategyThreaded strategy(45 * VDuration::SECOND(), 2, &pool);
+        strategy.injectDebugIPAddresses(debugIPAddresses);
+        TestThreadPoolCancelThread canceller(&pool, 100 * VDuration::MILLISECOND());
+        canceller.start();
+
+        VSocket sock;
+        VInstant start;
+        try {
+            sock.connectToHostName("use-debug-addresses-instead", 80, strategy);
+            VUNIT_ASSERT_FAILURE("Connect with cancelled workers incorrectly succeeded");
+        } catch (const VException& /*ex*/) {
+            VUNIT_ASSERT_SUCCESS("Connect with cancelled workers correctly failed");
+        }
+        VUNIT_ASSERT_TRUE_LABELED(VDuration(start) < 5 * VDuration::SECOND(), "connect with cancelled workers fails promptly");
+        canceller.join();
+    }
+
+}
+
+#include "vdatagramsocket.h"
+#include "vdatagramlistenerthread.h"
+#include "vmanagementinterface.h"
+
+// Echoes each received datagram back to its sender.
+class TestDatagramEchoListener : public VDatagramListenerThread {
+    public:
+        TestDatagramEchoListener(VManagementInterface* manager) : VDatagramListenerThread("TestDatagramEchoListener", kDontDeleteSelfAtEnd, kCreateThreadJoinable, manager, 0, "127.0.0.1") {}
+        virtual ~TestDatagramEchoListener() {}
+    protected:
+        virtual void handleDatagrams(VDatagramSocket& socket, int numDatagrams) {
+            VDatagramPtrVector replies;
+            for (int i = 0; i < numDatagrams; ++i) {
+                const VDatagram& d = socket.getReceivedDatagram(i);
+                replies.push_back(new VDatagram(d.getData(), d.getLength(), d.getHostIPAddress(), d.getPortNumber()));
+            }
+            (void) socket.sendBatch(replies);
+            vault::vectorDeleteAll(replies);
+        }
+};
+
+// Records the datagram listener notifications; ignores the rest.
+class TestDatagramManagementInterface : public VManagementInterface {
+    public:
+        TestDatagramManagementInterface() : mNumListening(0), mNumEnded(0) {}
+        virtual ~TestDatagramManagementInterface() {}
+        virtual void threadStarting(VThread* /*thread*/) {}
+        virtual void threadEnded(VThread* /*thread*/) {}
+        virtual void listenerStarting(VListenerThread* /*listener*/) {}
+        virtual void listenerListening(VListenerThread* /*listener*/) {}
+        virtual void listenerFailed(VListenerThread* /*listener*/, const VString& /*message*/) {}
+        virtual void listenerEnded(VListenerThread* /*listener*/) {}
+        virtual void datagramListenerListening(VDatagramListenerThread* /*listener*/) { ++mNumListening; }
+        virtual void datagramListenerEnded(VDatagramListenerThread* /*listener*/) { ++mNumEnded; }
+        volatile int mNumListening;
+        volatile int mNumEnded;
+};
+
+static void _fillTestDatagrams(VDatagramPtrVector& datagrams, int numDatagrams, int length) {
+    for (int i = 0; i < numDatagrams; ++i) {
+        VDatagram* d = new VDatagram(length);
+        for (int j = 0; j < length; ++j) {
+            d->getBuffer()[j] = static_cast<Vu8>(i + j);
+        }
+        d->setLength(length);
+        datagrams.push_back(d);
+    }
+}
+
+// Receives until the expected number of datagrams arrive or a receive times out; returns the number received.
+static int _receiveTestDatagrams(VDatagramSocket& socket, int numExpected, int length, bool& contentsOK) {
+    int numReceived = 0;
+    contentsOK = true;
+    while (numReceived < numExpected) {
+        int numInBatch = socket.receiveBatch();
+        if (numInBatch == 0) {
+            break;
+        }
+
+        // Loopback preserves datagram order, so datagram i carries pattern i.
+        for (int i = 0; i < numInBatch; ++i) {
+            const VDatagram& d = socket.getReceivedDatagram(i);
+            contentsOK = contentsOK && (d.getLength() == length) && (! d.isTruncated());
+            for (int j = 0; contentsOK && (j < length); ++j) {
+                contentsOK = (d.getData()[j] == static_cast<Vu8>(numReceived + i + j));
+            }
+        }
+
+        numReceived += numInBatch;
+    }
+
+    return numReceived;
+}
+
+void VPlatformUnit::_runDatagramSocketTests() {
+
+    struct timeval timeout;
+    timeout.tv_sec = 5;
+    timeout.tv_usec = 0;
+
+    /* batched send and receive scope */ {
+        VDatagramSocket receiver;
+        receiver.setReadTimeOut(timeout);
+        receiver.bind("127.0.0.1", 0);
+        VUNIT_ASSERT_TRUE_LABELED(receiver.getLocalPortNumber() != 0, "datagram receiver bound to a port");
+
+        // A small batch size means the 10 datagrams go out in several system calls.
+        VDatagramSocket sender(VDatagramSocket::kDefaultMaxDatagramSize, 4);
+        sender.bind("127.0.0.1", 0);
+        sender.setHostIPAddressAndPort("127.0.0.1", receiver.getLocalPortNumber());
+
+        VDatagramPtrVector datagrams;
+        _fillTestDatagrams(datagrams, 10, 100);
+        VUNIT_ASSERT_EQUAL_LABELED(sender.sendBatch(datagrams), 10, "datagrams sent");
+        vault::vectorDeleteAll(datagrams);
+
+        bool contentsOK = false;
+        VUNIT_ASSERT_EQUAL_LABELED(_receiveTestDatagrams(receiver, 10, 100, contentsOK), 10, "datagrams received");
+        VUNIT_ASSERT_TRUE_LABELED(contentsOK, "datagram contents");
+        VUNIT_ASSERT_EQUAL_LABELED(receiver.getReceivedDatagram(0).getHostIPAddress(), VString("127.0.0.1"), "datagram sender address");
+        VUNIT_ASSERT_EQUAL_LABELED(receiver.getReceivedDatagram(0).getPortNumber(), sender.getLocalPortNumber(), "datagram sender port");
+
+        VUNIT_ASSERT_EQUAL_LABELED(sender.numDatagramsWritten(), CONST_S64(10), "datagrams written count");
+        VUNIT_ASSERT_EQUAL_LABELED(sender.numBytesWritten(), CONST_S64(1000), "datagram bytes written count");
+        VUNIT_ASSERT_EQUAL_LABELED(receiver.numDatagramsRead(), CONST_S64(10), "datagrams read count");
+        VSocketInfo info(receiver);
+        VUNIT_ASSERT_EQUAL_LABELED(info.mNumBytesRead, CONST_S64(1000), "datagram bytes read count in VSocketInfo");
+
+        // The single-datagram convenience API goes to the socket's host address.
+        Vu8 oneByte = 42;
+        VUNIT_ASSERT_EQUAL_LABELED(sender.send(&oneByte, 1), 1, "single datagram sent");
+        VUNIT_ASSERT_EQUAL_LABELED(receiver.receiveBatch(), 1, "single datagram received");
+        VUNIT_ASSERT_EQUAL_LABELED((int) receiver.getReceivedDatagram(0).getData()[0], 42, "single datagram contents");
+
+        try {
+            (void) receiver.getReceivedDatagram(1);
+            VUNIT_ASSERT_FAILURE("getReceivedDatagram out of range did not throw");
+        } catch (const VRangeException& /*ex*/) {
+            VUNIT_ASSERT_SUCCESS("getReceivedDatagram out of range threw");
+        }
+
+        // The socket is IPv4, so a batch with an IPv6 destination is rejected before anything is sent.
+        VDatagramPtrVector mixedDatagrams;
+        mixedDatagrams.push_back(new VDatagram(&oneByte, 1));
+        mixedDatagrams.push_back(new VDatagram(&oneByte, 1, "::1", receiver.getLocalPortNumber()));
+        try {
+            (void) sender.sendBatch(mixedDatagrams);
+            VUNIT_ASSERT_FAILURE("datagram batch with mixed address families did not throw");
+        } catch (const VException& /*ex*/) {
+            VUNIT_ASSERT_SUCCESS("datagram batch with mixed address families threw");
+        }
+        vault::vectorDeleteAll(mixedDatagrams);
+        VUNIT_ASSERT_EQUAL_LABELED(sender.numDatagramsWritten(), CONST_S64(11), "datagram batch with mixed address families sent nothing");
+    }
+
+#ifdef VSOCKET_MMSG_SUPPORTED
+    /* truncation scope; only platforms using recvmmsg() report it */ {
+        VDatagramSocket receiver(16);
+        receiver.setReadTimeOut(timeout);
+        receiver.bind("127.0.0.1", 0);
+
+        VDatagramSocket sender;
+        sender.setHostIPAddressAndPort("127.0.0.1", receiver.getLocalPortNumber());
+        Vu8 buffer[32];
+        ::memset(buffer, 0, sizeof(buffer));
+        (void) sender.send(buffer, sizeof(buffer));
+
+        VUNIT_ASSERT_EQUAL_LABELED(receiver.receiveBatch(), 1, "oversized datagram received");
+        VUNIT_ASSERT_EQUAL_LABELED(receiver.getReceivedDatagram(0).getLength(), 16, "oversized datagram length");
+        VUNIT_ASSERT_TRUE_LABELED(receiver.getReceivedDatagram(0).isTruncated(), "oversized datagram truncated");
+    }
+#endif
+
+    /* listener thread scope */ {
+        TestDatagramManagementInterface manager;
+        TestDatagramEchoListener* listener = new TestDatagramEchoListener(&manager);
+        listener->start();
+
+        for (int i = 0; (i < 100) && (manager.mNumListening == 0); ++i) {
+            VThread::sleep(50 * VDuration::MILLISECOND());
+        }
+        VUNIT_ASSERT_EQUAL_LABELED(manager.mNumListening, 1, "datagram listener listening");
+
+        VDatagramSocket client;
+        client.setReadTimeOut(timeout);
+        client.bind("127.0.0.1", 0);
+        client.setHostIPAddressAndPort("127.0.0.1", listener->getPortNumber());
+
+        VDatagramPtrVector datagrams;
+        _fillTestDatagrams(datagrams, 5, 64);
+        (void) client.sendBatch(datagrams);
+        vault::vectorDeleteAll(datagrams);
+
+        bool contentsOK = false;
+        VUNIT_ASSERT_EQUAL_LABELED(_receiveTestDatagrams(client, 5, 64, contentsOK), 5, "datagrams echoed by listener");
+        VUNIT_ASSERT_TRUE_LABELED(contentsOK, "echoed datagram contents");
+
+        VSocketInfoVector sockets = listener->enumerateActiveSockets();
+        VUNIT_ASSERT_EQUAL_LABELED((int) sockets.size(), 1, "datagram listener socket info");
+        if (sockets.size() == 1) {
+            VUNIT_ASSERT_EQUAL_LABELED(sockets[0].mNumBytesRead, CONST_S64(320), "datagram listener bytes read");
+        }
+
+        // join() returns immediately for a stopped thread, so wait on the OS thread itself before deleting.
+        listener->stop();
+        (void) VThread::threadJoin(listener->threadID(), NULL);
+        VUNIT_ASSERT_EQUAL_LABELED(manager.mNumEnded, 1, "datagram listener ended");
+        delete listener;
+    }
+
+}
+
+#include "vlistenersocket.h"
+#include "vsocketfactory.h"
+#include "vsocketstream.h"
+#include "vbinaryiostream.h"
+#include "vfsnode.h"
+
+#include <fcntl.h>
+
+void VPlatformUnit::_runLocalSocketTests() {
+#ifdef VSOCKET_LOCAL_DOMAIN_SUPPORTED
+    const VString       kPath("vplatformunit_local.sock");
+    VSocketFactory      socketFactory;
+    VListenerSocket     listener(kPath, &socketFactory);
+    listener.listen();
+    VUNIT_ASSERT_TRUE_LABELED(listener.isLocal(), "local listener is local");
+
+    VSocket* client = socketFactory.createLocalSocket(kPath);
+    VSocket* server = listener.accept();
+    VUNIT_ASSERT_TRUE_LABELED(server != NULL, "local listener accepted a connection");
+    if (server == NULL) {
+        delete client;
+        return;
+    }
+
+    VUNIT_ASSERT_EQUAL_LABELED(client->getLocalPath(), kPath, "local client path");
+    VUNIT_ASSERT_EQUAL_LABELED(server->getLocalPath(), kPath, "local accepted socket path");
+    VUNIT_ASSERT_EQUAL_LABELED(server->getHostIPAddress(), kPath, "local accepted socket address is its path");
+
+    /* stream i/o scope; same as over TCP */ {
+        VSocketStream   clientStream(client, "local client");
+        VBinaryIOStream clientIO(clientStream);
+        VSocketStream   serverStream(server, "local server");
+        VBinaryIOStream serverIO(serverStream);
+
+        clientIO.writeS32(12345);
+        clientIO.writeString("over a unix domain socket");
+        clientIO.flush();
+        VUNIT_ASSERT_EQUAL_LABELED(serverIO.readS32(), 12345, "local socket int");
+        VUNIT_ASSERT_EQUAL_LABELED(serverIO.readString(), VString("over a unix domain socket"), "local socket string");
+    }
+
+    // Hand off a second connection: the server passes its accepted socket's descriptor to the first client,
+    // which then talks to the second client directly.
+    VSocket* secondClient = socketFactory.createLocalSocket(kPath);
+    VSocket* secondServer = listener.accept();
+    VUNIT_ASSERT_TRUE_LABELED(secondServer != NULL, "local listener accepted a second connection");
+    if (secondServer != NULL) {
+        server->sendFileDescriptor(secondServer->getSockID());
+        delete secondServer; // closes our descriptor; the passed one keeps the connection open
+
+        VSocket* handedOff = socketFactory.createSocket(client->receiveFileDescriptor());
+        VUNIT_ASSERT_TRUE_LABELED(handedOff->isLocal(), "handed off socket is local");
+
+        Vu8 data[3] = { 1, 2, 3 };
+        (void) secondClient->write(data, 3);
+        Vu8 received[3] = { 0, 0, 0 };
+        VUNIT_ASSERT_EQUAL_LABELED(handedOff->read(received, 3), 3, "handed off socket read");
+        VUNIT_ASSERT_TRUE_LABELED((received[0] == 1) && (received[1] == 2) && (received[2] == 3), "handed off socket data");
+        delete handedOff;
+    }
+
+    try {
+        VSocket tcpSocket;
+        tcpSocket.sendFileDescriptor(0);
+        VUNIT_ASSERT_FAILURE("sendFileDescriptor on a non-local socket did not throw");
+    } catch (const VException& /*ex*/) {
+        VUNIT_ASSERT_SUCCESS("sendFileDescriptor on a non-local socket threw");
+    }
+
+    // A live listener's path is in use; listening there again must not take it over.
+    try {
+        VListenerSocket secondListener(kPath, &socketFactory);
+        secondListener.listen();
+        VUNIT_ASSERT_FAILURE("listening on a live listener's path did not throw");
+    } catch (const VException& /*ex*/) {
+        VUNIT_ASSERT_SUCCESS("listening on a live listener's path threw");
+    }
+
+    VSocket* thirdClient = socketFactory.createLocalSocket(kPath);
+    VSocket* thirdServer = listener.accept();
+    VUNIT_ASSERT_TRUE_LABELED(thirdServer != NULL, "live listener still accepts after a second listen attempt");
+    delete thirdServer;
+    delete thirdClient;
+
+    delete secondClient;
+    delete server;
+    delete client;
+
+    // Something other than a socket at the path is left alone.
+    const VString kFilePath("vplatformunit_local_file.sock");
+    (void) ::close(::open(kFilePath.chars(), O_CREAT | O_WRONLY, 0644));
+    try {
+        VListenerSocket fileListener(kFilePath, &socketFactory);
+        fileListener.listen();
+        VUNIT_ASSERT_FAILURE("listening on a regular file's path did not throw");
+    } catch (const VException& /*ex*/) {
+        VUNIT_ASSERT_SUCCESS("listening on a regular file's path threw");
+    }
+    VUNIT_ASSERT_TRUE_LABELED(VFSNode(kFilePath).exists(), "regular file at the path not removed");
+    (void) VFileSystem::unlink(kFilePath);
+
+    // A socket file whose listener is gone is replaced.
+    const VString kStalePath("vplatformunit_local_stale.sock");
+    struct sockaddr_un staleInfo;
+    ::memset(&staleInfo, 0, sizeof(staleInfo));
+    staleInfo.sun_family = AF_UNIX;
+    ::strcpy(staleInfo.sun_path, kStalePath.chars());
+    VSocketID staleSockID = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    (void) ::bind(staleSockID, (const sockaddr*) &staleInfo, sizeof(staleInfo));
+    vault::closeSocket(staleSockID); // leaves the socket file behind
+    try {
+        VListenerSocket staleListener(kStalePath, &socketFactory);
+        staleListener.listen();
+        VUNIT_ASSERT_SUCCESS("listening on a stale socket file's path");
+    } catch (const VException& ex) {
+        VUNIT_ASSERT_FAILURE(VSTRING_FORMAT("listening on a stale socket file's path threw: %s", ex.what()));
+    }
+#endif
+}
+
+void VPlatformUnit::_runSocketStatisticsTests() {
+    const int           kPortNumber = 18429;
+    VSocketFactory      socketFactory;
+    VListenerSocket     listener(kPortNumber, "127.0.0.1", &socketFactory);
+    listener.listen();
+
+    VSocket* client = socketFactory.createSocket("127.0.0.1", kPortNumber, VSocketConnectionStrategySingle());
+    VSocket* server = listener.accept();
+    VUNIT_ASSERT_TRUE_LABELED(server != NULL, "statistics listener accepted a connection");
+    if (server == NULL) {
+        delete client;
+        return;
+    }
+
+    VUNIT_ASSERT_FALSE_LABELED(client->getTCPInfo().mIsValid, "no TCP info before first sample");
+
+    const int kNumBytes = 64 * 1024;
+    Vu8* buffer = new Vu8[kNumBytes];
+    ::memset(buffer, 0x5A, kNumBytes);
+    VThread::sleep(VDuration::MILLISECOND() * 20); // ensure a measurable sample interval
+    (void) client->write(buffer, kNumBytes);
+    VUNIT_ASSERT_EQUAL_LABELED(server->read(buffer, kNumBytes), kNumBytes, "statistics socket read");
+    delete [] buffer;
+
+    client->sampleStatistics();
+    server->sampleStatistics();
+    VUNIT_ASSERT_TRUE_LABELED(client->getWriteBytesPerSecond() > 0, "client write rate");
+    VUNIT_ASSERT_EQUAL_LABELED(client->getReadBytesPerSecond(), CONST_S64(0), "client read rate");
+    VUNIT_ASSERT_TRUE_LABELED(server->getReadBytesPerSecond() > 0, "server read rate");
+    VUNIT_ASSERT_EQUAL_LABELED(server->getWriteBytesPerSecond(), CONST_S64(0), "server write rate");
+
+    VSocketInfo info(*client);
+    VUNIT_ASSERT_EQUAL_LABELED(info.mWriteBytesPerSecond, client->getWriteBytesPerSecond(), "VSocketInfo write rate");
+    VUNIT_ASSERT_EQUAL_LABELED(info.mTCPInfo.mIsValid, client->getTCPInfo().mIsValid, "VSocketInfo TCP info");
+
+#ifdef __linux__
+    VUNIT_ASSERT_TRUE_LABELED(info.mTCPInfo.mIsValid, "TCP info sampled");
+    VUNIT_ASSERT_TRUE_LABELED(info.mTCPInfo.mRoundTripTimeMicroseconds > 0, "TCP info round trip time");
+    VUNIT_ASSERT_TRUE_LABELED(info.mTCPInfo.mCongestionWindowSegments > 0, "TCP info congestion window");
+    VUNIT_ASSERT_TRUE_LABELED(info.mTCPInfo.mNumRetransmits >= 0, "TCP info retransmits");
+#endif
+
+    delete server;
+    delete client;
+}
+
+#include "vmemorystream.h"
+#include "vtextiostream.h"
+#include "vsettings.h"
+
+#ifdef __linux__
+static int _getIntSockOpt(VSocketID socketID, int level, int name) {
+    int value = 0;
+    socklen_t valueLength = sizeof(value);
+    (void) ::getsockopt(socketID, level, name, &value, &valueLength);
+    return value;
+}
+#endif
+
+void VPlatformUnit::_runSocketTuningProfileTests() {
+    VUNIT_ASSERT_EQUAL_LABELED(VSocketTuningProfile().mName, "default", "default-constructed profile");
+    VUNIT_ASSERT_EQUAL_LABELED(VSocketTuningProfile::forName("low-latency").mName, "low-latency", "forName low-latency");
+    VUNIT_ASSERT_TRUE_LABELED(VSocketTuningProfile::LOW_LATENCY().mQuickAck, "low-latency uses quick ack");
+    VUNIT_ASSERT_FALSE_LABELED(VSocketTuningProfile::BULK_THROUGHPUT().mNoDelay, "bulk-throughput leaves Nagle on");
+    VUNIT_ASSERT_TRUE_LABELED(VSocketTuningProfile::MANY_IDLE().mKeepAlive, "many-idle uses keepalive");
+
+    try {
+        (void) VSocketTuningProfile::forName("no-such-profile");
+        VUNIT_ASSERT_FAILURE("forName of an unknown profile did not throw");
+    } catch (const VRangeException& /*ex*/) {
+        VUNIT_ASSERT_SUCCESS("forName of an unknown profile threw");
+    }
+
+    /* settings scope */ {
+        VString settingsText("<socket-tuning profile=\"many-idle\" name=\"custom\" receive-buffer-size=\"32768\" keep-alive-count=\"3\" cork=\"true\" />");
+        VMemoryStream buf;
+        VTextIOStream io(buf);
+        io.writeString(settingsText);
+        io.seek0();
+        VSettings settings(io);
+        VSocketTuningProfile profile(*(settings.findNode("socket-tuning")));
+        VUNIT_ASSERT_EQUAL_LABELED(profile.mName, "custom", "settings profile name");
+        VUNIT_ASSERT_EQUAL_LABELED(profile.mReceiveBufferSize, 32768, "settings profile receive buffer size");
+        VUNIT_ASSERT_EQUAL_LABELED(profile.mSendBufferSize, VSocketTuningProfile::MANY_IDLE().mSendBufferSize, "settings profile inherits send buffer size");
+        VUNIT_ASSERT_EQUAL_LABELED(profile.mKeepAliveCount, 3, "settings profile keepalive count");
+        VUNIT_ASSERT_EQUAL_LABELED(profile.mKeepAliveIdleSeconds, VSocketTuningProfile::MANY_IDLE().mKeepAliveIdleSeconds, "settings profile inherits keepalive idle");
+        VUNIT_ASSERT_TRUE_LABELED(profile.mCork, "settings profile cork");
+    }
+
+    /* applied options scope */ {
+        const int           kPortNumber = 18430;
+        VSocketFactory      socketFactory(VSocketTuningProfile::MANY_IDLE());
+        VListenerSocket     listener(kPortNumber, "127.0.0.1", &socketFactory);
+        listener.listen();
+
+        VSocket* client = socketFactory.createSocket("127.0.0.1", kPortNumber, VSocketConnectionStrategySingle());
+        VSocket* server = listener.accept();
+        VUNIT_ASSERT_TRUE_LABELED(server != NULL, "tuned listener accepted a connection");
+        VUNIT_ASSERT_EQUAL_LABELED(client->getTuningProfile().mName, "many-idle", "connected socket profile");
+        if (server != NULL) {
+            VUNIT_ASSERT_EQUAL_LABELED(server->getTuningProfile().mName, "many-idle", "accepted socket profile");
+#ifdef __linux__
+            VUNIT_ASSERT_EQUAL_LABELED(_getIntSockOpt(server->getSockID(), SOL_SOCKET, SO_KEEPALIVE), 1, "accepted socket keepalive");
+            VUNIT_ASSERT_EQUAL_LABELED(_getIntSockOpt(server->getSockID(), IPPROTO_TCP, TCP_KEEPCNT), VSocketTuningProfile::MANY_IDLE().mKeepAliveCount, "accepted socket keepalive count");
+#endif
+        }
+#ifdef __linux__
+        VUNIT_ASSERT_EQUAL_LABELED(_getIntSockOpt(client->getSockID(), SOL_SOCKET, SO_KEEPALIVE), 1, "connected socket keepalive");
+        VUNIT_ASSERT_EQUAL_LABELED(_getIntSockOpt(client->getSockID(), IPPROTO_TCP, TCP_KEEPIDLE), VSocketTuningProfile::MANY_IDLE().mKeepAliveIdleSeconds, "connected socket keepalive idle");
+        VUNIT_ASSERT_EQUAL_LABELED(_getIntSockOpt(client->getSockID(), IPPROTO_TCP, TCP_NODELAY) != 0, true, "connected socket no delay");
+
+        client->setTuningProfile(VSocketTuningProfile::BULK_THROUGHPUT());
+        client->setDefaultSockOpt();
+        VUNIT_ASSERT_EQUAL_LABELED(_getIntSockOpt(client->getSockID(), IPPROTO_TCP, TCP_NODELAY), 0, "retuned socket no delay");
+#endif
+
+        delete server;
+        delete client;
+    }
+}
+
+// Reads a known number of bytes from a socket, so that the benchmark's writer is not also its reader.
+class TestSocketDrainThread : public VThread {
+    public:
+        TestSocketDrainThread(VSocket* socket, Vs64 numBytesToRead)
+            : VThread("TestSocketDrainThread", "vault.test.TestSocketDrainThread", kDontDeleteSelfAtEnd, kCreateThreadJoinable, NULL)
+            , mSocket(socket)
+            , mNumBytesToRead(numBytesToRead)
+            , mNumBytesRead(0)
+            {}
+        virtual ~TestSocketDrainThread() {}
+
+        virtual void run() {
+            const int kBufferSize = 65536;
+            Vu8* buffer = new Vu8[kBufferSize];
+            try {
+                while (mNumBytesRead < mNumBytesToRead) {
+                    int numBytesToRead = static_cast<int>(V_MIN(static_cast<Vs64>(kBufferSize), mNumBytesToRead - mNumBytesRead));
+                    mNumBytesRead += mSocket->read(buffer, numBytesToRead);
+                }
+            } catch (const VException& ex) {
+                VLOGGER_ERROR(VSTRING_FORMAT("TestSocketDrainThread: %s", ex.what()));
+            }
+            delete [] buffer;
+        }
+
+        Vs64 getNumBytesRead() const { return mNumBytesRead; }
+
+    private:
+        VSocket*    mSocket;
+        Vs64        mNumBytesToRead;
+        Vs64        mNumBytesRead;
+};
+
+/*
+Compares the built-in tuning profiles over loopback, with two workloads: small
+request/response round trips, where latency settings matter, and a one-way bulk
+transfer, where buffer sizes and Nagle matter. Loopback has no real network, so
+the numbers mainly show the per-call and buffering overhead of each profile; the
+results are logged rather than asserted, apart from each workload making progress.
+The normal test run uses a short duration and a small transfer just to exercise
+each profile; pass larger values to get numbers worth comparing.
+*/
+void VPlatformUnit::_runSocketTuningProfileBenchmark(const VDuration& roundTripTestDuration, Vs64 bulkNumBytes) {
+    const int       kMessageSize = 32;
+    const int       kBulkChunkSize = 16384;
+
+    VSocketTuningProfile profiles[4];
+    profiles[0] = VSocketTuningProfile::DEFAULT();
+    profiles[1] = VSocketTuningProfile::LOW_LATENCY();
+    profiles[2] = VSocketTuningProfile::BULK_THROUGHPUT();
+    profiles[3] = VSocketTuningProfile::MANY_IDLE();
+
+    for (int profileIndex = 0; profileIndex < 4; ++profileIndex) {
+        const VSocketTuningProfile& profile = profiles[profileIndex];
+        const int       portNumber = 18431 + profileIndex;
+        VSocketFactory  socketFactory(profile);
+        VListenerSocket listener(portNumber, "127.0.0.1", &socketFactory);
+        listener.listen();
+
+        VSocket* client = socketFactory.createSocket("127.0.0.1", portNumber, VSocketConnectionStrategySingle());
+        VSocket* server = listener.accept();
+        VUNIT_ASSERT_TRUE_LABELED(server != NULL, VSTRING_FORMAT("%s benchmark listener accepted a connection", profile.mName.chars()));
+        if (server == NULL) {
+            delete client;
+            continue;
+        }
+
+        Vu8 message[kMessageSize];
+        ::memset(message, 0x5A, kMessageSize);
+        int numRoundTrips = 0;
+        VInstant roundTripStart;
+        VInstant roundTripEnd = roundTripStart + roundTripTestDuration;
+        while (VInstant() < roundTripEnd) {
+            (void) client->write(message, kMessageSize);
+            (void) server->read(message, kMessageSize);
+            (void) server->write(message, kMessageSize);
+            (void) client->read(message, kMessageSize);
+            ++numRoundTrips;
+        }
+        Vs64 roundTripMilliseconds = V_MAX(CONST_S64(1), VDuration(roundTripStart).getDurationMilliseconds());
+
+        TestSocketDrainThread drainThread(server, bulkNumBytes);
+        drainThread.start();
+        Vu8* chunk = new Vu8[kBulkChunkSize];
+        ::memset(chunk, 0xA5, kBulkChunkSize);
+        VInstant bulkStart;
+        for (Vs64 numBytesWritten = 0; numBytesWritten < bulkNumBytes; numBytesWritten += kBulkChunkSize) {
+            (void) client->write(chunk, kBulkChunkSize);
+        }
+        VThread::threadJoin(drainThread.threadID(), NULL);
+        Vs64 bulkMilliseconds = V_MAX(CONST_S64(1), VDuration(bulkStart).getDurationMilliseconds());
+        delete [] chunk;
+
+        VUNIT_ASSERT_TRUE_LABELED(numRoundTrips > 0, VSTRING_FORMAT("%s benchmark round trips", profile.mName.chars()));
+        VUNIT_ASSERT_EQUAL_LABELED(drainThread.getNumBytesRead(), bulkNumBytes, VSTRING_FORMAT("%s benchmark bulk transfer", profile.mName.chars()));
+        this->logStatus(VSTRING_FORMAT("Socket tuning profile %-16s: " VSTRING_FORMATTER_S64 " round trips/s, " VSTRING_FORMATTER_S64 " MB/s bulk.",
+            profile.mName.chars(),
+            (numRoundTrips * CONST_S64(1000)) / roundTripMilliseconds,
+            (bulkNumBytes * CONST_S64(1000)) / (bulkMilliseconds * 1024 * 1024)));
+
+        delete server;
+        delete client;
+    }
+}
+
+#include "vlistenerthread.h"
+#include "vsocketthreadfactory.h"
+#include "vmessageinputthread.h"
+
+// A message that is just a 4-byte payload, echoed back as-is by TestDrainSocketThread.
+class TestDrainMessage : public VMessage {
+    public:
+        TestDrainMessage() : VMessage(), mPayload(0) {}
+        virtual ~TestDrainMessage() {}
+        virtual void send(const VString& /*sessionLabel*/, VBinaryIOStream& out) { out.writeU32(mPayload); out.flush(); }
+        virtual void receive(const VString& /*sessionLabel*/, VBinaryIOStream& in) { mPayload = in.readU32(); }
+    private:
+        Vu32 mPayload;
+};
+
+class TestDrainMessageFactory : public VMessageFactory {
+    public:
+        TestDrainMessageFactory() {}
+        virtual ~TestDrainMessageFactory() {}
+        virtual VMessagePtr instantiateNewMessage(VMessageID /*messageID*/) const { return VMessagePtr(new TestDrainMessage()); }
+};
+
+// Echoes each request after a pause, so that a drain can find a request in progress.
+class TestDrainSocketThread : public VMessageInputThread {
+    public:
+        TestDrainSocketThread(VSocket* socket, VListenerThread* ownerThread, const VMessageFactory* messageFactory, volatile int& numRequestsStarted)
+            : VMessageInputThread("TestDrainSocketThread", socket, ownerThread, NULL, messageFactory)
+            , mNumRequestsStarted(numRequestsStarted)
+            {}
+        virtual ~TestDrainSocketThread() {}
+
+    protected:
+        virtual void _dispatchMessage(VMessagePtr message) {
+            ++mNumRequestsStarted;
+            VThread::sleep(200 * VDuration::MILLISECOND());
+            message->send(mName, mInputStream);
+        }
+
+    private:
+        volatile int& mNumRequestsStarted;
+};
+
+class TestDrainSocketThreadFactory : public VSocketThreadFactory {
+    public:
+        TestDrainSocketThreadFactory() : mNumRequestsStarted(0) {}
+        virtual ~TestDrainSocketThreadFactory() {}
+        virtual VSocketThread* createThread(VSocket* socket, VListenerThread* ownerThread) { return new TestDrainSocketThread(socket, ownerThread, &mMessageFactory, mNumRequestsStarted); }
+        volatile int mNumRequestsStarted;
+    private:
+        TestDrainMessageFactory mMessageFactory;
+};
+
+// Records the listener and drain notifications; ignores the rest.
+class TestDrainManagementInterface : public VManagementInterface {
+    public:
+        TestDrainManagementInterface() : mNumListening(0), mNumDrainStarted(0), mNumSocketThreadsAtStart(-1), mNumSocketThreadsRemaining(-1), mNumForceClosed(-1) {}
+        virtual ~TestDrainManagementInterface() {}
+        virtual void threadStarting(VThread* /*thread*/) {}
+        virtual void threadEnded(VThread* /*thread*/) {}
+        virtual void listenerStarting(VListenerThread* /*listener*/) {}
+        virtual void listenerListening(VListenerThread* /*listener*/) { ++mNumListening; }
+        virtual void listenerFailed(VListenerThread* /*listener*/, const VString& /*message*/) {}
+        virtual void listenerEnded(VListenerThread* /*listener*/) {}
+        virtual void listenerDrainStarted(VListenerThread* /*listener*/, int numSocketThreads) { ++mNumDrainStarted; mNumSocketThreadsAtStart = numSocketThreads; }
+        virtual void listenerDrainProgress(VListenerThread* /*listener*/, int numSocketThreads) { mNumSocketThreadsRemaining = numSocketThreads; }
+        virtual void listenerDrainEnded(VListenerThread* /*listener*/, int numForceClosed) { mNumForceClosed = numForceClosed; }
+        volatile int mNumListening;
+        volatile int mNumDrainStarted;
+        volatile int mNumSocketThreadsAtStart;
+        volatile int mNumSocketThreadsRemaining;
+        volatile int mNumForceClosed;
+};
+
+/*
+Drains a listener that has one connection with a request in progress and one
+idle connection. The busy connection must get its response before its thread
+ends by itself; the idle one never sends a request, so its thread ends at once
+rather than holding the drain until the deadline.
+*/
+void VPlatformUnit::_runListenerDrainTests() {
+    const int                       kPortNumber = 18435;
+    VSocketFactory                  socketFactory;
+    TestDrainSocketThreadFactory    threadFactory;
+    TestDrainManagementInterface    manager;
+
+    VListenerThread* listener = new VListenerThread("TestDrainListener", VThread::kDontDeleteSelfAtEnd, VThread::kCreateThreadJoinable, &manager, kPortNumber, "127.0.0.1", &socketFactory, &threadFactory);
+    listener->start();
+
+    for (int i = 0; (i < 100) && (manager.mNumListening == 0); ++i) {
+        VThread::sleep(50 * VDuration::MILLISECOND());
+    }
+    VUNIT_ASSERT_EQUAL_LABELED(manager.mNumListening, 1, "drain test listener listening");
+
+    VSocket* busyClient = socketFactory.createSocket("127.0.0.1", kPortNumber, VSocketConnectionStrategySingle());
+    VSocket* idleClient = socketFactory.createSocket("127.0.0.1", kPortNumber, VSocketConnectionStrategySingle());
+    for (int i = 0; (i < 100) && (listener->enumerateActiveSockets().size() < 2); ++i) {
+        VThread::sleep(50 * VDuration::MILLISECOND());
+    }
+
+    Vu8 request[4] = { 'P', 'I', 'N', 'G' };
+    (void) busyClient->write(request, 4);
+    for (int i = 0; (i < 100) && (threadFactory.mNumRequestsStarted == 0); ++i) {
+        VThread::sleep(10 * VDuration::MILLISECOND());
+    }
+
+    VInstant drainStart;
+    bool drained = listener->drainAndStop(10 * VDuration::SECOND());
+    VDuration drainDuration(drainStart);
+
+    VUNIT_ASSERT_TRUE_LABELED(drained, "drain reports that both connections ended by themselves");
+    VUNIT_ASSERT_EQUAL_LABELED(manager.mNumDrainStarted, 1, "drain started notification");
+    VUNIT_ASSERT_EQUAL_LABELED(manager.mNumSocketThreadsAtStart, 2, "drain started with both socket threads");
+    VUNIT_ASSERT_EQUAL_LABELED(manager.mNumSocketThreadsRemaining, 0, "drain progress reports no socket threads remaining");
+    VUNIT_ASSERT_EQUAL_LABELED(manager.mNumForceClosed, 0, "drain force-closed no socket threads");
+    VUNIT_ASSERT_TRUE_LABELED(drainDuration < 5 * VDuration::SECOND(), "drain did not wait for the deadline");
+
+    Vu8 response[4] = { 0, 0, 0, 0 };
+    (void) busyClient->read(response, 4);
+    VUNIT_ASSERT_TRUE_LABELED(::memcmp(request, response, 4) == 0, "in-flight request was answered during the drain");
+
+    // drainAndStop() waits for the closed threads to end, so they are gone even though the clients are still connected.
+    VUNIT_ASSERT_TRUE_LABELED(listener->enumerateActiveSockets().empty(), "socket threads ended by the end of the drain");
+
+    try {
+        (void) idleClient->read(response, 4);
+        VUNIT_ASSERT_FAILURE("idle connection was closed by the drain");
+    } catch (const VException& /*ex*/) {
+        VUNIT_ASSERT_SUCCESS("idle connection was closed by the drain");
+    }
+
+    delete busyClient;
+    delete idleClient;
+    (void) VThread::threadJoin(listener->threadID(), NULL);
+    delete listener;
 }
 
 void VPlatformUnit::_runResolveAndConnectHostNameTest(const VString& hostName) {
@@ -42,6 +42,12 @@ class VPlatformUnit : public VUnit {
         void _runMinMaxAbsCheck();
         void _runTimeCheck();
         void _runUtilitiesTest();
+        void _runDatagramSocketTests();
+        void _runLocalSocketTests();
+        void _runSocketStatisticsTests();
+        void _runSocketTuningProfileTests();
+        void _runSocketTuningProfileBenchmark(const VDuration& roundTripTestDuration, Vs64 bulkNumBytes);
+        void _runListenerDrainTests();
         void _runSocketTests();
 
         void _runResolveAndConnectHostNameTest(const VString& hostName);
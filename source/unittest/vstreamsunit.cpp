@@ -17,6 +17,11 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vtextstreamtailer.h"
 #include "vmutexlocker.h"
 
+#include "vdirectiofilestream.h"
+#include "vsocketstream.h"
+#include "vsocketfactory.h"
+#include "vlistenersocket.h"
+
 VStreamsUnit::VStreamsUnit(bool logOnSuccess, bool throwOnError) :
     VUnit("VStreamsUnit", logOnSuccess, throwOnError) {
 }
@@ -38,6 +43,7 @@ void VStreamsUnit::run() {
     this->_testReadOnlyStream();
     this->_testOverloadedStreamCopyAPIs();
     this->_testStreamTailer();
+    this->_testFileToSocketStreamCopy();
 }
 
 void VStreamsUnit::_testWriteBufferedStream() {
@@ -433,3 +439,98 @@ void VStreamsUnit::_testStreamTailer() {
     }
 
 }
+
+void VStreamsUnit::_testFileToSocketStreamCopy() {
+    // Copying from a file stream to a socket stream is done in the kernel (sendfile) where the
+    // platform supports it, and with a temporary buffer otherwise. Either way, the bytes that
+    // arrive on the other end of a loopback connection must match the file, and the file stream's
+    // i/o offset must end up just past what was copied. We deliberately read a byte from the
+    // buffered file stream first, so its stdio buffer has read ahead of its logical offset.
+
+    VFSNode tempDir = VFSNode::getKnownDirectoryNode(VFSNode::CACHED_DATA_DIRECTORY, "vault", "unittest");
+    VFSNode testDirRoot(tempDir, "vstreamsunit_temp");
+    testDirRoot.mkdirs();
+
+    const int kFileSize = 32768;
+    const int kStartOffset = 1000;
+    const int kFirstCopySize = 20000;
+    VFSNode testFileNode(testDirRoot, "sendfile_source.dat");
+
+    /* writing scope */ {
+        VMemoryStream fileContents;
+        VBinaryIOStream io(fileContents);
+        for (int i = 0; i < kFileSize; ++i) {
+            io.writeU8(static_cast<Vu8>(i % 251));
+        }
+
+        fileContents.seek0();
+        VBufferedFileStream outputFileStream(testFileNode);
+        outputFileStream.openWrite();
+        VStream::streamCopy(fileContents, outputFileStream, kFileSize);
+        outputFileStream.flush();
+    }
+
+    const int kTestPortNumber = 18426;
+    VSocketFactory socketFactory;
+    VListenerSocket listener(kTestPortNumber, "127.0.0.1", &socketFactory);
+    listener.listen();
+
+    VSocket clientSocket;
+    clientSocket.connectToIPAddress("127.0.0.1", kTestPortNumber);
+    VSocket* serverSocket = listener.accept();
+    VUNIT_ASSERT_NOT_NULL_LABELED(serverSocket, "accepted loopback connection");
+    if (serverSocket == NULL) {
+        return;
+    }
+
+    VSocketStream clientStream(&clientSocket, "sendfile client");
+    VSocketStream serverStream(serverSocket, "sendfile server");
+
+    /* buffered file stream scope */ {
+        VBufferedFileStream inputFileStream(testFileNode);
+        inputFileStream.openReadOnly();
+        inputFileStream.seek(kStartOffset, SEEK_SET);
+        Vu8 firstByte = 0;
+        (void) inputFileStream.read(&firstByte, 1);
+        VUNIT_ASSERT_EQUAL_LABELED(firstByte, static_cast<Vu8>(kStartOffset % 251), "buffered file first byte");
+
+        Vs64 numBytesCopied = VStream::streamCopy(inputFileStream, clientStream, kFirstCopySize);
+        VUNIT_ASSERT_EQUAL_LABELED(numBytesCopied, static_cast<Vs64>(kFirstCopySize), "buffered file to socket copy count");
+        VUNIT_ASSERT_EQUAL_LABELED(inputFileStream.getIOOffset(), static_cast<Vs64>(kStartOffset + 1 + kFirstCopySize), "buffered file offset after copy");
+
+        VMemoryStream received;
+        VStream::streamCopy(serverStream, received, kFirstCopySize);
+        const Vu8* receivedBytes = received.getBuffer();
+        bool allMatch = true;
+        for (int i = 0; i < kFirstCopySize; ++i) {
+            allMatch = allMatch && (receivedBytes[i] == static_cast<Vu8>((kStartOffset + 1 + i) % 251));
+        }
+        VUNIT_ASSERT_TRUE_LABELED(allMatch, "buffered file to socket copy contents");
+    }
+
+    /* direct i/o file stream scope */ {
+        // Ask for more than the file holds; the copy should stop at end of file.
+        const int kExpectedCopySize = kFileSize - kStartOffset;
+        VDirectIOFileStream inputFileStream(testFileNode);
+        inputFileStream.openReadOnly();
+        inputFileStream.seek(kStartOffset, SEEK_SET);
+
+        Vs64 numBytesCopied = VStream::streamCopy(inputFileStream, clientStream, kFileSize);
+        VUNIT_ASSERT_EQUAL_LABELED(numBytesCopied, static_cast<Vs64>(kExpectedCopySize), "direct i/o file to socket copy count stops at EOF");
+        VUNIT_ASSERT_EQUAL_LABELED(inputFileStream.getIOOffset(), static_cast<Vs64>(kFileSize), "direct i/o file offset after copy");
+
+        VMemoryStream received;
+        VStream::streamCopy(serverStream, received, kExpectedCopySize);
+        const Vu8* receivedBytes = received.getBuffer();
+        bool allMatch = true;
+        for (int i = 0; i < kExpectedCopySize; ++i) {
+            allMatch = allMatch && (receivedBytes[i] == static_cast<Vu8>((kStartOffset + i) % 251));
+        }
+        VUNIT_ASSERT_TRUE_LABELED(allMatch, "direct i/o file to socket copy contents");
+    }
+
+    VUNIT_ASSERT_EQUAL_LABELED(clientSocket.numBytesWritten(), static_cast<Vs64>(kFirstCopySize + kFileSize - kStartOffset), "socket byte count includes kernel-copied bytes");
+
+    delete serverSocket;
+    (void) testFileNode.rm();
+}
@@ -42,6 +42,7 @@ class VStreamsUnit : public VUnit {
         void _testReadOnlyStream();
         void _testOverloadedStreamCopyAPIs();
         void _testStreamTailer();
+        void _testFileToSocketStreamCopy();
 };
 
 #endif /* vstreamsunit_h */
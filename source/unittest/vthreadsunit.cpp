@@ -11,6 +11,11 @@ License: MIT. See LICENSE.md in the Vault top level directory.
 #include "vthread.h"
 #include "vmutex.h"
 #include "vmutexlocker.h"
+#include "vrwmutex.h"
+#include "vthreadpool.h"
+#include "vsettings.h"
+#include "vmemorystream.h"
+#include "vtextiostream.h"
 #include "vsemaphore.h"
 #include "vexception.h"
 
@@ -79,6 +84,288 @@ void TestThreadClass::run() {
     mOwnerUnit->logStatus(info);
 }
 
+// The far side of the semaphore latency benchmark: waits for its turn, hands the turn back, and repeats.
+class TestSemaphorePingPongThread : public VThread {
+    public:
+
+        TestSemaphorePingPongThread(VMutex& mutex, VSemaphore& pingSemaphore, VSemaphore& pongSemaphore, volatile bool& isPingTurn, int numRoundTrips)
+            : VThread("TestSemaphorePingPongThread", "vault.threads.TestSemaphorePingPongThread", kDontDeleteSelfAtEnd, kCreateThreadJoinable, NULL)
+            , mMutex(mutex)
+            , mPingSemaphore(pingSemaphore)
+            , mPongSemaphore(pongSemaphore)
+            , mIsPingTurn(isPingTurn)
+            , mNumRoundTrips(numRoundTrips)
+            {}
+        virtual ~TestSemaphorePingPongThread() {}
+
+        virtual void run() {
+            for (int i = 0; i < mNumRoundTrips; ++i) {
+                VMutexLocker locker(&mMutex, "TestSemaphorePingPongThread::run");
+                VDeadline deadline(5 * VDuration::SECOND());
+                while (mIsPingTurn && ! deadline.hasExpired()) {
+                    mPingSemaphore.wait(&mMutex, deadline);
+                }
+
+                mIsPingTurn = true;
+                locker.unlock();
+                mPongSemaphore.signal();
+            }
+        }
+
+    private:
+
+        TestSemaphorePingPongThread(const TestSemaphorePingPongThread&); // not copyable
+        TestSemaphorePingPongThread& operator=(const TestSemaphorePingPongThread&); // not assignable
+
+        VMutex&         mMutex;
+        VSemaphore&     mPingSemaphore;
+        VSemaphore&     mPongSemaphore;
+        volatile bool&  mIsPingTurn;
+        int             mNumRoundTrips;
+};
+
+// Acquires a VRWMutex for reading or writing, notes that it did, and holds it until told to let go.
+class TestRWMutexLockingThread : public VThread {
+    public:
+
+        TestRWMutexLockingThread(VRWMutex& rwMutex, bool lockForWriting)
+            : VThread("TestRWMutexLockingThread", "vault.threads.TestRWMutexLockingThread", kDontDeleteSelfAtEnd, kCreateThreadJoinable, NULL)
+            , mRWMutex(rwMutex)
+            , mLockForWriting(lockForWriting)
+            , mHasLock(false)
+            , mShouldRelease(false)
+            {}
+        virtual ~TestRWMutexLockingThread() {}
+
+        virtual void run() {
+            VReadLocker readLocker(&mRWMutex, "TestRWMutexLockingThread::run", ! mLockForWriting);
+            VWriteLocker writeLocker(&mRWMutex, "TestRWMutexLockingThread::run", mLockForWriting);
+            mHasLock = true;
+
+            VDeadline deadline(5 * VDuration::SECOND());
+            while ((! mShouldRelease) && ! deadline.hasExpired()) {
+                VThread::sleep(VDuration::MILLISECOND());
+            }
+        }
+
+        bool hasLock() const { return mHasLock; }
+        void release() { mShouldRelease = true; }
+
+    private:
+
+        TestRWMutexLockingThread(const TestRWMutexLockingThread&); // not copyable
+        TestRWMutexLockingThread& operator=(const TestRWMutexLockingThread&); // not assignable
+
+        VRWMutex&       mRWMutex;
+        bool            mLockForWriting;
+        volatile bool   mHasLock;
+        volatile bool   mShouldRelease;
+};
+
+// Does lookups in a shared map under either a VMutex or a VRWMutex read lock, for the reader contention benchmark.
+typedef std::map<int, int> TestLookupMap;
+class TestMapReaderThread : public VThread {
+    public:
+
+        TestMapReaderThread(const TestLookupMap& map, VMutex* mutex, VRWMutex* rwMutex, int numLookups)
+            : VThread("TestMapReaderThread", "vault.threads.TestMapReaderThread", kDontDeleteSelfAtEnd, kCreateThreadJoinable, NULL)
+            , mMap(map)
+            , mMutex(mutex)
+            , mRWMutex(rwMutex)
+            , mNumLookups(numLookups)
+            , mNumFound(0)
+            {}
+        virtual ~TestMapReaderThread() {}
+
+        virtual void run() {
+            for (int i = 0; i < mNumLookups; ++i) {
+                VMutexLocker mutexLocker(mMutex, "TestMapReaderThread::run");
+                VReadLocker readLocker(mRWMutex, "TestMapReaderThread::run");
+                if (mMap.find(i % (int) mMap.size()) != mMap.end()) {
+                    ++mNumFound;
+                }
+            }
+        }
+
+        int getNumFound() const { return mNumFound; }
+
+    private:
+
+        TestMapReaderThread(const TestMapReaderThread&); // not copyable
+        TestMapReaderThread& operator=(const TestMapReaderThread&); // not assignable
+
+        const TestLookupMap&    mMap;
+        VMutex*                 mMutex;
+        VRWMutex*               mRWMutex;
+        int                     mNumLookups;
+        int                     mNumFound;
+};
+
+// Records what VThread::getCurrentThread() and getCurrentThreadName() return on its own thread.
+class TestCurrentThreadThread : public VThread {
+    public:
+
+        TestCurrentThreadThread()
+            : VThread("TestCurrentThreadThread", "vault.threads.TestCurrentThreadThread", kDontDeleteSelfAtEnd, kCreateThreadJoinable, NULL)
+            , mCurrentThread(NULL)
+            , mCurrentThreadName()
+            {}
+        virtual ~TestCurrentThreadThread() {}
+
+        virtual void run() {
+            mCurrentThread = VThread::getCurrentThread();
+            mCurrentThreadName = VThread::getCurrentThreadName();
+        }
+
+        VThread*    mCurrentThread;
+        VString     mCurrentThreadName;
+
+    private:
+
+        TestCurrentThreadThread(const TestCurrentThreadThread&); // not copyable
+        TestCurrentThreadThread& operator=(const TestCurrentThreadThread&); // not assignable
+};
+
+class TestThreadOptionsThread : public VThread {
+    public:
+
+        TestThreadOptionsThread(const VThreadOptions& options)
+            : VThread("TestThreadOptionsThread", "vault.threads.TestThreadOptionsThread", kDontDeleteSelfAtEnd, kCreateThreadJoinable, NULL)
+            , mRan(false)
+            , mStackSize(0)
+            , mCPU(-1)
+            , mOSThreadName()
+            {
+            this->setThreadOptions(options);
+        }
+        virtual ~TestThreadOptionsThread() {}
+
+        virtual void run() {
+            mRan = true;
+#if defined(__GLIBC__) && defined(__USE_GNU)
+            pthread_attr_t attributes;
+            if (::pthread_getattr_np(::pthread_self(), &attributes) == 0) {
+                (void) ::pthread_attr_getstacksize(&attributes, &mStackSize);
+                (void) ::pthread_attr_destroy(&attributes);
+            }
+
+            mCPU = ::sched_getcpu();
+#endif
+#if defined(VTHREAD_PTHREAD_SETNAME_SUPPORTED) && ! defined(VPLATFORM_MAC)
+            char name[16];
+            if (::pthread_getname_np(::pthread_self(), name, sizeof(name)) == 0) {
+                mOSThreadName = name;
+            }
+#endif
+        }
+
+        bool    mRan;
+        size_t  mStackSize;     // the OS-reported stack size, where supported
+        int     mCPU;           // the CPU run() ran on, where supported
+        VString mOSThreadName;  // the OS-level thread name, where supported
+
+    private:
+
+        TestThreadOptionsThread(const TestThreadOptionsThread&); // not copyable
+        TestThreadOptionsThread& operator=(const TestThreadOptionsThread&); // not assignable
+};
+
+class TestMutexHolderThread : public VThread {
+    public:
+
+        TestMutexHolderThread(VMutex& mutex, const VDuration& holdTime)
+            : VThread("TestMutexHolderThread", "vault.threads.TestMutexHolderThread", kDontDeleteSelfAtEnd, kCreateThreadJoinable, NULL)
+            , mMutex(mutex)
+            , mHoldTime(holdTime)
+            , mIsHolding(false)
+            {}
+        virtual ~TestMutexHolderThread() {}
+
+        virtual void run() {
+            VMutexLocker locker(&mMutex, "TestMutexHolderThread::run");
+            mIsHolding = true;
+            VThread::sleep(mHoldTime);
+        }
+
+        VMutex&         mMutex;
+        VDuration       mHoldTime;
+        volatile bool   mIsHolding;
+
+    private:
+
+        TestMutexHolderThread(const TestMutexHolderThread&); // not copyable
+        TestMutexHolderThread& operator=(const TestMutexHolderThread&); // not assignable
+};
+
+class TestShortCriticalSectionThread : public VThread {
+    public:
+
+        TestShortCriticalSectionThread(VMutex& mutex, int numIterations, volatile int& counter)
+            : VThread("TestShortCriticalSectionThread", "vault.threads.TestShortCriticalSectionThread", kDontDeleteSelfAtEnd, kCreateThreadJoinable, NULL)
+            , mMutex(mutex)
+            , mNumIterations(numIterations)
+            , mCounter(counter)
+            {}
+        virtual ~TestShortCriticalSectionThread() {}
+
+        virtual void run() {
+            for (int i = 0; i < mNumIterations; ++i) {
+                VMutexLocker locker(&mMutex, "TestShortCriticalSectionThread::run");
+                mCounter = mCounter + 1;
+            }
+        }
+
+    private:
+
+        TestShortCriticalSectionThread(const TestShortCriticalSectionThread&); // not copyable
+        TestShortCriticalSectionThread& operator=(const TestShortCriticalSectionThread&); // not assignable
+
+        VMutex&         mMutex;
+        int             mNumIterations;
+        volatile int&   mCounter;
+};
+
+class TestSquarePoolTask : public VThreadPoolTask {
+    public:
+
+        TestSquarePoolTask(int value)
+            : VThreadPoolTask(VSTRING_FORMAT("TestSquarePoolTask.%d", value))
+            , mValue(value)
+            , mResult(0)
+            {}
+        virtual ~TestSquarePoolTask() {}
+
+        virtual void run() {
+            if (mValue < 0) {
+                throw VStackTraceException(VSTRING_FORMAT("TestSquarePoolTask: negative value %d.", mValue));
+            }
+
+            mResult = mValue * mValue;
+        }
+
+        int mValue;
+        int mResult;
+};
+
+class TestGatePoolTask : public VThreadPoolTask {
+    public:
+
+        TestGatePoolTask()
+            : VThreadPoolTask("TestGatePoolTask")
+            , mOpen(false)
+            {}
+        virtual ~TestGatePoolTask() {}
+
+        // Occupies its pool thread until opened or cancelled.
+        virtual void run() {
+            while (! mOpen && ! this->isCancelRequested()) {
+                VThread::sleep(VDuration::MILLISECOND());
+            }
+        }
+
+        volatile bool mOpen;
+};
+
 VThreadsUnit::VThreadsUnit(bool logOnSuccess, bool throwOnError) :
     VUnit("VThreadsUnit", logOnSuccess, throwOnError) {
 }
@@ -192,5 +479,643 @@ void VThreadsUnit::run() {
         VUNIT_ASSERT_FALSE_LABELED(mutexX.isLockedByCurrentThread(), "9 - local mutex not locked by current thread");
     }
 
+    this->_testSemaphoreTimedWaits();
+    this->_runSemaphoreLatencyBenchmark();
+    this->_runMutexLockerBenchmark();
+    this->_testRWMutex();
+    this->_runRWMutexReaderBenchmark();
+    this->_testCurrentThread();
+    this->_testThreadPool();
+    this->_runThreadPoolBenchmark();
+    this->_testThreadOptions();
+    this->_testMutexContentionProfile();
+    this->_runSpinMutexBenchmark();
+}
+
+void VThreadsUnit::_testSemaphoreTimedWaits() {
+    VUNIT_ASSERT_FALSE_LABELED(VDeadline(VDuration::POSITIVE_INFINITY()).hasExpired(), "infinite deadline has not expired");
+    VUNIT_ASSERT_EQUAL_LABELED(VDeadline(VDuration::POSITIVE_INFINITY()).getRemaining(), VDuration::POSITIVE_INFINITY(), "infinite deadline remaining");
+    VUNIT_ASSERT_TRUE_LABELED(VDeadline(VDuration::ZERO()).hasExpired(), "zero deadline has expired");
+    VUNIT_ASSERT_EQUAL_LABELED(VDeadline(VDuration::ZERO()).getRemaining(), VDuration::ZERO(), "zero deadline remaining");
+    VDuration remaining = VDeadline(VDuration::SECOND()).getRemaining();
+    VUNIT_ASSERT_TRUE_LABELED((remaining > VDuration::ZERO()) && (remaining <= VDuration::SECOND()), "deadline remaining");
+
+    // An unsignaled timed wait lasts its timeout, no matter what the wall clock (here, VInstant's
+    // simulated clock) does. When the deadline was taken from VInstant, a clock set back would hang
+    // the wait, and a clock set forward would end it at once.
+    const VDuration kTimeout = VDuration::MILLISECOND() * 50;
+    const VDuration clockOffsets[3] = { VDuration::ZERO(), VDuration::MINUTE(), -1 * VDuration::MINUTE() };
+    VMutex      mutex("VThreadsUnit::_testSemaphoreTimedWaits");
+    VSemaphore  semaphore;
+    for (int i = 0; i < 3; ++i) {
+        VInstant::setSimulatedClockOffset(clockOffsets[i]);
+
+        VMutexLocker locker(&mutex, "VThreadsUnit::_testSemaphoreTimedWaits");
+        Vs64 start = VDeadline::monotonicMicroseconds();
+        semaphore.wait(&mutex, kTimeout);
+        Vs64 elapsedMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+        VUNIT_ASSERT_TRUE_LABELED((elapsedMicroseconds >= CONST_S64(45000)) && (elapsedMicroseconds < CONST_S64(1000000)),
+            VSTRING_FORMAT("50ms timed wait with clock offset %s took " VSTRING_FORMATTER_S64 "us", clockOffsets[i].getDurationString().chars(), elapsedMicroseconds));
+    }
+    VInstant::setSimulatedClockOffset(VDuration::ZERO());
+
+    /* deadline wait scope */ {
+        VMutexLocker locker(&mutex, "VThreadsUnit::_testSemaphoreTimedWaits");
+        VDeadline deadline(kTimeout);
+        while (! deadline.hasExpired()) {
+            semaphore.wait(&mutex, deadline);
+        }
+        semaphore.wait(&mutex, deadline); // already expired, so must not block
+        VUNIT_ASSERT_SUCCESS("wait on an expired deadline returned");
+    }
+}
+
+/*
+Measures how long it takes one thread to wake another through a VSemaphore and be
+woken in return: each round trip is two signal/wait hand-offs. The results are
+logged for comparison across platforms and changes, not asserted.
+*/
+void VThreadsUnit::_runSemaphoreLatencyBenchmark() {
+    const int       kNumRoundTrips = 2000;
+    VMutex          mutex("VThreadsUnit::_runSemaphoreLatencyBenchmark");
+    VSemaphore      pingSemaphore;
+    VSemaphore      pongSemaphore;
+    volatile bool   isPingTurn = true; // true while the ping-pong thread has not yet answered the current ping
+
+    TestSemaphorePingPongThread pongThread(mutex, pingSemaphore, pongSemaphore, isPingTurn, kNumRoundTrips);
+    pongThread.start();
+
+    Vs64 longestRoundTripMicroseconds = 0;
+    int numCompleted = 0;
+    Vs64 start = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < kNumRoundTrips; ++i) {
+        Vs64 roundTripStart = VDeadline::monotonicMicroseconds();
+
+        VMutexLocker locker(&mutex, "VThreadsUnit::_runSemaphoreLatencyBenchmark");
+        isPingTurn = false;
+        pingSemaphore.signal();
+
+        VDeadline deadline(5 * VDuration::SECOND());
+        while ((! isPingTurn) && ! deadline.hasExpired()) {
+            pongSemaphore.wait(&mutex, deadline);
+        }
+
+        if (! isPingTurn) {
+            break; // timed out; reported below
+        }
+
+        locker.unlock();
+        ++numCompleted;
+        longestRoundTripMicroseconds = V_MAX(longestRoundTripMicroseconds, VDeadline::monotonicMicroseconds() - roundTripStart);
+    }
+    Vs64 elapsedMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+    VThread::threadJoin(pongThread.threadID(), NULL);
+
+    VUNIT_ASSERT_EQUAL_LABELED(numCompleted, kNumRoundTrips, "semaphore ping-pong round trips completed");
+    this->logStatus(VSTRING_FORMAT("Semaphore ping-pong: %d round trips, average " VSTRING_FORMATTER_S64 "us, longest " VSTRING_FORMATTER_S64 "us.",
+        numCompleted, elapsedMicroseconds / V_MAX(1, numCompleted), longestRoundTripMicroseconds));
+}
+
+void VThreadsUnit::_runMutexLockerBenchmark() {
+    // Uncontended lock/unlock cost of a VMutexLocker with a formatted label (the old
+    // habit at many lock sites), with a literal label, with a literal label and lock
+    // delay checking turned off, and of the raw platform mutex. The first two include
+    // the delay checking clock reads if VAULT_MUTEX_LOCK_DELAY_CHECK is compiled in.
+    const int   kNumLocks = 200000;
+    VMutex      mutex("VThreadsUnit::_runMutexLockerBenchmark");
+    VString     label("benchmark");
+    int         numLocked = 0;
+
+    Vs64 start = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < kNumLocks; ++i) {
+        VMutexLocker locker(&mutex, VSTRING_FORMAT("[%s]VThreadsUnit::_runMutexLockerBenchmark", label.chars()));
+        numLocked += locker.isLocked() ? 1 : 0;
+    }
+    Vs64 formattedMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+    start = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < kNumLocks; ++i) {
+        VMutexLocker locker(&mutex, "VThreadsUnit::_runMutexLockerBenchmark");
+        numLocked += locker.isLocked() ? 1 : 0;
+    }
+    Vs64 literalMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+    VDuration savedThreshold = VMutex::getLockDelayLoggingThreshold();
+    VMutex::setLockDelayLoggingThreshold(VDuration::NEGATIVE_INFINITY());
+    start = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < kNumLocks; ++i) {
+        VMutexLocker locker(&mutex, "VThreadsUnit::_runMutexLockerBenchmark");
+        numLocked += locker.isLocked() ? 1 : 0;
+    }
+    Vs64 uncheckedMicroseconds = VDeadline::monotonicMicroseconds() - start;
+    VMutex::setLockDelayLoggingThreshold(savedThreshold);
+
+    start = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < kNumLocks; ++i) {
+        if (VMutex::mutexLock(mutex.getMutex())) {
+            ++numLocked;
+            (void) VMutex::mutexUnlock(mutex.getMutex());
+        }
+    }
+    Vs64 rawMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+    VUNIT_ASSERT_EQUAL_LABELED(numLocked, 4 * kNumLocks, "mutex benchmark locks acquired");
+    VUNIT_ASSERT_FALSE_LABELED(mutex.isLockedByCurrentThread(), "mutex benchmark mutex released");
+    this->logStatus(VSTRING_FORMAT("Mutex lock/unlock: formatted label " VSTRING_FORMATTER_S64 "ns, literal label " VSTRING_FORMATTER_S64 "ns, unchecked " VSTRING_FORMATTER_S64 "ns, raw platform mutex " VSTRING_FORMATTER_S64 "ns.",
+        (formattedMicroseconds * CONST_S64(1000)) / kNumLocks, (literalMicroseconds * CONST_S64(1000)) / kNumLocks, (uncheckedMicroseconds * CONST_S64(1000)) / kNumLocks, (rawMicroseconds * CONST_S64(1000)) / kNumLocks));
+}
+
+void VThreadsUnit::_testRWMutex() {
+    VRWMutex rwMutex("VThreadsUnit::_testRWMutex");
+
+    /* locker state scope */ {
+        VReadLocker readLocker(&rwMutex, "VThreadsUnit::_testRWMutex", false);
+        VUNIT_ASSERT_FALSE_LABELED(readLocker.isLocked(), "read locker not initially locked");
+        readLocker.lock();
+        VUNIT_ASSERT_TRUE_LABELED(readLocker.isLocked(), "read locker locked");
+        readLocker.unlock();
+        VUNIT_ASSERT_FALSE_LABELED(readLocker.isLocked(), "read locker unlocked");
+
+        VWriteLocker writeLocker(&rwMutex, "VThreadsUnit::_testRWMutex");
+        VUNIT_ASSERT_TRUE_LABELED(writeLocker.isLocked(), "write locker locked");
+        writeLocker.unlock();
+        VUNIT_ASSERT_FALSE_LABELED(writeLocker.isLocked(), "write locker unlocked");
+
+        VReadLocker nullLocker(NULL, "VThreadsUnit::_testRWMutex");
+        VUNIT_ASSERT_FALSE_LABELED(nullLocker.isLocked(), "null read locker does nothing");
+    }
+
+    // A second reader gets in while we hold a read lock.
+    /* concurrent readers scope */ {
+        VReadLocker readLocker(&rwMutex, "VThreadsUnit::_testRWMutex");
+        TestRWMutexLockingThread reader(rwMutex, false);
+        reader.start();
+
+        VDeadline deadline(5 * VDuration::SECOND());
+        while ((! reader.hasLock()) && ! deadline.hasExpired()) {
+            VThread::sleep(VDuration::MILLISECOND());
+        }
+
+        VUNIT_ASSERT_TRUE_LABELED(reader.hasLock(), "second reader acquired read lock concurrently");
+        reader.release();
+        readLocker.unlock();
+        VThread::threadJoin(reader.threadID(), NULL);
+    }
+
+    // A writer waits until we release our read lock.
+    /* writer exclusion scope */ {
+        VReadLocker readLocker(&rwMutex, "VThreadsUnit::_testRWMutex");
+        TestRWMutexLockingThread writer(rwMutex, true);
+        writer.start();
+
+        VThread::sleep(50 * VDuration::MILLISECOND());
+        VUNIT_ASSERT_FALSE_LABELED(writer.hasLock(), "writer blocked by reader");
+        readLocker.unlock();
+
+        VDeadline deadline(5 * VDuration::SECOND());
+        while ((! writer.hasLock()) && ! deadline.hasExpired()) {
+            VThread::sleep(VDuration::MILLISECOND());
+        }
+
+        VUNIT_ASSERT_TRUE_LABELED(writer.hasLock(), "writer acquired lock after reader released");
+
+        // And a reader waits until the writer releases.
+        VReadLocker laterReadLocker(&rwMutex, "VThreadsUnit::_testRWMutex", false);
+        writer.release();
+        laterReadLocker.lock();
+        VUNIT_ASSERT_TRUE_LABELED(laterReadLocker.isLocked(), "reader acquired lock after writer released");
+        laterReadLocker.unlock();
+        VThread::threadJoin(writer.threadID(), NULL);
+    }
+}
+
+/*
+Several threads doing lookups in a shared map, as every log statement does in the
+logger registry, first serialized by a VMutex and then sharing a VRWMutex read lock.
+The results are logged, not asserted, since they depend on the number of cores.
+*/
+void VThreadsUnit::_runRWMutexReaderBenchmark() {
+    const int       kNumThreads = 4;
+    const int       kNumLookups = 100000;
+    TestLookupMap   map;
+    VMutex          mutex("VThreadsUnit::_runRWMutexReaderBenchmark");
+    VRWMutex        rwMutex("VThreadsUnit::_runRWMutexReaderBenchmark");
+
+    for (int i = 0; i < 100; ++i) {
+        map[i] = i;
+    }
+
+    Vs64 elapsedMicroseconds[2];
+    for (int pass = 0; pass < 2; ++pass) {
+        std::vector<TestMapReaderThread*> readers;
+        for (int i = 0; i < kNumThreads; ++i) {
+            readers.push_back(new TestMapReaderThread(map, (pass == 0) ? &mutex : NULL, (pass == 0) ? NULL : &rwMutex, kNumLookups));
+        }
+
+        Vs64 start = VDeadline::monotonicMicroseconds();
+        for (int i = 0; i < kNumThreads; ++i) {
+            readers[i]->start();
+        }
+
+        int numFound = 0;
+        for (int i = 0; i < kNumThreads; ++i) {
+            VThread::threadJoin(readers[i]->threadID(), NULL);
+            numFound += readers[i]->getNumFound();
+            delete readers[i];
+        }
+        elapsedMicroseconds[pass] = VDeadline::monotonicMicroseconds() - start;
+
+        VUNIT_ASSERT_EQUAL_LABELED(numFound, kNumThreads * kNumLookups, "reader benchmark lookups found");
+    }
+
+    this->logStatus(VSTRING_FORMAT("Map lookups by %d threads: VMutex " VSTRING_FORMATTER_S64 "ms, VRWMutex read lock " VSTRING_FORMATTER_S64 "ms.",
+        kNumThreads, elapsedMicroseconds[0] / CONST_S64(1000), elapsedMicroseconds[1] / CONST_S64(1000)));
 }
 
+void VThreadsUnit::_testCurrentThread() {
+    TestCurrentThreadThread thread;
+    thread.start();
+    VThread::threadJoin(thread.threadID(), NULL);
+    VUNIT_ASSERT_TRUE_LABELED(thread.mCurrentThread == &thread, "getCurrentThread() on a VThread returns it");
+    VUNIT_ASSERT_EQUAL_LABELED(thread.mCurrentThreadName, VString("TestCurrentThreadThread"), "getCurrentThreadName() on a VThread returns its name");
+
+    /* foreign thread scope */ {
+        VForeignThread foreignThread("VThreadsUnit::_testCurrentThread");
+        VUNIT_ASSERT_TRUE_LABELED(VThread::getCurrentThread() == &foreignThread, "getCurrentThread() returns the VForeignThread");
+        VUNIT_ASSERT_EQUAL_LABELED(VThread::getCurrentThreadName(), VString("VThreadsUnit::_testCurrentThread"), "getCurrentThreadName() returns the VForeignThread name");
+    }
+
+    VUNIT_ASSERT_TRUE_LABELED(VThread::getCurrentThread() != NULL, "getCurrentThread() after the VForeignThread has gone");
+
+    // This lookup happens for every formatted log line; log its cost.
+    const int kNumLookups = 1000000;
+    int numFound = 0;
+    Vs64 start = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < kNumLookups; ++i) {
+        numFound += (VThread::getCurrentThread() != NULL) ? 1 : 0;
+    }
+    Vs64 elapsedMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+    VUNIT_ASSERT_EQUAL_LABELED(numFound, kNumLookups, "current thread lookups");
+    this->logStatus(VSTRING_FORMAT("VThread::getCurrentThread(): " VSTRING_FORMATTER_S64 "ns per call.", (elapsedMicroseconds * CONST_S64(1000)) / kNumLookups));
+}
+
+void VThreadsUnit::_testThreadPool() {
+    /* many tasks scope */ {
+        VThreadPool pool("TestPool", 4);
+        pool.start();
+
+        std::vector<VSharedPtr<TestSquarePoolTask> > tasks;
+        for (int i = 0; i < 100; ++i) {
+            tasks.push_back(VSharedPtr<TestSquarePoolTask>(new TestSquarePoolTask(i)));
+            VUNIT_ASSERT_TRUE_LABELED(pool.submit(tasks.back()), "submit to unbounded pool");
+        }
+
+        int numCorrect = 0;
+        for (int i = 0; i < 100; ++i) {
+            VUNIT_ASSERT_TRUE_LABELED(tasks[i]->wait(), "task wait");
+            numCorrect += ((tasks[i]->getState() == VThreadPoolTask::kCompleted) && (tasks[i]->mResult == i * i)) ? 1 : 0;
+        }
+        VUNIT_ASSERT_EQUAL_LABELED(numCorrect, 100, "tasks completed with correct results");
+
+        VSharedPtr<TestSquarePoolTask> failingTask(new TestSquarePoolTask(-1));
+        pool.submit(failingTask);
+        VUNIT_ASSERT_TRUE_LABELED(failingTask->wait(), "failing task wait");
+        VUNIT_ASSERT_TRUE_LABELED(failingTask->getState() == VThreadPoolTask::kFailed, "failing task state");
+        VUNIT_ASSERT_TRUE_LABELED(failingTask->getErrorMessage().contains("negative value -1"), "failing task error message");
+
+        VUNIT_ASSERT_EQUAL_LABELED(pool.getStats().mNumThreads, 4, "stats thread count");
+
+        // A task's waiters are woken just before the pool counts it, so let shutdown settle the counts.
+        pool.shutdown();
+        VThreadPoolStats stats = pool.getStats();
+        VUNIT_ASSERT_EQUAL_LABELED(stats.mNumThreads, 0, "no threads after shutdown");
+        VUNIT_ASSERT_EQUAL_LABELED(stats.mNumTasksSubmitted, CONST_S64(101), "stats submitted");
+        VUNIT_ASSERT_EQUAL_LABELED(stats.mNumTasksCompleted, CONST_S64(100), "stats completed");
+        VUNIT_ASSERT_EQUAL_LABELED(stats.mNumTasksFailed, CONST_S64(1), "stats failed");
+        VUNIT_ASSERT_EQUAL_LABELED(stats.mQueueDepth, 0, "stats queue depth");
+        VUNIT_ASSERT_TRUE_LABELED(stats.mUtilization >= 0.0 && stats.mUtilization <= 1.0, "stats utilization range");
+
+        VSharedPtr<TestSquarePoolTask> lateTask(new TestSquarePoolTask(2));
+        VUNIT_ASSERT_FALSE_LABELED(pool.submit(lateTask), "submit after shutdown is rejected");
+        VUNIT_ASSERT_TRUE_LABELED(lateTask->getState() == VThreadPoolTask::kCancelled, "rejected task is cancelled");
+    }
+
+    /* cancellation and bounded queue scope */ {
+        VThreadPool pool("TestBoundedPool", 1, 2);
+        pool.start();
+
+        // The gate occupies the only thread, so subsequent tasks stay queued.
+        VSharedPtr<TestGatePoolTask> gate(new TestGatePoolTask());
+        pool.submit(gate);
+        while (gate->getState() == VThreadPoolTask::kPending) {
+            VThread::sleep(VDuration::MILLISECOND());
+        }
+
+        VSharedPtr<TestSquarePoolTask> cancelledTask(new TestSquarePoolTask(3));
+        VSharedPtr<TestSquarePoolTask> queuedTask(new TestSquarePoolTask(4));
+        VSharedPtr<TestSquarePoolTask> overflowTask(new TestSquarePoolTask(5));
+        VUNIT_ASSERT_TRUE_LABELED(pool.submit(cancelledTask), "submit first queued task");
+        VUNIT_ASSERT_TRUE_LABELED(pool.submit(queuedTask), "submit second queued task");
+        VUNIT_ASSERT_FALSE_LABELED(pool.submit(overflowTask, VDuration::ZERO()), "submit to full queue without waiting is rejected");
+        VUNIT_ASSERT_FALSE_LABELED(pool.submit(overflowTask, 20 * VDuration::MILLISECOND()), "submit to full queue times out");
+        VUNIT_ASSERT_EQUAL_LABELED(pool.getStats().mNumTasksRejected, CONST_S64(2), "stats rejected");
+        VUNIT_ASSERT_EQUAL_LABELED(pool.getStats().mQueueDepth, 2, "stats queue depth while blocked");
+        VUNIT_ASSERT_EQUAL_LABELED(pool.getStats().mNumBusyThreads, 1, "stats busy threads while blocked");
+
+        VUNIT_ASSERT_TRUE_LABELED(cancelledTask->cancel(), "cancel a queued task");
+        VUNIT_ASSERT_TRUE_LABELED(cancelledTask->isDone(), "cancelled task is done");
+        VUNIT_ASSERT_FALSE_LABELED(gate->cancel() || gate->isDone(), "cancel a running task only asks it to stop");
+        VUNIT_ASSERT_TRUE_LABELED(gate->wait(), "running task stops when asked");
+
+        VUNIT_ASSERT_TRUE_LABELED(queuedTask->wait(), "queued task runs after the gate");
+        VUNIT_ASSERT_EQUAL_LABELED(queuedTask->mResult, 16, "queued task result");
+        VUNIT_ASSERT_EQUAL_LABELED(cancelledTask->mResult, 0, "cancelled task never ran");
+        pool.shutdown();
+        VUNIT_ASSERT_EQUAL_LABELED(pool.getStats().mNumTasksCancelled, CONST_S64(1), "stats cancelled");
+    }
+
+    /* shutdown cancellation scope */ {
+        VThreadPool pool("TestShutdownPool", 1);
+        pool.start();
+
+        VSharedPtr<TestGatePoolTask> gate(new TestGatePoolTask());
+        VSharedPtr<TestSquarePoolTask> queuedTask(new TestSquarePoolTask(6));
+        pool.submit(gate);
+        pool.submit(queuedTask);
+        while (gate->getState() == VThreadPoolTask::kPending) {
+            VThread::sleep(VDuration::MILLISECOND());
+        }
+
+        // The gate is never opened; shutdown(true) must ask it to stop, and cancel the queued task.
+        pool.shutdown(true);
+        VUNIT_ASSERT_TRUE_LABELED(gate->isCancelRequested() && (gate->getState() == VThreadPoolTask::kCompleted), "shutdown stops the running task");
+        VUNIT_ASSERT_TRUE_LABELED(queuedTask->getState() == VThreadPoolTask::kCancelled, "shutdown cancels the queued task");
+        VUNIT_ASSERT_EQUAL_LABELED(pool.getStats().mNumTasksCancelled, CONST_S64(1), "stats cancelled by shutdown");
+    }
+
+    /* never started scope */ {
+        VSharedPtr<TestSquarePoolTask> task(new TestSquarePoolTask(7));
+        /* pool scope */ {
+            VThreadPool pool("TestUnstartedPool", 1);
+            pool.submit(task);
+        }
+        VUNIT_ASSERT_TRUE_LABELED(task->getState() == VThreadPoolTask::kCancelled, "task queued on a pool that never started is cancelled");
+    }
+}
+
+void VThreadsUnit::_runThreadPoolBenchmark() {
+    // Compare running short tasks on a pool against creating a thread for each.
+    const int kNumTasks = 2000;
+
+    Vs64 start = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < kNumTasks; ++i) {
+        TestCurrentThreadThread thread;
+        thread.start();
+        VThread::threadJoin(thread.threadID(), NULL);
+    }
+    Vs64 threadMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+    VThreadPool pool("BenchmarkPool", 4);
+    pool.start();
+    std::vector<VThreadPoolTaskPtr> tasks;
+    start = VDeadline::monotonicMicroseconds();
+    for (int i = 0; i < kNumTasks; ++i) {
+        tasks.push_back(VThreadPoolTaskPtr(new TestSquarePoolTask(i)));
+        pool.submit(tasks.back());
+    }
+    for (int i = 0; i < kNumTasks; ++i) {
+        tasks[i]->wait();
+    }
+    Vs64 poolMicroseconds = VDeadline::monotonicMicroseconds() - start;
+
+    pool.shutdown();
+    VThreadPoolStats stats = pool.getStats();
+    VUNIT_ASSERT_EQUAL_LABELED(stats.mNumTasksCompleted, (Vs64) kNumTasks, "benchmark tasks completed");
+    this->logStatus(VSTRING_FORMAT("%d tasks: thread per task " VSTRING_FORMATTER_S64 "ms, VThreadPool " VSTRING_FORMATTER_S64 "ms (average queue delay " VSTRING_FORMATTER_S64 "us, max queue depth %d).",
+        kNumTasks, threadMicroseconds / CONST_S64(1000), poolMicroseconds / CONST_S64(1000), stats.getAverageQueueMicroseconds(), stats.mMaxQueueDepthSeen));
+}
+
+void VThreadsUnit::_testThreadOptions() {
+    VUNIT_ASSERT_EQUAL_LABELED((int) VThreadOptions::DEFAULT().mStackSize, 0, "default stack size");
+    VUNIT_ASSERT_TRUE_LABELED(VThreadOptions::DEFAULT().mSchedulingPolicy == VThreadOptions::kDefaultPolicy, "default scheduling policy");
+
+    /* settings scope */ {
+        VString settingsText("<socket-threads stack-size=\"262144\" cpu-affinity-mask=\"3\" scheduling-policy=\"round-robin\" scheduling-priority=\"5\" />");
+        VMemoryStream buf;
+        VTextIOStream io(buf);
+        io.writeString(settingsText);
+        io.seek0();
+        VSettings settings(io);
+        VThreadOptions options(*(settings.findNode("socket-threads")));
+        VUNIT_ASSERT_EQUAL_LABELED((int) options.mStackSize, 262144, "settings stack size");
+        VUNIT_ASSERT_TRUE_LABELED(options.mCPUAffinityMask == CONST_U64(3), "settings affinity mask");
+        VUNIT_ASSERT_TRUE_LABELED(options.mSchedulingPolicy == VThreadOptions::kRoundRobinPolicy, "settings scheduling policy");
+        VUNIT_ASSERT_EQUAL_LABELED(options.mSchedulingPriority, 5, "settings scheduling priority");
+    }
+
+    /* bad settings scope */ {
+        VString settingsText("<socket-threads scheduling-policy=\"no-such-policy\" />");
+        VMemoryStream buf;
+        VTextIOStream io(buf);
+        io.writeString(settingsText);
+        io.seek0();
+        VSettings settings(io);
+        try {
+            VThreadOptions options(*(settings.findNode("socket-threads")));
+            VUNIT_ASSERT_FAILURE("unknown scheduling policy did not throw");
+        } catch (const VRangeException& /*ex*/) {
+            VUNIT_ASSERT_SUCCESS("unknown scheduling policy threw");
+        }
+    }
+
+    /* applied options scope */ {
+        // Pin to a CPU we are allowed to run on. CPU 0 may be outside a restricted cpuset (e.g., in a container).
+        int allowedCPU = 0;
+#if defined(__GLIBC__) && defined(__USE_GNU)
+        allowedCPU = -1;
+        cpu_set_t allowedCPUs;
+        CPU_ZERO(&allowedCPUs);
+        if (::sched_getaffinity(0, sizeof(allowedCPUs), &allowedCPUs) == 0) {
+            for (int cpu = 0; (cpu < 64) && (allowedCPU == -1); ++cpu) { // mCPUAffinityMask has 64 bits
+                if (CPU_ISSET(cpu, &allowedCPUs)) {
+                    allowedCPU = cpu;
+                }
+            }
+        }
+#endif
+
+        VThreadOptions options;
+        options.mStackSize = 256 * 1024;
+        options.mCPUAffinityMask = (allowedCPU == -1) ? 0 : (CONST_U64(1) << allowedCPU);
+        options.mSchedulingPolicy = VThreadOptions::kTimeSharingPolicy;
+        TestThreadOptionsThread thread(options);
+        thread.start();
+        VThread::threadJoin(thread.threadID(), NULL);
+        VUNIT_ASSERT_TRUE_LABELED(thread.mRan, "thread with options ran");
+#if defined(__GLIBC__) && defined(__USE_GNU)
+        VUNIT_ASSERT_EQUAL_LABELED((int) thread.mStackSize, 256 * 1024, "thread stack size applied");
+        if (allowedCPU != -1) {
+            VUNIT_ASSERT_EQUAL_LABELED(thread.mCPU, allowedCPU, "thread affinity applied");
+        }
+#endif
+#if defined(VTHREAD_PTHREAD_SETNAME_SUPPORTED) && ! defined(VPLATFORM_MAC)
+        VUNIT_ASSERT_EQUAL_LABELED(thread.mOSThreadName, VString("TestThreadOptio"), "OS thread name set and truncated");
+#endif
+    }
+
+    /* real-time scope */ {
+        // Without privileges this falls back to the default policy; either way the thread must run.
+        VThreadOptions options;
+        options.mSchedulingPolicy = VThreadOptions::kFIFOPolicy;
+        options.mSchedulingPriority = 1;
+        TestThreadOptionsThread thread(options);
+        thread.start();
+        VThread::threadJoin(thread.threadID(), NULL);
+        VUNIT_ASSERT_TRUE_LABELED(thread.mRan, "thread with real-time policy ran");
+    }
+}
+
+void VThreadsUnit::_testMutexContentionProfile() {
+    VMutex::resetContentionProfile();
+    VMutex::setContentionProfilingEnabled(true);
+
+    VMutex mutex("VThreadsUnit.contention");
+    for (int i = 0; i < 10; ++i) {
+        VMutexLocker locker(&mutex, "VThreadsUnit::_testMutexContentionProfile");
+    }
+
+    VMutexContentionStats stats = VMutex::getContentionProfile()["VThreadsUnit.contention"];
+    VUNIT_ASSERT_EQUAL_LABELED(stats.mNumAcquisitions, CONST_S64(10), "uncontended acquisitions");
+    VUNIT_ASSERT_EQUAL_LABELED(stats.mNumContendedAcquisitions, CONST_S64(0), "uncontended acquisitions did not wait");
+
+    /* contended scope */ {
+        TestMutexHolderThread holder(mutex, 30 * VDuration::MILLISECOND());
+        holder.start();
+        while (! holder.mIsHolding) {
+            VThread::sleep(VDuration::MILLISECOND());
+        }
+
+        /* locker scope */ {
+            VMutexLocker locker(&mutex, "VThreadsUnit::_testMutexContentionProfile");
+        }
+
+        VThread::threadJoin(holder.threadID(), NULL);
+    }
+
+    stats = VMutex::getContentionProfile()["VThreadsUnit.contention"];
+    VUNIT_ASSERT_EQUAL_LABELED(stats.mNumAcquisitions, CONST_S64(12), "acquisitions including contended one");
+    VUNIT_ASSERT_EQUAL_LABELED(stats.mNumContendedAcquisitions, CONST_S64(1), "contended acquisitions");
+    VUNIT_ASSERT_TRUE_LABELED(stats.mMaxWaitMicroseconds >= CONST_S64(10000), VSTRING_FORMAT("max wait " VSTRING_FORMATTER_S64 "us", stats.mMaxWaitMicroseconds));
+    VUNIT_ASSERT_TRUE_LABELED(stats.mMaxHoldMicroseconds >= CONST_S64(10000), VSTRING_FORMAT("max hold " VSTRING_FORMATTER_S64 "us", stats.mMaxHoldMicroseconds));
+
+    /* semaphore scope */ {
+        // Waiting on a semaphore releases the mutex, so it must not count as holding it.
+        VMutex      semaphoreMutex("VThreadsUnit.contention.semaphore");
+        VSemaphore  semaphore;
+        VMutexLocker locker(&semaphoreMutex, "VThreadsUnit::_testMutexContentionProfile");
+        semaphore.wait(&semaphoreMutex, 30 * VDuration::MILLISECOND());
+        locker.unlock();
+
+        stats = VMutex::getContentionProfile()["VThreadsUnit.contention.semaphore"];
+        VUNIT_ASSERT_TRUE_LABELED(stats.mTotalHoldMicroseconds < CONST_S64(20000), VSTRING_FORMAT("hold excluding semaphore wait " VSTRING_FORMATTER_S64 "us", stats.mTotalHoldMicroseconds));
+    }
+
+    /* retired scope */ {
+        VMutex shortLivedMutex("VThreadsUnit.contention.retired");
+        for (int i = 0; i < 3; ++i) {
+            VMutexLocker locker(&shortLivedMutex, "VThreadsUnit::_testMutexContentionProfile");
+        }
+    }
+
+    VUNIT_ASSERT_EQUAL_LABELED(VMutex::getContentionProfile()["VThreadsUnit.contention.retired"].mNumAcquisitions, CONST_S64(3), "destroyed mutex counts are kept");
+    VUNIT_ASSERT_TRUE_LABELED(VMutex::commandGetContentionInfoString().contains("VThreadsUnit.contention.retired"), "contention info lists mutex");
+
+    VMutex::setContentionProfilingEnabled(false);
+    /* locker scope */ {
+        VMutexLocker locker(&mutex, "VThreadsUnit::_testMutexContentionProfile");
+    }
+    VUNIT_ASSERT_EQUAL_LABELED(VMutex::getContentionProfile()["VThreadsUnit.contention"].mNumAcquisitions, CONST_S64(12), "no counting while disabled");
+
+    VMutex::resetContentionProfile();
+    VMutexContentionMap profile = VMutex::getContentionProfile();
+    VUNIT_ASSERT_TRUE_LABELED(profile.find("VThreadsUnit.contention") == profile.end(), "reset discards live mutex counts");
+    VUNIT_ASSERT_TRUE_LABELED(profile.find("VThreadsUnit.contention.retired") == profile.end(), "reset discards destroyed mutex counts");
+
+    // Log the uncontended cost of profiling.
+    const int kNumLocks = 200000;
+    Vs64 elapsedMicroseconds[2];
+    for (int pass = 0; pass < 2; ++pass) {
+        VMutex::setContentionProfilingEnabled(pass == 1);
+        Vs64 start = VDeadline::monotonicMicroseconds();
+        for (int i = 0; i < kNumLocks; ++i) {
+            VMutexLocker locker(&mutex, "VThreadsUnit::_testMutexContentionProfile");
+        }
+        elapsedMicroseconds[pass] = VDeadline::monotonicMicroseconds() - start;
+    }
+
+    VMutex::setContentionProfilingEnabled(false);
+    VMutex::resetContentionProfile();
+    this->logStatus(VSTRING_FORMAT("VMutexLocker lock/unlock: " VSTRING_FORMATTER_S64 "ns unprofiled, " VSTRING_FORMATTER_S64 "ns with contention profiling.",
+        (elapsedMicroseconds[0] * CONST_S64(1000)) / kNumLocks, (elapsedMicroseconds[1] * CONST_S64(1000)) / kNumLocks));
+}
+
+void VThreadsUnit::_runSpinMutexBenchmark() {
+    // Many threads hammering one mutex around a trivial critical section, the case
+    // kSpinThenBlock is for. Compare plain and spinning VMutex as the thread count grows.
+    // (On a single-processor machine spinning is disabled, so the two should match.)
+    const int kTotalIterations = 256000;
+
+    /* forced spinning scope */ {
+        // Exercise the spin path even on a single-processor machine, where the constructor turns it off.
+        VMutex mutex("VThreadsUnit::_runSpinMutexBenchmark", false, VMutex::kSpinThenBlock);
+        mutex.mSpinBeforeBlocking = true;
+        volatile int counter = 0;
+        std::vector<TestShortCriticalSectionThread*> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.push_back(new TestShortCriticalSectionThread(mutex, 20000, counter));
+            threads.back()->start();
+        }
+
+        for (int i = 0; i < 4; ++i) {
+            VThread::threadJoin(threads[i]->threadID(), NULL);
+            delete threads[i];
+        }
+
+        VUNIT_ASSERT_EQUAL_LABELED((int) counter, 80000, "forced spinning mutex excluded correctly");
+        VUNIT_ASSERT_TRUE_LABELED((mutex.mSpinEstimate >= 0) && (mutex.mSpinEstimate <= VMutex::kMaxAdaptiveSpins), "spin estimate stays in range");
+    }
+
+    this->logStatus(VSTRING_FORMAT("Short critical section benchmark, %d lock/unlock pairs, %d processors:", kTotalIterations, VThread::getNumberOfProcessors()));
+
+    for (int numThreads = 2; numThreads <= 64; numThreads *= 2) {
+        Vs64 elapsedMicroseconds[2];
+        for (int pass = 0; pass < 2; ++pass) {
+            VMutex mutex("VThreadsUnit::_runSpinMutexBenchmark", false, (pass == 0) ? VMutex::kBlockImmediately : VMutex::kSpinThenBlock);
+            volatile int counter = 0;
+
+            std::vector<TestShortCriticalSectionThread*> threads;
+            for (int i = 0; i < numThreads; ++i) {
+                threads.push_back(new TestShortCriticalSectionThread(mutex, kTotalIterations / numThreads, counter));
+            }
+
+            Vs64 start = VDeadline::monotonicMicroseconds();
+            for (int i = 0; i < numThreads; ++i) {
+                threads[i]->start();
+            }
+
+            for (int i = 0; i < numThreads; ++i) {
+                VThread::threadJoin(threads[i]->threadID(), NULL);
+                delete threads[i];
+            }
+            elapsedMicroseconds[pass] = VDeadline::monotonicMicroseconds() - start;
+
+            VUNIT_ASSERT_EQUAL_LABELED((int) counter, kTotalIterations, VSTRING_FORMAT("%s mutex with %d threads excluded correctly", (pass == 0) ? "plain" : "spinning", numThreads));
+        }
+
+        this->logStatus(VSTRING_FORMAT("  %2d threads: VMutex " VSTRING_FORMATTER_S64 "ms, kSpinThenBlock VMutex " VSTRING_FORMATTER_S64 "ms.",
+            numThreads, elapsedMicroseconds[0] / CONST_S64(1000), elapsedMicroseconds[1] / CONST_S64(1000)));
+    }
+}
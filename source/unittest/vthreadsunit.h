@@ -35,6 +35,20 @@ class VThreadsUnit : public VUnit {
         virtual void run();
 
         friend class TestThreadClass; // Our test uses this thread class and it needs to log status to unit test output.
+
+    private:
+
+        void _testSemaphoreTimedWaits();
+        void _runSemaphoreLatencyBenchmark();
+        void _runMutexLockerBenchmark();
+        void _testRWMutex();
+        void _runRWMutexReaderBenchmark();
+        void _testCurrentThread();
+        void _testThreadPool();
+        void _runThreadPoolBenchmark();
+        void _testThreadOptions();
+        void _testMutexContentionProfile();
+        void _runSpinMutexBenchmark();
 };
 
 #endif /* vthreadsunit_h */
@@ -131,4 +131,9 @@ own portable versions.
     #define V_EFFICIENT_SPRINTF
 #endif
 
+// glibc 2.12 added pthread_setname_np(), which unlike the Mac OS X version takes the thread to name.
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 12)))
+    #define VTHREAD_PTHREAD_SETNAME_SUPPORTED
+#endif
+
 #endif /* vtypes_platform_h */
@@ -64,6 +64,7 @@ typedef signed long ssize_t; // used by i/o APIs defined below
 
 #define SHUT_RD SD_RECEIVE
 #define SHUT_WR SD_SEND
+#define SHUT_RDWR SD_BOTH
 
 #ifdef VCOMPILER_MSVC
     typedef int mode_t;
@@ -74,6 +74,7 @@ bool VSystemError::_isLikePosixError(int posixErrorCode) const {
         case EINTR: return mErrorCode == WSAEINTR; break;
         case EBADF: return mErrorCode == WSAEBADF; break;
         case EPIPE: return false; break; // no such thing on Winsock
+        case EMSGSIZE: return mErrorCode == WSAEMSGSIZE; break;
         default: break;
     }
 
@@ -209,6 +209,32 @@ set up for this platform build.
     #define VCOMPILER_CLANG
 #endif
 
+/*
+V_THREAD_LOCAL declares a variable with one instance per thread. Use it only for
+plain data such as pointers and integers: the compiler-specific forms we use do not
+support constructors or destructors, but they are cheaper than C++11 thread_local.
+*/
+#ifdef VCOMPILER_MSVC
+    #define V_THREAD_LOCAL __declspec(thread)
+#else
+    #define V_THREAD_LOCAL __thread
+#endif
+
+/*
+V_CPU_PAUSE() tells the processor that the caller is in a spin-wait loop, which
+saves power and avoids a pipeline flush when the awaited value changes. It is a
+no-op on processors without such a hint.
+*/
+#if defined(VCOMPILER_MSVC)
+    #define V_CPU_PAUSE() YieldProcessor()
+#elif defined(__i386__) || defined(__x86_64__)
+    #define V_CPU_PAUSE() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+    #define V_CPU_PAUSE() __asm__ __volatile__("yield")
+#else
+    #define V_CPU_PAUSE() do {} while (false)
+#endif
+
 #include <memory> // C++11 shared_ptr
 #include <vector>
 #include <stdarg.h>